@@ -0,0 +1,66 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// binary image file written by link -i, loaded by raspictl in place of the hex file
+// everything is little endian
+// includer provides uint16_t and uint32_t
+
+#ifndef _HODEIMAGE_H
+#define _HODEIMAGE_H
+
+#define HIMG_MAGIC "HODEIMG1"
+#define HIMG_MEMOFFS 4096       // memory image starts on a page boundary so it can be mapped directly
+#define HIMG_MEMALIN 4096       // ...and is padded out to a whole number of pages
+#define HIMG_ABS 0xFFFF         // HImgSym.psect for absolute symbol
+
+typedef struct HImgHdr HImgHdr;
+typedef struct HImgPSect HImgPSect;
+typedef struct HImgSym HImgSym;
+
+struct HImgHdr {            // at beginning of file
+    char magic[8];          // HIMG_MAGIC
+    uint16_t entry;         // address of __boot
+    uint16_t rosize;        // address of __endro, writes below are errors (0 if none)
+    uint16_t stklim;        // address of __endrw, stack must stay at or above once set up (0 if none)
+    uint16_t npsects;       // number of HImgPSect entries at psectoffs
+    uint32_t nsymbols;      // number of HImgSym entries at symoffs, sorted by value
+    uint32_t memoffs;       // file offset of memory image (HIMG_MEMOFFS)
+    uint32_t memsize;       // size of memory image starting at address 0 (multiple of HIMG_MEMALIN)
+    uint32_t psectoffs;     // file offset of HImgPSect array
+    uint32_t symoffs;       // file offset of HImgSym array
+    uint32_t stroffs;       // file offset of null-terminated names
+    uint32_t strsize;       // size of names
+};
+
+struct HImgPSect {          // psect, sorted by base address
+    uint32_t name;          // offset of name within names
+    uint16_t base;          // absolute start address
+    uint16_t size;          // size in bytes
+    uint16_t alin;          // alignment in bytes
+    uint16_t pflg;          // PF_... flags
+};
+
+struct HImgSym {            // global symbol
+    uint32_t name;          // offset of name within names
+    uint16_t value;         // absolute value
+    uint16_t psect;         // index in psect array or HIMG_ABS
+};
+
+#endif
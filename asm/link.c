@@ -19,7 +19,8 @@
 //    http://www.gnu.org/licenses/gpl-2.0.html
 
 // link a bunch of assembler output files to create runnable hex file
-//  ./link.x86_64 -o <hexfile> <asmoutfile> ... > <mapfile>
+//  ./link.x86_64 [-i <imgfile>] -o <hexfile> <asmoutfile> ... > <mapfile>
+//      -i : also write binary image with memory, psects, symbols (see hodeimage.h)
 
 #include <assert.h>
 #include <stdint.h>
@@ -28,9 +29,12 @@
 #include <string.h>
 #include <unistd.h>
 
+#include "hodeimage.h"
 #include "pflags.h"
 
 #define bootsymname "__boot"    // defined in bootpage.asm
+#define endrosymname "__endro"  // defined in endtags.asm
+#define endrwsymname "__endrw"
 
 typedef struct Objfile Objfile;
 typedef struct PSect PSect;
@@ -76,6 +80,8 @@ static PSect *allpsects;    // combined psects
                             // - size is totals from all object files
                             // - base is absolute starting address of psect in output file
 static Symbol *allsymbols;  // as gathered from all input files
+static uint32_t memtop;     // pass 3: end of highest address loaded
+static uint8_t memimage[0x10000];   // pass 3: memory contents
 
 static void dolinkerpass ();
 static void processobjline (Objfile *objfile, char *objline);
@@ -85,6 +91,9 @@ static int sortpsect (void const *a, void const *b);
 static int sortsymbyname (void const *a, void const *b);
 static int sortsymbyaddr (void const *a, void const *b);
 static uint16_t getsymval (Symbol const *symbol);
+static uint16_t findsymval (char const *name);
+static void loadmemimage (uint16_t address, uint16_t size, uint16_t value, char const *hex);
+static int writeimage (char const *imgname, PSect **psectarray, int npsects, Symbol **symbyaddr, int nsymbols);
 
 int main (int argc, char **argv)
 {
@@ -95,6 +104,7 @@ int main (int argc, char **argv)
     Symbol *symbol;
 
     Objfile **lobjfile, *objfile;
+    char const *imgname = NULL;
     char const *outname = NULL;
 
     lobjfile = &objfiles;
@@ -105,6 +115,10 @@ int main (int argc, char **argv)
             ifrefd = 1;
             continue;
         }
+        if (strcasecmp (argv[i], "-i") == 0) {
+            imgname = argv[++i];
+            continue;
+        }
         if (strcasecmp (argv[i], "-o") == 0) {
             outname = argv[++i];
             continue;
@@ -270,10 +284,15 @@ foundbootsym:;
     fclose (outfile);
     if (error) unlink (outname);
 
+    // write binary image from what pass 3 loaded
+    if (! error && (imgname != NULL)) {
+        error = writeimage (imgname, psectarray, npsects, symbyaddr, nsymbols);
+    }
+
     return error;
 
 usage:
-    fprintf (stderr, "usage: link -o <outfile> <objfile> ...\n");
+    fprintf (stderr, "usage: link [-i <imgfile>] -o <outfile> <objfile> ...\n");
     return 1;
 }
 
@@ -417,10 +436,12 @@ static void processobjline (Objfile *objfile, char *objline)
                     if (passno == 3) {
                         if (objpsect != NULL) value += objpsect->base + objpsect->allpsect->base;
                         fprintf (outfile, "%02X%02X\n", value & 0xFF, value >> 8);
+                        loadmemimage (address, 2, value, NULL);
                     }
                 } else {
                     if (passno == 3) {
                         fprintf (outfile, "%s", p);
+                        loadmemimage (address, strspn (p, "0123456789ABCDEF") / 2, 0, p);
                     }
                 }
             }
@@ -539,3 +560,122 @@ static uint16_t getsymval (Symbol const *symbol)
     if (symbol->objpsect != NULL) v += symbol->objpsect->base + symbol->objpsect->allpsect->base;
     return v;
 }
+
+// get value of symbol from an included object file, 0 if not found
+static uint16_t findsymval (char const *name)
+{
+    Symbol *symbol;
+
+    for (symbol = allsymbols; symbol != NULL; symbol = symbol->next) {
+        if (! symbol->defobjfile->ifrefd && (strcmp (symbol->name, name) == 0)) return getsymval (symbol);
+    }
+    return 0;
+}
+
+// save data being written to hex file for the binary image
+//  input:
+//   address = where the data goes
+//   size = number of bytes
+//   value = little endian word when hex is NULL
+//   hex = string of hex byte pairs
+static void loadmemimage (uint16_t address, uint16_t size, uint16_t value, char const *hex)
+{
+    uint16_t i;
+
+    for (i = 0; i < size; i ++) {
+        uint32_t addr = address + i;
+        if (addr > 0xFFFF) {
+            fprintf (stderr, "data at %04X+%u overflows memory\n", address, i);
+            error = 1;
+            return;
+        }
+        if (hex == NULL) {
+            memimage[addr] = value >> (i * 8);
+        } else {
+            char pair[3] = { hex[i*2], hex[i*2+1], 0 };
+            memimage[addr] = strtoul (pair, NULL, 16);
+        }
+        if (memtop <= addr) memtop = addr + 1;
+    }
+}
+
+// write binary image file
+//  header, padding up to HIMG_MEMOFFS, memory image, psects, symbols, names
+// written to a temp file then renamed so raspictl runs that have the old one mapped don't crash
+static int writeimage (char const *imgname, PSect **psectarray, int npsects, Symbol **symbyaddr, int nsymbols)
+{
+    HImgHdr hdr;
+    int i;
+    uint32_t strsize;
+
+    memset (&hdr, 0, sizeof hdr);
+    memcpy (hdr.magic, HIMG_MAGIC, sizeof hdr.magic);
+    hdr.entry     = findsymval (bootsymname);
+    hdr.rosize    = findsymval (endrosymname);
+    hdr.stklim    = findsymval (endrwsymname);
+    hdr.npsects   = npsects;
+    hdr.nsymbols  = nsymbols;
+    hdr.memoffs   = HIMG_MEMOFFS;
+    hdr.memsize   = (memtop + HIMG_MEMALIN - 1) & - HIMG_MEMALIN;
+    hdr.psectoffs = hdr.memoffs + hdr.memsize;
+    hdr.symoffs   = hdr.psectoffs + npsects * sizeof (HImgPSect);
+    hdr.stroffs   = hdr.symoffs + nsymbols * sizeof (HImgSym);
+
+    // names are psect names then symbol names
+    HImgPSect *psects = calloc (npsects + 1, sizeof *psects);
+    HImgSym *syms = calloc (nsymbols + 1, sizeof *syms);
+    strsize = 0;
+    for (i = 0; i < npsects; i ++) {
+        PSect *allpsect = psectarray[i];
+        psects[i].name = strsize;
+        psects[i].base = allpsect->base;
+        psects[i].size = allpsect->size;
+        psects[i].alin = allpsect->alin;
+        psects[i].pflg = allpsect->pflg;
+        if ((allpsect->size != 0) && (allpsect->base + allpsect->size <= hdr.rosize)) psects[i].pflg |= PF_RO;
+        strsize += strlen (allpsect->name) + 1;
+    }
+    for (i = 0; i < nsymbols; i ++) {
+        Symbol *symbol = symbyaddr[i];
+        syms[i].name  = strsize;
+        syms[i].value = getsymval (symbol);
+        syms[i].psect = HIMG_ABS;
+        if (symbol->objpsect != NULL) {
+            int j;
+            for (j = 0; j < npsects; j ++) {
+                if (psectarray[j] == symbol->objpsect->allpsect) syms[i].psect = j;
+            }
+        }
+        strsize += strlen (symbol->name) + 1;
+    }
+    hdr.strsize = strsize;
+
+    char *tmpname = malloc (strlen (imgname) + 5);
+    sprintf (tmpname, "%s.tmp", imgname);
+    FILE *imgfile = fopen (tmpname, "w");
+    if (imgfile == NULL) {
+        fprintf (stderr, "error creating %s: %m\n", tmpname);
+        return 1;
+    }
+    fwrite (&hdr, sizeof hdr, 1, imgfile);
+    for (i = sizeof hdr; i < HIMG_MEMOFFS; i ++) putc (0, imgfile);
+    fwrite (memimage, hdr.memsize, 1, imgfile);
+    fwrite (psects, sizeof *psects, npsects, imgfile);
+    fwrite (syms, sizeof *syms, nsymbols, imgfile);
+    for (i = 0; i < npsects; i ++) fwrite (psectarray[i]->name, strlen (psectarray[i]->name) + 1, 1, imgfile);
+    for (i = 0; i < nsymbols; i ++) fwrite (symbyaddr[i]->name, strlen (symbyaddr[i]->name) + 1, 1, imgfile);
+    free (psects);
+    free (syms);
+    if (fclose (imgfile) != 0) {
+        fprintf (stderr, "error writing %s: %m\n", tmpname);
+        unlink (tmpname);
+        return 1;
+    }
+    if (rename (tmpname, imgname) < 0) {
+        fprintf (stderr, "error renaming %s to %s: %m\n", tmpname, imgname);
+        unlink (tmpname);
+        return 1;
+    }
+    free (tmpname);
+    return 0;
+}
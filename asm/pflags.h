@@ -18,4 +18,5 @@
 //
 //    http://www.gnu.org/licenses/gpl-2.0.html
 
-#define PF_OVR 1
+#define PF_OVR 1        // overlay, each object file's contribution starts at psect base
+#define PF_RO  2        // link -i image only: psect is below __endro so is read-only
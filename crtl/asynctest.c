@@ -0,0 +1,68 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// copy stdin to stdout with aread() and awrite()
+// ...counting how many times it loops while waiting for each read
+//  ./raspictl -nohw asynctest.hex < infile > outfile
+
+#include <errno.h>
+#include <stdio.h>
+#include <unistd.h>
+
+int main (int argc, char **argv)
+{
+    char buf0[256], buf1[256];
+    int wtag = -1;
+    for (int i = 0;; i ^= 1) {
+
+        // start reading into one buffer while other buffer is still being written
+        char *buf = (i == 0) ? buf0 : buf1;
+        int rtag = aread (0, buf, sizeof buf0);
+        if (rtag < 0) {
+            fprintf (stderr, "aread error %d\n", errno);
+            return 1;
+        }
+
+        // do something useful while waiting for read to complete
+        __uint32_t spins = 0;
+        int rc;
+        while ((rc = await (rtag, 0)) < 0) {
+            if (errno != EAGAIN) {
+                fprintf (stderr, "aread error %d\n", errno);
+                return 1;
+            }
+            spins ++;
+        }
+        fprintf (stderr, "read %d bytes after %u spins\n", rc, spins);
+
+        // previous write must be done before starting another
+        if ((wtag >= 0) && (await (wtag, 1) < 0)) {
+            fprintf (stderr, "awrite error %d\n", errno);
+            return 1;
+        }
+        if (rc == 0) break;
+        wtag = awrite (1, buf, rc);
+        if (wtag < 0) {
+            fprintf (stderr, "awrite error %d\n", errno);
+            return 1;
+        }
+    }
+    return 0;
+}
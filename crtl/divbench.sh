@@ -0,0 +1,33 @@
+#!/bin/bash
+#
+#  Compare cycle counts of divtest.hex using the raspi long/quad
+#  arithmetic (RASPILONGS = 1) with the software versions (RASPILONGS = 0)
+#
+#   ./divbench.sh [<dividend> <divisor> [<number of repeats>]]
+#
+cd `dirname $0`
+dividend=${1:-4000000000}
+divisor=${2:-65537}
+nreps=${3:-1000}
+unamem=`uname -m`
+make -C library > /dev/null || exit
+make divtest.hex > /dev/null || exit
+
+#  build software version of library in a scratch directory
+#  all but the long/quad arithmetic objects are re-used as is
+tmpdir=`mktemp -d`
+trap "rm -rf $tmpdir" EXIT
+cp library/*.asm library/*.hode.o library/makefile $tmpdir/
+sed -i 's/^\tRASPILONGS = 1/\tRASPILONGS = 0/' $tmpdir/magicdefs.asm
+touch $tmpdir/*.asm
+make -C $tmpdir ASM=`pwd`/../asm/assemble.$unamem AR=`pwd`/../asm/archive.$unamem crtl.hode.a > /dev/null || exit
+../asm/link.$unamem -o $tmpdir/divtest.hex divtest.hode.o $tmpdir/crtl.hode.a > $tmpdir/divtest.map || exit
+
+#  run the given hex file, print its output and cycle count
+function runbench {
+    ../driver/raspictl.$unamem -nohw $1 $dividend $divisor $nreps 2>&1 | sed 's/^/    /'
+}
+
+echo "divtest $dividend $divisor x $nreps"
+echo "  raspi long/quad arithmetic" ; runbench divtest.hex
+echo "  software long/quad arithmetic" ; runbench $tmpdir/divtest.hex
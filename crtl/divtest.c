@@ -15,5 +15,26 @@ int main (int argc, char **argv)
     int q = a / b;
     int r = a % b;
     printf ("%5d / %5d = %5d r %5d => %5d\n", a, b, q, r, q * b + r);
+
+    // same thing unsigned long and quad, like timestamp math on getnowns() values
+    // optional third arg repeats them so divbench.sh can compare library cycle counts
+    int n = (argc > 3) ? strtol (argv[3], NULL, 0) : 1;
+    unsigned long la = strtoul (argv[1], NULL, 0);
+    unsigned long lb = strtoul (argv[2], NULL, 0);
+    __uint64_t qa = la;
+    __uint64_t qb = lb;
+    qa <<= 24;
+    unsigned long lq, lr, lc;
+    __uint64_t qq, qr;
+    for (int i = 0; i < n; i ++) {
+        lq = la / lb;
+        lr = la % lb;
+        lc = lq * lb + lr;
+        qq = qa / qb;
+        qr = qa % qb;
+        if (qr >= qb) printf ("remainder %llu too big\n", qr);
+    }
+    printf ("%10lu / %10lu = %10lu r %10lu => %10lu\n", la, lb, lq, lr, lc);
+    printf ("%10lu << 24 / %10lu = %llu r %llu => %lu\n", la, lb, qq, qr, (unsigned long) (qq >> 24));
     return 0;
 }
@@ -53,4 +53,22 @@ __ssize_t read (int fd, void *buf, __ssize_t len);
 __ssize_t write (int fd, void const *buf, __ssize_t len);
 int unlink (char const *path);
 
+// start read() or write() in background, returns tag or -1
+// processor interrupt is requested when it completes (see IRQ_ASYNCIO in magicdefs.asm)
+int aread (int fd, void *buf, __ssize_t len);
+int awrite (int fd, void const *buf, __ssize_t len);
+
+// get aread() or awrite() result, returns -1 errno EAGAIN if not done and not wait
+__ssize_t await (int tag, int wait);
+
+// map memory window addr..addr+size-1 to file starting at offset, size 0 to unmap
+// addr, size and offset must be multiples of 4096, size at most 32768
+// reads and writes of the window access the file directly, read-only files are copy-on-write
+// writes beyond end-of-file are discarded, so extend the file with write() first
+// returns number of window bytes before end-of-file or -1
+int mapwin (int fd, void *addr, __size_t size, __uint64_t offset);
+
+// write modified window to file and move window to new file offset
+int mapsync (void *addr, __uint64_t offset);
+
 #endif
@@ -18,12 +18,27 @@
 ;;
 ;;    http://www.gnu.org/licenses/gpl-2.0.html
 
+	.include "magicdefs.asm"
+
 ; R0 = dest address
 ; R1 = source address
 ; R2 = byte count
 ; R3 = return address
 	.global	__memcpy
 __memcpy:
+.if RASPIMEMORY
+	lda	%r6,-8(%r6)
+	stw	%r0,-62(%r6)
+	stw	%r1,-60(%r6)
+	stw	%r2,-58(%r6)
+	ldw	%r0,ss_memcpy
+	stw	%r0,-64(%r6)
+	lda	%r1,-64(%r6)
+	stw	%r1,MAGIC_SCN-SCN_MEMCPY(%r0)
+	lda	%r6,8(%r6)
+	lda	%pc,0(%r3)
+ss_memcpy: .word SCN_MEMCPY
+.else
 	lda	%r6,-2(%r6)
 	stw	%r3,-64(%r6)
 	neg	%r2,%r2
@@ -39,4 +54,5 @@ memcpy_done:
 	ldw	%r3,-64(%r6)
 	lda	%r6,2(%r6)
 	lda	%r7,0(%r3)
+.endif
 
@@ -18,11 +18,18 @@
 ;;
 ;;    http://www.gnu.org/licenses/gpl-2.0.html
 
+	.include "magicdefs.asm"
+
 ; R0 = dest address
 ; R1 = source address
 ; R2 = double-word count
 	.global	__memcpy_ww
 __memcpy_ww:
+.if RASPIMEMORY
+	shl	%r2,%r2		; convert to byte count
+	shl	%r2,%r2
+	ldw	%pc,#__memcpy	; host does the copy
+.else
 	lda	%r6,-2(%r6)
 	stw	%r3,-64(%r6)
 	neg	%r2,%r2
@@ -40,4 +47,5 @@ memcpy_ww_done:
 	ldw	%r3,-64(%r6)
 	lda	%r6,2(%r6)
 	lda	%r7,0(%r3)
+.endif
 
@@ -18,6 +18,10 @@
 ;;
 ;;    http://www.gnu.org/licenses/gpl-2.0.html
 
+	.include "magicdefs.asm"
+
+.if 1 - RASPILONGS
+
 ;
 ; compare two quadwords
 ;  input:
@@ -98,3 +102,4 @@ cmp_qq_zero:
 	ldw	%r5,-60(%r6)
 	lda	%r6,6(%r6)
 	lda	%pc,0(%r3)
+.endif
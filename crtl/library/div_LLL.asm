@@ -18,6 +18,10 @@
 ;;
 ;;    http://www.gnu.org/licenses/gpl-2.0.html
 
+	.include "magicdefs.asm"
+
+.if 1 - RASPILONGS
+
 ;
 ; divide
 ;  input:
@@ -72,6 +76,15 @@ __div_LLL:
 	;  rr rr qq qq
 
 	lda	%r5,-32(%r4)
+	br	div_LLL_loop
+
+	; a bit shifted out the top so top dividend is definitely bigger
+div_LLL_big:
+	sub	%r0,%r2,%r1
+	ldw	%r1,dvsor+2(%r6)
+	sbb	%r1,%r4,%r1
+	br	div_LLL_fits
+
 div_LLL_loop:
 
 	; shift dividend left one bit
@@ -84,6 +97,7 @@ div_LLL_loop:
 
 	; subtract R1R0 = top dividend - divisor
 	ldw	%r1,dvsor+0(%r6)
+	bcs	div_LLL_big
 	sub	%r0,%r2,%r1
 	ldw	%r1,dvsor+2(%r6)
 	sbb	%r1,%r4,%r1
@@ -93,6 +107,7 @@ div_LLL_loop:
 	;   set low quotient bit
 	; }
 	bcs	div_LLL_next
+div_LLL_fits:
 	mov	%r2,%r0
 	mov	%r4,%r1
 	inc	%r3,%r3
@@ -124,3 +139,4 @@ div_LLL_ret:
 	ldw	%r5,-58(%r6)
 	lda	%r6,20(%r6)
 	lda	%pc,0(%r3)
+.endif
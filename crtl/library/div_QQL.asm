@@ -18,6 +18,10 @@
 ;;
 ;;    http://www.gnu.org/licenses/gpl-2.0.html
 
+	.include "magicdefs.asm"
+
+.if 1 - RASPILONGS
+
 ;
 ; divide
 ;  input:
@@ -92,13 +96,16 @@ div_QQL_loop:
 	rol	%r4,%r4
 	rol	%r5,%r5
 
-	; compare dividend<95:64> to divisor<31:00>
+	; compare dividend<96:64> to divisor<31:00>
+	; if a bit shifted out the top, it is definitely bigger
 	ldw	%r0,0(%r2)
 	ldw	%r1,2(%r2)
+	bcs	div_QQL_sub
 	sub	%pc,%r4,%r0
 	sbb	%pc,%r5,%r1
 
 	bcs	div_QQL_next
+div_QQL_sub:
 
 	; dividend<95:64> .ge. divisor<31:00>
 	; subtract divisor<31:00> from dividend<95:64>
@@ -132,3 +139,4 @@ div_QQL_next:
 	ldw	%r5,sav5(%r6)
 	lda	%r6,size(%r6)
 	lda	%pc,0(%r3)
+.endif
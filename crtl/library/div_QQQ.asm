@@ -18,6 +18,10 @@
 ;;
 ;;    http://www.gnu.org/licenses/gpl-2.0.html
 
+	.include "magicdefs.asm"
+
+.if 1 - RASPILONGS
+
 ;
 ; divide
 ;  input:
@@ -35,7 +39,7 @@
 	sav4 = -60
 	sav5 = -58
 	dvnd = -56
-	size = -44+64
+	size = -40+64
 
 	.align	2
 	.global	__mod_QQQ
@@ -103,7 +107,9 @@ div_QQQ_loop:
 	rol	%r4,%r4
 	rol	%r5,%r5
 
-	; compare dividend<127:064> to divisor<63:00>
+	; compare dividend<128:064> to divisor<63:00>
+	; if a bit shifted out the top, it is definitely bigger
+	bcs	div_QQQ_sub
 	ldw	%r0,dvnd+ 8(%r6)
 	ldw	%r1,0(%r2)
 	sub	%pc,%r0,%r1
@@ -116,8 +122,9 @@ div_QQQ_loop:
 	sbb	%pc,%r5,%r1
 
 	bcs	div_QQQ_next
+div_QQQ_sub:
 
-	; dividend<127:064> .ge. divisor<63:00>
+	; dividend<128:064> .ge. divisor<63:00>
 	; subtract divisor<63:00> from dividend<127:064>
 	ldw	%r0,dvnd+ 8(%r6)
 	ldw	%r1,0(%r2)
@@ -147,6 +154,8 @@ div_QQQ_next:
 	ldw	%r0,sav0(%r6)		; point to output
 	lsr	%pc,%r0
 	bcc	div_QQQ_store
+	stw	%r4,dvnd+12(%r6)	; top of remainder is still in R5R4
+	stw	%r5,dvnd+14(%r6)
 	lda	%r1,dvnd+8(%r6)	; point to remainder
 	lda	%r0,-1(%r0)
 div_QQQ_store:
@@ -165,3 +174,4 @@ div_QQQ_store:
 	ldw	%r5,sav5(%r6)
 	lda	%r6,size(%r6)
 	lda	%pc,0(%r3)
+.endif
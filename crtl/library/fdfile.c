@@ -120,6 +120,7 @@ int FILE::put (char const *buf, int len)
         if (room > len) room = len;
         memcpy (this->wbuff + this->wused, buf, room);
         this->wused += room;
+        buf += room;
         len -= room;
     }
     return this->maybeflush ();
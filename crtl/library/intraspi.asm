@@ -0,0 +1,201 @@
+;;    Copyright (C) Mike Rieker, Beverly, MA USA
+;;    www.outerworldapps.com
+;;
+;;    This program is free software; you can redistribute it and/or modify
+;;    it under the terms of the GNU General Public License as published by
+;;    the Free Software Foundation; version 2 of the License.
+;;
+;;    This program is distributed in the hope that it will be useful,
+;;    but WITHOUT ANY WARRANTY; without even the implied warranty of
+;;    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;;    GNU General Public License for more details.
+;;
+;;    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+;;
+;;    You should have received a copy of the GNU General Public License
+;;    along with this program; if not, write to the Free Software
+;;    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+;;
+;;    http://www.gnu.org/licenses/gpl-2.0.html
+
+
+	.include "magicdefs.asm"
+
+;
+; long/quad integer arithmetic via raspi
+; use mul_LLL.asm, div_LLL.asm, etc for software
+;
+	.align	2
+
+.if RASPILONGS
+
+;
+; multiply, divide, shift
+;  input:
+;   R0 = result address
+;   R1 = operand address
+;   R2 = operand address or shift count
+;   R3 = return address
+;  output:
+;   R0,R4,R5 = same as on input
+;   R1,R2,R3 = trashed
+;
+	.global	__mul_LLL
+__mul_LLL:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_mul_lll
+	br	intarith
+ss_mul_lll: .word SCN_MUL_LLL
+
+	.global	__div_LLL
+__div_LLL:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_div_lll
+	br	intarith
+ss_div_lll: .word SCN_DIV_LLL
+
+	.global	__mod_LLL
+__mod_LLL:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_mod_lll
+	br	intarith
+ss_mod_lll: .word SCN_MOD_LLL
+
+	.global	__div_QQL
+__div_QQL:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_div_qql
+	br	intarith
+ss_div_qql: .word SCN_DIV_QQL
+
+	.global	__div_QQQ
+__div_QQQ:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_div_qqq
+	br	intarith
+ss_div_qqq: .word SCN_DIV_QQQ
+
+	.global	__mod_QQQ
+__mod_QQQ:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_mod_qqq
+	br	intarith
+ss_mod_qqq: .word SCN_MOD_QQQ
+
+	.global	__shl_llB
+	.global	__shl_llW
+	.global	__shl_LLB
+	.global	__shl_LLW
+__shl_llB:
+__shl_llW:
+__shl_LLB:
+__shl_LLW:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_shl_llw
+	br	intarith
+ss_shl_llw: .word SCN_SHL_LLW
+
+	.global	__shr_LLW
+__shr_LLW:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_shr_llw
+	br	intarith
+ss_shr_llw: .word SCN_SHR_LLW
+
+	.global	__shr_llW
+__shr_llW:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_asr_llw
+	br	intarith
+ss_asr_llw: .word SCN_ASR_LLW
+
+	.global	__shl_qqB
+	.global	__shl_qqW
+	.global	__shl_QQB
+	.global	__shl_QQW
+__shl_qqB:
+__shl_qqW:
+__shl_QQB:
+__shl_QQW:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_shl_qqw
+	br	intarith
+ss_shl_qqw: .word SCN_SHL_QQW
+
+	.global	__shr_QQW
+__shr_QQW:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_shr_qqw
+	br	intarith
+ss_shr_qqw: .word SCN_SHR_QQW
+
+	.global	__shr_qqW
+__shr_qqW:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_asr_qqw
+	br	intarith
+ss_asr_qqw: .word SCN_ASR_QQW
+
+intarith:
+	stw	%r0,-62(%r6)
+	stw	%r2,-58(%r6)
+	stw	%r1,-64(%r6)
+	lda	%r2,-64(%r6)
+	clr	%r1
+	stw	%r2,MAGIC_SCN(%r1)
+	lda	%r6,8(%r6)
+	lda	%pc,0(%r3)
+
+;
+; modulus and comparison
+;  input:
+;   R0 = branch opcode for compare (see cmp_QQ.asm)
+;   R1 = operand address
+;   R2 = operand address or divisor
+;   R3 = return address
+;  output:
+;   R0 = remainder or compare result
+;   R4,R5 = same as on input
+;   R1,R2,R3 = trashed
+;
+	.global	__mod_WQW
+__mod_WQW:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_mod_wqw
+	br	intvalue
+ss_mod_wqw: .word SCN_MOD_WQW
+
+	.global	__cmp_QQ
+	.global	__cmp_qq
+__cmp_QQ:
+__cmp_qq:
+	lda	%r6,-8(%r6)
+	stw	%r1,-60(%r6)
+	ldw	%r1,ss_cmp_qq
+	br	intvalue
+ss_cmp_qq: .word SCN_CMP_QQ
+
+intvalue:
+	stw	%r0,-62(%r6)
+	stw	%r2,-58(%r6)
+	stw	%r1,-64(%r6)
+	lda	%r2,-64(%r6)
+	clr	%r1
+	stw	%r2,MAGIC_SCN(%r1)
+	lda	%r6,8(%r6)
+	ldw	%r0,MAGIC_SCN(%r1)
+	lda	%pc,0(%r3)
+.endif
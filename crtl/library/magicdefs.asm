@@ -54,10 +54,52 @@
 	SCN_WATCHWRITE	= 30
 	SCN_GETENV	= 31
 	SCN_SETTTYECHO	= 32
+	SCN_AREAD	= 33
+	SCN_AWRITE	= 34
+	SCN_AWAIT	= 35
+	SCN_MEMCPY	= 36
+	SCN_MEMSET	= 37
+	SCN_MEMMOVE	= 38
+	SCN_STRLEN	= 39
+	SCN_MEMCMP	= 40
+	SCN_MUL_LLL	= 41
+	SCN_DIV_LLL	= 42
+	SCN_MOD_LLL	= 43
+	SCN_DIV_QQL	= 44
+	SCN_DIV_QQQ	= 45
+	SCN_MOD_QQQ	= 46
+	SCN_MOD_WQW	= 47
+	SCN_SHL_LLW	= 48
+	SCN_SHR_LLW	= 49
+	SCN_ASR_LLW	= 50
+	SCN_SHL_QQW	= 51
+	SCN_SHR_QQW	= 52
+	SCN_ASR_QQW	= 53
+	SCN_CMP_QQ	= 54
+	SCN_SIN_DD	= 55
+	SCN_SIN_FF	= 56
+	SCN_COS_DD	= 57
+	SCN_COS_FF	= 58
+	SCN_TAN_DD	= 59
+	SCN_TAN_FF	= 60
+	SCN_EXP_DD	= 61
+	SCN_EXP_FF	= 62
+	SCN_LOG_DD	= 63
+	SCN_LOG_FF	= 64
+	SCN_SQRT_DD	= 65
+	SCN_SQRT_FF	= 66
+	SCN_POW_DDD	= 67
+	SCN_POW_FFF	= 68
+	SCN_ATAN2_DDD	= 69
+	SCN_ATAN2_FFF	= 70
+	SCN_VFORMAT	= 71
+	SCN_MAPWIN	= 72
+	SCN_MAPSYNC	= 73
 
 	IRQ_SCNINTREQ	= 0x1
 	IRQ_LINECLOCK	= 0x2
 	IRQ_RANDMEM	= 0x4
+	IRQ_ASYNCIO	= 0x8
 
 	; /usr/include/asm-generic/fcntl.h
 	O_ACCMODE	= 00000003
@@ -89,3 +131,9 @@
 	RASPIFLOATS = 1	; 0=software floatingpoint
 			; 1=raspi floatingpoint
 
+	RASPIMEMORY = 1	; 0=software memcpy,memset,memmove,strlen,memcmp
+			; 1=raspi memcpy,memset,memmove,strlen,memcmp
+
+	RASPILONGS = 1	; 0=software long/quad multiply/divide/shift/compare
+			; 1=raspi long/quad multiply/divide/shift/compare
+
@@ -21,6 +21,9 @@
 // returns -PI..+PI
 MType MMath(atan2) (MType y, MType x)
 {
+#if RASPIMATH
+    return raspimath (MScn (SCN_ATAN2_DDD, SCN_ATAN2_FFF), y, x);
+#else
     if (MMath(isnan) (y) || MMath(isnan) (x)) return MNAN;
     if (x == 0.0) {
         if (y == 0.0) return 0.0;
@@ -31,5 +34,6 @@ MType MMath(atan2) (MType y, MType x)
     if (MMath(isnan) (theta)) return theta;
     if (x >= 0.0) return theta;
     return (y >= 0.0) ? theta + MPI : theta - MPI;
+#endif
 }
 
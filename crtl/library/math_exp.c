@@ -20,6 +20,9 @@
 
 MType MMath(exp) (MType x)
 {
+#if RASPIMATH
+    return raspimath (MScn (SCN_EXP_DD, SCN_EXP_FF), x, 0.0);
+#else
     if (! MMath(isfinite) (x)) {
         if (MMath(isnan) (x)) return MNAN;
         return (x < 0.0) ? 0.0 : MINF;
@@ -42,5 +45,6 @@ MType MMath(exp) (MType x)
         y2 = y1;
         y1 = y;
     }
+#endif
 }
 
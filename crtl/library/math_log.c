@@ -20,6 +20,9 @@
 
 MType MMath(log) (MType x)
 {
+#if RASPIMATH
+    return raspimath (MScn (SCN_LOG_DD, SCN_LOG_FF), x, 0.0);
+#else
     if (MMath (isnan) (x) || (x < 0.0)) return MNAN;
     if (MMath (isinf) (x)) return MINF;
     if (x == 0.0) return - MINF;
@@ -41,4 +44,5 @@ MType MMath(log) (MType x)
         y2 = y1;
         y1 = y;
     }
+#endif
 }
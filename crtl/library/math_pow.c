@@ -20,6 +20,9 @@
 
 MType MMath(pow) (MType x, MType y)
 {
+#if RASPIMATH
+    return raspimath (MScn (SCN_POW_DDD, SCN_POW_FFF), x, y);
+#else
     if (y == 0.0) return 1.0;
     if (x == 1.0) return 1.0;
     if (x == 0.0) return (y < 0.0) ? MINF : 0.0;
@@ -53,5 +56,6 @@ MType MMath(pow) (MType x, MType y)
     if (x < 0.0) return MNAN;
 
     return MMath(exp) (MMath(log) (x) * y);
+#endif
 }
 
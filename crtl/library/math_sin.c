@@ -19,23 +19,58 @@
 //    http://www.gnu.org/licenses/gpl-2.0.html
 
 MType MMath(sin) (MType x)
+{
+#if RASPIMATH
+    return raspimath (MScn (SCN_SIN_DD, SCN_SIN_FF), x, 0.0);
+#else
+    return MMath(__sinquad) (x, 0);
+#endif
+}
+
+#if ! RASPIMATH
+
+// pi/2 split in two, the high part has only 33 significant bits
+// ...so n * PIO2HI is exact and x - n * PIO2HI doesn't lose the low bits of the result near multiples of pi/2
+#define PIO2HI 1.57079632673412561417e+00
+#define PIO2LO 6.07710050650619224932e-11
+
+// round to nearest integer, good for anything under 2**51
+#define RINT(v) (((v) + 6755399441055744.0) - 6755399441055744.0)
+
+// sin (x + quad * pi/2), used by cos() with quad = 1
+MType MMath(__sinquad) (MType x, int quad)
 {
     if (! MMath(isfinite) (x)) return MNAN;
-    while (x < -MPI) x += MPI * 2.0;
-    while (x >= MPI) x -= MPI * 2.0;
-    MType mxx = - x * x;
-    MType m   = 1.0;
-    MType y   = x;
-    MType y1  = x;
-    MType y2  = x;
+
+    // reduce to y = x - n * pi/2 in -pi/4..pi/4 in double
+    double n = RINT (x * M_2_PI);
+    double y = (x - n * PIO2HI) - n * PIO2LO;
+    quad = (quad + (int) (n - RINT (n * 0.25) * 4.0)) & 3;
+
+    // sin(y) or cos(y) series, negated for the lower half circle
+    MType yy  = (MType) y;
+    MType mxx = - yy * yy;
+    MType m   = 0.0;
+    MType t   = 1.0;
+    if (quad & 1) {
+        yy = 1.0;
+    } else {
+        t = yy;
+        m = 1.0;
+    }
+    MType y1 = yy;
+    MType y2 = yy;
     while (1) {
-        x *= mxx;
-        x /= ++ m;
-        x /= ++ m;
-        y += x;
-        if ((y == y1) || (y == y2)) return y;
+        t *= mxx;
+        t /= ++ m;
+        t /= ++ m;
+        yy += t;
+        if ((yy == y1) || (yy == y2)) break;
         y2 = y1;
-        y1 = y;
+        y1 = yy;
     }
+    return (quad & 2) ? - yy : yy;
 }
 
+#endif
+
@@ -20,6 +20,9 @@
 
 MType MMath(sqrt) (MType x)
 {
+#if RASPIMATH
+    return raspimath (MScn (SCN_SQRT_DD, SCN_SQRT_FF), x, 0.0);
+#else
     if (x == 0.0) return 0.0;
     if (x < 0.0) return MNAN;
     if (! MMath(isfinite) (x)) return x;
@@ -44,5 +47,6 @@ MType MMath(sqrt) (MType x)
         y2 = y1;
         y1 = y;
     }
+#endif
 }
 
@@ -20,6 +20,10 @@
 
 MType MMath(tan) (MType x)
 {
+#if RASPIMATH
+    return raspimath (MScn (SCN_TAN_DD, SCN_TAN_FF), x, 0.0);
+#else
     return MMath(sin) (x) / MMath(cos) (x);
+#endif
 }
 
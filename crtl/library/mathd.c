@@ -25,4 +25,7 @@
 #define MPI M_PI
 #define MINF M_INF
 #define MNAN M_NAN
+#define MScn(dd,ff) dd
+
+#include "mathraspi.h"
 
@@ -25,4 +25,7 @@
 #define MINF M_INFF
 #define MPI M_PIF
 #define MNAN M_NANF
+#define MScn(dd,ff) ff
+
+#include "mathraspi.h"
 
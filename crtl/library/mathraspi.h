@@ -0,0 +1,72 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// included by mathd.c and mathf.c after MMath, MType are defined
+
+#ifndef _MATHRASPI_H
+#define _MATHRASPI_H
+
+#ifndef RASPIMATH
+#define RASPIMATH 1     // 0=software sin,cos,tan,exp,log,pow,sqrt,atan2
+                        // 1=raspi sin,cos,tan,exp,log,pow,sqrt,atan2
+#endif
+
+#if RASPIMATH
+
+// must match driver/raspictl.cc
+#define SCN_SIN_DD 55
+#define SCN_SIN_FF 56
+#define SCN_COS_DD 57
+#define SCN_COS_FF 58
+#define SCN_TAN_DD 59
+#define SCN_TAN_FF 60
+#define SCN_EXP_DD 61
+#define SCN_EXP_FF 62
+#define SCN_LOG_DD 63
+#define SCN_LOG_FF 64
+#define SCN_SQRT_DD 65
+#define SCN_SQRT_FF 66
+#define SCN_POW_DDD 67
+#define SCN_POW_FFF 68
+#define SCN_ATAN2_DDD 69
+#define SCN_ATAN2_FFF 70
+
+struct MRaspi {
+    __uint16_t scn;
+    MType *result;
+    MType *leftop;
+    MType *riteop;
+};
+
+// have raspictl compute the whole function in one syscall
+static MType raspimath (__uint16_t scn, MType x, MType y)
+{
+    MType r;
+    struct MRaspi raspi = { scn, &r, &x, &y };
+    *(struct MRaspi **)0xFFF0U = &raspi;
+    return r;
+}
+
+#else
+
+MType MMath(__sinquad) (MType x, int quad);
+
+#endif
+#endif
@@ -18,10 +18,23 @@
 ;;
 ;;    http://www.gnu.org/licenses/gpl-2.0.html
 
+	.include "magicdefs.asm"
+
 ; int memcmp (char const *, char const *, size_t)
 	.align	2
 	.global	memcmp
 memcmp:
+.if RASPIMEMORY
+	lda	%r6,-2(%r6)
+	lda	%r1,-64(%r6)
+	ldw	%r0,ss_memcmp
+	stw	%r0,0(%r1)
+	stw	%r1,MAGIC_SCN-SCN_MEMCMP(%r0)
+	ldw	%r0,MAGIC_SCN-SCN_MEMCMP(%r0)
+	lda	%r6,8(%r6)
+	lda	%pc,0(%r3)
+ss_memcmp: .word SCN_MEMCMP
+.else
 	lda	%r6,-4(%r6)
 	stw	%r3,-64(%r6)
 	stw	%r4,-62(%r6)
@@ -44,4 +57,5 @@ memcmp_done:
 	ldw	%r4,-62(%r6)
 	lda	%r6,10(%r6)
 	lda	%pc,0(%r3)
+.endif
 
@@ -18,13 +18,26 @@
 ;;
 ;;    http://www.gnu.org/licenses/gpl-2.0.html
 
+	.include "magicdefs.asm"
+
 ; void memcpy (char *, char const *, int)
 	.align	2
 	.global	memcpy
 memcpy:
+.if RASPIMEMORY
+	lda	%r6,-2(%r6)
+	lda	%r1,-64(%r6)
+	ldw	%r0,ss_memcpy
+	stw	%r0,0(%r1)
+	stw	%r1,MAGIC_SCN-SCN_MEMCPY(%r0)
+	lda	%r6,8(%r6)
+	lda	%pc,0(%r3)
+ss_memcpy: .word SCN_MEMCPY
+.else
 	ldw	%r0,-64(%r6)
 	ldw	%r1,-62(%r6)
 	ldw	%r2,-60(%r6)
 	lda	%r6,6(%r6)
 	ldw	%pc,#__memcpy
+.endif
 
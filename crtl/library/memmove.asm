@@ -18,10 +18,22 @@
 ;;
 ;;    http://www.gnu.org/licenses/gpl-2.0.html
 
+	.include "magicdefs.asm"
+
 ; void memmove (char *, char const *, int)
 	.align	2
 	.global	memmove
 memmove:
+.if RASPIMEMORY
+	lda	%r6,-2(%r6)
+	lda	%r1,-64(%r6)
+	ldw	%r0,ss_memmove
+	stw	%r0,0(%r1)
+	stw	%r1,MAGIC_SCN-SCN_MEMMOVE(%r0)
+	lda	%r6,8(%r6)
+	lda	%pc,0(%r3)
+ss_memmove: .word SCN_MEMMOVE
+.else
 	lda	%r6,-2(%r6)
 	stw	%r3,-64(%r6)
 	ldw	%r0,-62(%r6)
@@ -67,4 +79,5 @@ memmove_w_done:
 memmove_fwd:
 	lda	%r6,8(%r6)
 	ldw	%pc,#__memcpy
+.endif
 
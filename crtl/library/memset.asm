@@ -18,10 +18,22 @@
 ;;
 ;;    http://www.gnu.org/licenses/gpl-2.0.html
 
+	.include "magicdefs.asm"
+
 ; void memset (char *, int, int)
 	.align	2
 	.global	memset
 memset:
+.if RASPIMEMORY
+	lda	%r6,-2(%r6)
+	lda	%r1,-64(%r6)
+	ldw	%r0,ss_memset
+	stw	%r0,0(%r1)
+	stw	%r1,MAGIC_SCN-SCN_MEMSET(%r0)
+	lda	%r6,8(%r6)
+	lda	%pc,0(%r3)
+ss_memset: .word SCN_MEMSET
+.else
 	ldw	%r0,-64(%r6)	; R0 = dest addr
 	ldw	%r2,-60(%r6)	; R2 = byte count
 	or	%r1,%r0,%r2	; R1 = check for alignment
@@ -52,4 +64,5 @@ memset_w_loop:
 memset_w_done:
 	lda	%r6,6(%r6)
 	lda	%r7,0(%r3)
+.endif
 
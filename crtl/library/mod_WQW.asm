@@ -20,6 +20,8 @@
 
 	.include "magicdefs.asm"
 
+.if 1 - RASPILONGS
+
 ;
 ; modulus
 ;  input:
@@ -63,4 +65,4 @@ mod_WQW_1500:
 	ldw	%r5,-60(%r6)
 	lda	%r6,6(%r6)
 	lda	%pc,0(%r3)
-
+.endif
@@ -20,6 +20,8 @@
 
 	.include "magicdefs.asm"
 
+.if 1 - RASPILONGS
+
 ;
 ; multiply
 ;  input:
@@ -56,7 +58,7 @@ __mul_LLL:
 	lda	%r5,mul_LLL_hi
 	ldw	%pc,#__umul
 mul_LLL_hi:
-	stw	%r1,-60(%r6)	; save high result
+	stw	%r0,-60(%r6)	; save high partial product
 
 	ldw	%r1,-62(%r6)	; R1R0 = multiplier * low multiplicand
 	ldw	%r1,0(%r1)
@@ -76,3 +78,4 @@ mul_LLL_lo:
 	ldw	%r5,-54(%r6)
 	lda	%r6,12(%r6)
 	lda	%pc,0(%r3)
+.endif
@@ -20,6 +20,8 @@
 
 	.include "magicdefs.asm"
 
+.if 1 - RASPILONGS
+
 ;
 ; shift left
 ;  input:
@@ -79,4 +81,4 @@ shl_LLW_done:
 	ldw	%r4,-62(%r6)
 	lda	%r6,4(%r6)
 	lda	%pc,0(%r3)
-
+.endif
@@ -20,6 +20,8 @@
 
 	.include "magicdefs.asm"
 
+.if 1 - RASPILONGS
+
 ;
 ; shift left
 ;  input:
@@ -94,8 +96,8 @@ shl_QQW_copyskip:
 
 	; zero that many bottom result words
 	clr	%r1
-	shl	%r3,%r3
-	sub	%r4,%pc,%r3
+	shl	%r5,%r3
+	sub	%r4,%pc,%r5
 shl_QQW_padbase:
 	lda	%pc,shl_QQW_padskip-shl_QQW_padbase(%r4)
 	stw	%r1,4(%r0)
@@ -104,7 +106,7 @@ shl_QQW_padbase:
 shl_QQW_padskip:
 
 	; offset result pointer by that much
-	add	%r0,%r0,%r3
+	add	%r0,%r0,%r5
 	stw	%r0,-60(%r6)
 
 	; get number of bits in word to shift by
@@ -165,4 +167,4 @@ shl_QQW_bitsnull:
 	ldw	%r5,-54(%r6)
 	lda	%r6,20(%r6)
 	lda	%pc,0(%r3)
-
+.endif
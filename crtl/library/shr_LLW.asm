@@ -20,6 +20,8 @@
 
 	.include "magicdefs.asm"
 
+.if 1 - RASPILONGS
+
 ;
 ; shift right
 ;  input:
@@ -90,4 +92,4 @@ shr_LLW_done:
 	ldw	%r5,-60(%r6)
 	lda	%r6,6(%r6)
 	lda	%pc,0(%r3)
-
+.endif
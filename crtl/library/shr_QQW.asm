@@ -20,6 +20,8 @@
 
 	.include "magicdefs.asm"
 
+.if 1 - RASPILONGS
+
 ;
 ; shift right
 ;  input:
@@ -170,4 +172,4 @@ shr_QQW_bitsnull:
 	ldw	%r5,-54(%r6)
 	lda	%r6,20(%r6)
 	lda	%pc,0(%r3)
-
+.endif
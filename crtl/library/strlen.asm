@@ -18,10 +18,23 @@
 ;;
 ;;    http://www.gnu.org/licenses/gpl-2.0.html
 
+	.include "magicdefs.asm"
+
 ; int strlen (char const *)
 	.align	2
 	.global	strlen
 strlen:
+.if RASPIMEMORY
+	lda	%r6,-2(%r6)
+	lda	%r1,-64(%r6)
+	ldw	%r0,ss_strlen
+	stw	%r0,0(%r1)
+	stw	%r1,MAGIC_SCN-SCN_STRLEN(%r0)
+	ldw	%r0,MAGIC_SCN-SCN_STRLEN(%r0)
+	lda	%r6,4(%r6)
+	lda	%pc,0(%r3)
+ss_strlen: .word SCN_STRLEN
+.else
 	ldw	%r0,-64(%r6)
 	lda	%r1,1(%r0)
 strlen_loop:
@@ -32,4 +45,5 @@ strlen_loop:
 	sub	%r0,%r0,%r1
 	lda	%r6,2(%r6)
 	lda	%r7,0(%r3)
+.endif
 
@@ -45,6 +45,28 @@
 #include "fdfile.h"
 #include "vfprintf.h"
 
+#ifndef RASPIFORMAT
+#define RASPIFORMAT 1     // 0=always format in software
+                          // 1=have raspictl format it, software if raspictl can't
+#endif
+
+#if RASPIFORMAT
+
+// must match driver/raspictl.cc
+#define SCN_VFORMAT 71
+
+struct VFRaspi {
+  __uint16_t scn;
+  char const *format;
+  va_list ap;
+  char *buf;
+  __size_t size;
+};
+
+static int raspiformat (FILE *stream, const char *format, va_list ap, int *rc_r);
+
+#endif
+
 /************************************************************************/
 /*                                                                      */
 /*    Input:                                                            */
@@ -68,6 +90,10 @@ int vfprintf (FILE *stream, const char *format, va_list ap)
   int siz, sts;
   Par par, *p;
 
+#if RASPIFORMAT
+  if (raspiformat (stream, format, ap, &sts)) return sts;                       // have raspictl do it all in one syscall
+#endif
+
   p = &par;                                                                     // point to param block
   memset (p, 0, sizeof *p);                                                     // clear out param block
 
@@ -262,8 +288,8 @@ gotfinal:
 
       case 'n': {                                                               // - number of output characters so far
         switch (p -> intsize) {
-          case 2:  *(va_arg (p -> ap, __int16_t *)) = p -> numout;
-          case 4:  *(va_arg (p -> ap, __int32_t *)) = p -> numout;
+          case 2:  *(va_arg (p -> ap, __int16_t *)) = p -> numout; break;
+          case 4:  *(va_arg (p -> ap, __int32_t *)) = p -> numout; break;
           default: *(va_arg (p -> ap, int *)) = p -> numout;
         }
         break;
@@ -280,6 +306,44 @@ gotfinal:
 
   return p -> numout;
 }
+
+#if RASPIFORMAT
+
+/* Have raspictl format the string with one syscall then output it with one put() call */
+/* Returns 0 if raspictl can't do it (something vfprintf would assert on or out of memory) */
+
+static int raspiformat (FILE *stream, const char *format, va_list ap, int *rc_r)
+{
+  char buf[128], *mbuf;
+  int len, sts;
+  struct VFRaspi raspi;
+
+  raspi.scn    = SCN_VFORMAT;
+  raspi.format = format;
+  raspi.ap     = ap;
+  raspi.buf    = buf;
+  raspi.size   = sizeof buf;
+  *(struct VFRaspi *volatile *)0xFFF0U = &raspi;
+  len = *(int volatile *)0xFFF0U;
+  if (len < 0) return 0;
+
+  mbuf = NULL;
+  if (len > sizeof buf) {                                                       // didn't fit in stack buffer, format again into malloc'd buffer
+    mbuf = malloc (len);
+    if (mbuf == NULL) return 0;
+    raspi.buf  = mbuf;
+    raspi.size = len;
+    *(struct VFRaspi *volatile *)0xFFF0U = &raspi;
+  }
+
+  sts = 0;
+  if (len > 0) sts = stream -> put (raspi.buf, len);
+  *rc_r = (sts < 0) ? sts : len;
+  free (mbuf);
+  return 1;
+}
+
+#endif
 
 /* Put the integer in p -> ncp..p -> nce, optionally prepending the alternate string and padding as required */
 
@@ -0,0 +1,96 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// count lines, words and bytes of a file by sliding a mapped window along it
+// ...optionally upper-casing it in place
+//  ./raspictl -nohw maptest.hex [-u] file
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define WINSIZE 8192
+
+int main (int argc, char **argv)
+{
+    int upper = 0;
+    if ((argc > 1) && (strcmp (argv[1], "-u") == 0)) {
+        upper = 1;
+        argc --;
+        argv ++;
+    }
+    if (argc != 2) {
+        fprintf (stderr, "usage: maptest [-u] file\n");
+        return 1;
+    }
+
+    int fd = open (argv[1], upper ? O_RDWR : O_RDONLY, 0);
+    if (fd < 0) {
+        fprintf (stderr, "error %d opening %s\n", errno, argv[1]);
+        return 1;
+    }
+
+    // window must be page aligned
+    char *mem = malloc (WINSIZE + 4095);
+    char *win = (char *) (((__size_t) mem + 4095) & -4096);
+
+    __uint32_t offset = 0;
+    __uint32_t nlines = 0;
+    __uint32_t nwords = 0;
+    __uint32_t nbytes = 0;
+    int inword = 0;
+    int len = mapwin (fd, win, WINSIZE, offset);
+
+    // windows can't go over read-only memory or another window
+    if ((len >= 0) && ((mapwin (fd, (void *) 0, 4096, 0) >= 0) || (errno != EINVAL) ||
+            (mapwin (fd, win + 4096, 4096, 0) >= 0) || (errno != EINVAL))) {
+        fprintf (stderr, "overlapping window was mapped\n");
+        return 1;
+    }
+
+    while (len > 0) {
+        for (int i = 0; i < len; i ++) {
+            char c = win[i];
+            if (c == '\n') nlines ++;
+            if ((c == ' ') || (c == '\t') || (c == '\n')) inword = 0;
+            else if (! inword) {
+                inword = 1;
+                nwords ++;
+            }
+            if (upper && (c >= 'a') && (c <= 'z')) win[i] = c - 'a' + 'A';
+        }
+        nbytes += len;
+        if (len < WINSIZE) break;
+        offset += WINSIZE;
+        len = mapsync (win, offset);
+    }
+    if (len < 0) {
+        fprintf (stderr, "error %d mapping %s\n", errno, argv[1]);
+        return 1;
+    }
+    mapwin (fd, win, 0, 0);
+    close (fd);
+    free (mem);
+
+    printf ("%8lu %8lu %8lu %s\n", nlines, nwords, nbytes, argv[1]);
+    return 0;
+}
@@ -0,0 +1,40 @@
+#!/bin/bash
+#
+#  Compare raspictl -nohw simulation speed of the
+#  instruction-at-a-time engine with the cycle-at-a-time
+#  shadow engine (-shadowsim)
+#
+#   ./simbench.sh [<number of sorttest runs>]
+#
+cd `dirname $0`
+nruns=${1:-50}
+unamem=`uname -m`
+make sorttest.hex printpi.hex > /dev/null || exit
+
+#  run the given hex file nruns times
+#  print total instructions, cycles and host seconds
+function runbench {
+    hexfile=$1
+    n=$2
+    shift 2
+    insts=0
+    cycles=0
+    start=`date +%s.%N`
+    for ((i = 0 ; i < n ; i ++))
+    do
+        line=`../driver/raspictl.$unamem -nohw "$@" $hexfile 2>&1 > /dev/null | grep SCN_EXIT`
+        read x x cyc x ins x <<< "$line"
+        cycles=$((cycles+cyc))
+        insts=$((insts+ins))
+    done
+    stop=`date +%s.%N`
+    echo $insts $cycles $start $stop | awk '{ secs = $4 - $3 ;
+        printf "%12d instrs %12d cycles %8.3f secs %10.0f instrs/sec\n", $1, $2, secs, $1 / secs }'
+}
+
+echo "sorttest x $nruns"
+echo -n "  fastcpu   " ; runbench sorttest.hex $nruns
+echo -n "  shadowsim " ; runbench sorttest.hex $nruns -shadowsim
+echo "printpi"
+echo -n "  fastcpu   " ; runbench printpi.hex 1
+echo -n "  shadowsim " ; runbench printpi.hex 1 -shadowsim
@@ -157,9 +157,10 @@ static void printdouble (char const *fmt, double val)
         }
         double inval = strtod (++ p, NULL);
         if (isnan (val) && isnan (inval)) return;
+        if (val == inval) return;
         if ((fabs (val) < 1e-9) && (fabs (inval) < 1e-9)) return;
         double ratio = val / inval;
-        if ((ratio > 1.0001) && (ratio < 0.9999)) {
+        if ((ratio > 1.0001) || (ratio < 0.9999)) {
             printf ("ERROR mismatch value %s", inbuf);
         }
     }
@@ -186,9 +187,10 @@ static void printfloat (char const *fmt, float val)
         }
         float inval = strtof (++ p, NULL);
         if (isnanf (val) && isnanf (inval)) return;
+        if (val == inval) return;
         if ((fabsf (val) < 1e-9) && (fabsf (inval) < 1e-9)) return;
         float ratio = val / inval;
-        if ((ratio > 1.0001) && (ratio < 0.9999)) {
+        if ((ratio > 1.0001) || (ratio < 0.9999)) {
             printf ("ERROR mismatch value %s", inbuf);
         }
     }
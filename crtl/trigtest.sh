@@ -1,4 +1,9 @@
 #!/bin/bash
+#
+#  Compare hode math library results to x86 math library
+#  both with the raspi math functions (library/mathraspi.h RASPIMATH = 1)
+#  and the software ones (RASPIMATH = 0)
+#
 set -e -x
 
 unamem=`uname -m`
@@ -8,5 +13,21 @@ cc -std=c99 -o trigtest.$unamem trigtest.c -lm
 rm -f x.c x.hode.o x.hode.s
 ln -s trigtest.c x.c
 make x.hex
+
+#  build software math version of library in a scratch directory
+#  all but the math function objects are re-used as is
+tmpdir=`mktemp -d`
+trap "rm -rf $tmpdir" EXIT
+cp library/math*.c library/mathraspi.h library/*.hode.o library/makefile $tmpdir/
+sed -i 's/^#define RASPIMATH 1/#define RASPIMATH 0/' $tmpdir/mathraspi.h
+rm $tmpdir/mathd*.hode.o $tmpdir/mathf*.hode.o
+make -C $tmpdir CC=`pwd`/../cc/compile.sh AR=`pwd`/../asm/archive.$unamem crtl.hode.a > /dev/null
+../asm/link.$unamem -o $tmpdir/x.hex x.hode.o $tmpdir/crtl.hode.a > $tmpdir/x.map
+
+#  raspi and software versions both compared to x86
+#  then raspi version compared to software version
 ./runit.sh x.hex tt.x86 > tt.hode
-grep ERROR tt.hode
+./runit.sh $tmpdir/x.hex tt.x86 > tt.hodesw
+./runit.sh $tmpdir/x.hex 2> /dev/null > tt.sw
+./runit.sh x.hex tt.sw > tt.hodevsw
+! grep ERROR tt.hode tt.hodesw tt.hodevsw
@@ -0,0 +1,311 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+/**
+ * Exhaustively test the 8-bit ALU slice netlist against the ALU8 equations alutester checks the boards with.
+ * Every A, B, CIN, SHR combination for each of the 18 functions (IRFC with IR[3:0] = 0..15, ADD, BONLY).
+ * Runs 64 or 256 (AVX2) vectors through the gate-level netlist at once.
+
+    cd ../modules
+    ./netgen.sh aluboard.mod -gen alueight -netbin alueight.bin
+    ../driver/alusweep.x86_64 -lanes 256 alueight.bin
+
+    -crosscheck works with any netlist, it checks the batch evaluator itself
+    ...random values get wire-anded onto the ports and every net of every lane must match Netlist::settle()
+    ...including ports something on the board drives too, like alueight's A[] that _aena jams to 0
+    ...for 64, 128, 256 and 512 lanes, each 64-lane word against its own Netlist
+    ../driver/alusweep.x86_64 -crosscheck netlisttest/regboard.bin
+
+    what we send to the slice:
+        A[7:0], B[7:0], CIN, SHR
+        IR[3:0], _IR[3:0], IRFC, ADD, BONLY
+
+    what we get from the slice:
+        S[7:0], COUT, VOUT
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "alu8.h"
+#include "gpiolib.h"
+#include "miscdefs.h"
+#include "netlist.h"
+
+#define NVECS (1U << 18)    // A[7:0], B[7:0], CIN, SHR
+#define MAXPRINT 8          // errors printed per function
+#define CHECKSTEPS 1000     // -crosscheck random input changes
+
+static Netlist *netlist;
+static char const *netname;
+
+static int crosscheck ();
+static uint64_t randuint64 ();
+static uint32_t findport (char const *name);
+static void findports (uint32_t *nets, char const *name, int width);
+
+int main (int argc, char **argv)
+{
+    bool crosschk = false;
+    uint32_t lanes = 256;
+
+    setlinebuf (stdout);
+
+    for (int i = 0; ++ i < argc;) {
+        if (strcasecmp (argv[i], "-crosscheck") == 0) {
+            crosschk = true;
+            continue;
+        }
+        if (strcasecmp (argv[i], "-lanes") == 0) {
+            if (++ i >= argc) {
+                fprintf (stderr, "-lanes missing count\n");
+                return 1;
+            }
+            lanes = atoi (argv[i]);
+            if ((lanes != 64) && (lanes != 128) && (lanes != 256) && (lanes != 512)) {
+                fprintf (stderr, "-lanes must be 64, 128, 256 or 512\n");
+                return 1;
+            }
+            continue;
+        }
+        if (argv[i][0] == '-') {
+            fprintf (stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+        if (netname != NULL) {
+            fprintf (stderr, "unknown argument %s\n", argv[i]);
+            return 1;
+        }
+        netname = argv[i];
+    }
+    if (netname == NULL) {
+        fprintf (stderr, "missing netlist filename\n");
+        return 1;
+    }
+
+    netlist = new Netlist ();
+    if (! netlist->load (netname)) return 1;
+    netlist->printsummary (stdout);
+    if (crosschk) return crosscheck ();
+
+    uint32_t anets[8], bnets[8], irnets[4], _irnets[4], snets[8];
+    findports (anets,   "A",   8);
+    findports (bnets,   "B",   8);
+    findports (irnets,  "IR",  4);
+    findports (_irnets, "_IR", 4);
+    findports (snets,   "S",   8);
+    uint32_t cinnet   = findport ("CIN");
+    uint32_t shrnet   = findport ("SHR");
+    uint32_t irfcnet  = findport ("IRFC");
+    uint32_t addnet   = findport ("ADD");
+    uint32_t bonlynet = findport ("BONLY");
+    uint32_t coutnet  = findport ("COUT");
+    uint32_t voutnet  = findport ("VOUT");
+
+    uint32_t nwords = lanes / 64;
+    NetlistBatch batch (netlist, nwords);
+    printf ("alusweep: %u lanes%s\n", lanes, batch.avx2 ? " (avx2)" : "");
+
+    struct timespec started, finished;
+    if (clock_gettime (CLOCK_MONOTONIC, &started) < 0) abort ();
+
+    uint32_t totalerrs = 0;
+    uint32_t totalvecs = 0;
+    for (int func = 0; func < 18; func ++) {
+
+        // functions 0..15 are IRFC with that IR, 16 is ADD, 17 is BONLY
+        ALU8 alu8;
+        alu8.ir = (func < 16) ? func : 0;
+        alu8.ctlpins = (func < 16) ? C_ALU_IRFC : (func == 16) ? C_ALU_ADD : C_ALU_BONLY;
+        for (uint32_t w = 0; w < nwords; w ++) {
+            for (int i = 0; i < 4; i ++) {
+                batch.drive (irnets[i],  w, ((alu8.ir >> i) & 1) ? ~0ULL : 0);
+                batch.drive (_irnets[i], w, ((alu8.ir >> i) & 1) ? 0 : ~0ULL);
+            }
+            batch.drive (irfcnet,  w, (alu8.ctlpins & C_ALU_IRFC)  ? ~0ULL : 0);
+            batch.drive (addnet,   w, (alu8.ctlpins & C_ALU_ADD)   ? ~0ULL : 0);
+            batch.drive (bonlynet, w, (alu8.ctlpins & C_ALU_BONLY) ? ~0ULL : 0);
+        }
+
+        uint32_t errors = 0;
+        char opchar = '?';
+        for (uint32_t base = 0; base < NVECS; base += lanes) {
+
+            // lane l of word w gets vector base + w * 64 + l
+            // ...so the low 6 bits of A are the same in every word, the rest is the same for all lanes of a word
+            uint64_t sexp[8][8], coutexp[8], voutexp[8];
+            for (uint32_t w = 0; w < nwords; w ++) {
+                uint32_t vec = base + w * 64;
+                for (int i = 0; i < 8; i ++) {
+                    uint64_t a = 0;
+                    if (i < 6) {
+                        for (uint32_t l = 0; l < 64; l ++) a |= (uint64_t) ((l >> i) & 1) << l;
+                    } else if ((vec >> i) & 1) a = ~0ULL;
+                    batch.drive (anets[i], w, a);
+                    batch.drive (bnets[i], w, ((vec >> (8 + i)) & 1) ? ~0ULL : 0);
+                }
+                batch.drive (cinnet, w, ((vec >> 16) & 1) ? ~0ULL : 0);
+                batch.drive (shrnet, w, ((vec >> 17) & 1) ? ~0ULL : 0);
+
+                // what ALU8 says each lane should come up with
+                memset (sexp[w], 0, sizeof sexp[w]);
+                coutexp[w] = 0;
+                voutexp[w] = 0;
+                for (uint32_t l = 0; l < 64; l ++) {
+                    alu8.ain   = vec + l;
+                    alu8.bin   = vec >> 8;
+                    alu8.cin   = (vec >> 16) & 1;
+                    alu8.shrin = (vec >> 17) & 1;
+                    alu8.compute ();
+                    for (int i = 0; i < 8; i ++) sexp[w][i] |= (uint64_t) ((alu8.dout >> i) & 1) << l;
+                    coutexp[w] |= (uint64_t) alu8.cout << l;
+                    voutexp[w] |= (uint64_t) alu8.vout << l;
+                }
+                opchar = alu8.opchar;
+            }
+
+            if (! batch.settle ()) {
+                fprintf (stderr, "alusweep: %s oscillating\n", netname);
+                return 1;
+            }
+
+            // compare what the netlist came up with
+            for (uint32_t w = 0; w < nwords; w ++) {
+                uint64_t bad = (batch.get (coutnet, w) ^ coutexp[w]) | (batch.get (voutnet, w) ^ voutexp[w]);
+                for (int i = 0; i < 8; i ++) bad |= batch.get (snets[i], w) ^ sexp[w][i];
+                for (; bad != 0; bad &= bad - 1) {
+                    if (++ errors > MAXPRINT) continue;
+                    uint32_t l   = __builtin_ctzll (bad);
+                    uint32_t vec = base + w * 64 + l;
+                    uint32_t s   = 0;
+                    uint32_t se  = 0;
+                    for (int i = 0; i < 8; i ++) {
+                        s  |= ((batch.get (snets[i], w) >> l) & 1) << i;
+                        se |= ((sexp[w][i] >> l) & 1) << i;
+                    }
+                    printf ("  %02X %c %02X cin=%u shr=%u  =>  S=%02X cout=%u vout=%u  sb S=%02X cout=%u vout=%u\n",
+                        vec & 0xFF, opchar, (vec >> 8) & 0xFF, (vec >> 16) & 1, (vec >> 17) & 1,
+                        s, (uint32_t) (batch.get (coutnet, w) >> l) & 1, (uint32_t) (batch.get (voutnet, w) >> l) & 1,
+                        se, (uint32_t) (coutexp[w] >> l) & 1, (uint32_t) (voutexp[w] >> l) & 1);
+                }
+            }
+        }
+
+        if (func < 16) printf ("IRFC IR=%2d  %c  %u vectors  %u errors\n", func, opchar, NVECS, errors);
+        else printf ("%-10s  %c  %u vectors  %u errors\n", (func == 16) ? "ADD" : "BONLY", opchar, NVECS, errors);
+        totalerrs += errors;
+        totalvecs += NVECS;
+    }
+
+    if (clock_gettime (CLOCK_MONOTONIC, &finished) < 0) abort ();
+    double secs = (finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) / 1000000000.0;
+    printf ("alusweep: %u vectors  %u errors  %.3f sec  %.0f vectors/sec  %llu cell evals\n",
+        totalvecs, totalerrs, secs, totalvecs / secs, (unsigned long long) batch.evals);
+    return (totalerrs == 0) ? 0 : 1;
+}
+
+// check NetlistBatch against Netlist::settle() for each number of words
+// one port at a time gets a new random value so flipflops don't see races
+// ...ports with cells driving them get it wire-anded on, eg, alueight's A[] pulled down by ~_aena
+static int crosscheck ()
+{
+    std::vector<uint32_t> innets;
+    for (uint32_t p = 0; p < netlist->nports; p ++) {
+        uint32_t n = netlist->portnet (p);
+        if (! (netlist->nets[n].flags & (NBN_GND | NBN_VCC))) innets.push_back (n);
+    }
+    std::sort (innets.begin (), innets.end ());
+    innets.erase (std::unique (innets.begin (), innets.end ()), innets.end ());
+    if (innets.empty ()) {
+        fprintf (stderr, "alusweep: %s has no ports to drive\n", netname);
+        return 1;
+    }
+
+    uint32_t totalerrs = 0;
+    for (uint32_t nwords = 1; nwords <= 8; nwords *= 2) {
+        srand (0);
+        NetlistBatch batch (netlist, nwords);
+        std::vector<Netlist *> scalars (nwords);
+        for (uint32_t w = 0; w < nwords; w ++) {
+            scalars[w] = new Netlist ();
+            if (! scalars[w]->load (netname)) return 1;
+        }
+
+        uint32_t errors = 0;
+        for (uint32_t step = 0; step < CHECKSTEPS; step ++) {
+            uint32_t innet = innets[rand()%innets.size()];
+            for (uint32_t w = 0; w < nwords; w ++) {
+                uint64_t val = randuint64 ();
+                batch.drive (innet, w, val);
+                scalars[w]->drive (innet, val);
+                if (! scalars[w]->settle ()) {
+                    fprintf (stderr, "alusweep: %s oscillating\n", netname);
+                    return 1;
+                }
+            }
+            if (! batch.settle ()) {
+                fprintf (stderr, "alusweep: %s oscillating\n", netname);
+                return 1;
+            }
+            for (uint32_t w = 0; w < nwords; w ++) {
+                for (uint32_t n = 0; n < netlist->nnets; n ++) {
+                    uint64_t diff = batch.get (n, w) ^ scalars[w]->vals[n];
+                    if ((diff != 0) && (++ errors <= MAXPRINT)) {
+                        printf ("  step %u word %u net %s is %016llX sb %016llX\n", step, w, netlist->nets[n].name,
+                            (unsigned long long) batch.get (n, w), (unsigned long long) scalars[w]->vals[n]);
+                    }
+                }
+            }
+        }
+        printf ("crosscheck: %3u lanes%s  %u steps  %u ports  %u mismatches\n",
+            nwords * 64, batch.avx2 ? " (avx2)" : "", CHECKSTEPS, (uint32_t) innets.size (), errors);
+        for (Netlist *scalar : scalars) delete scalar;
+        totalerrs += errors;
+    }
+    return (totalerrs == 0) ? 0 : 1;
+}
+
+static uint64_t randuint64 ()
+{
+    return ((uint64_t) rand () << 62) ^ ((uint64_t) rand () << 31) ^ (uint64_t) rand ();
+}
+
+static uint32_t findport (char const *name)
+{
+    int net = netlist->findport (name);
+    if (net < 0) {
+        fprintf (stderr, "alusweep: %s missing port %s\n", netname, name);
+        exit (1);
+    }
+    return net;
+}
+
+static void findports (uint32_t *nets, char const *name, int width)
+{
+    for (int i = 0; i < width; i ++) {
+        char portname[16];
+        sprintf (portname, "%s[%d]", name, i);
+        nets[i] = findport (portname);
+    }
+}
@@ -22,6 +22,9 @@
  * Requires four IOW56Paddles connected to the A,C,I,D connectors.
  * sudo insmod km/enabtsc.ko
  * sudo ./alutester -cpuhz 200 -loop {lo,hi} -pauseonerror
+ * or on the gate-level netlist without hardware, recording test vectors for faultsim
+ *   and when each connector pin settled with propagation delays:
+ *   ./alutester -netlist aluboard.bin [-vectors alutester.vec] [-nettiming alutester.txt] {lo,hi}
 
     what we send to ALU board:
 
@@ -77,6 +80,9 @@ int main (int argc, char **argv)
 {
     bool loopit = false;
     uint32_t cpuhz = DEFCPUHZ;
+    char const *netlistname = NULL;
+    char const *vectorsname = NULL;
+    char const *nettimingname = NULL;
 
     setlinebuf (stdout);
 
@@ -93,6 +99,9 @@ int main (int argc, char **argv)
             loopit = true;
             continue;
         }
+        int rc = NetlistLib::testeropt (argc, argv, &i, &netlistname, &vectorsname, &nettimingname);
+        if (rc < 0) return 1;
+        if (rc > 0) continue;
         if (strcasecmp (argv[i], "-pauseonerror") == 0) {
             pauseonerror = true;
             continue;
@@ -113,8 +122,12 @@ int main (int argc, char **argv)
     }
 
     // access seqboard circuitry via paddles
-    gpio = new PhysLib (cpuhz);
-    gpio->open ();
+    // ...or gate-level simulation of its netlist
+    gpio = NetlistLib::testeropen (netlistname, vectorsname, nettimingname);
+    if (gpio == NULL) {
+        gpio = new PhysLib (cpuhz);
+        gpio->open ();
+    }
 
     srand (0);
 
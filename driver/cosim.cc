@@ -0,0 +1,364 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// lockstep differential co-simulation for raspictl -cosim
+// fastcpu (maybe with fastxlat) runs the program for real, doing the memory accesses and system calls
+// ...and logs every access here as it makes it
+// shadow then steps through the same instructions cycle by cycle as the reference
+// ...getting its read data from the log and checking its addresses and write data against it
+// ...so it never touches memory or does system calls itself (and -randmem data is replayed as is)
+// registers, psw and cycle count are compared every time fastcpu->run() returns
+// ...which is every instruction if it is stopped after each one, else at sampled boundaries
+// shadow trails fastcpu by an instruction
+// ...as it can't end one until it sees if fastcpu took an interrupt before starting the next
+
+// fastxlat doesn't fetch opcodes or immediate values, they are part of the translation
+// ...so shadow reads them from memory, backing out writes fastcpu logged after that point
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "cosim.h"
+#include "disassemble.h"
+#include "gpiolib.h"
+
+//  input:
+//   memory = hode memory fastcpu is running from
+//   xlat = fastcpu has fastxlat translating (with setallslow())
+//   chkcycles = compare cycle counts
+CoSim::CoSim (uint8_t const *memory, bool xlat, bool chkcycles)
+{
+    this->memory    = memory;
+    this->xlat      = xlat;
+    this->chkcycles = chkcycles;
+    failed     = false;
+    started    = false;
+    wrpend     = false;
+    wrword     = false;
+    mq         = 0;
+    wraddr     = 0;
+    fastcycles = 0;
+    fastinsts  = 0;
+    histinsts  = 0;
+    ncycles    = 0;
+    memset (&startmark, 0, sizeof startmark);
+    memset (hists,   0, sizeof hists);
+    memset (states,  0, sizeof states);
+    memset (samples, 0, sizeof samples);
+    memset (pendwrites, 0, sizeof pendwrites);
+}
+
+// fastcpu is about to start running from the given state
+void CoSim::begin (uint16_t const *regs, uint16_t psw, uint64_t insts)
+{
+    startmark.insts  = insts;
+    startmark.cycles = 0;
+    memcpy (startmark.regs, regs, sizeof startmark.regs);
+    startmark.psw = psw;
+    fastinsts = insts;
+}
+
+// fastcpu fetched an opcode
+//  input:
+//   insts = fastcpu's instruction count, not counting the instruction being fetched
+void CoSim::fetch (uint64_t insts, uint16_t addr, uint16_t data)
+{
+    Access a = { insts, addr, data, 0, CA_FETCH, true };
+    accesses.push_back (a);
+}
+
+// fastcpu read data, including immediate values and the words iret pops
+void CoSim::read (uint64_t insts, uint16_t addr, bool word, uint16_t data)
+{
+    Access a = { insts, addr, data, 0, CA_READ, word };
+    accesses.push_back (a);
+}
+
+// fastcpu is about to write data, including system calls and the words interrupts push
+void CoSim::write (uint64_t insts, uint16_t addr, bool word, uint16_t data)
+{
+    uint16_t pair = addr & -2;
+    uint16_t old  = memory[pair] | (memory[pair+1] << 8);
+    Access a = { insts, addr, data, old, CA_WRITE, word };
+    accesses.push_back (a);
+    pendwrites[addr/2] ++;
+}
+
+// fastcpu->run() just returned, compare shadow up to where it can
+//  input:
+//   regs,psw = fastcpu state
+//   cycles = cycles the run() call took
+//   insts = fastcpu instruction count
+//  output:
+//   returns false: mismatch, message printed
+bool CoSim::step (uint16_t const *regs, uint16_t psw, uint32_t cycles, uint64_t insts)
+{
+    fastcycles += cycles;
+    fastinsts   = insts;
+    Mark mark;
+    mark.insts  = insts;
+    mark.cycles = fastcycles;
+    memcpy (mark.regs, regs, sizeof mark.regs);
+    mark.psw    = psw;
+    marks.push_back (mark);
+    return replay (false);
+}
+
+// fastcpu is done, finish up whatever it did last
+bool CoSim::finish ()
+{
+    if (! replay (true)) return false;
+    if (! accesses.empty ()) {
+        Access const &a = accesses.front ();
+        mismatch ("fastcpu did more accesses than shadow, next %s %04X data %04X", (a.kind == CA_WRITE) ? "write" : "read", a.addr, a.data);
+        return false;
+    }
+    return true;
+}
+
+// number of instructions compared so far
+uint64_t CoSim::getinsts ()
+{
+    return started ? shadow.getinsts () - startmark.insts : 0;
+}
+
+// step shadow through instructions fastcpu has done
+// it can't finish one until fastcpu has started the next (unless flushing)
+bool CoSim::replay (bool flush)
+{
+    if (failed) return false;
+
+    // fastcpu may have taken an interrupt before its first instruction
+    if (! started) {
+        if (fastinsts == startmark.insts) return true;
+        Access const &a = accesses.front ();
+        bool irq = (a.kind == CA_WRITE) && a.word && (a.addr == 0xFFFE) && (a.insts == startmark.insts);
+        shadow.resume (startmark.regs, startmark.psw, 0, startmark.insts, irq);
+        started = true;
+    }
+
+    for (;;) {
+        while (! marks.empty () && (marks.front ().insts <= shadow.getinsts ())) {
+            if ((marks.front ().insts == shadow.getinsts ()) && ! compare (&marks.front ())) return false;
+            marks.pop_front ();
+        }
+        if (shadow.getinsts () + (flush ? 1 : 2) > fastinsts) break;
+        if (! instr ()) return false;
+    }
+    return true;
+}
+
+// step shadow through one instruction, including interrupt before it
+// leaves it at FETCH1 or IREQ1 of the next instruction
+bool CoSim::instr ()
+{
+    uint64_t target = shadow.getinsts () + 1;
+    uint16_t pc = 0;
+    do {
+        if (shadow.state == Shadow::FETCH1) pc = shadow.regs[7];
+        if (! cycle ()) return false;
+    } while ((shadow.getinsts () < target) || ((shadow.state != Shadow::FETCH1) && (shadow.state != Shadow::IREQ1)));
+
+    Hist *h = &hists[target%COSIM_NHIST];
+    h->insts = target;
+    h->pc    = pc;
+    h->ir    = shadow.ir;
+    memcpy (h->regs, shadow.regs, sizeof h->regs);
+    h->psw   = shadow.psw;
+    h->irq   = shadow.state == Shadow::IREQ1;
+    histinsts = target;
+    return true;
+}
+
+// step shadow through one cycle
+bool CoSim::cycle ()
+{
+    uint32_t sample = shadow.readgpio ();
+    states[ncycles%COSIM_NHIST]  = shadow.state;
+    samples[ncycles%COSIM_NHIST] = sample;
+    ncycles ++;
+
+    uint16_t addr = (sample & G_DATA) / G_DATA0;
+    bool word = (sample & G_WORD) != 0;
+
+    // data written is on the bus the cycle after the address
+    if (wrpend) {
+        wrpend = false;
+        if (! writedata (addr)) return false;
+    }
+
+    if ((sample & G_READ) && ! readdata (shadow.state == Shadow::FETCH1, addr, word)) return false;
+
+    if (sample & G_WRITE) {
+        wrpend = true;
+        wraddr = addr;
+        wrword = word;
+    }
+
+    if (shadow.clock (mq, nextirq ())) {
+        mismatch ("shadow failed");
+        return false;
+    }
+    return true;
+}
+
+// shadow is reading memory, get what fastcpu read
+bool CoSim::readdata (bool fetch, uint16_t addr, bool word)
+{
+    // fetches are logged with count before the instruction, data reads with count including it
+    // ...same as shadow counts it at FETCH1 and after
+    uint64_t insts = shadow.getinsts ();
+    Kind kind = fetch ? CA_FETCH : CA_READ;
+
+    if (! accesses.empty ()) {
+        Access const &a = accesses.front ();
+        if ((a.kind == kind) && (a.insts == insts) && (a.addr == addr) && (a.word == word)) {
+            mq = a.data;
+            accesses.pop_front ();
+            return true;
+        }
+    }
+
+    // fastxlat doesn't fetch translated opcodes or immediate values
+    if (xlat) {
+        bool imm = (shadow.state == Shadow::LOAD1) && ((shadow.ir & 0x7F) == 0) && (((shadow.ir >> REGA) & 7) == 7);
+        bool logged = ! accesses.empty () && (accesses.front ().kind == kind) && (accesses.front ().insts == insts);
+        if ((fetch || imm) && ! logged) {
+            mq = undone (addr, word);
+            return true;
+        }
+    }
+
+    if (accesses.empty ()) {
+        mismatch ("shadow %s %04X, fastcpu didn't", fetch ? "fetch" : "read", addr);
+    } else {
+        Access const &a = accesses.front ();
+        mismatch ("shadow %s %s %04X, fastcpu %s %s %04X at instruction %llu",
+            fetch ? "fetch" : "read", word ? "word" : "byte", addr,
+            (a.kind == CA_FETCH) ? "fetch" : (a.kind == CA_READ) ? "read" : "write", a.word ? "word" : "byte", a.addr, a.insts);
+    }
+    return false;
+}
+
+// shadow is writing memory, check it against what fastcpu wrote
+bool CoSim::writedata (uint16_t data)
+{
+    uint16_t mask = wrword ? 0xFFFF : 0x00FF;
+    if (! accesses.empty ()) {
+        Access const &a = accesses.front ();
+        if ((a.kind == CA_WRITE) && (a.insts == shadow.getinsts ()) && (a.addr == wraddr) && (a.word == wrword) && (((a.data ^ data) & mask) == 0)) {
+            pendwrites[wraddr/2] --;
+            accesses.pop_front ();
+            return true;
+        }
+    }
+
+    if (accesses.empty ()) {
+        mismatch ("shadow write %04X data %04X, fastcpu didn't", wraddr, data & mask);
+    } else {
+        Access const &a = accesses.front ();
+        mismatch ("shadow write %s %04X data %04X, fastcpu %s %s %04X data %04X at instruction %llu",
+            wrword ? "word" : "byte", wraddr, data & mask,
+            (a.kind == CA_FETCH) ? "fetch" : (a.kind == CA_READ) ? "read" : "write", a.word ? "word" : "byte",
+            a.addr, a.data & (a.word ? 0xFFFF : 0x00FF), a.insts);
+    }
+    return false;
+}
+
+// see if fastcpu took an interrupt after the instruction shadow is on
+// it pushes psw first, logged with instruction count before the next fetch
+// ...whereas an instruction storing there has already been checked by the time it ends
+bool CoSim::nextirq ()
+{
+    if (accesses.empty ()) return false;
+    Access const &a = accesses.front ();
+    return (a.kind == CA_WRITE) && a.word && (a.addr == 0xFFFE) && (a.insts == shadow.getinsts ());
+}
+
+// shadow is at end of instruction where fastcpu->run() returned, compare state
+bool CoSim::compare (Mark const *mark)
+{
+    for (int i = 0; i < 8; i ++) {
+        if (shadow.regs[i] != mark->regs[i]) {
+            mismatch ("shadow R%d=%04X, fastcpu R%d=%04X", i, shadow.regs[i], i, mark->regs[i]);
+            return false;
+        }
+    }
+    if (shadow.psw != mark->psw) {
+        mismatch ("shadow PS=%04X, fastcpu PS=%04X", shadow.psw, mark->psw);
+        return false;
+    }
+    if (chkcycles && (shadow.getcycles () != mark->cycles)) {
+        mismatch ("shadow took %llu cycles, fastcpu %llu", shadow.getcycles (), mark->cycles);
+        return false;
+    }
+    return true;
+}
+
+// get memory contents as they were before writes fastcpu logged but shadow hasn't done yet
+uint16_t CoSim::undone (uint16_t addr, bool word)
+{
+    uint16_t pair = addr & -2;
+    uint16_t data = memory[pair] | (memory[pair+1] << 8);
+    if (pendwrites[addr/2] != 0) {
+        for (Access const &a : accesses) {
+            if ((a.kind == CA_WRITE) && ((a.addr & -2) == pair)) {
+                data = a.old;
+                break;
+            }
+        }
+    }
+    if (addr & 1) data = (data >> 8) | (data << 8);
+    return word ? data : (data & 0xFF);
+}
+
+// print mismatch message followed by recent history
+void CoSim::mismatch (char const *fmt, ...)
+{
+    failed = true;
+
+    va_list ap;
+    va_start (ap, fmt);
+    fprintf (stderr, "CoSim::mismatch: ");
+    vfprintf (stderr, fmt, ap);
+    fprintf (stderr, "\n");
+    va_end (ap);
+
+    fprintf (stderr, "CoSim::mismatch: shadow state=%s instruction=%llu\n", Shadow::statestr (shadow.state), shadow.getinsts ());
+    for (int i = COSIM_NHIST; -- i >= 0;) {
+        if (histinsts < startmark.insts + i + 1) continue;
+        Hist const *h = &hists[(histinsts-i)%COSIM_NHIST];
+        fprintf (stderr, "CoSim::mismatch: %12llu  %04X  %04X  %-24s  R0=%04X R1=%04X R2=%04X R3=%04X R4=%04X R5=%04X R6=%04X PC=%04X PS=%04X%s\n",
+            h->insts, h->pc, h->ir, disassemble (h->ir).c_str (),
+            h->regs[0], h->regs[1], h->regs[2], h->regs[3], h->regs[4], h->regs[5], h->regs[6], h->regs[7], h->psw,
+            h->irq ? "  **INTERRUPT**" : "");
+    }
+    for (int i = COSIM_NHIST; -- i >= 0;) {
+        if (ncycles < (uint64_t) i + 1) continue;
+        unsigned int j = (ncycles - i - 1) % COSIM_NHIST;
+        fprintf (stderr, "CoSim::mismatch: state=%-6s  sample=%08X %s\n", Shadow::statestr (states[j]), samples[j], GpioLib::decocon (CON_G, samples[j]).c_str ());
+    }
+    if (! marks.empty ()) {
+        Mark const *m = &marks.front ();
+        fprintf (stderr, "CoSim::mismatch: fastcpu %12llu  R0=%04X R1=%04X R2=%04X R3=%04X R4=%04X R5=%04X R6=%04X PC=%04X PS=%04X\n",
+            m->insts, m->regs[0], m->regs[1], m->regs[2], m->regs[3], m->regs[4], m->regs[5], m->regs[6], m->regs[7], m->psw);
+    }
+}
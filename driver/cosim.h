@@ -0,0 +1,105 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+#ifndef _COSIM_H
+#define _COSIM_H
+
+#include <deque>
+
+#include "miscdefs.h"
+#include "shadow.h"
+
+#define COSIM_NHIST 8           // instructions and cycles of history printed with a mismatch
+
+// runs shadow in lockstep behind fastcpu and compares them (raspictl -cosim)
+struct CoSim {
+    CoSim (uint8_t const *memory, bool xlat, bool chkcycles);
+    void begin (uint16_t const *regs, uint16_t psw, uint64_t insts);
+    void fetch (uint64_t insts, uint16_t addr, uint16_t data);
+    void read (uint64_t insts, uint16_t addr, bool word, uint16_t data);
+    void write (uint64_t insts, uint16_t addr, bool word, uint16_t data);
+    bool step (uint16_t const *regs, uint16_t psw, uint32_t cycles, uint64_t insts);
+    bool finish ();
+    uint64_t getinsts ();
+
+private:
+    enum Kind { CA_FETCH, CA_READ, CA_WRITE };
+
+    // memory access made by fastcpu, oldest first
+    struct Access {
+        uint64_t insts;         // fastcpu's instruction count when it made the access
+        uint16_t addr;
+        uint16_t data;
+        uint16_t old;           // writes: word at addr&-2 before the write
+        Kind kind;
+        bool word;
+    };
+
+    // where fastcpu->run() returned
+    struct Mark {
+        uint64_t insts;
+        uint64_t cycles;        // cycles spent in run() since begin()
+        uint16_t regs[8];
+        uint16_t psw;
+    };
+
+    // instruction shadow has executed
+    struct Hist {
+        uint64_t insts;
+        uint16_t pc;
+        uint16_t ir;
+        uint16_t regs[8];
+        uint16_t psw;
+        bool irq;               // interrupt taken at end of instruction
+    };
+
+    bool chkcycles;             // compare cycle counts (off if system calls add memcycles)
+    bool failed;                // mismatch found, stop comparing
+    bool started;               // shadow has been resumed from begin() state
+    bool wrpend;                // shadow wrote address last cycle, data this cycle
+    bool wrword;
+    bool xlat;                  // fastxlat doesn't log fetches or immediate values
+    Shadow shadow;
+    std::deque<Access> accesses;
+    std::deque<Mark> marks;
+    uint8_t const *memory;
+    uint16_t mq;                // data shadow is reading this cycle
+    uint16_t wraddr;
+    uint64_t fastcycles;        // cycles fastcpu has spent in run() since begin()
+    uint64_t fastinsts;         // instructions fastcpu has started
+    uint64_t histinsts;         // last instruction in hists[]
+    uint64_t ncycles;           // cycles shadow has executed
+    Mark startmark;
+    Hist hists[COSIM_NHIST];
+    Shadow::State states[COSIM_NHIST];
+    uint32_t samples[COSIM_NHIST];
+    uint32_t pendwrites[0x8000];    // logged writes shadow hasn't done yet, indexed by addr/2
+
+    bool replay (bool flush);
+    bool instr ();
+    bool cycle ();
+    bool readdata (bool fetch, uint16_t addr, bool word);
+    bool writedata (uint16_t data);
+    bool nextirq ();
+    bool compare (Mark const *mark);
+    uint16_t undone (uint16_t addr, bool word);
+    void mismatch (char const *fmt, ...);
+};
+
+#endif
@@ -0,0 +1,590 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+// simulates the cpu an instruction at a time for -nohw mode
+// does the same thing as shadow.cc but without going through the gpio pins
+// cycle counts match what shadow would count for the same instruction stream
+
+// all 65536 opcodes are decoded once at startup into the decodes[] table
+// run() then dispatches directly from one opcode's handler to the next via computed goto
+// if xlat is set, run() goes through the attention path each instruction to run translated code (fastxlat.cc)
+// ...likewise if profiler is set so it can see each instruction (profiler.cc)
+// ...or tracer so it can record each instruction (tracer.cc)
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "disassemble.h"
+#include "fastcpu.h"
+#include "fastxlat.h"
+#include "hodestats.h"
+#include "miscdefs.h"
+#include "profiler.h"
+#include "shadow.h"
+#include "tracer.h"
+
+// indices into run()'s handlers[] table
+enum {
+    H_BR, H_BEQ, H_BNE, H_BLT, H_BGE, H_BLE, H_BGT, H_BLO,
+    H_BHIS, H_BLOS, H_BHI, H_BMI, H_BPL, H_BVS, H_BVC,
+    H_LSR, H_ASR, H_ROR, H_MOV, H_NEG, H_INC, H_COM,
+    H_OR, H_AND, H_XOR, H_ADD, H_SUB, H_ADC, H_SBB,
+    H_STW, H_STB, H_LDA, H_LDBU, H_LDW, H_LDBS, H_LDBUI, H_LDWI, H_LDBSI,
+    H_HALT, H_IRET, H_WRPS, H_RDPS, H_BAD, H_COUNT
+};
+
+FastCpu::Decode *FastCpu::decodes;
+char const **FastCpu::disasms;
+
+FastCpu::FastCpu (MemReader *memreader, MemWriter *memwriter, void *memparam, uint32_t volatile *intreq)
+{
+    this->memreader = memreader;
+    this->memwriter = memwriter;
+    this->fetcher   = memreader;
+    this->memparam  = memparam;
+    this->intreq    = intreq;
+    idledetect = false;
+    printinstr = false;
+    stacklimit = 0;
+    stopcycle  = -1ULL;
+    idlecycles = 0;
+    idleinsts  = 0;
+    xlat = NULL;
+    profiler = NULL;
+    tracer   = NULL;
+    statecounts = NULL;
+    irqs = 0;
+    memset (regs, 0, sizeof regs);
+}
+
+// reset cpu, leaving it as shadow would be at beginning of first FETCH1
+void FastCpu::reset ()
+{
+    regs[7] = 0;
+    loadPsw (0);
+    halted  = false;
+    stopeoi = psw;
+    idlebranch = 0xFFFF;
+    sidefx  = 0;
+    cycle   = FC_RESET;
+    insts   = 0;
+}
+
+// execute instructions until HALT, stack pointer goes below stacklimit or cycle count reaches stopcycle
+// takes interrupts when requested by *intreq and enabled by psw
+//  output:
+//   returns FR_HALT: executed a HALT, call again to resume after the HALT
+//          FR_STACK: stack pointer below stacklimit
+//           FR_STOP: cycle count reached stopcycle, call again to resume
+//           FR_IDLE: idledetect found a spin-wait loop, idlecycles,idleinsts = one iteration
+//                    call again to resume at the top of the loop
+int FastCpu::run ()
+{
+    static void const *const handlers[H_COUNT] = {
+        &&h_br, &&h_beq, &&h_bne, &&h_blt, &&h_bge, &&h_ble, &&h_bgt, &&h_blo,
+        &&h_bhis, &&h_blos, &&h_bhi, &&h_bmi, &&h_bpl, &&h_bvs, &&h_bvc,
+        &&h_lsr, &&h_asr, &&h_ror, &&h_mov, &&h_neg, &&h_inc, &&h_com,
+        &&h_or, &&h_and, &&h_xor, &&h_add, &&h_sub, &&h_adc, &&h_sbb,
+        &&h_stw, &&h_stb, &&h_lda, &&h_ldbu, &&h_ldw, &&h_ldbs, &&h_ldbui, &&h_ldwi, &&h_ldbsi,
+        &&h_halt, &&h_iret, &&h_wrps, &&h_rdps, &&h_bad
+    };
+
+    // FastCpus might be running in several threads, C++ makes sure only one does the decoding
+    static bool const predecoded = predecode (handlers);
+    (void) predecoded;
+
+    Decode const *dc;
+
+    // psw as of end of last instruction, used to see if interrupts are enabled
+    // like shadow, it is the psw from before WRPS or IRET updated it
+    // and the irq line shadow sampled during HALT is from before the wait
+    // ...so the instruction after the HALT executes before the interrupt is taken
+    // ...and if returned FR_STOP, it is whatever it was when stopped
+    uint16_t eoi = halted ? 0 : stopeoi;
+    halted = false;
+
+    // something wants to see every instruction, checked once here so NEXT tests just one flag for all of them
+    bool const hooked = printinstr | (xlat != NULL) | (profiler != NULL) | (tracer != NULL) | (statecounts != NULL);
+
+    // end of one instruction, start of next
+    // if nothing special going on, fetch opcode and jump to its handler
+#define NEXT(eoipsw) do {                                                                   \
+    eoi = (eoipsw);                                                                         \
+    if (__builtin_expect ((*intreq != 0) | (regs[6] < stacklimit) | (cycle >= stopcycle) |  \
+            hooked, 0)) {                                                                   \
+        goto attention;                                                                     \
+    }                                                                                       \
+    ir = fetcher (memparam, regs[7], true);                                                 \
+    regs[7] += 2;                                                                           \
+    dc = &decodes[ir];                                                                      \
+    addcycles (dc->cycles);                                                                 \
+    insts ++;                                                                               \
+    goto *dc->handler;                                                                      \
+} while (0)
+
+#define BRANCHIF(cond) do {                                                                 \
+    if (cond) {                                                                             \
+        regs[7] += dc->offs;                                                                \
+        if (__builtin_expect (idledetect & (dc->offs >> 15), 0)) goto idlecheck;            \
+    }                                                                                       \
+    NEXT (psw);                                                                             \
+} while (0)
+
+    // alu result to Rd (unless R7) and update psw n,z,v,c, leaving ie as is
+#define ARITHDONE(result, v, c) do {                                                        \
+    uint16_t alu = (result);                                                                \
+    if (dc->rd != 7) regs[dc->rd] = alu;                                                    \
+    psw = (uint16_t) ((psw & 0x8000) | 0x7FF0 | ((alu >> 12) & 8) | ((alu == 0) << 2) |     \
+            ((v) << 1) | (c));                                                              \
+    NEXT (psw);                                                                             \
+} while (0)
+
+    // something needs attention before starting next instruction
+attention:
+    if (regs[6] < stacklimit) return FR_STACK;
+    if (cycle >= stopcycle) {
+        stopeoi = eoi;
+        return FR_STOP;
+    }
+    if ((*intreq != 0) && (eoi & 0x8000)) {
+        if (printinstr) {
+            printregs ();
+            printf ("**INTERRUPT**\n");
+        }
+        if (profiler != NULL) profiler->interrupt (regs[7], cycle);
+        if (tracer != NULL) tracer->interrupt (regs, psw, cycle);
+        if (statecounts != NULL) {
+            for (int s = Shadow::IREQ1; s <= Shadow::IREQ5; s ++) hsinc (&statecounts[s], 1);
+        }
+        sidefx ++;
+        irqs ++;
+        addcycles (FC_IREQ);
+        memwriter (memparam, 0xFFFE, true, psw);
+        psw &= 0x7FFF;
+        memwriter (memparam, 0xFFFC, true, regs[7]);
+        regs[7] = 2;
+    }
+
+    // run translated code if there is any for this PC
+    // but not if interrupts were just enabled, let the interpreter take them after the next instruction
+    if ((xlat != NULL) && (eoi == psw) && ! printinstr) {
+        uint32_t rc = xlat->execute ();
+        if ((rc & 0xFFFF) != XR_NONE) sidefx ++;
+        switch (rc & 0xFFFF) {
+            case XR_NONE: break;
+            case XR_NEXT: {
+                eoi = psw;
+                goto attention;
+            }
+            case XR_HALT: {
+                halted = true;
+                return FR_HALT;
+            }
+            case XR_EOI: {
+                eoi = rc >> 16;
+                goto attention;
+            }
+        }
+    }
+
+    if (printinstr) printregs ();
+    ir = fetcher (memparam, regs[7], true);
+    regs[7] += 2;
+    dc = &decodes[ir];
+    if (printinstr) printopcode ();
+    if (profiler != NULL) profiler->instr (regs[7] - 2, ir, regs, cycle);
+    if (tracer != NULL) tracer->instr (regs[7] - 2, ir, regs, psw, cycle);
+    if (statecounts != NULL) countstates ();
+    addcycles (dc->cycles);
+    insts ++;
+    goto *dc->handler;
+
+h_br:   BRANCHIF (true);
+h_beq:  BRANCHIF (psw & 4);
+h_bne:  BRANCHIF (! (psw & 4));
+h_blt:  BRANCHIF (((psw >> 3) ^ (psw >> 1)) & 1);
+h_bge:  BRANCHIF (! (((psw >> 3) ^ (psw >> 1)) & 1));
+h_ble:  BRANCHIF ((((psw >> 3) ^ (psw >> 1)) | (psw >> 2)) & 1);
+h_bgt:  BRANCHIF (! ((((psw >> 3) ^ (psw >> 1)) | (psw >> 2)) & 1));
+h_blo:  BRANCHIF (psw & 1);
+h_bhis: BRANCHIF (! (psw & 1));
+h_blos: BRANCHIF (psw & 5);
+h_bhi:  BRANCHIF (! (psw & 5));
+h_bmi:  BRANCHIF (psw & 8);
+h_bpl:  BRANCHIF (! (psw & 8));
+h_bvs:  BRANCHIF (psw & 2);
+h_bvc:  BRANCHIF (! (psw & 2));
+
+h_lsr: {
+    uint16_t a = regs[dc->ra];
+    ARITHDONE (a >> 1, 0, a & 1);
+}
+h_asr: {
+    uint16_t a = regs[dc->ra];
+    ARITHDONE ((sint16_t) a >> 1, 0, a & 1);
+}
+h_ror: {
+    uint16_t a = regs[dc->ra];
+    ARITHDONE ((a >> 1) | ((psw & 1) << 15), 0, a & 1);
+}
+h_mov: {
+    ARITHDONE (regs[dc->rb], 0, psw & 1);
+}
+h_neg: {
+    uint16_t b = regs[dc->rb];
+    ARITHDONE (- b, b == 0x8000, psw & 1);
+}
+h_inc: {
+    uint16_t b = regs[dc->rb];
+    ARITHDONE (b + 1, b == 0x7FFF, psw & 1);
+}
+h_com: {
+    ARITHDONE (~ regs[dc->rb], 0, psw & 1);
+}
+h_or: {
+    ARITHDONE (regs[dc->ra] | regs[dc->rb], 0, psw & 1);
+}
+h_and: {
+    ARITHDONE (regs[dc->ra] & regs[dc->rb], 0, psw & 1);
+}
+h_xor: {
+    ARITHDONE (regs[dc->ra] ^ regs[dc->rb], 0, psw & 1);
+}
+h_add: {
+    uint32_t a = regs[dc->ra];
+    uint32_t b = regs[dc->rb];
+    uint32_t s = a + b;
+    ARITHDONE (s, ((~ (a ^ b) & (a ^ s)) >> 15) & 1, s >> 16);
+}
+h_adc: {
+    uint32_t a = regs[dc->ra];
+    uint32_t b = regs[dc->rb];
+    uint32_t s = a + b + (psw & 1);
+    ARITHDONE (s, ((~ (a ^ b) & (a ^ s)) >> 15) & 1, s >> 16);
+}
+h_sub: {
+    uint32_t a = regs[dc->ra];
+    uint32_t b = regs[dc->rb];
+    uint32_t s = a - b;
+    ARITHDONE (s, (((a ^ b) & (a ^ s)) >> 15) & 1, (s >> 16) & 1);
+}
+h_sbb: {
+    uint32_t a = regs[dc->ra];
+    uint32_t b = regs[dc->rb];
+    uint32_t s = a - b - (psw & 1);
+    ARITHDONE (s, (((a ^ b) & (a ^ s)) >> 15) & 1, (s >> 16) & 1);
+}
+
+h_stw: {
+    sidefx ++;
+    if (xlat != NULL) xlat->invalidate (regs[dc->ra] + dc->offs, 2);
+    memwriter (memparam, (uint16_t) (regs[dc->ra] + dc->offs), true, regs[dc->rd]);
+    NEXT (psw);
+}
+h_stb: {
+    sidefx ++;
+    if (xlat != NULL) xlat->invalidate (regs[dc->ra] + dc->offs, 1);
+    memwriter (memparam, (uint16_t) (regs[dc->ra] + dc->offs), false, regs[dc->rd]);
+    NEXT (psw);
+}
+h_lda: {
+    regs[dc->rd] = regs[dc->ra] + dc->offs;
+    NEXT (psw);
+}
+h_ldbu: {
+    uint16_t mq = memreader (memparam, (uint16_t) (regs[dc->ra] + dc->offs), false);
+    regs[dc->rd] = mq & 0xFF;
+    NEXT (psw);
+}
+h_ldw: {
+    uint16_t mq = memreader (memparam, (uint16_t) (regs[dc->ra] + dc->offs), true);
+    regs[dc->rd] = mq;
+    NEXT (psw);
+}
+h_ldbs: {
+    uint16_t mq = memreader (memparam, (uint16_t) (regs[dc->ra] + dc->offs), false);
+    regs[dc->rd] = (sint8_t) mq;
+    NEXT (psw);
+}
+
+    // LDx Rd,#immediate: load from 0(R7) then increment R7 over the immediate value
+h_ldbui: {
+    uint16_t mq = memreader (memparam, regs[7], false);
+    regs[dc->rd] = mq & 0xFF;
+    regs[7] += 2;
+    NEXT (psw);
+}
+h_ldwi: {
+    uint16_t mq = memreader (memparam, regs[7], true);
+    regs[dc->rd] = mq;
+    regs[7] += 2;
+    NEXT (psw);
+}
+h_ldbsi: {
+    uint16_t mq = memreader (memparam, regs[7], false);
+    regs[dc->rd] = (sint8_t) mq;
+    regs[7] += 2;
+    NEXT (psw);
+}
+
+h_halt: {
+    halted = true;
+    return FR_HALT;
+}
+h_iret: {
+    sidefx ++;
+    uint16_t oldpsw = psw;
+    regs[7] = memreader (memparam, 0xFFFC, true);
+    loadPsw (memreader (memparam, 0xFFFE, true));
+    NEXT (oldpsw);
+}
+h_wrps: {
+    sidefx ++;
+    uint16_t oldpsw = psw;
+    loadPsw (regs[dc->rb]);
+    NEXT (oldpsw);
+}
+h_rdps: {
+    regs[dc->rd] = psw;
+    NEXT (psw);
+}
+
+h_bad: {
+    fprintf (stderr, "FastCpu::run: bad opcode %04X at %04X\n", ir, (uint16_t) (regs[7] - 2));
+    abort ();
+}
+
+    // idledetect and a backward branch was just taken
+    // if it is the same branch as last time, with the same registers and nothing stored, interrupts enabled,
+    // ...the loop will keep going around exactly the same until an interrupt
+    // translated code or an interrupt in between counts as something stored as they bump sidefx
+idlecheck: {
+    uint16_t brpc = regs[7] - dc->offs - 2;
+    if ((brpc == idlebranch) && (sidefx == idlesidefx) && (psw == idlepsw) && (psw & 0x8000) &&
+            (cycle - idlecycle <= IDLEMAXCYCLES) && (memcmp (regs, idleregs, sizeof idleregs) == 0)) {
+        idlecycles = cycle - idlecycle;
+        idleinsts  = insts - idleinst;
+        stopeoi    = psw;
+        return FR_IDLE;
+    }
+    idlebranch = brpc;
+    idlepsw    = psw;
+    memcpy (idleregs, regs, sizeof idleregs);
+    idlesidefx = sidefx;
+    idlecycle  = cycle;
+    idleinst   = insts;
+    NEXT (psw);
+}
+
+#undef ARITHDONE
+#undef BRANCHIF
+#undef NEXT
+}
+
+uint64_t FastCpu::getcycles ()
+{
+#if UNIPROC
+    return cycle;
+#else
+    return __atomic_load_n (&cycle, __ATOMIC_RELAXED);
+#endif
+}
+
+uint64_t FastCpu::getinsts ()
+{
+    return insts;
+}
+
+uint64_t FastCpu::getirqs ()
+{
+    return irqs;
+}
+
+// get state needed to resume where run() left off, for saving in a snapshot
+bool FastCpu::gethalted ()
+{
+    return halted;
+}
+
+uint16_t FastCpu::geteoi ()
+{
+    return stopeoi;
+}
+
+// restore state saved in a snapshot
+void FastCpu::setstate (uint64_t cycle, uint64_t insts, bool halted, uint16_t eoi)
+{
+    this->cycle   = cycle;
+    this->insts   = insts;
+    this->halted  = halted;
+    this->stopeoi = eoi;
+}
+
+// we are the only writer so a plain atomic store is enough for mintimesthread() to read it
+void FastCpu::addcycles (uint32_t n)
+{
+#if UNIPROC
+    cycle += n;
+#else
+    __atomic_store_n (&cycle, cycle + n, __ATOMIC_RELAXED);
+#endif
+}
+
+// count the shadow states the instruction just fetched goes through
+void FastCpu::countstates ()
+{
+    hsinc (&statecounts[Shadow::FETCH1], 1);
+    hsinc (&statecounts[Shadow::FETCH2], 1);
+    switch ((ir >> 13) & 7) {
+        case 0: {
+            if ((ir & 0b0001110000000001) != 0) {
+                hsinc (&statecounts[Shadow::BCC1], 1);
+            } else {
+                switch ((ir >> 1) & 7) {
+                    case 0: hsinc (&statecounts[Shadow::HALT1], 1); break;
+                    case 1: {
+                        for (int s = Shadow::IRET1; s <= Shadow::IRET4; s ++) hsinc (&statecounts[s], 1);
+                        break;
+                    }
+                    case 2: hsinc (&statecounts[Shadow::WRPS1], 1); break;
+                    case 3: hsinc (&statecounts[Shadow::RDPS1], 1); break;
+                }
+            }
+            break;
+        }
+        case 1: hsinc (&statecounts[Shadow::ARITH1], 1); break;
+        case 2:
+        case 3: {
+            hsinc (&statecounts[Shadow::STORE1], 1);
+            hsinc (&statecounts[Shadow::STORE2], 1);
+            break;
+        }
+        case 4: hsinc (&statecounts[Shadow::LDA1], 1); break;
+        default: {
+            hsinc (&statecounts[Shadow::LOAD1], 1);
+            hsinc (&statecounts[Shadow::LOAD2], 1);
+            if (decodes[ir].cycles == FC_LOADI) hsinc (&statecounts[Shadow::LOAD3], 1);
+            break;
+        }
+    }
+}
+
+// fix up psw bits before writing it
+void FastCpu::loadPsw (uint16_t newpsw)
+{
+    psw = (uint16_t) (newpsw | 0x7FF0);
+}
+
+// -printinstr output, same format as shadow
+void FastCpu::printregs ()
+{
+    printf ("%llu R0=%04X R1=%04X R2=%04X R3=%04X R4=%04X R5=%04X R6=%04X  PC=%04X  PS=%04X  ",
+        cycle, regs[0], regs[1], regs[2], regs[3], regs[4], regs[5], regs[6], regs[7], psw);
+}
+
+void FastCpu::printopcode ()
+{
+    if (disasms == NULL) {
+        disasms = (char const **) calloc (0x10000, sizeof *disasms);
+        if (disasms == NULL) abort ();
+    }
+    if (disasms[ir] == NULL) {
+        disasms[ir] = strdup (disassemble (ir).c_str ());
+    }
+
+    if ((ir & 0xC000) == 0x4000) {
+        Decode const *dc = &decodes[ir];
+        uint16_t addr = regs[dc->ra] + dc->offs;
+        int      size = (ir & 0x2000) ? 2 : 4;
+        uint16_t data = regs[dc->rd] & ((ir & 0x2000) ? 0x00FF : 0xFFFF);
+        printf ("%-16s  %04X <= %0*X\n", disasms[ir], addr, size, data);
+    } else {
+        printf ("%s\n", disasms[ir]);
+    }
+}
+
+// decode all possible opcodes
+//  input:
+//   handlers = run()'s handler labels indexed by H_*
+//  output:
+//   returns true
+bool FastCpu::predecode (void const *const *handlers)
+{
+    // indexed by ((opc >> 9) & 0xE) | (opc & 1)
+    static uint8_t const bcchandlers[16] = {
+        H_BAD, H_BR,  H_BEQ, H_BNE,  H_BLT,  H_BGE, H_BLE, H_BGT,
+        H_BLO, H_BHIS, H_BLOS, H_BHI, H_BMI, H_BPL, H_BVS, H_BVC
+    };
+
+    // indexed by opc & 15
+    static uint8_t const arithhandlers[16] = {
+        H_LSR, H_ASR, H_ROR, H_BAD, H_MOV, H_NEG, H_INC, H_COM,
+        H_OR,  H_AND, H_XOR, H_BAD, H_ADD, H_SUB, H_ADC, H_SBB
+    };
+
+    decodes = new Decode[0x10000];
+
+    for (uint32_t opc = 0; opc < 0x10000; opc ++) {
+        Decode *dc = &decodes[opc];
+        dc->ra   = (opc >> REGA) & 7;
+        dc->rb   = (opc >> REGB) & 7;
+        dc->rd   = (opc >> REGD) & 7;
+        dc->offs = ((opc & 0x7F) ^ 0x40) - 0x40;
+
+        int h = H_BAD;
+        switch ((opc >> 13) & 7) {
+            case 0: {
+                if ((opc & 0b0001110000000001) != 0) {
+                    h = bcchandlers[((opc>>9)&0xE)|(opc&1)];
+                    dc->offs   = ((opc & 0x03FE) ^ 0x0200) - 0x0200;
+                    dc->cycles = FC_BCC;
+                    break;
+                }
+                switch ((opc & 0b0000000000001110) >> 1) {
+                    case 0: h = H_HALT; dc->cycles = FC_HALT; break;
+                    case 1: h = H_IRET; dc->cycles = FC_IRET; break;
+                    case 2: h = H_WRPS; dc->cycles = FC_WRPS; break;
+                    case 3: h = H_RDPS; dc->cycles = FC_RDPS; break;
+                    default: dc->cycles = 0; break;
+                }
+                break;
+            }
+            case 1: {
+                h = arithhandlers[opc&15];
+                dc->cycles = FC_ARITH;
+                break;
+            }
+            case 2: h = H_STW; dc->cycles = FC_STORE; break;
+            case 3: h = H_STB; dc->cycles = FC_STORE; break;
+            case 4: h = H_LDA; dc->cycles = FC_LDA; break;
+            case 5:
+            case 6:
+            case 7: {
+                bool imm = ((opc & 0x7F) == 0) && (dc->ra == 7) && (dc->rd != 7);
+                int  op  = (opc >> 13) - 5;
+                h = (imm ? H_LDBUI : H_LDBU) + op;
+                dc->cycles = imm ? FC_LOADI : FC_LOAD;
+                break;
+            }
+        }
+        dc->handler = handlers[h];
+    }
+    return true;
+}
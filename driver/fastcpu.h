@@ -0,0 +1,123 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+#ifndef _FASTCPU_H
+#define _FASTCPU_H
+
+#include "miscdefs.h"
+
+// number of cycles (shadow states) each instruction takes, including FETCH1,FETCH2
+#define FC_BCC   3
+#define FC_ARITH 3
+#define FC_STORE 4
+#define FC_LDA   3
+#define FC_LOAD  4
+#define FC_LOADI 5      // LOAD immediate, ie, LDx Rd,0(R7) with Rd != R7
+#define FC_HALT  3
+#define FC_IRET  6
+#define FC_WRPS  3
+#define FC_RDPS  3
+#define FC_IREQ  5
+#define FC_RESET 2
+
+// run() return values
+#define FR_HALT  0      // executed a HALT instruction
+#define FR_STACK 1      // stack pointer below stacklimit
+#define FR_STOP  2      // cycle count reached stopcycle
+#define FR_IDLE  3      // spinning in a loop only an interrupt can get it out of (see idledetect)
+
+#define IDLEMAXCYCLES 256   // longest loop iteration idledetect looks for
+
+struct FastXlat;
+struct Profiler;
+struct Tracer;
+
+struct FastCpu {
+    friend struct FastXlat;
+
+    typedef uint16_t MemReader (void *param, uint16_t addr, bool word);
+    typedef void MemWriter (void *param, uint16_t addr, bool word, uint16_t data);
+
+    bool idledetect;            // return FR_IDLE for spin-wait loops
+    bool printinstr;
+    uint16_t stacklimit;
+    uint32_t idlecycles;        // cycles and instructions in one iteration of FR_IDLE loop
+    uint32_t idleinsts;
+    uint64_t volatile stopcycle;
+    FastXlat *xlat;
+    Profiler *profiler;
+    Tracer *tracer;
+    MemReader *fetcher;         // reads opcodes, same as memreader unless caller wants to tell them apart
+    uint64_t *statecounts;      // counts cycles in each Shadow::State (HodeStats), slows every instruction
+
+    uint16_t ir;
+    uint16_t regs[8];
+    uint16_t psw;
+
+    FastCpu (MemReader *memreader, MemWriter *memwriter, void *memparam, uint32_t volatile *intreq);
+    void reset ();
+    int run ();
+    void addcycles (uint32_t n);
+    uint64_t getcycles ();
+    uint64_t getinsts ();
+    uint64_t getirqs ();
+    bool gethalted ();
+    uint16_t geteoi ();
+    void setstate (uint64_t cycle, uint64_t insts, bool halted, uint16_t eoi);
+
+private:
+    // opcode decoded ahead of time, one for each of the 65536 possible opcodes
+    struct Decode {
+        void const *handler;    // label in run() that executes the opcode
+        uint16_t offs;          // sign-extended LSOF or BROF
+        uint8_t ra, rb, rd;     // register numbers
+        uint8_t cycles;         // number of cycles opcode takes including FETCH1,FETCH2
+    };
+
+    static Decode *decodes;
+    static char const **disasms;
+
+    bool halted;
+    uint16_t stopeoi;
+    MemReader *memreader;
+    MemWriter *memwriter;
+    void *memparam;
+    uint32_t volatile *intreq;
+    uint64_t cycle;
+    uint64_t insts;
+    uint64_t irqs;
+
+    // state at the end of the last iteration of the loop being checked by idledetect
+    uint16_t idlebranch;        // address of loop's backward branch
+    uint16_t idlepsw;
+    uint16_t idleregs[7];
+    uint32_t idlesidefx;
+    uint32_t sidefx;            // incremented by anything that might write memory or change psw
+    uint64_t idlecycle;
+    uint64_t idleinst;
+
+    void loadPsw (uint16_t newpsw);
+    void countstates ();
+    void printregs ();
+    void printopcode ();
+
+    static bool predecode (void const *const *handlers);
+};
+
+#endif
@@ -0,0 +1,982 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+// translates hot blocks of hode code to x86_64 code for raspictl -nohw -translate
+// FastCpu::run() calls execute() at instruction boundaries and interprets whatever isn't translated
+
+// a block ends with a branch, HALT, IRET, WRPS or anything else that writes R7
+// blocks jump directly to one another via blocktab[] as long as no interrupt is pending
+// ...so interrupts are taken at block boundaries
+
+// hode registers and psw stay in the FastCpu struct, the generated code works on them there:
+//   rbx = FastCpu struct
+//   r12 = hode memory
+//   r13 = blocktab[]
+//   r14 = pageflags[]
+//   r15 = FastCpu's intreq pointer
+// cycle and instruction counts are added at the beginning of each block
+// ...and backed out around the slow path calls to memreader,memwriter so they are exact there
+
+// writes from translated code, the interpreter or system calls (via invalidate())
+// ...to memory holding translated code throw the translations away
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+
+#include "fastcpu.h"
+#include "fastxlat.h"
+
+// pageflags[] bits
+#define XP_CODE   1     // page has translated code in it
+#define XP_ROSIZE 2     // page is at least partially below rosize
+#define XP_WATCH  4     // page has watchwrite address in it
+
+// x86 registers
+#define XAX 0
+#define XCX 1
+#define XDX 2
+
+// x86 condition codes
+#define CC_B  2
+#define CC_AE 3
+#define CC_E  4
+#define CC_NE 5
+
+// where setpsw() gets V and C bits from
+#define VS_ZERO 0       // zero
+#define VS_X86  1       // x86 overflow flag
+#define CS_KEEP 0       // leave psw C bit as is
+#define CS_X86  1       // x86 carry flag
+#define CS_CL   2       // low bit of cl register
+
+static bool validop (uint16_t ir);
+static bool loadimm (uint16_t ir);
+static bool endsblock (uint16_t ir);
+
+// see if host can run translated code
+bool FastXlat::supported ()
+{
+#if defined(__x86_64__)
+    return true;
+#else
+    return false;
+#endif
+}
+
+FastXlat::FastXlat (FastCpu *cpu, uint8_t *memory)
+{
+    this->cpu = cpu;
+    this->memory = memory;
+    allslow = false;
+
+    dregs   = (uint8_t *) cpu->regs        - (uint8_t *) cpu;
+    dpsw    = (uint8_t *) &cpu->psw        - (uint8_t *) cpu;
+    dir     = (uint8_t *) &cpu->ir         - (uint8_t *) cpu;
+    dcycle  = (uint8_t *) &cpu->cycle      - (uint8_t *) cpu;
+    dinsts  = (uint8_t *) &cpu->insts      - (uint8_t *) cpu;
+    dstklim = (uint8_t *) &cpu->stacklimit - (uint8_t *) cpu;
+    dstopcyc = (uint8_t *) &cpu->stopcycle - (uint8_t *) cpu;
+
+    memset (blocktab,  0, sizeof blocktab);
+    memset (hotcounts, 0, sizeof hotcounts);
+    memset (pageflags, 0, sizeof pageflags);
+    watchpage = -1;
+    invalcount = 0;
+
+    cache = (uint8_t *) mmap (NULL, XLATCACHESIZE, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (cache == MAP_FAILED) {
+        fprintf (stderr, "FastXlat: error mmapping code cache: %m\n");
+        abort ();
+    }
+    cp = cache;
+
+    // uint32_t enter (void const *entry)
+    enter = (Enter *) cp;
+    e1 (0x53);                                  // push rbx
+    e1 (0x55);                                  // push rbp
+    e1 (0x41); e1 (0x54);                       // push r12
+    e1 (0x41); e1 (0x55);                       // push r13
+    e1 (0x41); e1 (0x56);                       // push r14
+    e1 (0x41); e1 (0x57);                       // push r15
+    e1 (0x48); e1 (0x83); e1 (0xEC); e1 (0x08); // sub rsp,8 (align stack for calls)
+    e1 (0x48); e1 (0xBB); e8 ((uint64_t) cpu);  // movabs rbx,cpu
+    e1 (0x49); e1 (0xBC); e8 ((uint64_t) memory);
+    e1 (0x49); e1 (0xBD); e8 ((uint64_t) blocktab);
+    e1 (0x49); e1 (0xBE); e8 ((uint64_t) pageflags);
+    e1 (0x49); e1 (0xBF); e8 ((uint64_t) cpu->intreq);
+    e1 (0xFF); e1 (0xE7);                       // jmp rdi
+
+    // translated code jumps here to return XR_NEXT
+    exitnext = cp;
+    e1 (0xB8); e4 (XR_NEXT);                    // mov eax,XR_NEXT
+
+    // translated code jumps here to return eax
+    epilogue = cp;
+    e1 (0x48); e1 (0x83); e1 (0xC4); e1 (0x08); // add rsp,8
+    e1 (0x41); e1 (0x5F);                       // pop r15
+    e1 (0x41); e1 (0x5E);                       // pop r14
+    e1 (0x41); e1 (0x5D);                       // pop r13
+    e1 (0x41); e1 (0x5C);                       // pop r12
+    e1 (0x5D);                                  // pop rbp
+    e1 (0x5B);                                  // pop rbx
+    e1 (0xC3);                                  // ret
+
+    cacheblocks = cp;
+}
+
+// execute translated code starting at cpu->regs[7]
+// translates the block if it is hot enough
+//  output:
+//   returns XR_NONE: nothing translated there, interpret an instruction
+//                    else: XR_NEXT, XR_HALT, XR_EOI
+uint32_t FastXlat::execute ()
+{
+    uint16_t pc = cpu->regs[7];
+    if (pc & 1) return XR_NONE;
+    void const *entry = blocktab[pc/2];
+    if (entry == NULL) {
+        if (++ hotcounts[pc/2] < XLATHOT) return XR_NONE;
+        hotcounts[pc/2] = 0;
+        entry = translate (pc);
+        if (entry == NULL) return XR_NONE;
+    }
+    return enter (entry);
+}
+
+// memory is being written by something other than translated code
+void FastXlat::invalidate (uint16_t addr, uint32_t size)
+{
+    invalpages (addr, size);
+}
+
+// all loads and stores must go through memreader,memwriter so they can be traced (-cosim)
+// ...immediate values are still taken from memory when the block is translated
+// call before anything is translated
+void FastXlat::setallslow ()
+{
+    allslow = true;
+}
+
+// writes below rosize must go through memwriter so it can complain
+void FastXlat::setrosize (uint16_t rosize)
+{
+    for (uint32_t pg = 0; pg < sizeof pageflags; pg ++) {
+        if ((pg << XLATPGSHIFT) < rosize) pageflags[pg] |= XP_ROSIZE;
+                                    else pageflags[pg] &= ~XP_ROSIZE;
+    }
+}
+
+// writes to the watchwrite address must go through memwriter so it can print a message
+void FastXlat::setwatch (uint16_t addr)
+{
+    if (watchpage >= 0) pageflags[watchpage] &= ~XP_WATCH;
+    watchpage = addr >> XLATPGSHIFT;
+    pageflags[watchpage] |= XP_WATCH;
+}
+
+// throw away translations of any blocks that overlap the given range of memory
+//  output:
+//   returns true: something was thrown away
+bool FastXlat::invalpages (uint16_t addr, uint32_t size)
+{
+    bool inval = false;
+    uint32_t end = addr + size;
+    for (uint32_t pg = addr >> XLATPGSHIFT; (pg <= (end - 1) >> XLATPGSHIFT) && (pg < sizeof pageflags); pg ++) {
+        if (pageflags[pg] & XP_CODE) {
+            std::vector<Extent> &exts = pageblocks[pg];
+            for (size_t i = 0; i < exts.size ();) {
+                Extent ext = exts[i];
+                if ((ext.pc < end) && (ext.end > addr)) {
+                    blocktab[ext.pc/2]  = NULL;
+                    hotcounts[ext.pc/2] = 0;
+                    exts[i] = exts.back ();
+                    exts.pop_back ();
+                    inval = true;
+                    invalcount ++;
+                } else {
+                    i ++;
+                }
+            }
+            if (exts.empty ()) pageflags[pg] &= ~XP_CODE;
+        }
+    }
+    return inval;
+}
+
+// code cache full, throw everything away
+// only called when no translated code is running
+void FastXlat::flush ()
+{
+    memset (blocktab, 0, sizeof blocktab);
+    for (uint32_t pg = 0; pg < sizeof pageflags; pg ++) {
+        pageblocks[pg].clear ();
+        pageflags[pg] &= ~XP_CODE;
+    }
+    cp = cacheblocks;
+}
+
+// translate block starting at the given pc
+//  output:
+//   returns NULL: can't translate anything there
+//              else: entrypoint to translated code
+void const *FastXlat::translate (uint16_t pc)
+{
+    if (cp + XLATMAXINSTS * 256 > cache + XLATCACHESIZE) flush ();
+
+    // find instructions in the block
+    uint16_t irs[XLATMAXINSTS];
+    uint16_t pcnexts[XLATMAXINSTS];
+    int n = 0;
+    uint16_t xpc = pc;
+    bool ended = false;
+    while (! ended && (n < XLATMAXINSTS) && (xpc < XLATMAGIC)) {
+        uint16_t ir = memory[xpc] | (memory[xpc+1] << 8);
+        if (! validop (ir)) break;
+        if (loadimm (ir) && (xpc + 2 >= XLATMAGIC)) break;
+
+        // translated IRET reads memory directly, leave it to the interpreter if everything must go through memreader
+        if (allslow && ((ir & 0xFC0F) == 0x0002)) break;
+        xpc += loadimm (ir) ? 4 : 2;
+        irs[n] = ir;
+        pcnexts[n] = xpc;
+        n ++;
+        ended = endsblock (ir);
+    }
+    if (n == 0) return NULL;
+
+    // leave short loops that branch back without storing anything to the interpreter
+    // ...so FastCpu's idledetect can see them, translated code going around them would hide them
+    // the loop might start before this block if an interrupt returned to the middle of it
+    if (cpu->idledetect && ((irs[n-1] >> 13) == 0) && ((irs[n-1] & 0b0001110000000001) != 0)) {
+        uint16_t top = pcnexts[n-1] + (((irs[n-1] & 0x03FE) ^ 0x0200) - 0x0200);
+        if ((top <= pc) && (pcnexts[n-1] - top <= XLATIDLEINSTS * 2)) {
+            uint16_t xpc;
+            for (xpc = top; xpc < pcnexts[n-1]; xpc += 2) {
+                uint16_t ir = memory[xpc] | (memory[xpc+1] << 8);
+                if (((ir >> 13) == 2) || ((ir >> 13) == 3)) break;
+            }
+            if (xpc >= pcnexts[n-1]) return NULL;
+        }
+    }
+
+    // see which instructions need to update psw
+    // anything that might leave the block needs all psw bits up to date
+    // ...and stores can leave the block when they call a system service
+    bool flags[XLATMAXINSTS];
+    bool livenzv = true;
+    bool livec = true;
+    for (int i = n; -- i >= 0;) {
+        uint16_t ir = irs[i];
+        flags[i] = false;
+        switch (ir >> 13) {
+            case 1: {
+                int op = ir & 15;
+                bool writesc = (op < 3) || (op >= 12);
+                bool readsc  = (op == 2) || (op >= 14);
+                flags[i] = livenzv || (writesc && livec);
+                livenzv = false;
+                if (writesc) livec = false;
+                if (readsc)  livec = true;
+                break;
+            }
+            case 4:
+            case 5:
+            case 6:
+            case 7: break;
+            default: {
+                livenzv = true;
+                livec   = true;
+                break;
+            }
+        }
+    }
+
+    uint32_t totcyc = 0;
+    for (int i = 0; i < n; i ++) {
+        totcyc += FastCpu::decodes[irs[i]].cycles;
+    }
+
+    // generate code
+    uint8_t *entry = cp;
+    addmem64 (dcycle, totcyc);
+    addmem64 (dinsts, n);
+
+    std::vector<Stub> stubs;
+    uint32_t cycsofar = 0;
+    for (int i = 0; i < n; i ++) {
+        uint16_t ir = irs[i];
+        uint16_t pcnext = pcnexts[i];
+        cycsofar += FastCpu::decodes[ir].cycles;
+        uint32_t cycback = totcyc - cycsofar;
+        uint32_t insback = n - 1 - i;
+        int ra = (ir >> REGA) & 7;
+        int rb = (ir >> REGB) & 7;
+        int rd = (ir >> REGD) & 7;
+
+        switch (ir >> 13) {
+            case 0: {
+                if ((ir & 0b0001110000000001) != 0) {
+                    branch (ir, pcnext);
+                    break;
+                }
+                switch ((ir & 0b0000000000001110) >> 1) {
+
+                    // HALT
+                    case 0: {
+                        stregimm (7, pcnext);
+                        e1 (0x66); e1 (0xC7); rbxdisp (0, dir); e2 (ir);
+                        e1 (0xB8); e4 (XR_HALT);                    // mov eax,XR_HALT
+                        jmpto (epilogue);
+                        break;
+                    }
+
+                    // IRET
+                    case 1: {
+                        e1 (0x0F); e1 (0xB7); rbxdisp (XAX, dpsw);  // movzx eax,psw
+                        e1 (0xC1); e1 (0xE0); e1 (0x10);            // shl eax,16
+                        e1 (0x83); e1 (0xC8); e1 (XR_EOI);          // or eax,XR_EOI
+                        e1 (0x41); e1 (0x0F); e1 (0xB7); e1 (0x94); e1 (0x24); e4 (0xFFFC);  // movzx edx,[r12+0xFFFC]
+                        streg (XDX, 7);
+                        e1 (0x41); e1 (0x0F); e1 (0xB7); e1 (0x94); e1 (0x24); e4 (0xFFFE);  // movzx edx,[r12+0xFFFE]
+                        e1 (0x81); e1 (0xCA); e4 (0x7FF0);          // or edx,0x7FF0
+                        e1 (0x66); e1 (0x89); rbxdisp (XDX, dpsw);
+                        jmpto (epilogue);
+                        break;
+                    }
+
+                    // WRPS
+                    case 2: {
+                        e1 (0x0F); e1 (0xB7); rbxdisp (XAX, dpsw);  // movzx eax,psw
+                        e1 (0xC1); e1 (0xE0); e1 (0x10);            // shl eax,16
+                        e1 (0x83); e1 (0xC8); e1 (XR_EOI);          // or eax,XR_EOI
+                        ldreg (XDX, rb, pcnext);
+                        e1 (0x81); e1 (0xCA); e4 (0x7FF0);          // or edx,0x7FF0
+                        e1 (0x66); e1 (0x89); rbxdisp (XDX, dpsw);
+                        stregimm (7, pcnext);
+                        jmpto (epilogue);
+                        break;
+                    }
+
+                    // RDPS
+                    case 3: {
+                        e1 (0x0F); e1 (0xB7); rbxdisp (XAX, dpsw);  // movzx eax,psw
+                        streg (XAX, rd);
+                        if (rd == 7) chaindyn ();
+                        break;
+                    }
+                }
+                break;
+            }
+            case 1: {
+                arith (ir, pcnext, flags[i]);
+                break;
+            }
+            case 2:
+            case 3: {
+                store (ir, pcnext, stubs, cycback, insback);
+                break;
+            }
+            case 4: {
+                uint16_t offs = ((ir & 0x7F) ^ 0x40) - 0x40;
+                if (ra == 7) {
+                    if (rd == 7) chain (pcnext + offs);
+                    else stregimm (rd, pcnext + offs);
+                } else {
+                    ldreg (XAX, ra, pcnext);
+                    if (offs != 0) {
+                        e1 (0x05); e4 ((int16_t) offs);             // add eax,offs
+                    }
+                    streg (XAX, rd);
+                    if (rd == 7) chaindyn ();
+                }
+                break;
+            }
+            default: {
+                load (ir, pcnext, stubs, cycback, insback);
+                if (rd == 7) chaindyn ();
+                break;
+            }
+        }
+    }
+
+    // block didn't end with a branch, continue with whatever is next
+    if (! ended) chain (xpc);
+
+    for (size_t i = 0; i < stubs.size (); i ++) {
+        slowpath (&stubs[i]);
+    }
+
+    // writes to any of the block's instructions will throw the block away
+    Extent ext;
+    ext.pc  = pc;
+    ext.end = xpc;
+    for (uint32_t pg = pc >> XLATPGSHIFT; pg <= (uint32_t) (xpc - 1) >> XLATPGSHIFT; pg ++) {
+        pageblocks[pg].push_back (ext);
+        pageflags[pg] |= XP_CODE;
+    }
+
+    blocktab[pc/2] = entry;
+    return entry;
+}
+
+// arithmetic instruction
+//  input:
+//   flags = false: psw doesn't need to be updated cuz something later in block overwrites it
+void FastXlat::arith (uint16_t ir, uint16_t pcnext, bool flags)
+{
+    int ra = (ir >> REGA) & 7;
+    int rb = (ir >> REGB) & 7;
+    int rd = (ir >> REGD) & 7;
+
+    int vsrc = VS_ZERO;
+    int csrc = CS_KEEP;
+
+    switch (ir & 15) {
+
+        // LSR
+        case 0: {
+            ldreg (XAX, ra, pcnext);
+            e1 (0xD1); e1 (0xE8);                               // shr eax,1
+            csrc = CS_X86;
+            break;
+        }
+
+        // ASR
+        case 1: {
+            if (ra == 7) {
+                e1 (0xB8); e4 ((int16_t) pcnext);               // mov eax,pcnext
+            } else {
+                e1 (0x0F); e1 (0xBF); rbxdisp (XAX, dregs + ra * 2);    // movsx eax,Ra
+            }
+            e1 (0xD1); e1 (0xF8);                               // sar eax,1
+            csrc = CS_X86;
+            break;
+        }
+
+        // ROR
+        case 2: {
+            ldreg (XAX, ra, pcnext);
+            e1 (0x66); e1 (0x0F); e1 (0xBA); rbxdisp (4, dpsw); e1 (0);  // bt psw,0
+            e1 (0x66); e1 (0xD1); e1 (0xD8);                    // rcr ax,1
+            e1 (0x0F); e1 (0x92); e1 (0xC1);                    // setc cl
+            e1 (0x66); e1 (0x85); e1 (0xC0);                    // test ax,ax
+            csrc = CS_CL;
+            break;
+        }
+
+        // MOV
+        case 4: {
+            ldreg (XAX, rb, pcnext);
+            e1 (0x66); e1 (0x85); e1 (0xC0);                    // test ax,ax
+            break;
+        }
+
+        // NEG
+        case 5: {
+            ldreg (XAX, rb, pcnext);
+            e1 (0x66); e1 (0xF7); e1 (0xD8);                    // neg ax
+            vsrc = VS_X86;
+            break;
+        }
+
+        // INC
+        case 6: {
+            ldreg (XAX, rb, pcnext);
+            e1 (0x66); e1 (0xFF); e1 (0xC0);                    // inc ax
+            vsrc = VS_X86;
+            break;
+        }
+
+        // COM
+        case 7: {
+            ldreg (XAX, rb, pcnext);
+            e1 (0xF7); e1 (0xD0);                               // not eax
+            e1 (0x66); e1 (0x85); e1 (0xC0);                    // test ax,ax
+            break;
+        }
+
+        // OR, AND, XOR
+        case 8:
+        case 9:
+        case 10: {
+            static uint8_t const ops[3] = { 0x09, 0x21, 0x31 };
+            ldreg (XAX, ra, pcnext);
+            ldreg (XDX, rb, pcnext);
+            e1 (0x66); e1 (ops[(ir&15)-8]); e1 (0xD0);          // op ax,dx
+            break;
+        }
+
+        // ADD, SUB, ADC, SBB
+        case 12:
+        case 13:
+        case 14:
+        case 15: {
+            static uint8_t const ops[4] = { 0x01, 0x29, 0x11, 0x19 };
+            ldreg (XAX, ra, pcnext);
+            ldreg (XDX, rb, pcnext);
+            if ((ir & 15) >= 14) {
+                e1 (0x66); e1 (0x0F); e1 (0xBA); rbxdisp (4, dpsw); e1 (0);  // bt psw,0
+            }
+            e1 (0x66); e1 (ops[(ir&15)-12]); e1 (0xD0);         // op ax,dx
+            vsrc = VS_X86;
+            csrc = CS_X86;
+            break;
+        }
+
+        default: abort ();
+    }
+
+    if (rd != 7) streg (XAX, rd);
+    if (flags) setpsw (vsrc, csrc);
+}
+
+// LDBU, LDW, LDBS
+// leaves loaded value in eax and Rd
+void FastXlat::load (uint16_t ir, uint16_t pcnext, std::vector<Stub> &stubs, uint32_t cycback, uint32_t insback)
+{
+    int ra = (ir >> REGA) & 7;
+    int rd = (ir >> REGD) & 7;
+    uint16_t offs = ((ir & 0x7F) ^ 0x40) - 0x40;
+    int op = ir >> 13;
+    bool word = (op == 6);
+
+    // immediate value is part of the block so it is a constant
+    if (loadimm (ir)) {
+        uint16_t val = memory[pcnext-2];
+        if (word) val |= memory[pcnext-1] << 8;
+        if (op == 7) val = (int8_t) val;
+        stregimm (rd, val);
+        return;
+    }
+
+    Stub stub;
+    stub.njumps  = 0;
+    stub.ir      = ir;
+    stub.pcnext  = pcnext;
+    stub.cycback = cycback;
+    stub.insback = insback;
+
+    static uint8_t const loadops[3] = { 0xB6, 0xB7, 0xBE };    // movzx byte, movzx word, movsx byte
+
+    if (ra == 7) {
+        uint16_t addr = pcnext + offs;
+        if ((addr < XLATMAGIC) && ! (word && (addr & 1)) && ! allslow) {
+
+            // pc-relative address of ordinary memory, load directly
+            e1 (0x41); e1 (0x0F); e1 (loadops[op-5]); e1 (0x84); e1 (0x24); e4 (addr);  // movzx/movsx eax,[r12+addr]
+            streg (XAX, rd);
+            return;
+        }
+        e1 (0xB8); e4 (addr);                                   // mov eax,addr
+    } else {
+        ldreg (XAX, ra, pcnext);
+        if (offs != 0) {
+            e1 (0x05); e4 ((int16_t) offs);                     // add eax,offs
+            e1 (0x0F); e1 (0xB7); e1 (0xC0);                    // movzx eax,ax
+        }
+    }
+
+    // magic page and odd word addresses go the slow way
+    if (allslow) {
+        stub.jumps[stub.njumps++] = jmp ();
+        stub.cont = cp;
+        streg (XAX, rd);
+        stubs.push_back (stub);
+        return;
+    }
+    e1 (0x3D); e4 (XLATMAGIC);                                  // cmp eax,XLATMAGIC
+    stub.jumps[stub.njumps++] = jcc (CC_AE);
+    if (word) {
+        e1 (0xA8); e1 (0x01);                                   // test al,1
+        stub.jumps[stub.njumps++] = jcc (CC_NE);
+    }
+
+    e1 (0x41); e1 (0x0F); e1 (loadops[op-5]); e1 (0x04); e1 (0x04);    // movzx/movsx eax,[r12+rax]
+    stub.cont = cp;
+    streg (XAX, rd);
+
+    stubs.push_back (stub);
+}
+
+// STW, STB
+void FastXlat::store (uint16_t ir, uint16_t pcnext, std::vector<Stub> &stubs, uint32_t cycback, uint32_t insback)
+{
+    int ra = (ir >> REGA) & 7;
+    int rd = (ir >> REGD) & 7;
+    uint16_t offs = ((ir & 0x7F) ^ 0x40) - 0x40;
+    bool word = ! (ir & 0x2000);
+
+    Stub stub;
+    stub.njumps  = 0;
+    stub.ir      = ir;
+    stub.pcnext  = pcnext;
+    stub.cycback = cycback;
+    stub.insback = insback;
+
+    ldreg (XDX, rd, pcnext);
+    if (ra == 7) {
+        e1 (0xB8); e4 ((uint16_t) (pcnext + offs));             // mov eax,addr
+    } else {
+        ldreg (XAX, ra, pcnext);
+        if (offs != 0) {
+            e1 (0x05); e4 ((int16_t) offs);                     // add eax,offs
+            e1 (0x0F); e1 (0xB7); e1 (0xC0);                    // movzx eax,ax
+        }
+    }
+
+    // magic page, odd word addresses and flagged pages go the slow way
+    if (allslow) {
+        stub.jumps[stub.njumps++] = jmp ();
+        stub.cont = cp;
+        stubs.push_back (stub);
+        return;
+    }
+    e1 (0x3D); e4 (XLATMAGIC);                                  // cmp eax,XLATMAGIC
+    stub.jumps[stub.njumps++] = jcc (CC_AE);
+    if (word) {
+        e1 (0xA8); e1 (0x01);                                   // test al,1
+        stub.jumps[stub.njumps++] = jcc (CC_NE);
+    }
+    e1 (0x89); e1 (0xC1);                                       // mov ecx,eax
+    e1 (0xC1); e1 (0xE9); e1 (XLATPGSHIFT);                     // shr ecx,XLATPGSHIFT
+    e1 (0x41); e1 (0x80); e1 (0x3C); e1 (0x0E); e1 (0x00);      // cmp byte [r14+rcx],0
+    stub.jumps[stub.njumps++] = jcc (CC_NE);
+
+    if (word) {
+        e1 (0x66); e1 (0x41); e1 (0x89); e1 (0x14); e1 (0x04);  // mov [r12+rax],dx
+    } else {
+        e1 (0x41); e1 (0x88); e1 (0x14); e1 (0x04);             // mov [r12+rax],dl
+    }
+    stub.cont = cp;
+
+    stubs.push_back (stub);
+}
+
+// load or store going through memreader or memwriter
+// stores can return from translated code if they did a system call or wrote over translated code
+//  input:
+//   eax = hode address
+//   edx = data for stores
+void FastXlat::slowpath (Stub const *stub)
+{
+    for (int i = 0; i < stub->njumps; i ++) {
+        patch (stub->jumps[i], cp);
+    }
+
+    int op = stub->ir >> 13;
+    bool store = (op == 2) || (op == 3);
+    bool word  = (op == 2) || (op == 6);
+
+    stregimm (7, stub->pcnext);
+    addmem64 (dcycle, - stub->cycback);
+    addmem64 (dinsts, - stub->insback);
+    e1 (0x48); e1 (0x89); e1 (0xDF);                            // mov rdi,rbx
+    e1 (0x89); e1 (0xC6);                                       // mov esi,eax
+    if (store) {
+        e1 (0x89); e1 (0xD1);                                   // mov ecx,edx
+    }
+    e1 (0xBA); e4 (word);                                       // mov edx,word
+    if (store) {
+        callto ((void const *) writeslow);
+        e1 (0x85); e1 (0xC0);                                   // test eax,eax
+        jccto (CC_NE, epilogue);
+    } else {
+        callto ((void const *) readslow);
+    }
+    addmem64 (dcycle, stub->cycback);
+    addmem64 (dinsts, stub->insback);
+    if (op == 5) {
+        e1 (0x0F); e1 (0xB6); e1 (0xC0);                        // movzx eax,al
+    }
+    if (op == 7) {
+        e1 (0x0F); e1 (0xBE); e1 (0xC0);                        // movsx eax,al
+    }
+    jmpto (stub->cont);
+}
+
+// conditional branch at end of block
+void FastXlat::branch (uint16_t ir, uint16_t pcnext)
+{
+    // indexed by ((ir >> 9) & 0xE) | (ir & 1)
+    // mask = psw bits to test, or 0 for N^V, 1 for (N^V)|Z
+    static uint8_t const masks[16] = { 0, 0, 4, 4, 0, 0, 1, 1, 1, 1, 5, 5, 8, 8, 2, 2 };
+
+    uint16_t target = pcnext + (((ir & 0x03FE) ^ 0x0200) - 0x0200);
+    int c = ((ir >> 9) & 0xE) | (ir & 1);
+
+    if (c == 1) {
+        chain (target);
+        return;
+    }
+
+    if ((c < 4) || (c > 7)) {
+        e1 (0xF6); rbxdisp (0, dpsw); e1 (masks[c]);            // test byte psw,mask
+    } else {
+        e1 (0x0F); e1 (0xB7); rbxdisp (XAX, dpsw);              // movzx eax,psw
+        e1 (0x89); e1 (0xC2);                                   // mov edx,eax
+        e1 (0xC1); e1 (0xEA); e1 (0x02);                        // shr edx,2
+        e1 (0x31); e1 (0xC2);                                   // xor edx,eax
+        if (masks[c]) {
+            e1 (0x83); e1 (0xE0); e1 (0x04);                    // and eax,4
+            e1 (0xD1); e1 (0xE8);                               // shr eax,1
+            e1 (0x09); e1 (0xC2);                               // or edx,eax
+        }
+        e1 (0xF6); e1 (0xC2); e1 (0x02);                        // test dl,2
+    }
+
+    // even numbered conditions branch if bits set, odd if clear
+    uint8_t *taken = jcc ((c & 1) ? CC_E : CC_NE);
+    chain (pcnext);
+    patch (taken, cp);
+    chain (target);
+}
+
+// end of block going to constant address
+// jump directly to translation if there is one and nothing else needs attention
+void FastXlat::chain (uint16_t target)
+{
+    stregimm (7, target);
+    if (target & 1) {
+        jmpto (exitnext);
+        return;
+    }
+    checkattn ();
+    e1 (0x49); e1 (0x8B); e1 (0x85); e4 (target * 4);          // mov rax,[r13+target/2*8]
+    e1 (0x48); e1 (0x85); e1 (0xC0);                            // test rax,rax
+    jccto (CC_E, exitnext);
+    e1 (0xFF); e1 (0xE0);                                       // jmp rax
+}
+
+// end of block going to whatever R7 was set to
+void FastXlat::chaindyn ()
+{
+    checkattn ();
+    e1 (0x0F); e1 (0xB7); rbxdisp (XAX, dregs + 14);            // movzx eax,R7
+    e1 (0xA8); e1 (0x01);                                       // test al,1
+    jccto (CC_NE, exitnext);
+    e1 (0x49); e1 (0x8B); e1 (0x44); e1 (0x85); e1 (0x00);      // mov rax,[r13+rax*4]
+    e1 (0x48); e1 (0x85); e1 (0xC0);                            // test rax,rax
+    jccto (CC_E, exitnext);
+    e1 (0xFF); e1 (0xE0);                                       // jmp rax
+}
+
+// return to FastCpu::run() if interrupt can be taken, stack overflowed or reached stopcycle
+void FastXlat::checkattn ()
+{
+    e1 (0x41); e1 (0x8B); e1 (0x0F);                            // mov ecx,[r15]
+    e1 (0x85); e1 (0xC9);                                       // test ecx,ecx
+    e1 (0x74); e1 (13);                                         // jz .+13
+    e1 (0xF6); rbxdisp (0, dpsw + 1); e1 (0x80);                // test byte psw+1,0x80
+    jccto (CC_NE, exitnext);
+    e1 (0x0F); e1 (0xB7); rbxdisp (XCX, dregs + 12);            // movzx ecx,R6
+    e1 (0x66); e1 (0x3B); rbxdisp (XCX, dstklim);               // cmp cx,stacklimit
+    jccto (CC_B, exitnext);
+    e1 (0x48); e1 (0x8B); rbxdisp (XCX, dcycle);                // mov rcx,cycle
+    e1 (0x48); e1 (0x3B); rbxdisp (XCX, dstopcyc);              // cmp rcx,stopcycle
+    jccto (CC_AE, exitnext);
+}
+
+// update psw from x86 flags as set by the last arithmetic instruction
+// result has already been saved in Rd
+void FastXlat::setpsw (int vsrc, int csrc)
+{
+    e1 (0x9F);                                                  // lahf
+    if (vsrc == VS_X86) {
+        e1 (0x0F); e1 (0x90); e1 (0xC1);                        // seto cl
+    }
+    e1 (0x0F); e1 (0xB6); e1 (0xC4);                            // movzx eax,ah
+    if (csrc == CS_X86) {
+        e1 (0x89); e1 (0xC2);                                   // mov edx,eax
+    }
+    e1 (0xC1); e1 (0xE8); e1 (0x04);                            // shr eax,4
+    e1 (0x83); e1 (0xE0); e1 (0x0C);                            // and eax,0x0C (N,Z)
+    if (csrc == CS_X86) {
+        e1 (0x83); e1 (0xE2); e1 (0x01);                        // and edx,1
+        e1 (0x09); e1 (0xD0);                                   // or eax,edx
+    }
+    if (csrc == CS_CL) {
+        e1 (0x0F); e1 (0xB6); e1 (0xC9);                        // movzx ecx,cl
+        e1 (0x09); e1 (0xC8);                                   // or eax,ecx
+    }
+    if (vsrc == VS_X86) {
+        e1 (0x0F); e1 (0xB6); e1 (0xC9);                        // movzx ecx,cl
+        e1 (0x01); e1 (0xC9);                                   // add ecx,ecx
+        e1 (0x09); e1 (0xC8);                                   // or eax,ecx
+    }
+    e1 (0x0F); e1 (0xB7); rbxdisp (XDX, dpsw);                  // movzx edx,psw
+    e1 (0x81); e1 (0xE2); e4 ((csrc == CS_KEEP) ? 0x8001 : 0x8000);
+    e1 (0x09); e1 (0xD0);                                       // or eax,edx
+    e1 (0x0D); e4 (0x7FF0);                                     // or eax,0x7FF0
+    e1 (0x66); e1 (0x89); rbxdisp (XAX, dpsw);                  // mov psw,ax
+}
+
+// load hode register into eax, ecx or edx
+// R7 is whatever it will be at end of instruction, ie, address of next instruction
+void FastXlat::ldreg (int x86, int hreg, uint16_t pcnext)
+{
+    if (hreg == 7) {
+        e1 (0xB8 + x86); e4 (pcnext);                           // mov e?x,pcnext
+    } else {
+        e1 (0x0F); e1 (0xB7); rbxdisp (x86, dregs + hreg * 2);  // movzx e?x,Rn
+    }
+}
+
+// store ax, cx or dx into hode register
+void FastXlat::streg (int x86, int hreg)
+{
+    e1 (0x66); e1 (0x89); rbxdisp (x86, dregs + hreg * 2);      // mov Rn,?x
+}
+
+void FastXlat::stregimm (int hreg, uint16_t val)
+{
+    e1 (0x66); e1 (0xC7); rbxdisp (0, dregs + hreg * 2); e2 (val); // mov word Rn,val
+}
+
+// modrm byte for [rbx+disp32] followed by the disp32
+void FastXlat::rbxdisp (int x86, int32_t disp)
+{
+    e1 (0x83 | (x86 << 3));
+    e4 (disp);
+}
+
+// add qword [rbx+disp],val
+void FastXlat::addmem64 (int32_t disp, int32_t val)
+{
+    if (val != 0) {
+        e1 (0x48); e1 (0x81); rbxdisp (0, disp); e4 (val);
+    }
+}
+
+// conditional jump, returns where to patch in the target
+uint8_t *FastXlat::jcc (int cc)
+{
+    e1 (0x0F); e1 (0x80 | cc);
+    uint8_t *at = cp;
+    e4 (0);
+    return at;
+}
+
+uint8_t *FastXlat::jmp ()
+{
+    e1 (0xE9);
+    uint8_t *at = cp;
+    e4 (0);
+    return at;
+}
+
+void FastXlat::jccto (int cc, uint8_t const *target)
+{
+    patch (jcc (cc), target);
+}
+
+void FastXlat::jmpto (uint8_t const *target)
+{
+    patch (jmp (), target);
+}
+
+void FastXlat::callto (void const *func)
+{
+    e1 (0x48); e1 (0xB8); e8 ((uint64_t) func);                 // movabs rax,func
+    e1 (0xFF); e1 (0xD0);                                       // call rax
+}
+
+void FastXlat::patch (uint8_t *at, uint8_t const *target)
+{
+    int32_t rel = target - (at + 4);
+    memcpy (at, &rel, 4);
+}
+
+void FastXlat::e1 (uint32_t b)
+{
+    *(cp ++) = b;
+}
+
+void FastXlat::e2 (uint32_t w)
+{
+    uint16_t v = w;
+    memcpy (cp, &v, 2);
+    cp += 2;
+}
+
+void FastXlat::e4 (uint32_t l)
+{
+    memcpy (cp, &l, 4);
+    cp += 4;
+}
+
+void FastXlat::e8 (uint64_t q)
+{
+    memcpy (cp, &q, 8);
+    cp += 8;
+}
+
+// called by translated code to read memory it can't read directly
+uint32_t FastXlat::readslow (FastCpu *cpu, uint32_t addr, uint32_t word)
+{
+    return cpu->memreader (cpu->memparam, addr, word != 0);
+}
+
+// called by translated code to write memory it can't write directly
+// the write might be a system call that writes over translated code, turns on printinstr or stops the cpu
+//  output:
+//   returns 0: continue on in block
+//     XR_NEXT: return to FastCpu::run()
+uint32_t FastXlat::writeslow (FastCpu *cpu, uint32_t addr, uint32_t word, uint32_t data)
+{
+    FastXlat *xlat = cpu->xlat;
+    uint32_t oldinvalcount = xlat->invalcount;
+    xlat->invalpages (addr, word ? 2 : 1);
+    cpu->memwriter (cpu->memparam, addr, word != 0, data);
+    return ((xlat->invalcount != oldinvalcount) || cpu->printinstr || (cpu->cycle >= cpu->stopcycle)) ? XR_NEXT : 0;
+}
+
+// see if opcode is valid
+static bool validop (uint16_t ir)
+{
+    switch (ir >> 13) {
+        case 0: return ((ir & 0b0001110000000001) != 0) || ((ir & 0b0000000000001000) == 0);
+        case 1: return (ir & 7) != 3;
+    }
+    return true;
+}
+
+// see if opcode is LDx Rd,#immediate
+static bool loadimm (uint16_t ir)
+{
+    return ((ir >> 13) >= 5) && ((ir & 0x7F) == 0) && (((ir >> REGA) & 7) == 7) && (((ir >> REGD) & 7) != 7);
+}
+
+// see if opcode ends a block, ie, might change R7 other than just stepping to next instruction
+static bool endsblock (uint16_t ir)
+{
+    switch (ir >> 13) {
+        case 0: {
+            if ((ir & 0b0001110000000001) != 0) return true;
+            if ((ir & 0b0000000000001110) != 0b0000000000000110) return true;
+            return ((ir >> REGD) & 7) == 7;
+        }
+        case 4:
+        case 5:
+        case 6:
+        case 7: return ((ir >> REGD) & 7) == 7;
+    }
+    return false;
+}
@@ -0,0 +1,123 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+#ifndef _FASTXLAT_H
+#define _FASTXLAT_H
+
+#include <vector>
+
+#include "miscdefs.h"
+
+struct FastCpu;
+
+// execute() return values
+#define XR_NONE 0       // no translation for PC, caller should interpret an instruction
+#define XR_NEXT 1       // executed some blocks, psw as is is what interrupts check
+#define XR_HALT 2       // executed a HALT instruction
+#define XR_EOI  3       // executed WRPS or IRET, upper 16 bits = psw interrupts check
+
+#define XLATMAGIC     0xFFF0    // accesses at or above here go through memreader/memwriter
+#define XLATHOT       16        // executions before a block gets translated
+#define XLATMAXINSTS  32        // max instructions in a translated block
+#define XLATIDLEINSTS 8         // max instructions in a loop left for FastCpu's idledetect
+#define XLATPGSHIFT   6         // log2 of size of pages for tracking writes
+#define XLATCACHESIZE (16 << 20)
+
+struct FastXlat {
+    static bool supported ();
+
+    FastXlat (FastCpu *cpu, uint8_t *memory);
+    uint32_t execute ();
+    void invalidate (uint16_t addr, uint32_t size);
+    void setallslow ();
+    void setrosize (uint16_t rosize);
+    void setwatch (uint16_t addr);
+
+private:
+    typedef uint32_t Enter (void const *entry);
+
+    // what a translated block covers, for invalidation
+    struct Extent {
+        uint16_t pc;
+        uint16_t end;
+    };
+
+    // pending out-of-line slow path for a load or store
+    struct Stub {
+        uint8_t *jumps[3];      // jumps to patch to point to the stub
+        int njumps;
+        uint8_t *cont;          // where to resume when done
+        uint16_t ir;
+        uint16_t pcnext;
+        uint32_t cycback;       // cycles/instructions of the block that haven't happened yet
+        uint32_t insback;
+    };
+
+    bool allslow;               // all loads and stores go through memreader,memwriter
+    FastCpu *cpu;
+    uint8_t *memory;
+    uint8_t *cache;             // mmapped code cache
+    uint8_t *cacheblocks;       // blocks start here, after trampoline
+    uint8_t *cp;                // where next code goes
+    uint8_t *exitnext;          // return XR_NEXT from translated code
+    uint8_t *epilogue;          // return eax from translated code
+    Enter *enter;
+
+    void const *blocktab[0x8000];                       // translated block entry indexed by pc/2
+    uint8_t hotcounts[0x8000];                          // execution counts of untranslated pcs
+    uint8_t pageflags[0x10000>>XLATPGSHIFT];            // XP_* bits, slow path for writes if non-zero
+    std::vector<Extent> pageblocks[0x10000>>XLATPGSHIFT];  // blocks with code in the page
+    int watchpage;
+    uint32_t invalcount;                                // incremented whenever a block is thrown away
+
+    int32_t dregs, dpsw, dir, dcycle, dinsts, dstklim, dstopcyc;    // offsets within FastCpu
+
+    bool invalpages (uint16_t addr, uint32_t size);
+    void flush ();
+    void const *translate (uint16_t pc);
+    void arith (uint16_t ir, uint16_t pcnext, bool flags);
+    void load (uint16_t ir, uint16_t pcnext, std::vector<Stub> &stubs, uint32_t cycback, uint32_t insback);
+    void store (uint16_t ir, uint16_t pcnext, std::vector<Stub> &stubs, uint32_t cycback, uint32_t insback);
+    void branch (uint16_t ir, uint16_t pcnext);
+    void chain (uint16_t target);
+    void chaindyn ();
+    void checkattn ();
+    void slowpath (Stub const *stub);
+    void setpsw (int vsrc, int csrc);
+    void ldreg (int x86, int hreg, uint16_t pcnext);
+    void streg (int x86, int hreg);
+    void stregimm (int hreg, uint16_t val);
+    void rbxdisp (int x86, int32_t disp);
+    void addmem64 (int32_t disp, int32_t val);
+    uint8_t *jcc (int cc);
+    uint8_t *jmp ();
+    void jccto (int cc, uint8_t const *target);
+    void jmpto (uint8_t const *target);
+    void callto (void const *func);
+    static void patch (uint8_t *at, uint8_t const *target);
+    void e1 (uint32_t b);
+    void e2 (uint32_t w);
+    void e4 (uint32_t l);
+    void e8 (uint64_t q);
+
+    static uint32_t readslow (FastCpu *cpu, uint32_t addr, uint32_t word);
+    static uint32_t writeslow (FastCpu *cpu, uint32_t addr, uint32_t word, uint32_t data);
+};
+
+#endif
@@ -0,0 +1,303 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+/**
+ * Stuck-at fault simulation of a netgen -netbin netlist.
+ * Tells how many single stuck-at-0/stuck-at-1 faults the testers would catch.
+ *
+    cd ../modules
+    ./netgen.sh aluboard.mod -gen aluboard -netbin aluboard.bin
+    ../driver/alutester.x86_64 -netlist aluboard.bin -vectors alulo.vec lo
+    ../driver/alutester.x86_64 -netlist aluboard.bin -vectors aluhi.vec hi
+    ../driver/faultsim.x86_64 aluboard.bin alulo.vec aluhi.vec
+
+    the vectors files are every call the tester made to NetlistLib (see netvecs.h)
+    ...they get replayed through NetlistLib 63 faults at a time
+    ...lane 0 is the good circuit, lanes 1..63 each have a different net stuck at 0 or 1
+    a fault is detected if its lane reads something from the board different than lane 0 does
+
+    faults are put on every net the cell model has, ie, transistor collectors, jumpers and ports
+    lanes that oscillate are frozen and counted separately, a real board might or might not catch those
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <vector>
+
+#include "gpiolib.h"
+#include "netlist.h"
+#include "netvecs.h"
+
+#define LANES 64        // lane 0 is the good circuit, the rest get faults
+
+// a net stuck at 0 or 1
+struct Fault {
+    uint32_t net;
+    bool stuck1;
+};
+
+// a vectors file and what it detected
+struct Trace {
+    char const *name;
+    std::vector<NVRec> recs;
+    std::vector<bool> detected;     // indexed by fault
+    std::vector<bool> oscillated;   // indexed by fault
+};
+
+static NetlistLib *netlistlib;
+static std::vector<Fault> faults;
+
+static bool readtrace (Trace *trace);
+static void runtrace (Trace *trace);
+static void printundetected (std::vector<bool> const &detected, std::vector<bool> const &oscillated);
+
+int main (int argc, char **argv)
+{
+    bool each = false;
+    char const *netname = NULL;
+    std::vector<Trace> traces;
+
+    setlinebuf (stdout);
+
+    for (int i = 0; ++ i < argc;) {
+        if (strcasecmp (argv[i], "-each") == 0) {
+            each = true;
+            continue;
+        }
+        if (argv[i][0] == '-') {
+            fprintf (stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+        if (netname == NULL) {
+            netname = argv[i];
+            continue;
+        }
+        Trace trace;
+        trace.name = argv[i];
+        traces.push_back (trace);
+    }
+    if (traces.size () == 0) {
+        fprintf (stderr, "usage: faultsim [-each] <netbinfile> <vectorsfile>...\n");
+        return 1;
+    }
+
+    for (Trace &trace : traces) {
+        if (! readtrace (&trace)) return 1;
+    }
+
+    netlistlib = new NetlistLib (netname);
+    netlistlib->open ();
+    Netlist *netlist = netlistlib->netlist;
+    netlist->freezeosc = true;
+
+    // fault every net the cells drive or read plus ports, except for power and ground
+    uint32_t nnets = netlist->nnets;
+    std::vector<bool> isport (nnets);
+    for (uint32_t p = 0; p < netlist->nports; p ++) isport[netlist->portnet(p)] = true;
+    uint32_t nsites = 0;
+    for (uint32_t n = 0; n < nnets; n ++) {
+        Netlist::Net const *net = &netlist->nets[n];
+        if (net->flags & (NBN_GND | NBN_VCC)) continue;
+        if ((net->cell < 0) && (net->nreaders == 0) && ! isport[n]) continue;
+        Fault fault;
+        fault.net = n;
+        fault.stuck1 = false;
+        faults.push_back (fault);
+        fault.stuck1 = true;
+        faults.push_back (fault);
+        nsites ++;
+    }
+    uint32_t nfaults = faults.size ();
+    printf ("faultsim: %u nets, %u faults, %u passes of %u faults per vectors file\n",
+        nsites, nfaults, (nfaults + LANES - 2) / (LANES - 1), LANES - 1);
+
+    // run each vectors file against all the faults
+    std::vector<bool> detected (nfaults);
+    std::vector<bool> oscillated (nfaults);
+    for (Trace &trace : traces) {
+        runtrace (&trace);
+        for (uint32_t f = 0; f < nfaults; f ++) {
+            if (trace.detected[f]) detected[f] = true;
+            if (trace.oscillated[f]) oscillated[f] = true;
+        }
+        if (each) {
+            printf ("\n%s undetected:\n", trace.name);
+            printundetected (trace.detected, trace.oscillated);
+        }
+    }
+
+    // combined coverage
+    uint32_t ndetected = 0;
+    for (uint32_t f = 0; f < nfaults; f ++) {
+        if (detected[f]) ndetected ++;
+    }
+    if (traces.size () > 1) {
+        printf ("\nall vectors: %u of %u faults detected (%.1f%%)\n", ndetected, nfaults, ndetected * 100.0 / nfaults);
+    }
+    if (ndetected < nfaults) {
+        printf ("\nundetected by any vectors:\n");
+        printundetected (detected, oscillated);
+    }
+
+    netlistlib->close ();
+    return 0;
+}
+
+// read vectors file into memory
+static bool readtrace (Trace *trace)
+{
+    FILE *vecsfile = fopen (trace->name, "r");
+    if (vecsfile == NULL) {
+        fprintf (stderr, "faultsim: error opening %s: %m\n", trace->name);
+        return false;
+    }
+    char magic[8];
+    if ((fread (magic, 8, 1, vecsfile) != 1) || (memcmp (magic, NETVECS_MAGIC, 8) != 0)) {
+        fprintf (stderr, "faultsim: %s is not a vectors file\n", trace->name);
+        fclose (vecsfile);
+        return false;
+    }
+    NVRec rec;
+    while (fread (&rec, sizeof rec, 1, vecsfile) == 1) {
+        if ((rec.op < NVO_HALFCYCLE) || (rec.op > NVO_WRITECON)) {
+            fprintf (stderr, "faultsim: %s has bad record %u\n", trace->name, (uint32_t) trace->recs.size ());
+            fclose (vecsfile);
+            return false;
+        }
+        trace->recs.push_back (rec);
+    }
+    if (! feof (vecsfile)) {
+        fprintf (stderr, "faultsim: error reading %s: %m\n", trace->name);
+        fclose (vecsfile);
+        return false;
+    }
+    if (ftell (vecsfile) != (long) (8 + trace->recs.size () * sizeof rec)) {
+        fprintf (stderr, "faultsim: %s is truncated\n", trace->name);
+    }
+    fclose (vecsfile);
+    return true;
+}
+
+// replay a vectors file for every fault, 63 faults at a time
+static void runtrace (Trace *trace)
+{
+    Netlist *netlist = netlistlib->netlist;
+    uint32_t nfaults = faults.size ();
+    uint32_t nrecs   = trace->recs.size ();
+    trace->detected.assign (nfaults, false);
+    trace->oscillated.assign (nfaults, false);
+
+    struct timespec started, finished;
+    if (clock_gettime (CLOCK_MONOTONIC, &started) < 0) abort ();
+
+    uint32_t mismatches = 0;
+    for (uint32_t base = 0; base < nfaults; base += LANES - 1) {
+
+        // put faults in lanes 1..63
+        uint32_t nlanes = nfaults - base;
+        if (nlanes > LANES - 1) nlanes = LANES - 1;
+        uint64_t groupmask = 0;
+        netlist->clearfaults ();
+        for (uint32_t l = 0; l < nlanes; l ++) {
+            Fault const *fault = &faults[base+l];
+            uint64_t lane = 2ULL << l;
+            netlist->setfault (fault->net, fault->stuck1 ? 0 : lane, fault->stuck1 ? lane : 0);
+            groupmask |= lane;
+        }
+        netlistlib->restart ();
+
+        // replay what the tester did, stop when all the faulty lanes have been caught
+        // what frozen lanes read is meaningless so they are only caught if they differed before freezing
+        uint64_t caught = 0;
+        for (uint32_t r = 0; r < nrecs; r ++) {
+            NVRec const *rec = &trace->recs[r];
+            uint32_t value;
+            switch (rec->op) {
+                case NVO_HALFCYCLE: {
+                    netlistlib->halfcycle ();
+                    continue;
+                }
+                case NVO_READGPIO: {
+                    value = netlistlib->readgpio ();
+                    break;
+                }
+                case NVO_WRITEGPIO: {
+                    netlistlib->writegpio (rec->con != 0, rec->value);
+                    continue;
+                }
+                case NVO_READCON: {
+                    netlistlib->readcon ((IOW56Con) rec->con, &value);
+                    break;
+                }
+                case NVO_WRITECON: {
+                    netlistlib->writecon ((IOW56Con) rec->con, rec->mask, rec->value);
+                    continue;
+                }
+                default: abort ();
+            }
+
+            // the good lane should read what the tester read
+            if ((value != rec->value) && (++ mismatches <= 10)) {
+                fprintf (stderr, "faultsim: %s record %u read %08X, tester read %08X\n", trace->name, r, value, rec->value);
+            }
+            caught |= netlistlib->lanediffs & ~ netlist->frozen;
+            if (((caught | netlist->frozen) & groupmask) == groupmask) break;
+        }
+
+        if (netlist->frozen & 1) {
+            fprintf (stderr, "faultsim: %s good lane oscillated\n", trace->name);
+        }
+        for (uint32_t l = 0; l < nlanes; l ++) {
+            uint64_t lane = 2ULL << l;
+            if (caught & lane) trace->detected[base+l] = true;
+            else if (netlist->frozen & lane) trace->oscillated[base+l] = true;
+        }
+    }
+    netlist->clearfaults ();
+    netlistlib->restart ();
+
+    if (clock_gettime (CLOCK_MONOTONIC, &finished) < 0) abort ();
+    double secs = (finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) / 1000000000.0;
+
+    uint32_t ndetected = 0;
+    uint32_t noscillated = 0;
+    for (uint32_t f = 0; f < nfaults; f ++) {
+        if (trace->detected[f]) ndetected ++;
+        if (trace->oscillated[f]) noscillated ++;
+    }
+    printf ("%s: %u records, %u of %u faults detected (%.1f%%), %u more oscillated, %.3f sec\n",
+        trace->name, nrecs, ndetected, nfaults, ndetected * 100.0 / nfaults, noscillated, secs);
+    if (mismatches > 0) {
+        printf ("%s: %u reads did not match what the tester read\n", trace->name, mismatches);
+    }
+}
+
+// print faults not detected
+static void printundetected (std::vector<bool> const &detected, std::vector<bool> const &oscillated)
+{
+    Netlist *netlist = netlistlib->netlist;
+    for (uint32_t f = 0; f < faults.size (); f ++) {
+        if (! detected[f]) {
+            printf ("  %s  %s%s\n", faults[f].stuck1 ? "sa1" : "sa0", netlist->nets[faults[f].net].name, oscillated[f] ? "  (oscillates)" : "");
+        }
+    }
+}
@@ -23,11 +23,13 @@
 #include <signal.h>
 #include <stdio.h>
 #include <string>
+#include <vector>
 
 #include <iowkit.h>
 
 #include "miscdefs.h"
 
+struct Netlist;
 struct Shadow;
 
 #define DEFCPUHZ 472000
@@ -252,4 +254,53 @@ private:
 
     uint32_t examine (char const *varname);
 };
+
+struct NetlistLib : GpioLib {
+    NetlistLib (char const *netname);
+    void open ();
+    void close ();
+    void halfcycle ();
+    uint32_t readgpio ();
+    void writegpio (bool wdata, uint32_t valu);
+    bool readcon (IOW56Con c, uint32_t *pins);
+    bool writecon (IOW56Con c, uint32_t mask, uint32_t pins);
+    void settiming (char const *reportname, Shadow *shadow, double stagens, double loadns, double jumperns);
+    void recordvecs (char const *filename);
+    void restart ();
+
+    static int testeropt (int argc, char **argv, int *i, char const **netlistname, char const **vectorsname, char const **nettimingname);
+    static NetlistLib *testeropen (char const *netlistname, char const *vectorsname, char const *nettimingname);
+
+    Netlist *netlist;
+    uint64_t lanediffs;     // lanes that read something different than lane 0 (see faultsim)
+
+private:
+    struct TimingStat;
+
+    bool hasraspi;
+    char const *netname;
+    int connets[4][32];     // A,C,I,D connector pin nets, -1 if not in netlist
+    int clknet, resnet, irqnet, mqnets[16];
+    int mdnets[16], mreadnet, mwritenet, mwordnet, haltnet;
+    uint32_t gpiowritten;
+    uint32_t oscillations;
+
+    char const *reportname; // timed simulation report file, NULL if not timing
+    Shadow *shadow;         // what state the cpu is in
+    double stagens, loadns, jumperns;
+    uint32_t timedround;    // netlist round last timed
+    std::vector<TimingStat *> timingstats;  // [state*2+clock], [0] if no shadow
+    FILE *vecsfile;         // recording test vectors here, NULL if not
+
+    int findraspiport (char const *raspi, char const *sig);
+    void settle ();
+    void timecycle ();
+    char const *halfstate (uint32_t index);
+    void writereport ();
+    void recordvec (int op, int con, uint32_t mask, uint32_t value);
+    uint32_t readlane0 (int net);
+
+    static NetlistLib *testerlib;   // opened by testeropen()
+    static void testerclose ();
+};
 #endif
@@ -0,0 +1,72 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+#ifndef _HODESTATS_H
+#define _HODESTATS_H
+
+#include "miscdefs.h"
+
+#define HODESTATS_MAGIC 0x54534448U     // "HDST"
+#define HODESTATS_VERSION 1
+
+#define HS_NSTATES 24           // one for each Shadow::State
+#define HS_NSYSCALLS 128        // counts for SCN_... numbers below this
+
+#define HSF_STATES 0x01         // statecounts[] are being kept
+#define HSF_EXITED 0x02         // raspictl has exited, counts are final
+
+// live statistics raspictl -stats publishes in a /dev/shm segment for hodetop
+// each counter has a single writer and is updated with relaxed atomics
+// ...so readers just load each one, there is no lock
+struct HodeStats {
+    uint32_t magic;             // HODESTATS_MAGIC, set last when segment is ready
+    uint32_t version;           // HODESTATS_VERSION
+    uint32_t size;              // sizeof (HodeStats)
+    uint32_t flags;             // HSF_...
+    uint32_t pid;               // raspictl process id
+    uint32_t cpuhz;             // -cpuhz setting
+    uint64_t startns;           // CLOCK_REALTIME when raspictl started
+    uint64_t updatens;          // CLOCK_REALTIME of last update of cycles,insts,hz
+    uint64_t cycles;            // cpu cycles executed
+    uint64_t insts;             // instructions executed
+    uint64_t hz;                // cycles per second over last update interval
+    uint64_t irqs;              // interrupts taken
+    uint64_t halts;             // HALT instructions executed
+    uint64_t haltns;            // host time spent waiting for interrupt after HALT
+    uint64_t statecounts[HS_NSTATES];   // cycles spent in each Shadow::State
+    uint64_t syscalls[HS_NSYSCALLS];    // system calls by SCN_... number
+};
+
+// increment counter that only the calling thread writes
+static inline void hsinc (uint64_t *ctr, uint64_t n)
+{
+    __atomic_store_n (ctr, __atomic_load_n (ctr, __ATOMIC_RELAXED) + n, __ATOMIC_RELAXED);
+}
+
+static inline void hsset (uint64_t *ctr, uint64_t val)
+{
+    __atomic_store_n (ctr, val, __ATOMIC_RELAXED);
+}
+
+static inline uint64_t hsget (uint64_t const *ctr)
+{
+    return __atomic_load_n (ctr, __ATOMIC_RELAXED);
+}
+
+#endif
@@ -0,0 +1,208 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// display live statistics published by raspictl -stats
+//  ./hodetop [-interval <seconds>] [-once] <name>
+//      -interval : seconds between updates (default 1)
+//      -once     : print one update and exit instead of refreshing the screen
+//      name      : same as given to raspictl -stats, ie, /dev/shm/<name>
+//  attaches read-only so it can come and go without disturbing raspictl
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "hodestats.h"
+
+// same order as Shadow::State
+static char const *const statenames[HS_NSTATES] = {
+    "RESET0", "RESET1", "FETCH1", "FETCH2",
+    "BCC1", "ARITH1",
+    "STORE1", "STORE2", "LDA1", "LOAD1", "LOAD2", "LOAD3",
+    "WRPS1", "RDPS1", "IRET1", "IRET2", "IRET3", "IRET4",
+    "HALT1", "IREQ1", "IREQ2", "IREQ3", "IREQ4", "IREQ5"
+};
+
+// copy of the counts taken at one point in time
+struct Snap {
+    uint64_t nowns;
+    uint32_t flags;
+    uint64_t cycles;
+    uint64_t insts;
+    uint64_t hz;
+    uint64_t irqs;
+    uint64_t halts;
+    uint64_t haltns;
+    uint64_t statecounts[HS_NSTATES];
+    uint64_t syscalls[HS_NSYSCALLS];
+};
+
+static void takesnap (HodeStats const *hs, Snap *snap);
+static void display (HodeStats const *hs, char const *shmname, Snap const *prev, Snap const *snap);
+static double rate (uint64_t prev, uint64_t next, double secs);
+static uint64_t nowns ();
+
+int main (int argc, char **argv)
+{
+    bool once = false;
+    char const *statsname = NULL;
+    double interval = 1.0;
+
+    for (int i = 0; ++ i < argc;) {
+        if (strcasecmp (argv[i], "-interval") == 0) {
+            if (++ i >= argc) {
+                fprintf (stderr, "hodetop: missing seconds after -interval\n");
+                return 1;
+            }
+            interval = atof (argv[i]);
+            if (interval <= 0.0) {
+                fprintf (stderr, "hodetop: bad -interval %s\n", argv[i]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcasecmp (argv[i], "-once") == 0) {
+            once = true;
+            continue;
+        }
+        if ((argv[i][0] == '-') || (statsname != NULL)) {
+            fprintf (stderr, "hodetop: unknown argument %s\n", argv[i]);
+            return 1;
+        }
+        statsname = argv[i];
+    }
+    if (statsname == NULL) {
+        fprintf (stderr, "usage: hodetop [-interval <seconds>] [-once] <name>\n");
+        return 1;
+    }
+
+    std::string shmname = (statsname[0] == '/') ? statsname : std::string ("/") + statsname;
+    int shmfd = shm_open (shmname.c_str (), O_RDONLY, 0);
+    if (shmfd < 0) {
+        fprintf (stderr, "hodetop: error opening /dev/shm%s: %m\n", shmname.c_str ());
+        return 1;
+    }
+    void *ptr = mmap (NULL, sizeof (HodeStats), PROT_READ, MAP_SHARED, shmfd, 0);
+    if (ptr == MAP_FAILED) {
+        fprintf (stderr, "hodetop: error mapping /dev/shm%s: %m\n", shmname.c_str ());
+        return 1;
+    }
+    close (shmfd);
+    HodeStats const *hs = (HodeStats const *) ptr;
+
+    if (__atomic_load_n (&hs->magic, __ATOMIC_ACQUIRE) != HODESTATS_MAGIC) {
+        fprintf (stderr, "hodetop: /dev/shm%s is not a raspictl -stats segment\n", shmname.c_str ());
+        return 1;
+    }
+    if ((hs->version != HODESTATS_VERSION) || (hs->size != sizeof *hs)) {
+        fprintf (stderr, "hodetop: /dev/shm%s is version %u size %u, expected version %u size %u\n",
+            shmname.c_str (), hs->version, hs->size, HODESTATS_VERSION, (uint32_t) sizeof *hs);
+        return 1;
+    }
+
+    Snap snaps[2];
+    takesnap (hs, &snaps[0]);
+    for (int i = 1;; i ^= 1) {
+        usleep ((useconds_t) (interval * 1000000.0));
+        takesnap (hs, &snaps[i]);
+        if (! once) printf ("\033[H\033[J");
+        display (hs, shmname.c_str (), &snaps[i^1], &snaps[i]);
+        if (once || (snaps[i].flags & HSF_EXITED)) break;
+    }
+    return 0;
+}
+
+static void takesnap (HodeStats const *hs, Snap *snap)
+{
+    snap->nowns  = nowns ();
+    snap->flags  = __atomic_load_n (&hs->flags, __ATOMIC_RELAXED);
+    snap->cycles = hsget (&hs->cycles);
+    snap->insts  = hsget (&hs->insts);
+    snap->hz     = hsget (&hs->hz);
+    snap->irqs   = hsget (&hs->irqs);
+    snap->halts  = hsget (&hs->halts);
+    snap->haltns = hsget (&hs->haltns);
+    for (int i = 0; i < HS_NSTATES; i ++) snap->statecounts[i] = hsget (&hs->statecounts[i]);
+    for (int i = 0; i < HS_NSYSCALLS; i ++) snap->syscalls[i] = hsget (&hs->syscalls[i]);
+}
+
+static void display (HodeStats const *hs, char const *shmname, Snap const *prev, Snap const *snap)
+{
+    double secs = (snap->nowns - prev->nowns) / 1000000000.0;
+    uint64_t upsecs = (snap->nowns - hs->startns) / 1000000000ULL;
+
+    printf ("hodetop: /dev/shm%s  pid %u  up %llu:%02u:%02u  %s\n", shmname, hs->pid,
+        upsecs / 3600, (uint32_t) (upsecs / 60 % 60), (uint32_t) (upsecs % 60),
+        (snap->flags & HSF_EXITED) ? "exited" : "running");
+    printf ("\n");
+    printf ("  %-10s  %15s  %12s\n", "", "total", "per sec");
+    printf ("  %-10s  %15llu  %12llu  %6.1f%% of -cpuhz %u\n", "cycles", snap->cycles, snap->hz,
+        snap->hz * 100.0 / hs->cpuhz, hs->cpuhz);
+    printf ("  %-10s  %15llu  %12.0f", "instrs", snap->insts, rate (prev->insts, snap->insts, secs));
+    if (snap->insts != 0) printf ("  %6.2f cycles/instr", (double) snap->cycles / snap->insts);
+    printf ("\n");
+    printf ("  %-10s  %15llu  %12.0f\n", "interrupts", snap->irqs, rate (prev->irqs, snap->irqs, secs));
+    printf ("  %-10s  %15llu  %12.0f  %6.1f%% of time halted\n", "halts", snap->halts,
+        rate (prev->halts, snap->halts, secs), (snap->haltns - prev->haltns) / 10000000.0 / secs);
+
+    if (snap->flags & HSF_STATES) {
+        uint64_t delta = 0;
+        for (int i = 0; i < HS_NSTATES; i ++) {
+            delta += snap->statecounts[i] - prev->statecounts[i];
+        }
+        printf ("\n");
+        printf ("  %-10s  %15s  %12s  %6s\n", "state", "cycles", "per sec", "recent");
+        for (int i = 0; i < HS_NSTATES; i ++) {
+            if (snap->statecounts[i] == 0) continue;
+            uint64_t d = snap->statecounts[i] - prev->statecounts[i];
+            printf ("  %-10s  %15llu  %12.0f  %5.1f%%\n", statenames[i], snap->statecounts[i],
+                rate (prev->statecounts[i], snap->statecounts[i], secs), (delta == 0) ? 0.0 : d * 100.0 / delta);
+        }
+    }
+
+    bool first = true;
+    for (int i = 0; i < HS_NSYSCALLS; i ++) {
+        if (snap->syscalls[i] == 0) continue;
+        if (first) {
+            printf ("\n");
+            printf ("  %-10s  %15s  %12s\n", "syscall", "calls", "per sec");
+            first = false;
+        }
+        printf ("  SCN %-6d  %15llu  %12.0f\n", i, snap->syscalls[i], rate (prev->syscalls[i], snap->syscalls[i], secs));
+    }
+    fflush (stdout);
+}
+
+static double rate (uint64_t prev, uint64_t next, double secs)
+{
+    return (secs <= 0.0) ? 0.0 : (next - prev) / secs;
+}
+
+static uint64_t nowns ()
+{
+    struct timespec nowts;
+    if (clock_gettime (CLOCK_REALTIME, &nowts) < 0) abort ();
+    return nowts.tv_sec * 1000000000ULL + nowts.tv_nsec;
+}
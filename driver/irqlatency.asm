@@ -0,0 +1,105 @@
+;;    Copyright (C) Mike Rieker, Beverly, MA USA
+;;    www.outerworldapps.com
+;;
+;;    This program is free software; you can redistribute it and/or modify
+;;    it under the terms of the GNU General Public License as published by
+;;    the Free Software Foundation; version 2 of the License.
+;;
+;;    This program is distributed in the hope that it will be useful,
+;;    but WITHOUT ANY WARRANTY; without even the implied warranty of
+;;    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+;;    GNU General Public License for more details.
+;;
+;;    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+;;
+;;    You should have received a copy of the GNU General Public License
+;;    along with this program; if not, write to the Free Software
+;;    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+;;
+;;    http:;;www.gnu.org/licenses/gpl-2.0.html
+
+; line clock interrupt latency benchmark, see irqlatency.sh
+; takes NTICKS interrupts STEPNS apart then exits
+; alternates between waiting for the interrupt in HALT and spinning in a loop
+; raspictl -irqlatency prints how long after each deadline the interrupt was taken
+
+	.include "../crtl/library/magicdefs.asm"
+
+	NTICKS = 2000
+
+	.global	__boot
+__boot:				; 0000: cpu resets here
+	br	start
+intreq:				; 0002: interrupts come here
+	ldw	%r2,count	; count down the ticks
+	ldw	%r3,#-1
+	add	%r2,%r2,%r3
+	beq	done
+	stw	%r2,count
+	ldw	%r2,spin	; alternate between halting and spinning
+	com	%r2,%r2
+	stw	%r2,spin
+	lda	%r4,.+4		; call armint to re-arm timer interrupt
+	br	armint
+	iret			; return back where we left off
+done:
+	lda	%r2,exitok	; all done, exit successfully
+	stw	%r2,0(%r5)
+	halt	%r2
+
+start:
+	ldw	%r5,#MAGIC_SCN	; r5 points to MAGIC_SCN from here on
+	lda	%r4,.+4		; call armint to arm timer interrupt
+	br	armint
+	ldw	%r2,#0x8000	; enable interrupt delivery
+	wrps	%r2
+mainloop:
+	ldw	%r0,spin	; spin until interrupted
+	tst	%r0
+	bne	mainloop
+	halt	%r0		; ...or wait for interrupt in HALT
+	br	mainloop
+
+count:	.word	NTICKS
+spin:	.word	0
+
+getnow:	.word	SCN_GETNOWNS
+	.word	nextirq
+
+nextirq: .word	0,0,0,0		; 64-bit absolute time in ns
+stepns:	.long	1000000		; time step (1 msec)
+
+lcenab:	.word	SCN_IRQATNS
+	.word	nextirq
+
+exitok:	.word	SCN_EXIT
+	.word	0
+
+; compute next interrupt time from current time
+; ...so a late interrupt doesn't make the following ones late too
+; r2,r3 = scratch
+; r4 = return address
+; r5 = points to MAGIC_SCN
+armint:
+	lda	%r2,getnow	; get current time
+	stw	%r2,0(%r5)
+	ldw	%r2,nextirq+0	; do 64-bit add to compute time for next interrupt
+	ldw	%r3,stepns+0
+	add	%r2,%r2,%r3
+	stw	%r2,nextirq+0
+	ldw	%r2,nextirq+2
+	ldw	%r3,stepns+2
+	adc	%r2,%r2,%r3
+	stw	%r2,nextirq+2
+	bcc	noupper
+	ldw	%r2,nextirq+4
+	inc	%r2,%r2
+	stw	%r2,nextirq+4
+	bne	noupper
+	ldw	%r2,nextirq+6
+	inc	%r2,%r2
+	stw	%r2,nextirq+6
+noupper:
+	lda	%r2,lcenab	; tell raspi to request interrupt at that time
+	stw	%r2,0(%r5)
+	lda	%pc,0(%r4)
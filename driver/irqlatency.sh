@@ -0,0 +1,12 @@
+#!/bin/bash
+#
+#  Measure line clock interrupt latency in -nohw mode,
+#  ie, wall time from SCN_IRQATNS deadline to cpu taking
+#  the interrupt (IREQ), both when the cpu is waiting in
+#  HALT and when it is running
+#
+#   ./irqlatency.sh [<more raspictl options> ...]
+#
+cd `dirname $0`
+make irqlatency.hex > /dev/null || exit
+exec ./raspictl.`uname -m` -nohw -irqlatency "$@" irqlatency.hex
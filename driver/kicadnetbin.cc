@@ -0,0 +1,511 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+/**
+ * Convert a board's KiCad netlist and report, as written by netgen -net and -report, to a netbin file.
+ * For boards that were laid out, eg, ../goodpcbs, when netgen -netbin isn't at hand.
+
+    ./kicadnetbin.x86_64 -jumper Conn/irsel.20 Conn/irsel.19 -jumper Conn/ctsa.47 Conn/ctsa.48 ... \
+        ../goodpcbs/regboard.net ../goodpcbs/regboard.rep regboard.bin
+
+    comes out the same as ../netgen/NetBin.java writes for the same -gen:
+    - components are named by their netgen name, taken from the report's component list
+    - Comp.Capac capacitors go in as NBK_CAPAC, Comp.ByCap bypass caps, connectors and holes are left out
+    - loads are what the report gives for Network.getLoads(), wired-and subnets added into their wired-and net
+    - connector pins become ports named <connector>.<pin>, eg, Conn/abbus.7
+    except RasPi cpu-side ports (RasPiModule.getNetBinPorts()) aren't in either file so they are left out
+    -jumper <input> <driver> puts a jumper block on the board, eg, regboard's register select jumpers
+    ...the input port's net is driven by the other port's net (wired-and if more than one)
+    ...like NetBin.java does for a connector input pin jumpered in the module source
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <algorithm>
+#include <map>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "netbin.h"
+
+// component from the netlist
+struct KComp {
+    std::string name;           // netgen name from the report
+    std::string value;
+    std::string part;
+    std::string footprint;
+    std::map<std::string,std::string> pinnets;  // <pin number, net name>
+};
+
+// parsed s-expression
+struct SExp {
+    std::string atom;           // atom or quoted string, empty if list
+    std::vector<SExp> list;
+
+    SExp const *find (char const *key) const;
+    std::string const &value (char const *key) const;
+};
+
+static char const *netname;
+static int lineno;
+static std::map<std::string,KComp> kcomps;                  // <ref, component>
+static std::set<std::string> knets;
+static std::map<std::string,std::string> compnames;        // <ref, netgen name>
+static std::map<std::string,uint32_t> reploads;            // <network name, loads>
+static std::map<std::string,std::string> wiredands;        // <subnet name, wired-and net name>
+static std::map<std::string,std::vector<std::string>> jumpers;  // <input port, driving ports>
+
+static bool readreport (char const *repname);
+static bool parse (FILE *netfile, SExp *sexp);
+static void findlists (SExp const *sexp, std::vector<SExp const *> *compsexps, std::vector<SExp const *> *netsexps);
+static int skipspace (FILE *netfile);
+static bool getpinnos (KComp const *kcomp, uint8_t *kind_r, std::vector<char const *> *pinnos_r);
+static bool isconnector (KComp const *kcomp);
+static uint32_t stringoffset (std::string const &s);
+
+static std::map<std::string,uint32_t> stroffsets;
+static std::vector<std::string> strings;
+static uint32_t strsize;
+
+int main (int argc, char **argv)
+{
+    char const *binname = NULL;
+    char const *repname = NULL;
+
+    for (int i = 0; ++ i < argc;) {
+        if (strcasecmp (argv[i], "-jumper") == 0) {
+            if (i + 2 >= argc) {
+                fprintf (stderr, "-jumper missing input and driver pins\n");
+                return 1;
+            }
+            jumpers[argv[i+1]].push_back (argv[i+2]);
+            i += 2;
+            continue;
+        }
+        if (argv[i][0] == '-') {
+            fprintf (stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+        if (netname == NULL) {
+            netname = argv[i];
+            continue;
+        }
+        if (repname == NULL) {
+            repname = argv[i];
+            continue;
+        }
+        if (binname == NULL) {
+            binname = argv[i];
+            continue;
+        }
+        fprintf (stderr, "unknown argument %s\n", argv[i]);
+        return 1;
+    }
+    if (binname == NULL) {
+        fprintf (stderr, "usage: kicadnetbin [-jumper <inputport> <drivingport>]... <kicadnetfile> <reportfile> <netbinfile>\n");
+        return 1;
+    }
+
+    if (! readreport (repname)) return 1;
+
+    // read the whole netlist in
+    // netgen's parentheses don't quite balance, so just read everything at the top level
+    FILE *netfile = fopen (netname, "r");
+    if (netfile == NULL) {
+        fprintf (stderr, "kicadnetbin: error opening %s: %m\n", netname);
+        return 1;
+    }
+    lineno = 1;
+    SExp top;
+    int c;
+    while ((c = skipspace (netfile)) != EOF) {
+        if (c == ')') continue;
+        ungetc (c, netfile);
+        top.list.emplace_back ();
+        if (! parse (netfile, &top.list.back ())) {
+            fclose (netfile);
+            return 1;
+        }
+    }
+    fclose (netfile);
+
+    std::vector<SExp const *> compsexps, netsexps;
+    findlists (&top, &compsexps, &netsexps);
+    for (SExp const *c : compsexps) {
+        std::string const &ref = c->value ("ref");
+        auto it = compnames.find (ref);
+        if (it == compnames.end ()) {
+            fprintf (stderr, "kicadnetbin: component %s not in %s\n", ref.c_str (), repname);
+            return 1;
+        }
+        KComp *kcomp = &kcomps[ref];
+        kcomp->name  = it->second;
+        kcomp->value = c->value ("value");
+        kcomp->footprint = c->value ("footprint");
+        SExp const *libsource = c->find ("libsource");
+        if (libsource != NULL) kcomp->part = libsource->value ("part");
+    }
+    for (SExp const *np : netsexps) {
+        SExp const &n = *np;
+        std::string name = n.value ("name");
+        if (name.empty ()) name = "N" + n.value ("code");
+        knets.insert (name);
+        for (SExp const &node : n.list) {
+            if (node.list.empty () || (node.list[0].atom != "node")) continue;
+            std::string ref = node.value ("ref");
+            if (kcomps.count (ref) == 0) {
+                fprintf (stderr, "kicadnetbin: net %s has undefined component %s\n", name.c_str (), ref.c_str ());
+                return 1;
+            }
+            kcomps[ref].pinnets[node.value("pin")] = name;
+        }
+    }
+
+    // net indices, sorted by name like NetBin.java
+    // the netlist's nets are already merged, like GenCtx.getMergedNetNames()
+    std::map<std::string,uint32_t> netindices;
+    for (std::string const &n : knets) {
+        uint32_t i = netindices.size ();
+        netindices[n] = i;
+    }
+
+    // each network's loads go to the wired-and network it is part of, like GenCtx.getWiredAndNetworkName()
+    std::vector<uint32_t> netloads (knets.size ());
+    for (auto const &it : reploads) {
+        std::string name = it.first;
+        for (auto wa = wiredands.find (name); (wa != wiredands.end ()) && (wa->second != name); wa = wiredands.find (name)) {
+            name = wa->second;
+        }
+        auto ni = netindices.find (name);
+        if (ni == netindices.end ()) {
+            fprintf (stderr, "kicadnetbin: network %s in %s not in %s\n", name.c_str (), repname, netname);
+            return 1;
+        }
+        netloads[ni->second] += it.second;
+    }
+
+    // logic components sorted by netgen name, connector pins become ports
+    std::map<std::string,KComp const *> compsbyname;
+    for (auto const &it : kcomps) compsbyname[it.second.name] = &it.second;
+    std::vector<KComp const *> comps;
+    std::vector<uint8_t> compkinds;
+    std::vector<std::vector<char const *>> comppinnos;
+    std::map<std::string,uint32_t> ports;
+    uint32_t npins = 0;
+    for (auto const &it : compsbyname) {
+        KComp const *kcomp = it.second;
+        uint8_t kind;
+        std::vector<char const *> pinnos;
+        if (getpinnos (kcomp, &kind, &pinnos)) {
+            comps.push_back (kcomp);
+            compkinds.push_back (kind);
+            comppinnos.push_back (pinnos);
+            npins += pinnos.size ();
+        } else if (isconnector (kcomp)) {
+            for (auto const &pn : kcomp->pinnets) {
+                ports[kcomp->name+"."+pn.first] = netindices[pn.second];
+            }
+        }
+    }
+
+    // jumper blocks, input port's net first then the nets driving it
+    std::vector<std::vector<uint32_t>> jumpernets;
+    for (auto const &it : jumpers) {
+        std::vector<uint32_t> jnets;
+        for (uint32_t j = 0; j <= it.second.size (); j ++) {
+            std::string const &portname = (j == 0) ? it.first : it.second[j-1];
+            auto pt = ports.find (portname);
+            if (pt == ports.end ()) {
+                fprintf (stderr, "kicadnetbin: jumper port %s not in netlist\n", portname.c_str ());
+                return 1;
+            }
+            jnets.push_back (pt->second);
+        }
+        jumpernets.push_back (jnets);
+        npins += jnets.size ();
+    }
+
+    // lay the file out
+    NBHdr hdr;
+    memset (&hdr, 0, sizeof hdr);
+    memcpy (hdr.magic, NETBIN_MAGIC, 8);
+    hdr.nnets    = knets.size ();
+    hdr.ncomps   = comps.size () + jumpernets.size ();
+    hdr.npins    = npins;
+    hdr.nports   = ports.size ();
+    hdr.netoffs  = sizeof hdr;
+    hdr.compoffs = hdr.netoffs  + hdr.nnets  * sizeof (NBNet);
+    hdr.pinoffs  = hdr.compoffs + hdr.ncomps * sizeof (NBComp);
+    hdr.portoffs = hdr.pinoffs  + hdr.npins  * sizeof (uint32_t);
+    hdr.stroffs  = hdr.portoffs + hdr.nports * sizeof (NBPort);
+
+    std::vector<NBNet> nbnets;
+    for (std::string const &n : knets) {
+        NBNet nbnet;
+        nbnet.name  = stringoffset (n);
+        nbnet.loads = std::min (netloads[nbnets.size()], (uint32_t) 0xFFFF);
+        nbnet.flags = (n == "GND") ? NBN_GND : (n == "VCC") ? NBN_VCC : 0;
+        nbnets.push_back (nbnet);
+    }
+
+    std::vector<NBComp> nbcomps;
+    std::vector<uint32_t> nbpins;
+    for (uint32_t i = 0; i < comps.size (); i ++) {
+        KComp const *kcomp = comps[i];
+        NBComp nbcomp;
+        nbcomp.name  = stringoffset (kcomp->name);
+        nbcomp.value = stringoffset (kcomp->value);
+        nbcomp.pins  = nbpins.size ();
+        nbcomp.kind  = compkinds[i];
+        nbcomp.npins = comppinnos[i].size ();
+        nbcomp.spare = 0;
+        nbcomps.push_back (nbcomp);
+        for (char const *pino : comppinnos[i]) {
+            auto it = kcomp->pinnets.find (pino);
+            nbpins.push_back ((it == kcomp->pinnets.end ()) ? NBP_NONE : netindices[it->second]);
+        }
+    }
+    uint32_t j = 0;
+    for (auto const &it : jumpers) {
+        NBComp nbcomp;
+        nbcomp.name  = stringoffset (it.first);
+        nbcomp.value = stringoffset ("jumper");
+        nbcomp.pins  = nbpins.size ();
+        nbcomp.kind  = NBK_JUMPER;
+        nbcomp.npins = jumpernets[j].size ();
+        nbcomp.spare = 0;
+        nbcomps.push_back (nbcomp);
+        nbpins.insert (nbpins.end (), jumpernets[j].begin (), jumpernets[j].end ());
+        j ++;
+    }
+
+    std::vector<NBPort> nbports;
+    for (auto const &it : ports) {
+        NBPort nbport;
+        nbport.name = stringoffset (it.first);
+        nbport.net  = it.second;
+        nbports.push_back (nbport);
+    }
+    hdr.strsize = strsize;
+
+    FILE *binfile = fopen (binname, "w");
+    if (binfile == NULL) {
+        fprintf (stderr, "kicadnetbin: error creating %s: %m\n", binname);
+        return 1;
+    }
+    fwrite (&hdr, sizeof hdr, 1, binfile);
+    fwrite (nbnets.data (), sizeof nbnets[0], nbnets.size (), binfile);
+    fwrite (nbcomps.data (), sizeof nbcomps[0], nbcomps.size (), binfile);
+    fwrite (nbpins.data (), sizeof nbpins[0], nbpins.size (), binfile);
+    fwrite (nbports.data (), sizeof nbports[0], nbports.size (), binfile);
+    for (std::string const &s : strings) {
+        fwrite (s.c_str (), s.size () + 1, 1, binfile);
+    }
+    if (fclose (binfile) < 0) {
+        fprintf (stderr, "kicadnetbin: error writing %s: %m\n", binname);
+        return 1;
+    }
+
+    printf ("kicadnetbin: %u nets, %u components, %u ports\n", hdr.nnets, hdr.ncomps, hdr.nports);
+    return 0;
+}
+
+// read component names, network loads and wired-ands from netgen -report file
+static bool readreport (char const *repname)
+{
+    FILE *repfile = fopen (repname, "r");
+    if (repfile == NULL) {
+        fprintf (stderr, "kicadnetbin: error opening %s: %m\n", repname);
+        return false;
+    }
+
+    enum { OTHER, MODULES, WIREDANDS } section = OTHER;
+    char line[4096], name[4096], ref[4096], wiredand[4096];
+    double x, y;
+    uint32_t loads;
+    wiredand[0] = 0;
+    while (fgets (line, sizeof line, repfile) != NULL) {
+
+        // "Module regboard" starts list of components by module, "Wired Ands:" ends it
+        if (strncmp (line, "Module ", 7) == 0) section = MODULES;
+        else if (strcmp (line, "Wired Ands:\n") == 0) section = WIREDANDS;
+        else if (line[0] > ' ') section = OTHER;
+
+        //        Conn/abbus  J1   19.2,  8.8   487.68, 223.52
+        // <name> <ref> <x>, <y> <x>, <y>
+        else if (section == MODULES) {
+            if (sscanf (line, "%s %s %lf, %lf %lf, %lf", name, ref, &x, &y, &x, &y) == 6) {
+                compnames[ref] = name;
+            }
+        }
+
+        //  1.ABUS/regpair
+        //    Q.0.abus/revn/regpair[1:1]2
+        // two spaces for the wired-and, four for each of its subnets
+        else if (section == WIREDANDS) {
+            if ((line[0] == ' ') && (line[1] == ' ') && (line[2] > ' ')) sscanf (line, "%s", wiredand);
+            else if ((wiredand[0] != 0) && (sscanf (line, "%s", name) == 1)) wiredands[name] = wiredand;
+        }
+
+        // Network: I12/ctla (load 2)
+        // only printed for networks with loads
+        if (sscanf (line, "Network: %s (load %u", name, &loads) == 2) reploads[name] = loads;
+    }
+    fclose (repfile);
+
+    if (compnames.empty ()) {
+        fprintf (stderr, "kicadnetbin: %s has no component list, not a netgen -report file\n", repname);
+        return false;
+    }
+    return true;
+}
+
+// parse an s-expression, either an atom, a quoted string or a list
+static bool parse (FILE *netfile, SExp *sexp)
+{
+    int c = skipspace (netfile);
+    if (c == '(') {
+        while ((c = skipspace (netfile)) != ')') {
+            if (c == EOF) {
+                fprintf (stderr, "kicadnetbin: %s:%d: eof in list\n", netname, lineno);
+                return false;
+            }
+            ungetc (c, netfile);
+            sexp->list.emplace_back ();
+            if (! parse (netfile, &sexp->list.back ())) return false;
+        }
+        return true;
+    }
+    if (c == '"') {
+        while ((c = fgetc (netfile)) != '"') {
+            if (c == EOF) {
+                fprintf (stderr, "kicadnetbin: %s:%d: eof in string\n", netname, lineno);
+                return false;
+            }
+            if (c == '\n') lineno ++;
+            if (c == '\\') c = fgetc (netfile);
+            sexp->atom.push_back (c);
+        }
+        return true;
+    }
+    if ((c == ')') || (c == EOF)) {
+        fprintf (stderr, "kicadnetbin: %s:%d: expecting atom or list\n", netname, lineno);
+        return false;
+    }
+    do sexp->atom.push_back (c);
+    while (((c = fgetc (netfile)) != EOF) && (c > ' ') && (c != '(') && (c != ')'));
+    ungetc (c, netfile);
+    return true;
+}
+
+// find all the (comp (ref ...) ...) and (net (code ...) ...) lists
+static void findlists (SExp const *sexp, std::vector<SExp const *> *compsexps, std::vector<SExp const *> *netsexps)
+{
+    if (sexp->list.empty ()) return;
+    if ((sexp->list[0].atom == "comp") && (sexp->find ("ref") != NULL)) {
+        compsexps->push_back (sexp);
+        return;
+    }
+    if ((sexp->list[0].atom == "net") && (sexp->find ("code") != NULL)) {
+        netsexps->push_back (sexp);
+        return;
+    }
+    for (SExp const &e : sexp->list) findlists (&e, compsexps, netsexps);
+}
+
+static int skipspace (FILE *netfile)
+{
+    int c;
+    while (((c = fgetc (netfile)) != EOF) && (c <= ' ')) {
+        if (c == '\n') lineno ++;
+    }
+    return c;
+}
+
+// find (key ...) element of a list
+SExp const *SExp::find (char const *key) const
+{
+    for (SExp const &e : list) {
+        if (! e.list.empty () && (e.list[0].atom == key)) return &e;
+    }
+    return NULL;
+}
+
+// get value of (key value) element of a list, empty if none
+std::string const &SExp::value (char const *key) const
+{
+    static std::string const none;
+    SExp const *e = find (key);
+    return ((e == NULL) || (e->list.size () < 2)) ? none : e->list[1].atom;
+}
+
+// get netbin kind and KiCad pin numbers in the order given by netbin.h
+// false if not part of the logic (connector, hole, bypass cap), like NetBin.getPinNumbers()
+// parts, footprints and pin numbers are the ones netgen's Comp.java printnet() methods give
+static bool getpinnos (KComp const *kcomp, uint8_t *kind_r, std::vector<char const *> *pinnos_r)
+{
+    if (kcomp->part == "Q_NPN_EBC") {                   // Comp.Trans
+        *kind_r = (kcomp->value == "2N3906") ? NBK_PNP : (kcomp->value == "2N7000") ? NBK_NFET : NBK_NPN;
+        *pinnos_r = { "1", "2", "3" };
+        return true;
+    }
+    if (kcomp->part == "D_ALT") {                       // Comp.Diode
+        *kind_r = NBK_DIODE;
+        *pinnos_r = { "2", "1" };
+        return true;
+    }
+    if (kcomp->part == "LED_ALT") {                     // Comp.SmLed
+        *kind_r = NBK_LED;
+        *pinnos_r = { "2", "1" };
+        return true;
+    }
+    if (kcomp->part == "R") {                           // Comp.Resis
+        *kind_r = NBK_RESIS;
+        *pinnos_r = { "2", "1" };
+        return true;
+    }
+    if ((kcomp->part == "CP") && (kcomp->footprint != "Capacitors_THT:C_Axial_5.00mm")) {
+        *kind_r = NBK_CAPAC;                            // Comp.Capac, Comp.ByCap has the axial footprint
+        *pinnos_r = { "1", "2" };
+        return true;
+    }
+    return false;
+}
+
+// see if component is a Comp.Conn, whose pins become ports
+// Comp.Hole is also in the conn library but its part is 1pin
+static bool isconnector (KComp const *kcomp)
+{
+    return kcomp->part.compare (0, 5, "CONN_") == 0;
+}
+
+// get offset of string in the string table, adding it if not already there
+static uint32_t stringoffset (std::string const &s)
+{
+    auto it = stroffsets.find (s);
+    if (it != stroffsets.end ()) return it->second;
+    uint32_t offs = strsize;
+    stroffsets[s] = offs;
+    strings.push_back (s);
+    strsize += s.size () + 1;
+    return offs;
+}
@@ -0,0 +1,82 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// flattened component-level netlist written by netgen -netbin
+// read by the netlist simulator (netlist.cc)
+//  all values little-endian, all offsets are bytes from beginning of file
+//  names are sorted so the same circuit always gives the same file
+//  must match ../netgen/NetBin.java
+
+#ifndef _NETBIN_H
+#define _NETBIN_H
+
+#include <stdint.h>
+
+#define NETBIN_MAGIC "HODENET1"
+
+#define NBN_GND    1           // net is the GND rail
+#define NBN_VCC    2           // net is the VCC rail
+
+#define NBK_NPN    1           // pins: emitter, base, collector
+#define NBK_PNP    2           // pins: emitter, base, collector
+#define NBK_NFET   3           // pins: source, gate, drain
+#define NBK_DIODE  4           // pins: anode, cathode
+#define NBK_LED    5           // pins: anode, cathode
+#define NBK_RESIS  6           // pins: either end
+#define NBK_CAPAC  7           // pins: positive, negative
+#define NBK_JUMPER 8           // pins: connector input pin, then what drives it (wired-and)
+
+#define NBP_NONE   0xFFFFFFFFU  // pin not connected to anything
+
+struct NBHdr {
+    char magic[8];              // NETBIN_MAGIC
+    uint32_t nnets;             // number of NBNet entries
+    uint32_t ncomps;            // number of NBComp entries
+    uint32_t npins;             // number of uint32_t net indices in pin table
+    uint32_t nports;            // number of NBPort entries
+    uint32_t netoffs;           // where the NBNet array is
+    uint32_t compoffs;          // where the NBComp array is
+    uint32_t pinoffs;           // where the pin table is
+    uint32_t portoffs;          // where the NBPort array is
+    uint32_t stroffs;           // where the null-terminated strings are
+    uint32_t strsize;           // total size of the strings
+};
+
+struct NBNet {
+    uint32_t name;              // string offset of merged (wired-and) network name
+    uint16_t loads;             // standard logic loads on the network
+    uint16_t flags;             // NBN_* flags
+};
+
+struct NBComp {
+    uint32_t name;              // string offset of component name
+    uint32_t value;             // string offset of component value, eg, 2N3904, 680
+    uint32_t pins;              // index in pin table of first pin's net index
+    uint8_t kind;               // NBK_* kind
+    uint8_t npins;              // number of pins
+    uint16_t spare;
+};
+
+struct NBPort {
+    uint32_t name;              // string offset of port name, eg, conapins[3], Conn/abbus.12, RasPi.clk
+    uint32_t net;               // net index the port is connected to
+};
+
+#endif
@@ -0,0 +1,1013 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// compiled gate-level simulation of the component netlist written by netgen -netbin
+
+// the components are boiled down to logic by recognizing the DTL circuits netgen generates:
+//   a net with a pullup resistor and diodes going to other nets is an AND of those other nets
+//   diodes or resistors going into a net with no pullup OR together whatever is on their other ends
+//   an NPN (or N-FET) with emitter (source) on GND pulls its collector (drain) low when its base (gate) is high
+//   several transistors on the same collector net are a wired-AND
+// so each net driven by transistors becomes one AND-OR-INVERT cell whose inputs are other transistor-driven nets or ports
+// everything else (LEDs and what drives them, bypass caps) doesn't affect the logic and is ignored
+
+// the cells are levelized so a single pass in order settles everything but feedback loops (flipflops)
+// settle() evaluates only cells whose inputs changed, lowest numbered first, repeating feedback loops until stable
+// it is zero-delay, so it gives the steady state the circuit settles to, not any glitches along the way
+
+// settletimed() is event-driven instead, each cell taking a configurable propagation delay to change its output
+// so it tells when each net settles after the inputs change and which input change made it change last
+// the delays are inertial, ie, a pulse shorter than a cell's delay doesn't get through it
+
+// setfault() makes nets stuck at 0 or 1 in some lanes so up to 63 faults can be simulated alongside the good circuit
+
+// NetlistBatch evaluates more than 64 lanes at once with wider nets, using AVX2 for 256 lanes if the cpu has it
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <functional>
+
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+#include "netlist.h"
+
+typedef std::vector<uint32_t> NetVec;
+typedef std::vector<NetVec> SumOfProds;
+
+Netlist::Netlist ()
+{
+    nnets   = 0;
+    nports  = 0;
+    ncells  = 0;
+    nsccs   = 0;
+    nloops  = 0;
+    maxscc  = 0;
+    ignored = 0;
+    evals   = 0;
+    round   = 0;
+    frozen  = 0;
+    freezeosc = false;
+    faulty  = false;
+    strs    = NULL;
+    hdr     = NULL;
+    ports   = NULL;
+    pendlo  = 0;
+    mapptr  = NULL;
+    mapsize = 0;
+    newround = false;
+}
+
+Netlist::~Netlist ()
+{
+    if (mapptr != NULL) munmap (mapptr, mapsize);
+}
+
+// load netlist file written by netgen -netbin
+//  input:
+//   filename = name of file
+//  output:
+//   returns false: error message printed
+//            true: netlist ready to simulate, all cells settled with ports floating high
+bool Netlist::load (char const *filename)
+{
+    int fd = open (filename, O_RDONLY);
+    if (fd < 0) {
+        fprintf (stderr, "netlist: error opening %s: %m\n", filename);
+        return false;
+    }
+    struct stat statbuf;
+    if (fstat (fd, &statbuf) < 0) {
+        fprintf (stderr, "netlist: error statting %s: %m\n", filename);
+        close (fd);
+        return false;
+    }
+    mapsize = statbuf.st_size;
+    mapptr  = (mapsize < sizeof *hdr) ? MAP_FAILED : mmap (NULL, mapsize, PROT_READ, MAP_PRIVATE, fd, 0);
+    close (fd);
+    if (mapptr == MAP_FAILED) {
+        mapptr = NULL;
+        fprintf (stderr, "netlist: %s is not a netgen -netbin file\n", filename);
+        return false;
+    }
+
+    // validate everything up front so nothing below has to check
+    hdr = (NBHdr const *) mapptr;
+    bool ok = memcmp (hdr->magic, NETBIN_MAGIC, sizeof hdr->magic) == 0;
+    ok = ok && ((uint64_t) hdr->netoffs  + (uint64_t) hdr->nnets  * sizeof (NBNet)  <= mapsize);
+    ok = ok && ((uint64_t) hdr->compoffs + (uint64_t) hdr->ncomps * sizeof (NBComp) <= mapsize);
+    ok = ok && ((uint64_t) hdr->pinoffs  + (uint64_t) hdr->npins  * sizeof (uint32_t) <= mapsize);
+    ok = ok && ((uint64_t) hdr->portoffs + (uint64_t) hdr->nports * sizeof (NBPort) <= mapsize);
+    ok = ok && ((uint64_t) hdr->stroffs  + hdr->strsize <= mapsize) && (hdr->strsize > 0);
+    ok = ok && ((hdr->netoffs | hdr->compoffs | hdr->pinoffs | hdr->portoffs) % 4 == 0);
+    strs = (char const *) mapptr + hdr->stroffs;
+    ok = ok && (strs[hdr->strsize-1] == 0);
+    NBNet  const *nbnets = (NBNet  const *) ((char const *) mapptr + hdr->netoffs);
+    NBComp const *comps  = (NBComp const *) ((char const *) mapptr + hdr->compoffs);
+    uint32_t const *pins = (uint32_t const *) ((char const *) mapptr + hdr->pinoffs);
+    ports = (NBPort const *) ((char const *) mapptr + hdr->portoffs);
+    for (uint32_t i = 0; ok && (i < hdr->nnets); i ++) {
+        ok = nbnets[i].name < hdr->strsize;
+    }
+    static uint8_t const kindpins[] = { 0, 3, 3, 3, 2, 2, 2, 2 };
+    for (uint32_t i = 0; ok && (i < hdr->ncomps); i ++) {
+        ok = (comps[i].name < hdr->strsize) && (comps[i].value < hdr->strsize) &&
+                ((uint64_t) comps[i].pins + comps[i].npins <= hdr->npins) &&
+                (comps[i].kind >= NBK_NPN) && (comps[i].kind <= NBK_JUMPER) &&
+                ((comps[i].kind == NBK_JUMPER) ? (comps[i].npins > 0) : (comps[i].npins == kindpins[comps[i].kind]));
+    }
+    for (uint32_t i = 0; ok && (i < hdr->npins); i ++) {
+        ok = (pins[i] < hdr->nnets) || (pins[i] == NBP_NONE);
+    }
+    for (uint32_t i = 0; ok && (i < hdr->nports); i ++) {
+        ok = (ports[i].name < hdr->strsize) && (ports[i].net < hdr->nnets);
+    }
+    if (! ok) {
+        fprintf (stderr, "netlist: %s is not a valid netgen -netbin file\n", filename);
+        return false;
+    }
+
+    nnets  = hdr->nnets;
+    nports = hdr->nports;
+    nets.resize (nnets);
+    vals.resize (nnets);
+    forced.resize (nnets);
+    drives.assign (nnets, ~0ULL);
+    for (uint32_t i = 0; i < nnets; i ++) {
+        Net *net      = &nets[i];
+        net->name     = strs + nbnets[i].name;
+        net->loads    = nbnets[i].loads;
+        net->flags    = nbnets[i].flags;
+        net->cell     = -1;
+        net->readers  = 0;
+        net->nreaders = 0;
+        vals[i]       = (net->flags & NBN_GND) ? 0 : ~0ULL;
+    }
+
+    analyze (comps, pins);
+    levelize ();
+
+    changeround.assign (nnets, 0);
+    changetime.assign (nnets, 0);
+    changecause.assign (nnets, -1);
+    pendvals.assign (nnets, 0);
+    pendseqs.assign (nnets, 0);
+    pendcauses.assign (nnets, -1);
+    haspend.assign (nnets, false);
+    stuck0s.assign (nnets, 0);
+    stuck1s.assign (nnets, 0);
+    setdelays (DEFSTAGENS, DEFLOADNS, DEFJUMPERNS);
+
+    if (! restart ()) {
+        fprintf (stderr, "netlist: %s does not settle with ports floating\n", filename);
+        return false;
+    }
+    return true;
+}
+
+// put everything back the way load() left it, ie, nothing forced or driven, all cells settled with ports floating high
+// ...except that stuck-at faults are applied
+//  returns true: everything is stable
+//         false: something is oscillating
+bool Netlist::restart ()
+{
+    frozen = 0;
+    for (uint32_t i = 0; i < nnets; i ++) {
+        forced[i]  = false;
+        drives[i]  = ~0ULL;
+        vals[i]    = stuck (i, (nets[i].flags & NBN_GND) ? 0 : ~0ULL);
+        haspend[i] = false;
+    }
+    events.clear ();
+    extchanged.clear ();
+
+    // start with everything needing evaluation
+    pending.assign ((ncells + 63) / 64, 0);
+    pendlo = 0;
+    for (uint32_t i = 0; i < ncells; i ++) markcell (i);
+    return settle ();
+}
+
+// make a net stuck at 0 or 1 in some more lanes, call restart() when done setting faults
+//  input:
+//   net = net to fault
+//   stuck0 = lanes it is stuck at 0 in
+//   stuck1 = lanes it is stuck at 1 in
+void Netlist::setfault (uint32_t net, uint64_t stuck0, uint64_t stuck1)
+{
+    stuck0s[net] |= stuck0;
+    stuck1s[net] |= stuck1 & ~ stuck0s[net];
+    faulty = true;
+}
+
+// remove all stuck-at faults, call restart() when done setting faults
+void Netlist::clearfaults ()
+{
+    if (faulty) {
+        stuck0s.assign (nnets, 0);
+        stuck1s.assign (nnets, 0);
+        faulty = false;
+    }
+}
+
+// find net by name
+//  returns index or -1 if not found
+int Netlist::findnet (char const *name)
+{
+    uint32_t lo = 0;
+    uint32_t hi = nnets;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        int cmp = strcmp (nets[mid].name, name);
+        if (cmp == 0) return mid;
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return -1;
+}
+
+// find net a port is connected to
+//  input:
+//   name = port name, eg, conapins[3], Conn/abbus.12, RasPi/rbc/rasbd.clk
+//  returns index of net or -1 if not found
+int Netlist::findport (char const *name)
+{
+    uint32_t lo = 0;
+    uint32_t hi = nports;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        int cmp = strcmp (strs + ports[mid].name, name);
+        if (cmp == 0) return ports[mid].net;
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return -1;
+}
+
+// get port name and the net it is connected to, ports are sorted by name
+char const *Netlist::portname (uint32_t port)
+{
+    return strs + ports[port].name;
+}
+
+uint32_t Netlist::portnet (uint32_t port)
+{
+    return ports[port].net;
+}
+
+// force net to the given value regardless of what drives it, until released
+void Netlist::force (uint32_t net, uint64_t val)
+{
+    val = stuck (net, val);
+    forced[net] = true;
+    if (vals[net] != val) {
+        vals[net] = val;
+        markreaders (net);
+        extchange (net);
+    }
+}
+
+// let whatever drives the net drive it again
+void Netlist::release (uint32_t net)
+{
+    forced[net] = false;
+    int32_t cell = nets[net].cell;
+    if (cell >= 0) {
+        startround ();
+        markcell (cell);
+    } else {
+        uint64_t val = stuck (net, (nets[net].flags & NBN_GND) ? 0 : drives[net]);
+        if (vals[net] != val) {
+            vals[net] = val;
+            markreaders (net);
+            extchange (net);
+        }
+    }
+}
+
+// wired-and an outside driver onto the net, like a tester's open-drain connector pin
+// whatever else drives the net can still pull it low, pass ~0 to stop driving it
+void Netlist::drive (uint32_t net, uint64_t val)
+{
+    drives[net] = val;
+    if (forced[net]) return;
+    int32_t cell = nets[net].cell;
+    val = stuck (net, val);
+    if (cell >= 0) {
+        startround ();
+        markcell (cell);
+    } else if (! (nets[net].flags & NBN_GND) && (vals[net] != val)) {
+        vals[net] = val;
+        markreaders (net);
+        extchange (net);
+    }
+}
+
+// evaluate cells until nothing changes
+// if freezeosc is set, lanes that oscillate are frozen (until restart()) so the other lanes can finish settling
+//  returns true: everything is stable
+//         false: something is oscillating (evaluation abandoned or lanes frozen)
+bool Netlist::settle ()
+{
+    extchanged.clear ();
+    newround = true;
+    uint32_t npend = pending.size ();
+    uint64_t limit = evals + ncells * 64ULL + 1024;
+    uint64_t osclanes = 0;      // lanes seen changing after limit reached
+    bool overlimit = false;
+    bool oscillated = false;
+    while (true) {
+        while ((pendlo < npend) && (pending[pendlo] == 0)) pendlo ++;
+        if (pendlo >= npend) return ! oscillated;
+        uint32_t c = pendlo * 64 + __builtin_ctzll (pending[pendlo]);
+        pending[pendlo] &= pending[pendlo] - 1;
+        uint32_t out = cells[c].out;
+        if (forced[out]) continue;
+        uint64_t val = stuck (out, evalcell (c) & drives[out]);
+        val = (val & ~ frozen) | (vals[out] & frozen);
+        if (vals[out] != val) {
+            if (overlimit) osclanes |= vals[out] ^ val;
+            vals[out] = val;
+            markreaders (out);
+        }
+        if (++ evals > limit) {
+            if (! freezeosc) {
+                memset (pending.data (), 0, npend * sizeof pending[0]);
+                pendlo = npend;
+                return false;
+            }
+            if (! overlimit) {
+
+                // keep going a little to see which lanes keep changing
+                overlimit = true;
+                osclanes  = 0;
+                limit     = evals + ncells * 4ULL + 1024;
+            } else {
+
+                // freeze them and let the others finish
+                frozen    |= osclanes;
+                overlimit  = false;
+                oscillated = true;
+                limit      = evals + ncells * 64ULL + 1024;
+            }
+        }
+    }
+}
+
+// set propagation delays used by settletimed()
+//  input:
+//   stagens  = delay through a transistor stage, ie, one cell (nanoseconds)
+//   loadns   = additional delay for each standard load on the cell's output
+//   jumperns = delay through a jumper cell between boards
+void Netlist::setdelays (double stagens, double loadns, double jumperns)
+{
+    delays.resize (ncells);
+    for (uint32_t c = 0; c < ncells; c ++) {
+        Cell const *cell = &cells[c];
+        double ns = (cell->nprods == 0) ? jumperns : stagens + loadns * nets[cell->out].loads;
+        delays[c] = (ns <= 0) ? 0 : (uint32_t) (ns * 1000.0 + 0.5);
+    }
+}
+
+// evaluate cells with delays until nothing changes
+// time starts at zero when the round started, ie, the first force/drive/release since the last settletimed()
+//  returns true: everything is stable, changeround/time/cause tell what changed when in this round
+//         false: something is oscillating (evaluation abandoned)
+bool Netlist::settletimed ()
+{
+    newround = true;
+
+    // cells that read nets changed from outside see them change at time zero
+    for (uint32_t net : extchanged) {
+        Net const *n = &nets[net];
+        for (uint32_t r = n->readers; r < n->readers + n->nreaders; r ++) {
+            uint32_t c = readers[r];
+            pending[c/64] &= ~ (1ULL << (c % 64));
+            schedule (c, 0, net);
+        }
+    }
+    extchanged.clear ();
+
+    // cells whose outputs were released or driven from outside
+    uint32_t npend = pending.size ();
+    for (; pendlo < npend; pendlo ++) {
+        while (pending[pendlo] != 0) {
+            uint32_t c = pendlo * 64 + __builtin_ctzll (pending[pendlo]);
+            pending[pendlo] &= pending[pendlo] - 1;
+            schedule (c, 0, -1);
+        }
+    }
+
+    // process events in time order until there are no more
+    uint64_t limit = evals + ncells * 64ULL + 1024;
+    while (! events.empty ()) {
+        std::pop_heap (events.begin (), events.end (), std::greater<Event> ());
+        Event ev = events.back ();
+        events.pop_back ();
+        if (! haspend[ev.net] || (pendseqs[ev.net] != ev.seq)) continue;
+        haspend[ev.net] = false;
+        if (forced[ev.net]) continue;
+        vals[ev.net]        = pendvals[ev.net];
+        changeround[ev.net] = round;
+        changetime[ev.net]  = ev.time;
+        changecause[ev.net] = pendcauses[ev.net];
+        Net const *n = &nets[ev.net];
+        for (uint32_t r = n->readers; r < n->readers + n->nreaders; r ++) {
+            schedule (readers[r], ev.time, ev.net);
+        }
+        if (evals > limit) {
+            events.clear ();
+            for (uint32_t i = 0; i < nnets; i ++) haspend[i] = false;
+            return false;
+        }
+    }
+    return true;
+}
+
+// an input to the cell changed at the given time, see what its output will do
+//  input:
+//   cell  = cell to evaluate
+//   time  = time the input changed
+//   cause = net that changed (-1 if outside)
+void Netlist::schedule (uint32_t cell, uint64_t time, int32_t cause)
+{
+    uint32_t out = cells[cell].out;
+    if (forced[out]) return;
+    evals ++;
+    uint64_t val = stuck (out, evalcell (cell) & drives[out]);
+
+    // if already changing to that value, let it
+    // otherwise cancel it, the pulse is too short to get through
+    if (haspend[out]) {
+        if (pendvals[out] == val) return;
+        haspend[out] = false;
+        pendseqs[out] ++;
+    }
+    if (vals[out] == val) return;
+
+    haspend[out]    = true;
+    pendvals[out]   = val;
+    pendcauses[out] = cause;
+    Event ev;
+    ev.time = time + delays[cell];
+    ev.seq  = ++ pendseqs[out];
+    ev.net  = out;
+    events.push_back (ev);
+    std::push_heap (events.begin (), events.end (), std::greater<Event> ());
+}
+
+// compute what a cell outputs given current values of its inputs
+uint64_t Netlist::evalcell (uint32_t cell)
+{
+    Cell const *c = &cells[cell];
+    uint64_t orval = 0;
+    for (uint32_t p = c->prods; p < c->prods + c->nprods; p ++) {
+        uint64_t andval = ~0ULL;
+        uint32_t const *ins = &inputs[prods[p].ins];
+        for (uint32_t i = prods[p].nins; i > 0; -- i) andval &= vals[*(ins++)];
+        orval |= andval;
+    }
+    orval = ~ orval;
+    uint32_t const *jps = &inputs[c->jumps];
+    for (uint32_t i = c->njumps; i > 0; -- i) orval &= vals[*(jps++)];
+    return orval;
+}
+
+void Netlist::printsummary (FILE *out)
+{
+    fprintf (out, "netlist: %u nets, %u cells, %u products, %u inputs, %u loops (largest %u cells), %u transistors ignored\n",
+        nnets, ncells, (uint32_t) prods.size (), (uint32_t) inputs.size (), nloops, maxscc, ignored);
+}
+
+// queue all cells that read the given net for evaluation
+void Netlist::markreaders (uint32_t net)
+{
+    Net const *n = &nets[net];
+    for (uint32_t r = n->readers; r < n->readers + n->nreaders; r ++) {
+        markcell (readers[r]);
+    }
+}
+
+void Netlist::markcell (uint32_t cell)
+{
+    uint32_t w = cell / 64;
+    pending[w] |= 1ULL << (cell % 64);
+    if (pendlo > w) pendlo = w;
+}
+
+// first change from outside after settletimed() starts a new round at time zero
+void Netlist::startround ()
+{
+    if (newround) {
+        round ++;
+        newround = false;
+    }
+}
+
+// net was changed from outside at time zero of the round
+void Netlist::extchange (uint32_t net)
+{
+    startround ();
+    changeround[net] = round;
+    changetime[net]  = 0;
+    changecause[net] = -1;
+    extchanged.push_back (net);
+}
+
+//////////////////////
+//  CIRCUIT ANALYSIS  //
+//////////////////////
+
+struct Analyzer {
+    std::vector<Netlist::Net> const *nets;
+    std::vector<NetVec> dfwd;       // cathodes of diodes whose anodes are on the net
+    std::vector<NetVec> drev;       // anodes of diodes whose cathodes are on the net
+    std::vector<NetVec> rlink;      // other end of resistors going to something other than a rail
+    std::vector<NetVec> bases;      // bases of transistors whose collectors are on the net
+    std::vector<NetVec> jumps;      // what drives connector input pin jumpered to the net
+    std::vector<bool> pullup;       // has resistor to VCC
+    std::vector<bool> signal;       // driven by transistors, jumpers or from outside
+    std::vector<uint8_t> state;     // 0=not analyzed yet; 1=being analyzed; 2=analyzed
+    std::vector<SumOfProds> funcs;  // analyzed function of non-signal net
+
+    bool isgnd (uint32_t n) { return ((*nets)[n].flags & NBN_GND) != 0; }
+    bool isvcc (uint32_t n) { return ((*nets)[n].flags & NBN_VCC) != 0; }
+    bool israil (uint32_t n) { return ((*nets)[n].flags & (NBN_GND | NBN_VCC)) != 0; }
+
+    SumOfProds const &netfunc (uint32_t n);
+};
+
+static void normalize (SumOfProds &sop);
+
+// analyze the components to get the cells that drive each net
+void Netlist::analyze (NBComp const *comps, uint32_t const *pins)
+{
+    Analyzer az;
+    az.nets = &nets;
+    az.dfwd.resize (nnets);
+    az.drev.resize (nnets);
+    az.rlink.resize (nnets);
+    az.bases.resize (nnets);
+    az.jumps.resize (nnets);
+    az.pullup.resize (nnets);
+    az.signal.resize (nnets);
+    az.state.resize (nnets);
+    az.funcs.resize (nnets);
+
+    for (uint32_t i = 0; i < hdr->nports; i ++) {
+        az.signal[ports[i].net] = true;
+    }
+
+    for (uint32_t i = 0; i < hdr->ncomps; i ++) {
+        NBComp const *comp = &comps[i];
+        uint32_t const *cpins = &pins[comp->pins];
+        switch (comp->kind) {
+            case NBK_NPN:
+            case NBK_NFET: {
+                uint32_t e = cpins[0], b = cpins[1], c = cpins[2];
+                if ((e == NBP_NONE) || (b == NBP_NONE) || (c == NBP_NONE) || ! az.isgnd (e) || az.israil (c)) {
+                    ignored ++;
+                } else {
+                    az.bases[c].push_back (b);
+                    az.signal[c] = true;
+                }
+                break;
+            }
+            case NBK_DIODE: {
+                uint32_t a = cpins[0], c = cpins[1];
+                if ((a != NBP_NONE) && (c != NBP_NONE)) {
+                    az.dfwd[a].push_back (c);
+                    az.drev[c].push_back (a);
+                }
+                break;
+            }
+            case NBK_RESIS: {
+                uint32_t a = cpins[0], c = cpins[1];
+                if ((a != NBP_NONE) && (c != NBP_NONE)) {
+                    if (az.isvcc (a)) az.pullup[c] = true;
+                    if (az.isvcc (c)) az.pullup[a] = true;
+                    if (! az.israil (a) && ! az.israil (c)) {
+                        az.rlink[a].push_back (c);
+                        az.rlink[c].push_back (a);
+                    }
+                }
+                break;
+            }
+            case NBK_JUMPER: {
+                uint32_t p = cpins[0];
+                if (p != NBP_NONE) {
+                    for (uint32_t j = 1; j < comp->npins; j ++) {
+                        if (cpins[j] != NBP_NONE) az.jumps[p].push_back (cpins[j]);
+                    }
+                    az.signal[p] = true;
+                }
+                break;
+            }
+
+            // PNPs just drive LEDs, LEDs and caps don't affect logic
+            case NBK_PNP: {
+                ignored ++;
+                break;
+            }
+        }
+    }
+
+    // make a cell for every net that has transistors or jumpers driving it
+    for (uint32_t n = 0; n < nnets; n ++) {
+        if (az.israil (n) || (az.bases[n].empty () && az.jumps[n].empty ())) continue;
+        SumOfProds sop;
+        for (uint32_t b : az.bases[n]) {
+            SumOfProds const &bf = az.netfunc (b);
+            sop.insert (sop.end (), bf.begin (), bf.end ());
+        }
+        normalize (sop);
+
+        Cell cell;
+        memset (&cell, 0, sizeof cell);
+        cell.out    = n;
+        cell.prods  = prods.size ();
+        cell.nprods = sop.size ();
+        cell.ntrans = std::min<size_t> (az.bases[n].size (), 0xFFFF);
+        for (NetVec const &p : sop) {
+            Prod prod;
+            prod.ins  = inputs.size ();
+            prod.nins = p.size ();
+            inputs.insert (inputs.end (), p.begin (), p.end ());
+            prods.push_back (prod);
+        }
+        cell.jumps  = inputs.size ();
+        cell.njumps = az.jumps[n].size ();
+        inputs.insert (inputs.end (), az.jumps[n].begin (), az.jumps[n].end ());
+        nets[n].cell = cells.size ();
+        cells.push_back (cell);
+    }
+    ncells = cells.size ();
+}
+
+// get function of a net in terms of signal nets
+//  an empty sum is always 0, an empty product is always 1
+SumOfProds const &Analyzer::netfunc (uint32_t n)
+{
+    static SumOfProds const zero;
+    static SumOfProds const one (1);
+
+    if (isgnd (n)) return zero;
+    if (isvcc (n)) return one;
+    if (state[n] == 1) return zero;
+    if (state[n] == 2) return funcs[n];
+    state[n] = 1;
+    SumOfProds sop;
+    if (signal[n]) {
+
+        // transistor-driven or port, it is an input to the cell
+        sop.push_back (NetVec (1, n));
+    } else if (pullup[n]) {
+
+        // pulled up with diodes going to signals, it is an AND of those signals
+        // the diode going forward to the OR / base doesn't pull it down
+        NetVec prod;
+        bool gnd = false;
+        for (uint32_t c : dfwd[n]) {
+            if (signal[c]) prod.push_back (c);
+            gnd |= isgnd (c);
+        }
+        if (! gnd) sop.push_back (prod);
+    } else {
+
+        // not pulled up, OR of whatever diodes and resistors bring in
+        for (uint32_t a : drev[n]) {
+            SumOfProds const &af = netfunc (a);
+            sop.insert (sop.end (), af.begin (), af.end ());
+        }
+        for (uint32_t r : rlink[n]) {
+            SumOfProds const &rf = netfunc (r);
+            sop.insert (sop.end (), rf.begin (), rf.end ());
+        }
+    }
+    normalize (sop);
+    funcs[n] = sop;
+    state[n] = 2;
+    return funcs[n];
+}
+
+// sort and remove duplicates so equivalent functions look the same
+static void normalize (SumOfProds &sop)
+{
+    for (NetVec &p : sop) {
+        std::sort (p.begin (), p.end ());
+        p.erase (std::unique (p.begin (), p.end ()), p.end ());
+    }
+    std::sort (sop.begin (), sop.end ());
+    sop.erase (std::unique (sop.begin (), sop.end ()), sop.end ());
+}
+
+// renumber cells so they come after the cells they read
+// cells in a feedback loop are numbered together
+void Netlist::levelize ()
+{
+    // get list of cells each cell reads
+    std::vector<NetVec> deps (ncells);
+    for (uint32_t c = 0; c < ncells; c ++) {
+        Cell const *cell = &cells[c];
+        uint32_t beg = (cell->nprods == 0) ? cell->jumps : prods[cell->prods].ins;
+        for (uint32_t i = beg; i < cell->jumps + cell->njumps; i ++) {
+            int32_t d = nets[inputs[i]].cell;
+            if (d >= 0) deps[c].push_back (d);
+        }
+        std::sort (deps[c].begin (), deps[c].end ());
+        deps[c].erase (std::unique (deps[c].begin (), deps[c].end ()), deps[c].end ());
+    }
+
+    // Tarjan's strongly-connected components, iteratively
+    // ...gives components with everything they read coming first
+    std::vector<uint32_t> index (ncells, 0);    // 0 = not visited yet, else 1 + visit order
+    std::vector<uint32_t> lowlink (ncells);
+    std::vector<bool> onstack (ncells);
+    std::vector<uint32_t> stack;
+    std::vector<std::pair<uint32_t,uint32_t>> frames;   // <cell, next dep to look at>
+    std::vector<uint32_t> neworder;
+    std::vector<uint32_t> sccs (ncells);
+    uint32_t visits = 0;
+    neworder.reserve (ncells);
+    for (uint32_t root = 0; root < ncells; root ++) {
+        if (index[root] != 0) continue;
+        frames.push_back (std::make_pair (root, 0));
+        index[root] = lowlink[root] = ++ visits;
+        stack.push_back (root);
+        onstack[root] = true;
+        while (! frames.empty ()) {
+            uint32_t v = frames.back ().first;
+            uint32_t i = frames.back ().second;
+            if (i < deps[v].size ()) {
+                frames.back ().second ++;
+                uint32_t w = deps[v][i];
+                if (index[w] == 0) {
+                    frames.push_back (std::make_pair (w, 0));
+                    index[w] = lowlink[w] = ++ visits;
+                    stack.push_back (w);
+                    onstack[w] = true;
+                } else if (onstack[w] && (lowlink[v] > index[w])) {
+                    lowlink[v] = index[w];
+                }
+                continue;
+            }
+            frames.pop_back ();
+            if (lowlink[v] == index[v]) {
+                uint32_t size = 0;
+                uint32_t w;
+                do {
+                    w = stack.back ();
+                    stack.pop_back ();
+                    onstack[w] = false;
+                    sccs[w] = nsccs;
+                    neworder.push_back (w);
+                    size ++;
+                } while (w != v);
+                nsccs ++;
+                if (size > 1) nloops ++;
+                if (maxscc < size) maxscc = size;
+            }
+            if (! frames.empty ()) {
+                uint32_t u = frames.back ().first;
+                if (lowlink[u] > lowlink[v]) lowlink[u] = lowlink[v];
+            }
+        }
+    }
+
+    // put cells in that order
+    std::vector<uint32_t> sccsizes (nsccs, 0);
+    for (uint32_t c = 0; c < ncells; c ++) sccsizes[sccs[c]] ++;
+    std::vector<Cell> oldcells;
+    oldcells.swap (cells);
+    cells.reserve (ncells);
+    for (uint32_t c : neworder) {
+        Cell cell = oldcells[c];
+        cell.scc  = sccs[c];
+        cell.loop = (sccsizes[cell.scc] > 1) || std::binary_search (deps[c].begin (), deps[c].end (), c);
+        nets[cell.out].cell = cells.size ();
+        cells.push_back (cell);
+    }
+
+    // make list of cells that read each net
+    std::vector<uint32_t> lastreader (nnets, ~0U);
+    for (int pass = 0; pass < 2; pass ++) {
+        for (uint32_t c = 0; c < ncells; c ++) {
+            Cell const *cell = &cells[c];
+            uint32_t beg = (cell->nprods == 0) ? cell->jumps : prods[cell->prods].ins;
+            for (uint32_t i = beg; i < cell->jumps + cell->njumps; i ++) {
+                uint32_t n = inputs[i];
+                if (lastreader[n] == c) continue;
+                lastreader[n] = c;
+                if (pass == 0) nets[n].nreaders ++;
+                else readers[nets[n].readers+nets[n].nreaders++] = c;
+            }
+        }
+        if (pass == 0) {
+            uint32_t total = 0;
+            for (uint32_t n = 0; n < nnets; n ++) {
+                nets[n].readers  = total;
+                total += nets[n].nreaders;
+                nets[n].nreaders = 0;
+                lastreader[n]    = ~0U;
+            }
+            readers.resize (total);
+        }
+    }
+}
+
+////////////////////////
+//  BATCH EVALUATION  //
+////////////////////////
+
+// evaluate one cell for NW words of lanes
+//  returns whether the output changed
+template <uint32_t NW>
+struct EvalWide {
+    static bool eval (Netlist::Cell const *cell, Netlist::Prod const *prods, uint32_t const *inputs, uint64_t *vals, uint64_t const *drives)
+    {
+        uint64_t orval[NW];
+        for (uint32_t w = 0; w < NW; w ++) orval[w] = 0;
+        for (uint32_t p = cell->prods; p < cell->prods + cell->nprods; p ++) {
+            uint64_t andval[NW];
+            for (uint32_t w = 0; w < NW; w ++) andval[w] = ~0ULL;
+            uint32_t const *ins = &inputs[prods[p].ins];
+            for (uint32_t i = prods[p].nins; i > 0; -- i) {
+                uint64_t const *in = &vals[*(ins++)*NW];
+                for (uint32_t w = 0; w < NW; w ++) andval[w] &= in[w];
+            }
+            for (uint32_t w = 0; w < NW; w ++) orval[w] |= andval[w];
+        }
+        uint64_t const *drv = &drives[cell->out*NW];
+        for (uint32_t w = 0; w < NW; w ++) orval[w] = ~ orval[w] & drv[w];
+        uint32_t const *jps = &inputs[cell->jumps];
+        for (uint32_t i = cell->njumps; i > 0; -- i) {
+            uint64_t const *in = &vals[*(jps++)*NW];
+            for (uint32_t w = 0; w < NW; w ++) orval[w] &= in[w];
+        }
+        uint64_t *out = &vals[cell->out*NW];
+        uint64_t diff = 0;
+        for (uint32_t w = 0; w < NW; w ++) {
+            diff |= out[w] ^ orval[w];
+            out[w] = orval[w];
+        }
+        return diff != 0;
+    }
+};
+
+#if defined(__x86_64__)
+// same as EvalWide<4> but all 256 lanes at once in AVX2 registers
+struct EvalAvx2 {
+    __attribute__((target("avx2")))
+    static bool eval (Netlist::Cell const *cell, Netlist::Prod const *prods, uint32_t const *inputs, uint64_t *vals, uint64_t const *drives)
+    {
+        __m256i const ones = _mm256_set1_epi64x (-1);
+        __m256i orval = _mm256_setzero_si256 ();
+        for (uint32_t p = cell->prods; p < cell->prods + cell->nprods; p ++) {
+            __m256i andval = ones;
+            uint32_t const *ins = &inputs[prods[p].ins];
+            for (uint32_t i = prods[p].nins; i > 0; -- i) {
+                andval = _mm256_and_si256 (andval, _mm256_loadu_si256 ((__m256i const *) &vals[*(ins++)*4]));
+            }
+            orval = _mm256_or_si256 (orval, andval);
+        }
+        orval = _mm256_andnot_si256 (orval, _mm256_loadu_si256 ((__m256i const *) &drives[cell->out*4]));
+        uint32_t const *jps = &inputs[cell->jumps];
+        for (uint32_t i = cell->njumps; i > 0; -- i) {
+            orval = _mm256_and_si256 (orval, _mm256_loadu_si256 ((__m256i const *) &vals[*(jps++)*4]));
+        }
+        __m256i *out = (__m256i *) &vals[cell->out*4];
+        __m256i diff = _mm256_xor_si256 (_mm256_loadu_si256 (out), orval);
+        _mm256_storeu_si256 (out, orval);
+        return ! _mm256_testz_si256 (diff, diff);
+    }
+};
+#endif
+
+// set up to evaluate nwords*64 lanes
+//  input:
+//   netlist = loaded netlist
+//   nwords  = 1, 2, 4 or 8
+NetlistBatch::NetlistBatch (Netlist *netlist, uint32_t nwords)
+{
+    if ((nwords != 1) && (nwords != 2) && (nwords != 4) && (nwords != 8)) {
+        fprintf (stderr, "NetlistBatch: bad nwords %u\n", nwords);
+        abort ();
+    }
+    this->netlist = netlist;
+    this->nwords  = nwords;
+    evals = 0;
+    avx2  = false;
+#if defined(__x86_64__)
+    avx2  = (nwords == 4) && __builtin_cpu_supports ("avx2");
+#endif
+
+    vals.resize (netlist->nnets * nwords);
+    drives.assign (netlist->nnets * nwords, ~0ULL);
+    for (uint32_t n = 0; n < netlist->nnets; n ++) {
+        for (uint32_t w = 0; w < nwords; w ++) {
+            vals[n*nwords+w] = netlist->vals[n];
+        }
+    }
+
+    // cells were levelized so everything a cell reads comes before it except in feedback loops
+    // so run of cells not in loops can be evaluated in one pass
+    for (uint32_t beg = 0; beg < netlist->ncells;) {
+        uint32_t scc = netlist->cells[beg].scc;
+        uint32_t end = beg;
+        while ((end < netlist->ncells) && (netlist->cells[end].scc == scc)) end ++;
+        bool loop = netlist->cells[beg].loop;
+        if (! loop && ! ranges.empty () && ! ranges.back ().loop) {
+            ranges.back ().end = end;
+        } else {
+            Range range;
+            range.beg  = beg;
+            range.end  = end;
+            range.loop = loop;
+            ranges.push_back (range);
+        }
+        beg = end;
+    }
+}
+
+// wired-and an outside driver onto one word of a net, ~0 to stop driving
+// nets without cells driving them take the value immediately, others on next settle()
+void NetlistBatch::drive (uint32_t net, uint32_t word, uint64_t val)
+{
+    drives[net*nwords+word] = val;
+    if ((netlist->nets[net].cell < 0) && ! (netlist->nets[net].flags & NBN_GND)) {
+        vals[net*nwords+word] = val;
+    }
+}
+
+// evaluate cells once in order, repeating feedback loops until stable
+//  returns true: everything is stable
+//         false: a feedback loop is oscillating (evaluation abandoned)
+bool NetlistBatch::settle ()
+{
+    switch (nwords) {
+#if defined(__x86_64__)
+        case 4: return avx2 ? settleranges<EvalAvx2> () : settleranges<EvalWide<4>> ();
+#else
+        case 4: return settleranges<EvalWide<4>> ();
+#endif
+        case 1: return settleranges<EvalWide<1>> ();
+        case 2: return settleranges<EvalWide<2>> ();
+        case 8: return settleranges<EvalWide<8>> ();
+    }
+    abort ();
+}
+
+template <typename EVAL>
+bool NetlistBatch::settleranges ()
+{
+    Netlist::Cell const *cells = netlist->cells.data ();
+    Netlist::Prod const *prods = netlist->prods.data ();
+    uint32_t const *inputs = netlist->inputs.data ();
+    uint64_t *vs = vals.data ();
+    uint64_t const *ds = drives.data ();
+
+    for (Range const &r : ranges) {
+        if (! r.loop) {
+            for (uint32_t c = r.beg; c < r.end; c ++) {
+                EVAL::eval (&cells[c], prods, inputs, vs, ds);
+            }
+            evals += r.end - r.beg;
+        } else {
+            uint32_t passes = 0;
+            bool changed;
+            do {
+                if (++ passes > (r.end - r.beg) * 4 + 16) return false;
+                changed = false;
+                for (uint32_t c = r.beg; c < r.end; c ++) {
+                    changed |= EVAL::eval (&cells[c], prods, inputs, vs, ds);
+                }
+                evals += r.end - r.beg;
+            } while (changed);
+        }
+    }
+    return true;
+}
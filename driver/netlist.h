@@ -0,0 +1,183 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+#ifndef _NETLIST_H
+#define _NETLIST_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "netbin.h"
+
+// default settletimed() delays
+#define DEFSTAGENS  20.0        // each transistor stage
+#define DEFLOADNS    1.0        // plus this for each load on its output
+#define DEFJUMPERNS  2.0        // jumper between boards
+
+// compiled gate-level simulation of a netgen -netbin file
+// each net holds 64 lanes, one bit per lane, all lanes evaluated at once
+struct Netlist {
+
+    // a net, ie, merged (wired-and) network from the netbin file
+    struct Net {
+        char const *name;
+        uint16_t loads;         // standard logic loads from netgen
+        uint16_t flags;         // NBN_* flags
+        int32_t cell;           // cell that drives the net, -1 if none
+        uint32_t readers;       // index in readers[] of first cell that reads this net
+        uint32_t nreaders;      // number of cells that read this net
+    };
+
+    // a cell drives one net:
+    //   out = ~(OR of products) & (AND of jumper inputs)
+    // products are the DTL diode-and/diode-or terms feeding the base of all the transistors whose collectors are on the net
+    // cells are numbered in evaluation order, ie, cells come after the cells they read, except within feedback loops
+    struct Cell {
+        uint32_t out;           // net being driven
+        uint32_t prods;         // index in prods[] of first product term
+        uint32_t nprods;        // number of product terms
+        uint32_t jumps;         // index in inputs[] of first jumper input
+        uint32_t njumps;        // number of jumper inputs
+        uint32_t scc;           // strongly-connected component (feedback loop) number
+        uint16_t ntrans;        // number of transistors driving the net
+        bool loop;              // part of a feedback loop, ie, scc of more than one cell or reads its own output
+    };
+
+    struct Prod {
+        uint32_t ins;           // index in inputs[] of first net being and-ed
+        uint32_t nins;          // number of nets being and-ed
+    };
+
+    uint32_t nnets;
+    uint32_t nports;
+    uint32_t ncells;
+    uint32_t nsccs;             // number of strongly-connected components
+    uint32_t nloops;            // number of those with more than one cell, ie, feedback loops
+    uint32_t maxscc;            // size of largest one
+    uint32_t ignored;           // transistors that aren't part of the logic (LED drivers, etc)
+    uint64_t evals;             // number of cell evaluations done by settle() and settletimed()
+    bool freezeosc;             // settle() freezes oscillating lanes instead of giving up
+    uint64_t frozen;            // lanes settle() has frozen
+
+    std::vector<Net> nets;
+    std::vector<Cell> cells;
+    std::vector<Prod> prods;
+    std::vector<uint32_t> inputs;
+    std::vector<uint32_t> readers;
+    std::vector<uint64_t> vals; // current value of each net, one bit per lane
+    std::vector<uint64_t> drives;   // outside drivers (connector pins) wired-anded onto each net
+
+    // timed simulation, see settletimed()
+    uint32_t round;                     // incremented by first force/drive/release after settletimed()
+    std::vector<uint32_t> delays;       // propagation delay of each cell (picoseconds)
+    std::vector<uint32_t> changeround;  // round each net last changed in
+    std::vector<uint64_t> changetime;   // when it changed (picoseconds after round started)
+    std::vector<int32_t> changecause;   // net whose change caused it to change, -1 if changed from outside
+
+    Netlist ();
+    ~Netlist ();
+    bool load (char const *filename);
+    int findnet (char const *name);
+    int findport (char const *name);
+    char const *portname (uint32_t port);
+    uint32_t portnet (uint32_t port);
+    void force (uint32_t net, uint64_t val);
+    void release (uint32_t net);
+    void drive (uint32_t net, uint64_t val);
+    bool settle ();
+    bool restart ();
+    void setfault (uint32_t net, uint64_t stuck0, uint64_t stuck1);
+    void clearfaults ();
+    void setdelays (double stagens, double loadns, double jumperns);
+    bool settletimed ();
+    uint64_t evalcell (uint32_t cell);
+    void printsummary (FILE *out);
+
+private:
+    char const *strs;
+    NBHdr const *hdr;
+    NBPort const *ports;
+    std::vector<bool> forced;
+    bool faulty;                        // some lanes have stuck-at faults
+    std::vector<uint64_t> stuck0s;      // lanes each net is stuck at 0 in
+    std::vector<uint64_t> stuck1s;      // lanes each net is stuck at 1 in
+    std::vector<uint64_t> pending;  // bitmask of cells that need evaluating
+    uint32_t pendlo;                // lowest word of pending that might have a bit set
+    void *mapptr;
+    size_t mapsize;
+
+    // a net changing value at some time in the future
+    struct Event {
+        uint64_t time;
+        uint32_t seq;
+        uint32_t net;
+        bool operator> (Event const &e) const { return time > e.time; }
+    };
+
+    bool newround;                      // next force/drive/release starts a new round
+    std::vector<uint32_t> extchanged;   // nets changed from outside this round
+    std::vector<Event> events;          // heap of pending events, soonest first
+    std::vector<uint64_t> pendvals;     // value each net will change to
+    std::vector<uint32_t> pendseqs;     // sequence of the event that is still valid
+    std::vector<int32_t> pendcauses;    // net that caused the event
+    std::vector<bool> haspend;          // net has an event pending
+
+    void analyze (NBComp const *comps, uint32_t const *pins);
+    void levelize ();
+    void markreaders (uint32_t net);
+    void markcell (uint32_t cell);
+    uint64_t stuck (uint32_t net, uint64_t val) { return faulty ? (val & ~ stuck0s[net]) | stuck1s[net] : val; }
+    void startround ();
+    void extchange (uint32_t net);
+    void schedule (uint32_t cell, uint64_t time, int32_t cause);
+};
+
+// evaluates nwords*64 independent lanes through a netlist's cells at once
+// for sweeping combinational logic through lots of input vectors
+// one pass in cell order settles everything, feedback loops are repeated until stable
+// starts out with values copied from the netlist, its forced nets are not forced here
+struct NetlistBatch {
+    Netlist *netlist;
+    uint32_t nwords;            // 64-bit words per net: 1, 2, 4 or 8
+    bool avx2;                  // nwords == 4 and using AVX2 instructions
+    uint64_t evals;             // number of cell evaluations done by settle()
+    std::vector<uint64_t> vals;     // value of each net, [net*nwords+word]
+    std::vector<uint64_t> drives;   // outside drivers wired-anded onto each net, [net*nwords+word]
+
+    NetlistBatch (Netlist *netlist, uint32_t nwords);
+    void drive (uint32_t net, uint32_t word, uint64_t val);
+    uint64_t get (uint32_t net, uint32_t word) { return vals[net*nwords+word]; }
+    bool settle ();
+
+    // cells to evaluate once in order, or repeat until stable if a feedback loop
+    struct Range {
+        uint32_t beg;
+        uint32_t end;
+        bool loop;
+    };
+
+private:
+    std::vector<Range> ranges;
+
+    template <typename EVAL> bool settleranges ();
+};
+
+#endif
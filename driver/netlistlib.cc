@@ -0,0 +1,500 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// Simulates the circuit from a netgen -netbin file to access the GPIO and 2x20 connectors
+// Like PipeLib but runs the gate-level simulation right here instead of in NetGen.java
+
+// writes to the GPIO pins force the cpu side of the RasPi level converters like NetGen.java's force command
+// reads of the GPIO pins sample the other cpu-side level converter nets like NetGen.java's examine command
+
+// connector pins are the master module's con{a,c,i,d}pins[31:00] outputs if present
+// ...otherwise the pins of a single board's abbus, ctla, irbus, dbus connectors
+// ...so the board testers can drive the connector pins with writecon()
+// writecon() wired-ands the pins like the IOW56 open-drain outputs so the boards can still pull them low
+
+// recordvecs() writes every call made by the tester to a file for faultsim to replay
+// the reads compare all 64 lanes with lane 0 so faultsim can tell which faults were detected
+
+// settiming() switches to timed simulation (see Netlist::settletimed())
+// ...and tallies when the connector pins settle in each half of each Shadow::State
+// ...with the path through the boards that made the slowest one settle last
+// ...or, for the board testers, which have no cpu state, over all half cycles
+
+// the board testers take -netlist <file>, -vectors <file> and -nettiming <file> via testeropt() and testeropen()
+
+// cd ../modules
+// ./master.sh -gen master -netbin master.bin
+// tclsh assemble.tcl umul.asm umul.hex
+// ../driver/raspictl.x86_64 -printstate -netlist master.bin -tclhex umul.hex
+// ../driver/raspictl.x86_64 -netlist master.bin -nettiming timing.txt -tclhex umul.hex
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#include "gpiolib.h"
+#include "netlist.h"
+#include "netvecs.h"
+#include "shadow.h"
+
+// timing of one half of one state
+struct NetlistLib::TimingStat {
+    uint64_t halfcycles;            // number of times through this half of the state
+    uint64_t pintimes[4][32];       // latest each connector pin settled (picoseconds)
+    uint64_t pincounts[4][32];      // number of times it changed
+    uint64_t worsttime;             // latest any pin settled
+    int worstcon, worstpin;         // which pin that was
+    std::vector<uint32_t> worstnets;    // path that made it settle last, pin first
+    std::vector<uint64_t> worsttimes;   // when each net on the path changed
+};
+
+// connector pin number for each bit returned by readcon()
+static int const conpinnos[32] = {
+     1,  2,  3,  4,  6,  7,  8, 10, 11, 12, 14, 15, 16, 18, 19, 20,
+    21, 22, 24, 25, 26, 28, 29, 30, 32, 33, 34, 36, 37, 38, 39, 40 };
+
+// board connector names for CON_A,C,I,D
+static char const *const connames[4] = { "abbus", "ctla", "irbus", "dbus" };
+
+NetlistLib::NetlistLib (char const *netname)
+{
+    this->netname = netname;
+    netlist      = NULL;
+    hasraspi     = false;
+    gpiowritten  = 0;
+    oscillations = 0;
+    reportname   = NULL;
+    shadow       = NULL;
+    timedround   = 0;
+    vecsfile     = NULL;
+    lanediffs    = 0;
+}
+
+// load the netlist and find the RasPi and connector nets
+void NetlistLib::open ()
+{
+    netlist = new Netlist ();
+    if (! netlist->load (netname)) abort ();
+
+    // RasPi's cpu-side ports are named RasPi<instvarsuf>.<signal>
+    char raspi[256];
+    raspi[0] = 0;
+    for (uint32_t i = 0; i < netlist->nports; i ++) {
+        char const *name = netlist->portname (i);
+        int len = strlen (name);
+        if ((strncmp (name, "RasPi", 5) == 0) && (len > 4) && (len < (int) sizeof raspi) && (strcmp (name + len - 4, ".clk") == 0)) {
+            memcpy (raspi, name, len - 4);
+            raspi[len-4] = 0;
+            break;
+        }
+    }
+    hasraspi = raspi[0] != 0;
+    if (hasraspi) {
+        clknet    = findraspiport (raspi, "clk");
+        resnet    = findraspiport (raspi, "reset");
+        irqnet    = findraspiport (raspi, "irq");
+        mreadnet  = findraspiport (raspi, "mread");
+        mwritenet = findraspiport (raspi, "mwrite");
+        mwordnet  = findraspiport (raspi, "mword");
+        haltnet   = findraspiport (raspi, "halt");
+        for (int i = 0; i < 16; i ++) {
+            char sig[8];
+            sprintf (sig, "mq[%d]", i);
+            mqnets[i] = findraspiport (raspi, sig);
+            sprintf (sig, "md[%d]", i);
+            mdnets[i] = findraspiport (raspi, sig);
+        }
+    }
+
+    // connector pins
+    for (int c = 0; c < 4; c ++) {
+        for (int i = 0; i < 32; i ++) {
+            char name[32];
+            sprintf (name, "con%cpins[%d]", CONLETS[c] + 'a' - 'A', i);
+            connets[c][i] = netlist->findport (name);
+            if (connets[c][i] < 0) {
+                sprintf (name, "Conn/%s.%d", connames[c], conpinnos[i]);
+                connets[c][i] = netlist->findport (name);
+            }
+        }
+    }
+
+    netlist->printsummary (stderr);
+}
+
+// switch to timed simulation
+//  input:
+//   reportname = file to write timing report to at close()
+//   shadow     = tells what state the cpu is in, NULL to tally all half cycles together
+//   stagens, loadns, jumperns = delays, see Netlist::setdelays()
+void NetlistLib::settiming (char const *reportname, Shadow *shadow, double stagens, double loadns, double jumperns)
+{
+    this->reportname = reportname;
+    this->shadow     = shadow;
+    this->stagens    = stagens;
+    this->loadns     = loadns;
+    this->jumperns   = jumperns;
+    netlist->setdelays (stagens, loadns, jumperns);
+    timedround = netlist->round;
+}
+
+// put circuit back the way open() left it except for any faults set in the netlist
+// ...so faultsim can replay the vectors again
+void NetlistLib::restart ()
+{
+    if (! netlist->restart () && ! netlist->freezeosc) {
+        fprintf (stderr, "NetlistLib::restart: %s does not settle with ports floating\n", netname);
+    }
+    gpiowritten = 0;
+    lanediffs   = 0;
+    timedround  = netlist->round;
+}
+
+// process board tester -netlist <file>, -vectors <file> and -nettiming <file> options
+//  input:
+//   argv[*i] = option to check
+//  output:
+//   returns < 0: error message printed
+//          == 0: not -netlist, -vectors or -nettiming
+//           > 0: option processed, *i = index of its filename
+int NetlistLib::testeropt (int argc, char **argv, int *i, char const **netlistname, char const **vectorsname, char const **nettimingname)
+{
+    char const **name_r;
+    if (strcasecmp (argv[*i], "-netlist") == 0) name_r = netlistname;
+    else if (strcasecmp (argv[*i], "-vectors") == 0) name_r = vectorsname;
+    else if (strcasecmp (argv[*i], "-nettiming") == 0) name_r = nettimingname;
+    else return 0;
+    if (++ *i >= argc) {
+        fprintf (stderr, "%s missing filename\n", argv[*i-1]);
+        return -1;
+    }
+    *name_r = argv[*i];
+    return 1;
+}
+
+// open netlist given by board tester -netlist option, start recording its -vectors file
+// ...and simulate with default delays if -nettiming
+//  returns NULL if no -netlist, tester accesses the board itself
+//  the files are written out when the tester exits
+NetlistLib *NetlistLib::testeropen (char const *netlistname, char const *vectorsname, char const *nettimingname)
+{
+    if (netlistname == NULL) {
+        if (vectorsname != NULL) {
+            fprintf (stderr, "-vectors requires -netlist\n");
+            exit (1);
+        }
+        if (nettimingname != NULL) {
+            fprintf (stderr, "-nettiming requires -netlist\n");
+            exit (1);
+        }
+        return NULL;
+    }
+    testerlib = new NetlistLib (netlistname);
+    testerlib->open ();
+    if (vectorsname != NULL) testerlib->recordvecs (vectorsname);
+    if (nettimingname != NULL) testerlib->settiming (nettimingname, NULL, DEFSTAGENS, DEFLOADNS, DEFJUMPERNS);
+    atexit (testerclose);
+    return testerlib;
+}
+
+NetlistLib *NetlistLib::testerlib;
+
+void NetlistLib::testerclose ()
+{
+    testerlib->close ();
+}
+
+// record test vectors to the given file
+void NetlistLib::recordvecs (char const *filename)
+{
+    vecsfile = fopen (filename, "w");
+    if (vecsfile == NULL) {
+        fprintf (stderr, "NetlistLib::recordvecs: error creating %s: %m\n", filename);
+        abort ();
+    }
+    fwrite (NETVECS_MAGIC, 8, 1, vecsfile);
+}
+
+void NetlistLib::close ()
+{
+    if (vecsfile != NULL) {
+        if (fclose (vecsfile) < 0) fprintf (stderr, "NetlistLib::close: error closing vectors file: %m\n");
+        vecsfile = NULL;
+    }
+    if (reportname != NULL) writereport ();
+    reportname = NULL;
+    for (TimingStat *ts : timingstats) delete ts;
+    timingstats.clear ();
+    delete netlist;
+    netlist = NULL;
+}
+
+// let the circuit settle for half a clock cycle
+void NetlistLib::halfcycle ()
+{
+    settle ();
+    if (reportname != NULL) timecycle ();
+    if (vecsfile != NULL) recordvec (NVO_HALFCYCLE, 0, 0, 0);
+}
+
+// read raspi gpio pins
+//  like NetGen.java's RasPiModule examine command
+uint32_t NetlistLib::readgpio ()
+{
+    if (! hasraspi) {
+        fprintf (stderr, "NetlistLib::readgpio: %s has no RasPi\n", netname);
+        abort ();
+    }
+    settle ();
+    uint32_t value = gpiowritten & (G_DENA | G__QENA | G_IRQ | G_RESET | G_CLK);
+    if (readlane0 (mwritenet)) value |= G_WRITE;
+    if (readlane0 (mreadnet))  value |= G_READ;
+    if (readlane0 (haltnet))   value |= G_HALT;
+    if (readlane0 (mwordnet))  value |= G_WORD;
+    if (gpiowritten & G__QENA) {
+        for (int i = 0; i < 16; i ++) {
+            if (readlane0 (mdnets[i])) value |= G_DATA0 << i;
+        }
+    } else {
+        value |= gpiowritten & G_DATA;
+    }
+    if (vecsfile != NULL) recordvec (NVO_READGPIO, 0, 0, value);
+    return value;
+}
+
+// write raspi gpio pins
+//  like NetGen.java's RasPiModule force command
+//  the G_DENA and G__QENA pins are set like PhysLib does
+void NetlistLib::writegpio (bool wdata, uint32_t valu)
+{
+    if (! hasraspi) {
+        fprintf (stderr, "NetlistLib::writegpio: %s has no RasPi\n", netname);
+        abort ();
+    }
+    if (wdata) valu &= ~ (G_DENA | G__QENA);
+          else valu |=    G_DENA | G__QENA;
+    gpiowritten = valu;
+    if (vecsfile != NULL) recordvec (NVO_WRITEGPIO, wdata, 0, valu);
+    netlist->force (clknet, (valu & G_CLK)   ? ~0ULL : 0);
+    netlist->force (resnet, (valu & G_RESET) ? ~0ULL : 0);
+    netlist->force (irqnet, (valu & G_IRQ)   ? ~0ULL : 0);
+    for (int i = 0; i < 16; i ++) {
+        netlist->force (mqnets[i], (valu & (G_DATA0 << i)) ? ~0ULL : 0);
+    }
+}
+
+// read value of the 32 pins of a 2x20 connector
+//  input:
+//   c = CON_A,C,I,D connector selection
+//  output:
+//   returns 32 bits for the pins, pins not in the netlist read as 0
+bool NetlistLib::readcon (IOW56Con c, uint32_t *pins)
+{
+    if ((unsigned) c >= 4) abort ();
+    settle ();
+    uint32_t value = 0;
+    for (int i = 0; i < 32; i ++) {
+        int net = connets[c][i];
+        if ((net >= 0) && readlane0 (net)) value |= 1U << i;
+    }
+    *pins = value;
+    if (vecsfile != NULL) recordvec (NVO_READCON, c, 0, value);
+    return true;
+}
+
+// write value to the 32 pins of a 2x20 connector
+//  input:
+//   c = CON_A,C,I,D connector selection
+//   mask = which pins to drive, others are left floating high
+//   pins = values for the driven pins
+bool NetlistLib::writecon (IOW56Con c, uint32_t mask, uint32_t pins)
+{
+    if ((unsigned) c >= 4) abort ();
+    if (vecsfile != NULL) recordvec (NVO_WRITECON, c, mask, pins);
+    for (int i = 0; i < 32; i ++) {
+        int net = connets[c][i];
+        if (net >= 0) {
+            netlist->drive (net, ((~ mask | pins) >> i) & 1 ? ~0ULL : 0);
+        }
+    }
+    return true;
+}
+
+// read lane 0 of a net, noting which other lanes are different
+uint32_t NetlistLib::readlane0 (int net)
+{
+    uint64_t val = netlist->vals[net];
+    lanediffs |= val ^ - (val & 1);
+    return val & 1;
+}
+
+void NetlistLib::recordvec (int op, int con, uint32_t mask, uint32_t value)
+{
+    NVRec rec;
+    memset (&rec, 0, sizeof rec);
+    rec.op    = op;
+    rec.con   = con;
+    rec.mask  = mask;
+    rec.value = value;
+    fwrite (&rec, sizeof rec, 1, vecsfile);
+}
+
+int NetlistLib::findraspiport (char const *raspi, char const *sig)
+{
+    char name[300];
+    snprintf (name, sizeof name, "%s.%s", raspi, sig);
+    int net = netlist->findport (name);
+    if (net < 0) {
+        fprintf (stderr, "NetlistLib::open: %s missing port %s\n", netname, name);
+        abort ();
+    }
+    return net;
+}
+
+void NetlistLib::settle ()
+{
+    bool ok = (reportname != NULL) ? netlist->settletimed () : netlist->settle ();
+    if (! ok && ! netlist->freezeosc && (++ oscillations <= 10)) {
+        fprintf (stderr, "NetlistLib::settle: %s did not settle, oscillating\n", netname);
+    }
+}
+
+// tally when the connector pins settled in the half cycle just completed
+void NetlistLib::timecycle ()
+{
+    uint32_t round = netlist->round;
+    if (timedround == round) return;
+    timedround = round;
+
+    uint32_t index = (shadow == NULL) ? 0 : shadow->state * 2 + ((gpiowritten & G_CLK) ? 1 : 0);
+    if (timingstats.size () <= index) timingstats.resize (index + 1);
+    TimingStat *ts = timingstats[index];
+    if (ts == NULL) {
+        ts = new TimingStat ();
+        ts->halfcycles = 0;
+        memset (ts->pintimes, 0, sizeof ts->pintimes);
+        memset (ts->pincounts, 0, sizeof ts->pincounts);
+        ts->worsttime = 0;
+        ts->worstcon  = -1;
+        ts->worstpin  = -1;
+        timingstats[index] = ts;
+    }
+    ts->halfcycles ++;
+
+    for (int c = 0; c < 4; c ++) {
+        for (int i = 0; i < 32; i ++) {
+            int net = connets[c][i];
+            if ((net < 0) || (netlist->changeround[net] != round)) continue;
+            uint64_t time = netlist->changetime[net];
+            ts->pincounts[c][i] ++;
+            if (ts->pintimes[c][i] < time) ts->pintimes[c][i] = time;
+            if ((ts->worstcon < 0) || (ts->worsttime < time)) {
+
+                // slowest so far, trace back through what made it change
+                ts->worsttime = time;
+                ts->worstcon  = c;
+                ts->worstpin  = i;
+                ts->worstnets.clear ();
+                ts->worsttimes.clear ();
+                for (int32_t n = net; (n >= 0) && (netlist->changeround[n] == round) && (ts->worstnets.size () <= netlist->nnets);
+                        n = netlist->changecause[n]) {
+                    ts->worstnets.push_back (n);
+                    ts->worsttimes.push_back (netlist->changetime[n]);
+                }
+            }
+        }
+    }
+}
+
+// get board instance a net is on, ie, last part of its name
+// ...less the [hi:lo]n netgen tacks on for gates made from an expression, eg, regpair[0:0]3 is on regpair
+static std::string boardname (char const *netname)
+{
+    char const *slash = strrchr (netname, '/');
+    if (slash == NULL) return "top";
+    return std::string (slash + 1, strcspn (slash + 1, "["));
+}
+
+// get state name for timingstats[index]
+char const *NetlistLib::halfstate (uint32_t index)
+{
+    return (shadow == NULL) ? "tester" : Shadow::statestr ((Shadow::State) (index / 2));
+}
+
+// write timing report
+void NetlistLib::writereport ()
+{
+    FILE *rptfile = fopen (reportname, "w");
+    if (rptfile == NULL) {
+        fprintf (stderr, "NetlistLib::writereport: error creating %s: %m\n", reportname);
+        return;
+    }
+    fprintf (rptfile, "netlist %s timing: stage %.1fns + %.1fns per load, jumper %.1fns\n", netname, stagens, loadns, jumperns);
+    fprintf (rptfile, "connector pins given as bit number in readcon() value\n");
+
+    // summary, one line per state half
+    fprintf (rptfile, "\n  state  clock   halfcycles  settled  slowest pin\n");
+    for (uint32_t index = 0; index < timingstats.size (); index ++) {
+        TimingStat const *ts = timingstats[index];
+        if (ts == NULL) continue;
+        fprintf (rptfile, "%7s  %s %12llu  ", halfstate (index), (shadow == NULL) ? " any" : (index & 1) ? "high" : " low",
+            (unsigned long long) ts->halfcycles);
+        if (ts->worstcon < 0) fprintf (rptfile, "      -\n");
+        else fprintf (rptfile, "%5.0fns  %c[%02d]\n", ts->worsttime / 1000.0, CONLETS[ts->worstcon], ts->worstpin);
+    }
+
+    // details, when each pin settles and critical path
+    for (uint32_t index = 0; index < timingstats.size (); index ++) {
+        TimingStat const *ts = timingstats[index];
+        if ((ts == NULL) || (ts->worstcon < 0)) continue;
+        fprintf (rptfile, "\n%s clock %s:\n", halfstate (index), (shadow == NULL) ? "any" : (index & 1) ? "high" : "low");
+        for (int c = 0; c < 4; c ++) {
+            int n = 0;
+            for (int i = 0; i < 32; i ++) {
+                if (ts->pincounts[c][i] == 0) continue;
+                if (n % 8 == 0) fprintf (rptfile, (n == 0) ? "  %c:" : "\n    ", CONLETS[c]);
+                fprintf (rptfile, "  [%02d]%4.0f", i, ts->pintimes[c][i] / 1000.0);
+                n ++;
+            }
+            if (n > 0) fprintf (rptfile, "\n");
+        }
+
+        fprintf (rptfile, "  critical path to %c[%02d]:\n", CONLETS[ts->worstcon], ts->worstpin);
+        for (uint32_t j = ts->worstnets.size (); j > 0;) {
+            -- j;
+            char const *name = netlist->nets[ts->worstnets[j]].name;
+            fprintf (rptfile, "    %6.1fns  %-12s  %s\n", ts->worsttimes[j] / 1000.0, boardname (name).c_str (), name);
+        }
+        fprintf (rptfile, "  boards:");
+        std::string lastboard;
+        for (uint32_t j = ts->worstnets.size (); j > 0;) {
+            std::string board = boardname (netlist->nets[ts->worstnets[--j]].name);
+            if (lastboard != board) {
+                fprintf (rptfile, "%s %s", lastboard.empty () ? "" : " ->", board.c_str ());
+                lastboard = board;
+            }
+        }
+        fprintf (rptfile, "\n");
+    }
+
+    fclose (rptfile);
+}
@@ -0,0 +1,166 @@
+#!/bin/bash
+#
+#  test the netlist simulator on a real board
+#  netlisttest/regboard.bin is ../goodpcbs/regboard.net and .rep (as written by netgen -net -report) converted by kicadnetbin
+#  ...jumpered as the R0/R1 board
+#  needs kicadnetbin, alusweep, sta, regtester and faultsim built
+#  if ../netgen is built, also checks that netgen -netbin writes the same file kicadnetbin does
+#  ...and sweeps netgen's alueight through alusweep
+#  netlisttest/regtester.timing is the last known good regtester -nettiming report
+#  netlisttest/regboard.sta is the last known good sta report
+#  netlisttest/regtester.faults is the last known good faultsim grading of regtester's vectors
+#  netlisttest/master.timing is the last known good raspictl -nettiming report of umul on netgen's whole cpu
+#  netlisttest/master.sta is the last known good sta report of netgen's whole cpu
+#  ...both recorded by the first run that has netgen built, review and commit them
+#
+cd `dirname $0`
+mach=`uname -m`
+tmpdir=`mktemp -d`
+trap "rm -rf $tmpdir" EXIT
+failed=0
+
+# irsel: _ir05,06,08,09,11,12 jumpered to IR[05,06,08,09,11,12] selects R0/R1
+# ctsa: weodd and reaodd jumpered to ground for all but the R6/R7 board
+regjumpers="-jumper Conn/irsel.20 Conn/irsel.19 -jumper Conn/irsel.23 Conn/irsel.22
+    -jumper Conn/irsel.35 Conn/irsel.34 -jumper Conn/irsel.38 Conn/irsel.37
+    -jumper Conn/irsel.44 Conn/irsel.43 -jumper Conn/irsel.47 Conn/irsel.46
+    -jumper Conn/ctsa.47 Conn/ctsa.48 -jumper Conn/ctsa.50 Conn/ctsa.51"
+./kicadnetbin.$mach $regjumpers ../goodpcbs/regboard.net ../goodpcbs/regboard.rep $tmpdir/regboard.bin > /dev/null
+if ! cmp -s netlisttest/regboard.bin $tmpdir/regboard.bin
+then
+    echo "netlisttest: netlisttest/regboard.bin doesn't match ../goodpcbs/regboard.net"
+    failed=1
+fi
+
+# netgen round trip: netgen -netbin must write the same file kicadnetbin makes from netgen -net and -report
+# ...so the fixture above is what netgen would write for the board (less the jumper blocks)
+if [ -f ../netgen/classes/NetBin.class ]
+then
+    (cd ../modules ; ./master.sh -gen regboard -net $tmpdir/ng-regboard.net -report $tmpdir/ng-regboard.rep \
+            -netbin $tmpdir/ng-regboard.bin > $tmpdir/netgen.out 2>&1)
+    ./kicadnetbin.$mach $tmpdir/ng-regboard.net $tmpdir/ng-regboard.rep $tmpdir/kc-regboard.bin > /dev/null
+    if ! cmp $tmpdir/ng-regboard.bin $tmpdir/kc-regboard.bin
+    then
+        tail $tmpdir/netgen.out
+        echo "netlisttest: netgen -netbin and kicadnetbin disagree on regboard"
+        failed=1
+    fi
+else
+    echo "netlisttest: ../netgen not built, skipping netgen round trip"
+fi
+
+# batch evaluator must agree with the scalar one at every lane count
+if ! ./alusweep.$mach -crosscheck netlisttest/regboard.bin > $tmpdir/crosscheck.out 2>&1
+then
+    cat $tmpdir/crosscheck.out
+    echo "netlisttest: alusweep -crosscheck failed"
+    failed=1
+fi
+
+# alueight straight from netgen: every A, B, CIN, SHR for all 18 functions against ALU8
+# ...with 64 lanes and 256 lanes (avx2 if the cpu has it), A[] also gets jammed by the slice's own _aena
+# ...then cross-check the evaluators with A[] wire-anded
+if [ -f ../netgen/classes/NetBin.class ]
+then
+    (cd ../modules ; ./netgen.sh aluboard.mod -gen alueight -netbin $tmpdir/alueight.bin > $tmpdir/netgen.out 2>&1)
+    for lanes in 64 256
+    do
+        if ! ./alusweep.$mach -lanes $lanes $tmpdir/alueight.bin > $tmpdir/alusweep.out 2>&1
+        then
+            tail -25 $tmpdir/alusweep.out
+            echo "netlisttest: alusweep -lanes $lanes failed on alueight"
+            failed=1
+        fi
+    done
+    if ! ./alusweep.$mach -crosscheck $tmpdir/alueight.bin > $tmpdir/crosscheck.out 2>&1
+    then
+        cat $tmpdir/crosscheck.out
+        echo "netlisttest: alusweep -crosscheck failed on alueight"
+        failed=1
+    fi
+else
+    echo "netlisttest: ../netgen not built, skipping alueight sweep"
+fi
+
+# static timing analysis must match the last known good one, less how long it took
+./sta.$mach netlisttest/regboard.bin 2>&1 | grep -v '^sta: analyzed in ' > $tmpdir/regboard.sta
+if ! diff netlisttest/regboard.sta $tmpdir/regboard.sta
+then
+    echo "netlisttest: sta report differs from netlisttest/regboard.sta"
+    failed=1
+fi
+
+# known vectors: regtester writes and reads back random values 1000 times
+./regtester.$mach -netlist netlisttest/regboard.bin -vectors $tmpdir/regtester.vec 01 < /dev/null > $tmpdir/regtester.out 2>&1
+if grep -q '^bad ' $tmpdir/regtester.out || ! grep -q '^PASS 1 ' $tmpdir/regtester.out
+then
+    grep -v 'RA =\|wrote' $tmpdir/regtester.out | head
+    echo "netlisttest: regtester failed"
+    failed=1
+fi
+
+# grade the vectors regtester just recorded, less how long it took
+./faultsim.$mach netlisttest/regboard.bin $tmpdir/regtester.vec 2>&1 | sed "s|^$tmpdir/||;s/, [0-9.]* sec\$//" > $tmpdir/regtester.faults
+if ! diff netlisttest/regtester.faults $tmpdir/regtester.faults
+then
+    echo "netlisttest: faultsim grading differs from netlisttest/regtester.faults"
+    failed=1
+fi
+
+# same again with propagation delays, the settle report must match the last known good one
+./regtester.$mach -netlist netlisttest/regboard.bin -nettiming $tmpdir/regtester.timing 01 < /dev/null > $tmpdir/regtester.out 2>&1
+if grep -q '^bad ' $tmpdir/regtester.out || ! grep -q '^PASS 1 ' $tmpdir/regtester.out
+then
+    grep -v 'RA =\|wrote' $tmpdir/regtester.out | head
+    echo "netlisttest: regtester -nettiming failed"
+    failed=1
+elif ! diff netlisttest/regtester.timing $tmpdir/regtester.timing
+then
+    echo "netlisttest: regtester -nettiming report differs from netlisttest/regtester.timing"
+    failed=1
+fi
+
+# whole cpu from netgen running umul with propagation delays, settle report per Shadow::State
+if [ -f ../netgen/classes/NetBin.class ]
+then
+    (cd ../modules ; ./master.sh -gen master -netbin $tmpdir/master.bin > $tmpdir/netgen.out 2>&1 ;
+            tclsh assemble.tcl umul.asm $tmpdir/umul.hex > $tmpdir/assemble.out 2>&1)
+    ./raspictl.$mach -netlist $tmpdir/master.bin -nettiming $tmpdir/master.timing -tclhex $tmpdir/umul.hex > $tmpdir/umul.out 2>&1
+    [ -f $tmpdir/master.timing ] && sed -i "s|$tmpdir/||" $tmpdir/master.timing
+    if ! grep -q 'multiply result 093F9AE5' $tmpdir/umul.out
+    then
+        tail $tmpdir/netgen.out $tmpdir/assemble.out $tmpdir/umul.out
+        echo "netlisttest: umul failed on netgen's master netlist"
+        failed=1
+    elif [ ! -f netlisttest/master.timing ]
+    then
+        cp $tmpdir/master.timing netlisttest/master.timing
+        echo "netlisttest: recorded netlisttest/master.timing, review and commit it"
+    elif ! diff netlisttest/master.timing $tmpdir/master.timing
+    then
+        echo "netlisttest: raspictl -nettiming report differs from netlisttest/master.timing"
+        failed=1
+    fi
+
+    # static timing analysis of the whole cpu, showing how long it took
+    ./sta.$mach $tmpdir/master.bin > $tmpdir/master.sta 2>&1
+    grep '^sta: analyzed in ' $tmpdir/master.sta
+    grep -v '^sta: analyzed in ' $tmpdir/master.sta > $tmpdir/master.sta.cmp
+    if [ ! -f netlisttest/master.sta ]
+    then
+        cp $tmpdir/master.sta.cmp netlisttest/master.sta
+        echo "netlisttest: recorded netlisttest/master.sta, review and commit it"
+    elif ! diff netlisttest/master.sta $tmpdir/master.sta.cmp
+    then
+        echo "netlisttest: sta report differs from netlisttest/master.sta"
+        failed=1
+    fi
+else
+    echo "netlisttest: ../netgen not built, skipping master netlist"
+fi
+
+if [ $failed == 0 ]
+then
+    echo "netlisttest: all passed"
+fi
+exit $failed
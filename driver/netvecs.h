@@ -0,0 +1,46 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// test vector file written by a tester running with -netlist <file> -vectors <file>
+// it is every call the tester made to NetlistLib in order, so faultsim can replay them
+//  the magic number followed by NVRec records, all little-endian
+
+#ifndef _NETVECS_H
+#define _NETVECS_H
+
+#include <stdint.h>
+
+#define NETVECS_MAGIC "HODEVEC1"
+
+#define NVO_HALFCYCLE 1         // halfcycle ()
+#define NVO_READGPIO  2         // value = readgpio ()
+#define NVO_WRITEGPIO 3         // writegpio (con != 0, value)
+#define NVO_READCON   4         // readcon (con, &value)
+#define NVO_WRITECON  5         // writecon (con, mask, value)
+
+struct NVRec {
+    uint8_t op;                 // NVO_* operation
+    uint8_t con;                // IOW56Con connector, writegpio wdata flag
+    uint16_t spare;
+    uint32_t mask;              // writecon mask
+    uint32_t value;             // value written or read
+};
+
+#endif
@@ -0,0 +1,352 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// cycle profiler for raspictl -profile
+// fastcpu calls instr() at the beginning of every instruction
+// ...which charges the cycles since the previous call to the previous instruction's address
+// it also follows calls and returns to keep an inclusive call graph:
+//  a jump to a symbol from the link.c .map file is a call
+//  ...or any ldw %pc,#function if there is no map file
+//      lda  %r3,retaddr
+//      ldw  %pc,#function
+//  a jump to the R3 a function on the stack was called with is a return from that function
+//      lda  %pc,0(%r3)
+//  ...which also handles iret and throws unwinding several functions at once
+//  ...and tail calls, ie, jumped to with same R3 and with R6 no deeper than the function doing the jumping was called with
+//  ...but not branches, as a recursive function can branch to the label its inner call returns to
+//  any other lda %pc,0(%rn) returns from the current function (eg, __umul returns via R5)
+// the report is symbolized from the same .map file
+
+#include <algorithm>
+#include <string.h>
+
+#include "profiler.h"
+
+Profiler::Profiler (char const *mapname)
+{
+    lastir    = 0;
+    lastpc    = 0;
+    nextpc    = 0;
+    lastcycle = 0;
+    lostcalls = 0;
+    memset (flat,   0, sizeof flat);
+    memset (incl,   0, sizeof incl);
+    memset (calls,  0, sizeof calls);
+    memset (active, 0, sizeof active);
+    memset (entries, 0, sizeof entries);
+    if (mapname != NULL) readmap (mapname);
+}
+
+// cpu is about to execute instruction ir at address pc
+//  input:
+//   pc = address of instruction
+//   ir = opcode
+//   regs = registers as of end of previous instruction
+//   cycle = cycle count at beginning of instruction
+void Profiler::instr (uint16_t pc, uint16_t ir, uint16_t const *regs, uint64_t cycle)
+{
+    flat[lastpc/2] += cycle - lastcycle;
+
+    if (stack.empty ()) pushframe (pc, regs[3], regs[6], cycle);
+    else if (pc != nextpc) {
+
+        // jumped to where something on the stack returns to, pop back through it
+        // ...including any that tail called it
+        bool isbr = ((lastir & 0xE000) == 0) && ((lastir & 0x1C01) != 0);
+        int i = isbr ? 0 : stack.size ();
+        while (-- i > 0) {
+            if (stack[i].retaddr == pc) {
+                while ((i > 1) && stack[i].tail) -- i;
+                while ((int) stack.size () > i) popframe (cycle);
+                break;
+            }
+        }
+        if (i <= 0) {
+
+            // lda %pc,0(%rn) returns from current function
+            bool isret  = ((lastir & 0xE3FF) == 0x8380) && (((lastir >> REGA) & 7) != 7);
+            bool iscall = symbols.empty () ? (lastir == 0xDF80) : entries[pc/2];
+            if (isret) {
+                if (stack.size () > 1) popframe (cycle);
+            } else if (iscall) {
+                pushframe (pc, regs[3], regs[6], cycle);
+            }
+        }
+    }
+
+    // where it will go if it doesn't jump
+    // LDx Rd,0(R7) is immediate, ie, ldw %pc,#function is 4 bytes long
+    lastir    = ir;
+    lastpc    = pc;
+    lastcycle = cycle;
+    nextpc    = pc + 2;
+    if ((ir >= 0xA000) && (((ir >> REGA) & 7) == 7) && ((ir & 0x7F) == 0)) nextpc += 2;
+}
+
+// cpu is about to take an interrupt, treat as a call to the handler at 0002
+//  input:
+//   retaddr = address the iret will return to
+//   cycle = cycle count before the interrupt cycles are added
+void Profiler::interrupt (uint16_t retaddr, uint64_t cycle)
+{
+    flat[lastpc/2] += cycle - lastcycle;
+    pushframe (2, retaddr, 0xFFFF, cycle);
+    lastir    = 0;
+    lastpc    = 2;
+    nextpc    = 2;
+    lastcycle = cycle;
+}
+
+void Profiler::pushframe (uint16_t entry, uint16_t retaddr, uint16_t sp, uint64_t cycle)
+{
+    if (stack.size () >= PROF_MAXDEPTH) {
+        lostcalls ++;
+        return;
+    }
+    if (! stack.empty ()) {
+        uint32_t key = ((uint32_t) stack.back ().entry << 16) | entry;
+        arcs[key].calls ++;
+    }
+    calls[entry/2] ++;
+    active[entry/2] ++;
+    Frame frame;
+    frame.entry    = entry;
+    frame.retaddr  = retaddr;
+    frame.sp       = sp;
+    frame.tail     = ! stack.empty () && (stack.back ().retaddr == retaddr) && (sp >= stack.back ().sp);
+    frame.begcycle = cycle;
+    stack.push_back (frame);
+}
+
+// function on top of stack returned
+// recursive calls only count the outermost one so cycles don't get counted twice
+void Profiler::popframe (uint64_t cycle)
+{
+    Frame *frame = &stack.back ();
+    uint64_t cycles = cycle - frame->begcycle;
+    if (-- active[frame->entry/2] == 0) {
+        incl[frame->entry/2] += cycles;
+        if (stack.size () > 1) {
+            uint32_t key = ((uint32_t) stack[stack.size()-2].entry << 16) | frame->entry;
+            arcs[key].cycles += cycles;
+        }
+    }
+    stack.pop_back ();
+}
+
+// write report
+//  input:
+//   out = where to write report
+//   cycle,insts = final counts from fastcpu
+void Profiler::report (FILE *out, uint64_t cycle, uint64_t insts)
+{
+    // charge last instruction and unwind whatever is still on the stack
+    flat[lastpc/2] += cycle - lastcycle;
+    lastcycle = cycle;
+    while (! stack.empty ()) popframe (cycle);
+
+    double pct = (cycle == 0) ? 0.0 : 100.0 / cycle;
+
+    fprintf (out, "raspictl profile: %llu cycles; %llu instrs", (unsigned long long) cycle, (unsigned long long) insts);
+    if (lostcalls != 0) fprintf (out, "; %llu calls too deep to track", (unsigned long long) lostcalls);
+    fprintf (out, "\n");
+
+    // flat profile, one line per function sorted by self cycles
+    // self cycles are all the instructions from the symbol up to the next symbol
+    struct Func {
+        uint16_t addr;
+        uint64_t self;
+        bool operator< (Func const &that) const { return self > that.self; }
+    };
+    std::vector<Func> funcs;
+    if (symbols.empty ()) {
+        Func func = { 0, 0 };
+        for (int i = 0; i < 0x8000; i ++) func.self += flat[i];
+        funcs.push_back (func);
+    }
+    for (size_t j = 0; j < symbols.size (); j ++) {
+        uint32_t beg = symbols[j].addr;
+        uint32_t end = (j + 1 < symbols.size ()) ? symbols[j+1].addr : 0x10000;
+        Func func = { (uint16_t) beg, 0 };
+        if (j == 0) beg = 0;
+        for (uint32_t a = beg; a < end; a += 2) func.self += flat[a/2];
+        if ((func.self != 0) || (calls[func.addr/2] != 0)) funcs.push_back (func);
+    }
+    std::stable_sort (funcs.begin (), funcs.end ());
+
+    fprintf (out, "\nflat profile:\n\n");
+    fprintf (out, "   self cycles   self%%     incl cycles   incl%%        calls  function\n");
+    for (std::vector<Func>::iterator it = funcs.begin (); it != funcs.end (); it ++) {
+        uint16_t a = it->addr;
+        fprintf (out, "  %12llu  %6.2f    %12llu  %6.2f  %11llu  %s\n",
+            (unsigned long long) it->self, it->self * pct, (unsigned long long) incl[a/2], incl[a/2] * pct,
+            (unsigned long long) calls[a/2], symbolize (a).c_str ());
+    }
+
+    // call graph, one block per called function sorted by inclusive cycles
+    // ...listing who called it and what it called
+    struct Entry {
+        uint16_t addr;
+        uint64_t incl;
+        bool operator< (Entry const &that) const { return incl > that.incl; }
+    };
+    std::vector<Entry> entries;
+    for (int i = 0; i < 0x8000; i ++) {
+        if (calls[i] != 0) {
+            Entry entry = { (uint16_t) (i * 2), incl[i] };
+            entries.push_back (entry);
+        }
+    }
+    std::stable_sort (entries.begin (), entries.end ());
+
+    struct Edge {
+        uint16_t addr;
+        Arc arc;
+        bool operator< (Edge const &that) const { return arc.cycles > that.arc.cycles; }
+    };
+
+    fprintf (out, "\ncall graph:\n");
+    for (std::vector<Entry>::iterator it = entries.begin (); it != entries.end (); it ++) {
+        uint16_t a = it->addr;
+        std::vector<Edge> callers, callees;
+        for (std::map<uint32_t,Arc>::iterator jt = arcs.begin (); jt != arcs.end (); jt ++) {
+            Edge edge;
+            edge.arc = jt->second;
+            if ((jt->first & 0xFFFF) == a) {
+                edge.addr = jt->first >> 16;
+                callers.push_back (edge);
+            }
+            if ((jt->first >> 16) == a) {
+                edge.addr = jt->first & 0xFFFF;
+                callees.push_back (edge);
+            }
+        }
+        std::stable_sort (callers.begin (), callers.end ());
+        std::stable_sort (callees.begin (), callees.end ());
+
+        fprintf (out, "\n  %12llu  %6.2f  %11llu  %s\n",
+            (unsigned long long) it->incl, it->incl * pct, (unsigned long long) calls[a/2], symbolize (a).c_str ());
+        for (std::vector<Edge>::iterator jt = callers.begin (); jt != callers.end (); jt ++) {
+            fprintf (out, "  %12llu  %6.2f  %11llu      <- %s\n",
+                (unsigned long long) jt->arc.cycles, jt->arc.cycles * pct, (unsigned long long) jt->arc.calls, symbolize (jt->addr).c_str ());
+        }
+        for (std::vector<Edge>::iterator jt = callees.begin (); jt != callees.end (); jt ++) {
+            fprintf (out, "  %12llu  %6.2f  %11llu      -> %s\n",
+                (unsigned long long) jt->arc.cycles, jt->arc.cycles * pct, (unsigned long long) jt->arc.calls, symbolize (jt->addr).c_str ());
+        }
+    }
+
+    // busiest instructions
+    struct Hot {
+        uint16_t addr;
+        uint64_t cycles;
+        bool operator< (Hot const &that) const { return cycles > that.cycles; }
+    };
+    std::vector<Hot> hots;
+    for (int i = 0; i < 0x8000; i ++) {
+        if (flat[i] != 0) {
+            Hot hot = { (uint16_t) (i * 2), flat[i] };
+            hots.push_back (hot);
+        }
+    }
+    std::stable_sort (hots.begin (), hots.end ());
+    if (hots.size () > 50) hots.resize (50);
+
+    fprintf (out, "\nhot instructions:\n\n");
+    fprintf (out, "        cycles   self%%  addr  symbol\n");
+    for (std::vector<Hot>::iterator it = hots.begin (); it != hots.end (); it ++) {
+        fprintf (out, "  %12llu  %6.2f  %04X  %s\n",
+            (unsigned long long) it->cycles, it->cycles * pct, it->addr, symbolize (it->addr).c_str ());
+    }
+}
+
+// read symbols from link.c map file
+// they are listed two columns to a line at the end, sorted by name and by address:
+//   addr  name  objectfile    addr  name  objectfile
+void Profiler::readmap (char const *mapname)
+{
+    FILE *mapfile = fopen (mapname, "r");
+    if (mapfile == NULL) {
+        fprintf (stderr, "raspictl: error opening %s: %m\n", mapname);
+        return;
+    }
+
+    char line[4096];
+    while (fgets (line, sizeof line, mapfile) != NULL) {
+        char *toks[8];
+        int ntoks = 0;
+        for (char *p = strtok (line, " \t\n"); (p != NULL) && (ntoks < 8); p = strtok (NULL, " \t\n")) {
+            toks[ntoks++] = p;
+        }
+        if ((ntoks != 3) && (ntoks != 6)) continue;
+        for (int i = 0; i < ntoks; i += 3) {
+            char *p;
+            uint32_t addr = strtoul (toks[i], &p, 16);
+            if ((strlen (toks[i]) != 4) || (*p != 0)) break;
+            strtoul (toks[i+1], &p, 16);
+            if ((strlen (toks[i+1]) == 4) && (*p == 0)) break;
+            addsymbol (addr, toks[i+1]);
+        }
+    }
+    fclose (mapfile);
+    sortsymbols ();
+}
+
+// add symbol from map file or link -i image
+// call sortsymbols() when all have been added
+void Profiler::addsymbol (uint16_t addr, char const *name)
+{
+    Symbol sym;
+    sym.addr = addr;
+    sym.name = name;
+    symbols.push_back (sym);
+}
+
+// sort symbols by address and mark function entry points
+void Profiler::sortsymbols ()
+{
+    // map file lists each symbol twice, keep the first name seen at each address
+    std::stable_sort (symbols.begin (), symbols.end ());
+    std::vector<Symbol> uniques;
+    for (std::vector<Symbol>::iterator it = symbols.begin (); it != symbols.end (); it ++) {
+        if (uniques.empty () || (uniques.back ().addr != it->addr)) uniques.push_back (*it);
+    }
+    symbols = uniques;
+    for (std::vector<Symbol>::iterator it = symbols.begin (); it != symbols.end (); it ++) {
+        entries[it->addr/2] = true;
+    }
+}
+
+// get name+offset for an address
+std::string Profiler::symbolize (uint16_t addr)
+{
+    char buf[16];
+    Symbol key;
+    key.addr = addr;
+    std::vector<Symbol>::iterator it = std::upper_bound (symbols.begin (), symbols.end (), key);
+    if (it == symbols.begin ()) {
+        sprintf (buf, "%04X", addr);
+        return buf;
+    }
+    -- it;
+    if (it->addr == addr) return it->name;
+    sprintf (buf, "+%04X", addr - it->addr);
+    return it->name + buf;
+}
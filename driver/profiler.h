@@ -0,0 +1,81 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+#ifndef _PROFILER_H
+#define _PROFILER_H
+
+#include <map>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+#include "miscdefs.h"
+
+#define PROF_MAXDEPTH 1024      // deepest call stack tracked
+
+struct Profiler {
+    Profiler (char const *mapname);
+    void instr (uint16_t pc, uint16_t ir, uint16_t const *regs, uint64_t cycle);
+    void interrupt (uint16_t retaddr, uint64_t cycle);
+    void report (FILE *out, uint64_t cycle, uint64_t insts);
+    void addsymbol (uint16_t addr, char const *name);
+    void sortsymbols ();
+
+private:
+    struct Frame {
+        uint16_t entry;         // address of function's first instruction
+        uint16_t retaddr;       // R3 when called, ie, where it should return to
+        uint16_t sp;            // R6 when called
+        bool tail;              // tail called, returns along with caller
+        uint64_t begcycle;      // cycle count when function was entered
+    };
+
+    struct Arc {
+        uint64_t calls;         // number of times caller called callee
+        uint64_t cycles;        // cycles spent in callee (inclusive) on behalf of caller
+    };
+
+    struct Symbol {
+        uint16_t addr;
+        std::string name;
+        bool operator< (Symbol const &that) const { return addr < that.addr; }
+    };
+
+    uint16_t lastir;            // opcode of instruction being executed
+    uint16_t lastpc;            // address of instruction being executed
+    uint16_t nextpc;            // where it goes if it doesn't jump
+    uint64_t lastcycle;         // cycle count when it began
+    uint64_t lostcalls;         // calls not tracked because stack too deep
+    std::map<uint32_t,Arc> arcs;    // indexed by caller<<16|callee entry points
+    std::vector<Frame> stack;
+    std::vector<Symbol> symbols;
+
+    uint64_t flat[0x8000];      // cycles charged to each instruction
+    uint64_t incl[0x8000];      // cycles spent in each function including what it calls
+    uint64_t calls[0x8000];     // number of times each function was called
+    uint32_t active[0x8000];    // number of times each function is on the stack
+    bool entries[0x8000];       // symbol from map file is at this address
+
+    void pushframe (uint16_t entry, uint16_t retaddr, uint16_t sp, uint64_t cycle);
+    void popframe (uint64_t cycle);
+    void readmap (char const *mapname);
+    std::string symbolize (uint16_t addr);
+};
+
+#endif
@@ -0,0 +1,489 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// coverage-guided random instruction fuzzer
+// runs several shadow machines on random opcodes and data, same as raspictl -randmem,
+// but steers the opcodes toward (state, opcode, psw, raw alu signal) combinations not seen yet
+//  ./randfuzz [-nobias] [-seconds <n>] [-seed <hex>] [-threads <n>] [-tuples <file>]
+//      -nobias  : plain raspictl -randmem opcode distribution, for comparison
+//      -seconds : stop after that many seconds (default run until control-C)
+//      -seed    : base for each thread's random number seed
+//      -threads : number of machines to run (default one per cpu)
+//      -tuples  : write list of covered tuples to file at end
+//  prints a line each second with throughput and number of tuples covered
+
+#include <pthread.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "miscdefs.h"
+#include "shadow.h"
+
+// coverage tuple = state : opsel : psw : raws
+//  state = Shadow::State the cycle is in
+//  opsel = 0..8 : instruction class (OC_...) or 16..31 : ARITH opcode, OS_NONE for fetch and interrupt states
+//  psw   = IE,N,Z,V,C at start of cycle
+//  raws  = raw alu signals for ARITH1 (RW_...)
+#define NSTATES (Shadow::IREQ5 + 1)
+#define OS_NONE 15
+#define NTUPLES (32 << 17)
+#define TUPLE(state,opsel,psw,raws) (((state) << 17) | ((opsel) << 12) | ((psw) << 7) | (raws))
+
+#define RW_CIN    0x01
+#define RW_CMID   0x02
+#define RW_COUT   0x04
+#define RW_VOUT   0x08
+#define RW_SHRIN  0x10
+#define RW_SHRMID 0x20
+#define RW_SHROUT 0x40
+
+// instruction classes, same split as raspictl's randopcode()
+#define OC_BCC   0
+#define OC_ARITH 1
+#define OC_STORE 2
+#define OC_LDA   3
+#define OC_LOAD  4
+#define OC_HALT  5
+#define OC_IRET  6
+#define OC_WRPS  7
+#define OC_RDPS  8
+
+// opcode generator choices
+// 0..7 are non-ARITH classes, 8..21 are the ARITH opcodes
+// base weights give each class 1/9 chance like raspictl's randopcode()
+#define NARMS 22
+#define ARMBASE 14          // weight of each non-ARITH arm, ARITH arms get 1 each
+#define ARMBONUS 64         // weight added to an arm each time it finds a new tuple
+#define ARMMAXBONUS 2048    // keeps sum of weights within randuint16()
+#define ARMDECAY 65536      // halve bonuses every this many instructions
+#define NTRIES 8            // candidate opcodes tried per fetch looking for new tuple
+
+static uint8_t const armclass[NARMS] = { OC_BCC, OC_STORE, OC_LDA, OC_LOAD, OC_HALT, OC_IRET, OC_WRPS, OC_RDPS,
+        OC_ARITH, OC_ARITH, OC_ARITH, OC_ARITH, OC_ARITH, OC_ARITH, OC_ARITH,
+        OC_ARITH, OC_ARITH, OC_ARITH, OC_ARITH, OC_ARITH, OC_ARITH, OC_ARITH };
+static uint8_t const armaop[NARMS] = { 0, 0, 0, 0, 0, 0, 0, 0,
+        0, 1, 2, 4, 5, 6, 7, 8, 9, 10, 12, 13, 14, 15 };
+
+// data values that tend to make carries and overflows
+static uint16_t const edgevals[] = { 0x0000, 0x0001, 0x007F, 0x0080, 0x00FF, 0x0100,
+        0x7FFE, 0x7FFF, 0x8000, 0x8001, 0xFF00, 0xFF7F, 0xFF80, 0xFFFE, 0xFFFF };
+
+struct Fuzzer {
+    pthread_t tid;
+    uint64_t seed;
+    uint64_t volatile cycles;
+    uint64_t volatile insts;
+
+    void run ();
+
+private:
+    uint32_t armbonus[NARMS];
+    int curarm;
+
+    uint16_t randopcode (int arm);
+    uint16_t randdata ();
+    uint16_t randuint16 ();
+    int pickarm ();
+    uint16_t pickopcode (Shadow *shadow, bool irq);
+};
+
+static bool nobias;
+static bool volatile stopping;
+static uint32_t ncovered;
+static uint64_t coverage[NTUPLES/64];
+
+static void *fuzzthread (void *fuzzv);
+static void sighand (int signum);
+static uint32_t tupleof (Shadow *shadow);
+static bool covered (uint32_t tuple);
+static bool cover (uint32_t tuple);
+static bool writetuples (char const *filename);
+static double nowsecs ();
+
+int main (int argc, char **argv)
+{
+    char const *tuplename = NULL;
+    int nthreads = sysconf (_SC_NPROCESSORS_ONLN);
+    uint32_t seconds = 0;
+    uint64_t seed = 0x123456789ABCDEF0ULL;
+
+    setlinebuf (stdout);
+
+    for (int i = 0; ++ i < argc;) {
+        if (strcasecmp (argv[i], "-nobias") == 0) {
+            nobias = true;
+            continue;
+        }
+        if (strcasecmp (argv[i], "-seconds") == 0) {
+            if (++ i >= argc) {
+                fprintf (stderr, "randfuzz: missing count after -seconds\n");
+                return 1;
+            }
+            seconds = atoi (argv[i]);
+            continue;
+        }
+        if (strcasecmp (argv[i], "-seed") == 0) {
+            if (++ i >= argc) {
+                fprintf (stderr, "randfuzz: missing value after -seed\n");
+                return 1;
+            }
+            seed = strtoull (argv[i], NULL, 16);
+            continue;
+        }
+        if (strcasecmp (argv[i], "-threads") == 0) {
+            if (++ i >= argc) {
+                fprintf (stderr, "randfuzz: missing count after -threads\n");
+                return 1;
+            }
+            nthreads = atoi (argv[i]);
+            if (nthreads <= 0) {
+                fprintf (stderr, "randfuzz: bad thread count %s\n", argv[i]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcasecmp (argv[i], "-tuples") == 0) {
+            if (++ i >= argc) {
+                fprintf (stderr, "randfuzz: missing filename after -tuples\n");
+                return 1;
+            }
+            tuplename = argv[i];
+            continue;
+        }
+        fprintf (stderr, "randfuzz: unknown argument %s\n", argv[i]);
+        fprintf (stderr, "usage: randfuzz [-nobias] [-seconds <n>] [-seed <hex>] [-threads <n>] [-tuples <file>]\n");
+        return 1;
+    }
+
+    signal (SIGINT, sighand);
+    signal (SIGTERM, sighand);
+
+    // start the machines, each with its own seed
+    // all-ones seed would lock up the lfsr
+    Fuzzer *fuzzers = new Fuzzer[nthreads];
+    for (int i = 0; i < nthreads; i ++) {
+        Fuzzer *fz = &fuzzers[i];
+        fz->seed = seed + i * 0x9E3779B97F4A7C15ULL;
+        if (fz->seed == ~ 0ULL) fz->seed = 0;
+        fz->cycles = 0;
+        fz->insts  = 0;
+        int rc = pthread_create (&fz->tid, NULL, fuzzthread, fz);
+        if (rc != 0) abort ();
+    }
+
+    printf ("randfuzz: %d threads, seed %016llX%s\n", nthreads, (unsigned long long) seed, nobias ? ", no bias" : "");
+
+    // print stats once a second
+    double started = nowsecs ();
+    double lastsecs = started;
+    uint32_t lastcovered = 0;
+    uint64_t lastcycles = 0;
+    uint64_t lastinsts = 0;
+    uint64_t totcycles = 0;
+    uint64_t totinsts = 0;
+    while (! stopping) {
+        usleep (1000000 - (uint32_t) ((nowsecs () - started) * 1000000) % 1000000);
+        double secs = nowsecs ();
+        totcycles = 0;
+        totinsts  = 0;
+        for (int i = 0; i < nthreads; i ++) {
+            totcycles += fuzzers[i].cycles;
+            totinsts  += fuzzers[i].insts;
+        }
+        uint32_t nowcovered = __atomic_load_n (&ncovered, __ATOMIC_RELAXED);
+        printf ("randfuzz: %5.0fs  %7.2f Mcyc/s  %7.2f Minst/s  %7u tuples (+%u)\n", secs - started,
+            (totcycles - lastcycles) / (secs - lastsecs) / 1000000.0,
+            (totinsts  - lastinsts)  / (secs - lastsecs) / 1000000.0,
+            nowcovered, nowcovered - lastcovered);
+        lastsecs    = secs;
+        lastcovered = nowcovered;
+        lastcycles  = totcycles;
+        lastinsts   = totinsts;
+        if ((seconds > 0) && (secs - started >= seconds)) stopping = true;
+    }
+
+    for (int i = 0; i < nthreads; i ++) {
+        pthread_join (fuzzers[i].tid, NULL);
+    }
+
+    printf ("randfuzz: %llu cycles, %llu instrs, %u tuples covered\n",
+        (unsigned long long) totcycles, (unsigned long long) totinsts, ncovered);
+
+    if ((tuplename != NULL) && ! writetuples (tuplename)) return 1;
+    return 0;
+}
+
+static void *fuzzthread (void *fuzzv)
+{
+    ((Fuzzer *) fuzzv)->run ();
+    return NULL;
+}
+
+static void sighand (int signum)
+{
+    stopping = true;
+}
+
+// run random opcodes and data through a shadow machine until told to stop
+// memory cycles are handled same as raspictl -randmem
+void Fuzzer::run ()
+{
+    for (int i = 0; i < NARMS; i ++) armbonus[i] = 0;
+    curarm = -1;
+
+    Shadow shadow;
+    shadow.open (NULL);
+    uint16_t regs[8];
+    for (int i = 0; i < 8; i ++) regs[i] = randuint16 ();
+    shadow.resume (regs, randuint16 () & 0x800F, 0, 0, false);
+
+    bool irq = false;
+    uint64_t ncycles = 0;
+    uint64_t nextdecay = ARMDECAY;
+    while (! stopping) {
+        uint32_t sample = shadow.readgpio ();
+
+        // cpu is accepting data this cycle, either opcode or random data
+        uint16_t mq = 0;
+        if (sample & G__QENA) {
+            mq = (shadow.state == Shadow::FETCH2) ? pickopcode (&shadow, irq) : randdata ();
+        }
+
+        // writes randomly change interrupt request
+        if (sample & G_WRITE) irq = randuint16 () & 1;
+
+        if (shadow.clock (mq, irq)) {
+            fprintf (stderr, "randfuzz: shadow failed\n");
+            abort ();
+        }
+
+        // anything new found goes to the credit of the arm that generated the instruction
+        if (cover (tupleof (&shadow)) && (curarm >= 0) && (armbonus[curarm] < ARMMAXBONUS)) {
+            armbonus[curarm] += ARMBONUS;
+        }
+
+        if ((++ ncycles & 4095) == 0) {
+            cycles = ncycles;
+            insts  = shadow.getinsts ();
+            if (insts >= nextdecay) {
+                for (int i = 0; i < NARMS; i ++) armbonus[i] /= 2;
+                nextdecay = insts + ARMDECAY;
+            }
+        }
+    }
+    cycles = ncycles;
+    insts  = shadow.getinsts ();
+}
+
+// shadow is in FETCH2, pick opcode to send to it
+// try a few random opcodes, use the first that gets to a new tuple for its first state
+uint16_t Fuzzer::pickopcode (Shadow *shadow, bool irq)
+{
+    int arm = pickarm ();
+    uint16_t opcode = randopcode (arm);
+    if (! nobias) {
+        for (int i = 0; i < NTRIES; i ++) {
+            Shadow trial = *shadow;
+            trial.clock (opcode, irq);
+            if (! covered (tupleof (&trial))) break;
+            arm = pickarm ();
+            opcode = randopcode (arm);
+        }
+    }
+    curarm = arm;
+    return opcode;
+}
+
+// pick opcode generator arm, weighted toward those that have found new tuples recently
+int Fuzzer::pickarm ()
+{
+    uint32_t weights[NARMS];
+    uint32_t total = 0;
+    for (int i = 0; i < NARMS; i ++) {
+        weights[i] = ((i < 8) ? ARMBASE : 1) + (nobias ? 0 : armbonus[i]);
+        total += weights[i];
+    }
+    uint32_t r = randuint16 () % total;
+    int arm;
+    for (arm = 0; r >= weights[arm]; arm ++) r -= weights[arm];
+    return arm;
+}
+
+// generate random opcode for the given arm
+// do not generate undefined opcode so shadow won't puque
+uint16_t Fuzzer::randopcode (int arm)
+{
+    switch (armclass[arm]) {
+        case OC_BCC: {
+            uint16_t cond = randuint16 () % 15 + 1;
+            uint16_t offs = randuint16 () & 0x3FE;
+            return 0x0000 | ((cond & 14) << 9) | offs | (cond & 1);
+        }
+        case OC_ARITH: {
+            uint16_t adb = randuint16 () & 0x1FF;
+            return 0x2000 | (adb << 4) | armaop[arm];
+        }
+        case OC_STORE: {
+            return 0x4000 | (randuint16 () & 0x3FFF);
+        }
+        case OC_LDA: {
+            return 0x8000 | (randuint16 () & 0x1FFF);
+        }
+        case OC_LOAD: {
+            uint16_t r = randuint16 ();
+            bool imm = (r & 7) == 0;
+            uint16_t loadop = r / 8 % 3 + 5;
+            uint16_t rardofs = imm ? (((randuint16 () & 7) << REGD) | (7 << REGA)) : (randuint16 () & 0x1FFF);
+            return (loadop << 13) | rardofs;
+        }
+        case OC_HALT: {
+            return 0x0000 | ((randuint16 () & 7) << REGB);
+        }
+        case OC_IRET: {
+            return 0x0002;
+        }
+        case OC_WRPS: {
+            return 0x0004 | ((randuint16 () & 7) << REGB);
+        }
+        case OC_RDPS: {
+            return 0x0006 | ((randuint16 () & 7) << REGD);
+        }
+        default: abort ();
+    }
+}
+
+// random data for load and iret
+// unbiased is plain random like raspictl -randmem
+// otherwise a quarter of the time use value near a carry or overflow boundary
+uint16_t Fuzzer::randdata ()
+{
+    uint16_t r = randuint16 ();
+    if (nobias || ((r & 3) != 0)) return randuint16 ();
+    return edgevals[(r >> 2) % (sizeof edgevals / sizeof edgevals[0])];
+}
+
+uint16_t Fuzzer::randuint16 ()
+{
+    // https://www.xilinx.com/support/documentation/application_notes/xapp052.pdf
+    uint64_t xnor = ~ ((seed >> 63) ^ (seed >> 62) ^ (seed >> 60) ^ (seed >> 59));
+    seed = (seed << 1) | (xnor & 1);
+
+    return (uint16_t) seed;
+}
+
+// get tuple for the state the shadow is now in
+static uint32_t tupleof (Shadow *shadow)
+{
+    uint32_t opsel = OS_NONE;
+    uint32_t raws  = 0;
+    uint16_t ir    = shadow->ir;
+    switch (shadow->state) {
+        case Shadow::RESET0: case Shadow::RESET1: case Shadow::FETCH1: case Shadow::FETCH2:
+        case Shadow::IREQ1:  case Shadow::IREQ2:  case Shadow::IREQ3:  case Shadow::IREQ4:  case Shadow::IREQ5: break;
+        case Shadow::BCC1:   opsel = OC_BCC;   break;
+        case Shadow::STORE1: case Shadow::STORE2: opsel = OC_STORE; break;
+        case Shadow::LDA1:   opsel = OC_LDA;   break;
+        case Shadow::LOAD1:  case Shadow::LOAD2:  case Shadow::LOAD3: opsel = OC_LOAD; break;
+        case Shadow::HALT1:  opsel = OC_HALT;  break;
+        case Shadow::IRET1:  case Shadow::IRET2:  case Shadow::IRET3:  case Shadow::IRET4: opsel = OC_IRET; break;
+        case Shadow::WRPS1:  opsel = OC_WRPS;  break;
+        case Shadow::RDPS1:  opsel = OC_RDPS;  break;
+        case Shadow::ARITH1: {
+            opsel = 16 + (ir & 15);
+            uint32_t mask;
+            uint32_t dsb = shadow->getraws (&mask) & mask;
+            if (dsb & D_RAWCIN)    raws |= RW_CIN;
+            if (dsb & D_RAWCMIDO)  raws |= RW_CMID;
+            if (dsb & D_RAWCOUT)   raws |= RW_COUT;
+            if (dsb & D_RAWVOUT)   raws |= RW_VOUT;
+            if (dsb & D_RAWSHRIN)  raws |= RW_SHRIN;
+            if (dsb & D_RAWSHRMIDO) raws |= RW_SHRMID;
+            if (dsb & D_RAWSHROUT) raws |= RW_SHROUT;
+            break;
+        }
+    }
+    uint16_t psw = shadow->psw;
+    return TUPLE (shadow->state, opsel, ((psw >> 11) & 0x10) | (psw & 15), raws);
+}
+
+static bool covered (uint32_t tuple)
+{
+    return (__atomic_load_n (&coverage[tuple/64], __ATOMIC_RELAXED) >> (tuple % 64)) & 1;
+}
+
+// mark tuple covered, return whether it is new
+static bool cover (uint32_t tuple)
+{
+    uint64_t bit = 1ULL << (tuple % 64);
+    if (__atomic_load_n (&coverage[tuple/64], __ATOMIC_RELAXED) & bit) return false;
+    if (__atomic_fetch_or (&coverage[tuple/64], bit, __ATOMIC_RELAXED) & bit) return false;
+    __atomic_add_fetch (&ncovered, 1, __ATOMIC_RELAXED);
+    return true;
+}
+
+// write covered tuples to file, one per line
+//  state  opsel  psw flags  raw signals
+static bool writetuples (char const *filename)
+{
+    static char const *const classnames[] = { "BCC", "ARITH", "STORE", "LDA", "LOAD", "HALT", "IRET", "WRPS", "RDPS" };
+    static char const *const aopnames[] = { "LSR", "ASR", "ROR", "?3", "MOV", "NEG", "INC", "COM",
+                                            "OR", "AND", "XOR", "?11", "ADD", "SUB", "ADC", "SBB" };
+
+    FILE *tuplefile = fopen (filename, "w");
+    if (tuplefile == NULL) {
+        fprintf (stderr, "randfuzz: error creating %s: %m\n", filename);
+        return false;
+    }
+    for (uint32_t tuple = 0; tuple < NTUPLES; tuple ++) {
+        if (! covered (tuple)) continue;
+        uint32_t state = tuple >> 17;
+        uint32_t opsel = (tuple >> 12) & 31;
+        uint32_t psw   = (tuple >> 7) & 31;
+        uint32_t raws  = tuple & 127;
+        fprintf (tuplefile, "%-6s  %-5s  %c%c%c%c%c",
+            Shadow::statestr ((Shadow::State) state),
+            (opsel >= 16) ? aopnames[opsel-16] : (opsel < 9) ? classnames[opsel] : "-",
+            (psw & 16) ? 'I' : '-', (psw & 8) ? 'N' : '-', (psw & 4) ? 'Z' : '-', (psw & 2) ? 'V' : '-', (psw & 1) ? 'C' : '-');
+        if (state == Shadow::ARITH1) {
+            fprintf (tuplefile, "  %s%s%s%s%s%s%s",
+                (raws & RW_CIN)    ? " cin"    : "", (raws & RW_CMID)   ? " cmid"   : "",
+                (raws & RW_COUT)   ? " cout"   : "", (raws & RW_VOUT)   ? " vout"   : "",
+                (raws & RW_SHRIN)  ? " shrin"  : "", (raws & RW_SHRMID) ? " shrmid" : "",
+                (raws & RW_SHROUT) ? " shrout" : "");
+        }
+        fprintf (tuplefile, "\n");
+    }
+    if (fclose (tuplefile) < 0) {
+        fprintf (stderr, "randfuzz: error writing %s: %m\n", filename);
+        return false;
+    }
+    return true;
+}
+
+static double nowsecs ()
+{
+    struct timespec nowts;
+    if (clock_gettime (CLOCK_MONOTONIC, &nowts) < 0) abort ();
+    return nowts.tv_sec + nowts.tv_nsec / 1000000000.0;
+}
@@ -22,6 +22,9 @@
  * Requires four IOW56Paddles connected to the A,C,I,D connectors.
  * sudo insmod km/enabtsc.ko
  * sudo ./raseqtest [-alu] [-cpuhz 200] [-loop] [-loopat <count>] [-nopads] [-pauseat <count>] [-reg{01,23,45,67}] [-statepause]
+ * or on the gate-level netlist without hardware, recording test vectors for faultsim
+ *   and when each connector pin settled with propagation delays:
+ *   ./raseqtest -netlist raseq.bin [-vectors raseqtest.vec] [-nettiming raseqtest.txt] [-alu] [-reg{01,23,45,67}]
  */
 
 #include <errno.h>
@@ -130,6 +133,9 @@ int main (int argc, char **argv)
     int loopat = 0;
     int passno = 0;
     uint32_t cpuhz = DEFCPUHZ;
+    char const *netlistname = NULL;
+    char const *vectorsname = NULL;
+    char const *nettimingname = NULL;
     pads = true;
 
     setlinebuf (stdout);
@@ -159,6 +165,9 @@ int main (int argc, char **argv)
             loopat = atoi (argv[i]);
             continue;
         }
+        int rc = NetlistLib::testeropt (argc, argv, &i, &netlistname, &vectorsname, &nettimingname);
+        if (rc < 0) return 1;
+        if (rc > 0) continue;
         if (strcasecmp (argv[i], "-nopads") == 0) {
             pads = false;
             continue;
@@ -204,8 +213,12 @@ int main (int argc, char **argv)
     }
 
     // access rasboard and seqboard circuitry via gpio and paddles
-    gpio = new PhysLib (cpuhz);
-    gpio->open ();
+    // ...or gate-level simulation of its netlist
+    gpio = NetlistLib::testeropen (netlistname, vectorsname, nettimingname);
+    if (gpio == NULL) {
+        gpio = new PhysLib (cpuhz);
+        gpio->open ();
+    }
 
 loopatloop:
     srand (0);
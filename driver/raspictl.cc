@@ -23,44 +23,100 @@
  *
  *  ../asm/assemble.armv7l r6loop.asm r6loop.hex [cmdargs ...] > r6loop.lis
  *  . ./iow56sns.si
- *  sudo -E gdb --args ./raspictl [-chkacid] [-cpuhz <freq>] [-haltstop] [-mintimes] [-nohw] [-oddok] [-printstate] [-sim <pipename>] -randmem | r6loop.hex
+ *  sudo -E gdb --args ./raspictl [-chkacid] [-cosim <cycles>] [-cpuhz <freq>] [-haltstop] [-idleskip] [-irqlatency] [-memcycles <cycles>] [-mintimes] [-netdelays <stage>,<load>,<jumper>] [-netlist <file>] [-nettiming <file>] [-nohw] [-oddok] [-printstate] [-profile <file>] [-savesnap <file>] [-savesnapat <cycles>] [-shadowsim] [-sim <pipename>] [-statecounts] [-stats <name>] [-trace <file>] [-translate] [-virtualtime] -loadsnap <file> | -randmem | r6loop.hex
+ *  ./raspictl -batch <jobsfile> [-cpuhz <freq>] [-haltstop] [-idleskip] [-j <threads>] [-memcycles <cycles>] [-oddok] [-stopat <addr>] [-translate] [-virtualtime]
+ *      -batch      : run the jobs listed in jobsfile simultaneously, as if by -nohw, one per line:
+ *                      hexfile [args ...] [<stdinfile] [>stdoutfile] [2>stderrfile]
+ *                    prints each job's exit status and cycle count when all are done
  *      -chkacid    : check A,C,I,D connectors at end of each cycle (requires paddles)
+ *      -cosim      : with -nohw, run shadow in lockstep behind the instruction-by-instruction simulator and compare them
+ *                    memory accesses and system calls are checked as they happen, registers and psw every <cycles> cycles
+ *                    ...1 compares every instruction, works with -translate and -randmem (not both)
  *      -cpuhz      : specify cpu frequency (default 470000Hz)
  *      -haltstop   : HALT instruction causes exit (else it is 'wait for interrupt')
+ *      -idleskip   : with -nohw, detect loops spinning until an interrupt and skip ahead instead of running them
+ *                    skips to the next line clock with -virtualtime, else sleeps counting the time at -cpuhz
+ *      -irqlatency : print line clock interrupt latency (deadline to IREQ) at exit (see irqlatency.sh)
+ *      -j          : with -batch, number of threads to run jobs on (default number of cpus)
+ *      -loadsnap   : with -nohw, resume from snapshot file written by -savesnap instead of loading hex file
+ *      -memcycles  : with -nohw, cycles charged per byte by SCN_MEMCPY, SCN_MEMSET, etc (default 0)
  *      -mintimes   : print cpu cycle info once a minute
+ *      -netdelays  : with -nettiming, nanoseconds per transistor stage, per load on its output, per jumper between boards
+ *                    (default 20,1,2)
+ *      -netlist    : simulate the circuit at gate level from netgen -netbin file
+ *      -nettiming  : with -netlist, simulate with propagation delays and write when the connector pins settle
+ *                    in each state and the critical paths through the boards to file at exit
  *      -nohw       : don't use hardware, simulate processor internally
  *      -oddok      : odd addresses ok (swaps bytes) (else give warning message)
  *      -printinstr : print message at beginning of each instruction
  *      -printstate : print message at beginning of each state
+ *      -profile    : with -nohw, write cycles spent in each function and call graph to file at exit
+ *                    symbols come from the .map file alongside the .hex file, or from the image file
  *      -randmem    : supply random opcodes and data for testing
+ *      -savesnap   : with -nohw, write snapshot file at exit, on SIGHUP,SIGINT,SIGTERM,SIGUSR1 (SIGUSR1 continues running)
+ *      -savesnapat : with -savesnap, write snapshot when cycle count reached (and keep running) instead of at exit
+ *                    (delayed until no async i/o is in progress)
+ *      -shadowsim  : with -nohw, simulate cycle-by-cycle via shadow (else instruction-by-instruction)
  *      -sim        : simulate via pipe connected to NetGen
+ *      -statecounts: with -stats, also count cycles in each state when simulating instruction-by-instruction
+ *                    (always counted when cycle-by-cycle), slows it down, not with -translate
+ *      -stats      : publish live cycle, instruction, interrupt, HALT and syscall counts in /dev/shm/<name> (see hodetop)
  *      -stopat     : stop simulating when accessing the address
  *      -tclhex     : tcl assembler generated hex file format
+ *      -trace      : with -nohw, write compact binary record of each instruction to file (see tracedump)
+ *      -translate  : with -nohw, translate hot code to host machine code (x86_64 only)
+ *      -virtualtime: with -nohw, clock is cycle count at -cpuhz frequency instead of host time
+ *                    line clock interrupts at exact cycle, HALT skips ahead to next interrupt
+ *                    ...so runs are repeatable and go as fast as the host can go
+ *  r6loop.hex can also be a binary image written by link -i (see ../asm/hodeimage.h)
+ *      it is mapped into memory instead of being parsed, sets rosize and stack limit up front,
+ *      and its symbols are used in error messages and by -profile
  */
 
+#include <algorithm>
 #include <errno.h>
+#include <deque>
 #include <fcntl.h>
 #include <map>
 #include <math.h>
+#include <poll.h>
 #include <pthread.h>
 #include <sched.h>
+#include <set>
 #include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string>
 #include <string.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <sys/timerfd.h>
 #include <termios.h>
 #include <time.h>
 #include <unistd.h>
+#include <vector>
 
+#include "../asm/hodeimage.h"
+#include "cosim.h"
+#include "fastcpu.h"
+#include "fastxlat.h"
 #include "gpiolib.h"
+#include "hodestats.h"
 #include "miscdefs.h"
+#include "netlist.h"
+#include "profiler.h"
 #include "rdcyc.h"
 #include "shadow.h"
+#include "tracer.h"
+#include "vformat.h"
 
 #define SHADOWCHECK(samp) shadowcheck (samp)
 
+#define STATSUS 100000          // -stats updates cycle and instruction counts this often
+
 #define MAGIC 0xFFF0
 #define ERRNO 0xFFF2
 
@@ -97,61 +153,280 @@
 #define SCN_WATCHWRITE 30
 #define SCN_GETENV 31
 #define SCN_SETTTYECHO 32
+#define SCN_AREAD 33
+#define SCN_AWRITE 34
+#define SCN_AWAIT 35
+#define SCN_MEMCPY 36
+#define SCN_MEMSET 37
+#define SCN_MEMMOVE 38
+#define SCN_STRLEN 39
+#define SCN_MEMCMP 40
+#define SCN_MUL_LLL 41
+#define SCN_DIV_LLL 42
+#define SCN_MOD_LLL 43
+#define SCN_DIV_QQL 44
+#define SCN_DIV_QQQ 45
+#define SCN_MOD_QQQ 46
+#define SCN_MOD_WQW 47
+#define SCN_SHL_LLW 48
+#define SCN_SHR_LLW 49
+#define SCN_ASR_LLW 50
+#define SCN_SHL_QQW 51
+#define SCN_SHR_QQW 52
+#define SCN_ASR_QQW 53
+#define SCN_CMP_QQ 54
+#define SCN_SIN_DD 55
+#define SCN_SIN_FF 56
+#define SCN_COS_DD 57
+#define SCN_COS_FF 58
+#define SCN_TAN_DD 59
+#define SCN_TAN_FF 60
+#define SCN_EXP_DD 61
+#define SCN_EXP_FF 62
+#define SCN_LOG_DD 63
+#define SCN_LOG_FF 64
+#define SCN_SQRT_DD 65
+#define SCN_SQRT_FF 66
+#define SCN_POW_DDD 67
+#define SCN_POW_FFF 68
+#define SCN_ATAN2_DDD 69
+#define SCN_ATAN2_FFF 70
+#define SCN_VFORMAT 71
+#define SCN_MAPWIN 72
+#define SCN_MAPSYNC 73
 
 #define IRQ_SCNINTREQ 0x1
 #define IRQ_LINECLOCK 0x2
 #define IRQ_RANDMEM   0x4
+#define IRQ_ASYNCIO   0x8
 
 #define ever (;;)
 
-typedef uint16_t MagicReader (uint32_t sample);
-typedef void MagicWriter (uint32_t sample, uint16_t data);
-
-static bool lineclockrun;
-static char **cmdargv;
-static GpioLib *gpio;
-static int cmdargc;
-static pthread_cond_t intreqcond = PTHREAD_COND_INITIALIZER;
-static pthread_cond_t lineclockcond = PTHREAD_COND_INITIALIZER;
-static pthread_mutex_t intreqlock = PTHREAD_MUTEX_INITIALIZER;
-static Shadow shadow;
-static std::map<int,struct termios> savedtermioss;
-static struct timespec lineclockabs;
-static uint16_t readonlysize;
-static uint16_t stacklimit;
-static uint32_t intreqreg;
-static uint32_t syncintreq;
-static uint32_t watchwrite;
-static uint8_t memory[0x10000];
-static uint32_t readcounts[0x8000];
-
-static uint16_t mr_syscall (uint32_t sample);
-static void mw_syscall (uint32_t sample, uint16_t data);
-
-static MagicReader *const magicreaders[] = { mr_syscall };
-static MagicWriter *const magicwriters[] = { mw_syscall };
-
-static void save_errno ();
-static void *mintimesthread (void *dummy);
-static void *lineclockthread (void *dummy);
+// snapshot file written by -savesnap, read by -loadsnap
+// header at beginning of file, memory contents at SNAP_MEMOFFS so it can be mmapped directly
+#define SNAP_MAGIC "HODESNAP"
+#define SNAP_VERSION 1
+#define SNAP_MAXFDS 64
+#define SNAP_MEMOFFS 0x10000
+#define SNAP_RETRYCYCLES 100000 // -savesnapat tries again this often while async i/o is in progress
+
+struct SnapFd {
+    int32_t fd;                 // hode program's fd number
+    int32_t flags;              // as given by F_GETFL
+    int64_t offset;             // file position or -1 if not seekable
+    char path[240];             // as given by /proc/self/fd/<fd>
+};
+
+struct SnapHdr {
+    char magic[8];              // SNAP_MAGIC
+    uint32_t version;           // SNAP_VERSION
+    uint32_t nfds;              // number of fds[] entries used
+    uint64_t cycles;            // cycle counter
+    uint64_t insts;             // instruction counter
+    uint64_t lineclockns;       // line clock deadline or 0 if not armed (virtual ns with -virtualtime)
+    uint32_t intreqreg;         // pending interrupt requests
+    uint32_t watchwrite;        // SCN_WATCHWRITE address
+    uint16_t regs[8];           // R0..R6,PC at beginning of instruction
+    uint16_t psw;               // processor status word
+    uint16_t eoi;               // psw as of end of previous instruction
+    uint16_t readonlysize;      // SCN_SETROSIZE size
+    uint16_t stacklimit;        // SCN_SETSTKLIM limit
+    uint16_t syscallrc;         // value last syscall will return
+    uint8_t halted;             // waiting for interrupt after HALT
+    SnapFd fds[SNAP_MAXFDS];    // host files opened by SCN_OPEN
+};
+
+// read or write started by SCN_AREAD/SCN_AWRITE, done by irqthread
+// the request's index in asyncreqs[] is the tag the program passes to SCN_AWAIT
+#define ASYNC_MAX 16
+
+#define ASYNC_FREE   0  // slot available
+#define ASYNC_QUEUED 1  // waiting for fd to be ready
+#define ASYNC_BUSY   2  // irqthread doing the read() or write()
+#define ASYNC_DONE   3  // completed, waiting for SCN_AWAIT
+
+struct AsyncReq {
+    uint8_t state;              // ASYNC_*
+    bool write;                 // write() else read()
+    int fd;                     // host fd
+    void *buf;                  // buffer in hode memory
+    uint16_t len;               // buffer length
+    uint32_t seq;               // requests on an fd are done in order queued
+    int rc;                     // read()/write() return value
+    int err;                    // ...and errno if failed
+};
+
+// hode memory window mapped to a host file by SCN_MAPWIN
+#define MAPWIN_MAXSIZE 0x8000
+
+struct MapWin {
+    int fd;                     // dup of program's host fd
+    bool shared;                // file opened read/write, writes go to file
+    uint16_t size;              // window size in bytes
+    uint64_t offset;            // file offset window is mapped to
+    std::vector<uint8_t> saved; // memory contents to restore when unmapped
+};
+
+struct Machine;
+
+typedef uint16_t (Machine::*MagicReader) (uint32_t sample);
+typedef void (Machine::*MagicWriter) (uint32_t sample, uint16_t data);
+
+// state of one simulated hode computer
+// normally there is just one, but -batch runs several at once in different threads
+struct Machine {
+    AsyncReq asyncreqs[ASYNC_MAX];
+    bool exited;
+    bool halting;
+    bool irqlatwoke;
+    bool irqrun;
+    char **cmdargv;
+    CoSim *cosim;
+    FastCpu *fastcpu;
+    FastXlat *fastxlat;
+    FILE *errfile;
+    GpioLib *gpio;
+    int cmdargc;
+    int exitcode;
+    int haltepfd;
+    int haltfd;
+    int irqpipe[2];
+    int randinit;
+    int lineclockfd;
+    int stdfds[3];
+    pthread_cond_t asynccond;
+    pthread_mutex_t asynclock;
+    pthread_t irqpid;
+    Shadow shadow;
+    std::map<int,struct termios> savedtermioss;
+    std::map<uint16_t,MapWin> mapwins;
+    std::set<int> hodefds;
+    std::vector<uint32_t> irqlatnss[2];
+    uint16_t lastmemread;
+    uint16_t readonlysize;
+    uint16_t stacklimit;
+    uint32_t asyncpending;
+    uint32_t asyncseq;
+    uint32_t volatile intreqreg;
+    uint32_t syncintreq;
+    uint32_t watchwrite;
+    uint64_t irqlatdeadline;
+    uint64_t lineclockcycle;
+    uint64_t lineclockns;
+    uint8_t *memory;
+    uint16_t mr_syscall_rc;
+    uint8_t const *imgfile;     // link -i image file mapped read-only, else NULL
+    size_t imgsize;
+    HImgHdr const *imghdr;
+    HImgSym const *imgsyms;     // sorted by value
+    uint32_t readcounts[0x8000];
+
+    Machine ();
+    ~Machine ();
+    bool loadhex (char const *loadname, bool tclhex);
+    bool loadimage (char const *loadname, int loadfd);
+    std::string symbolize (uint16_t addr);
+    int runshadow (bool haltstop);
+    void startfastcpu ();
+    void startxlat ();
+    void startcosim ();
+    int runfastcpu (bool haltstop);
+    int runcosim ();
+    void finishcosim ();
+    void stopmach (int code);
+    void fatalerr ();
+
+    uint16_t mr_syscall (uint32_t sample);
+    void mw_syscall (uint32_t sample, uint16_t data);
+
+    void waithalted ();
+    bool skiphalted ();
+    void skipidle ();
+    void checksnapsignal ();
+    void setstopcycle ();
+    bool writesnap ();
+    bool loadsnap (char const *snapname);
+    static uint16_t fastmemread (void *param, uint16_t addr, bool word);
+    static void fastmemwrite (void *param, uint16_t addr, bool word, uint16_t data);
+    static uint16_t cosimfetch (void *param, uint16_t addr, bool word);
+    static uint16_t cosimread (void *param, uint16_t addr, bool word);
+    static void cosimwrite (void *param, uint16_t addr, bool word, uint16_t data);
+    static void *vfgetmemptr (void *param, uint32_t addr, uint32_t size, bool write);
+    static char const *vfgetmemstr (void *param, uint32_t addr);
+    uint16_t randread (bool fetch);
+    void checkmemaccess (uint16_t addr, uint32_t sample);
+    uint16_t readcycle (uint16_t addr, uint32_t sample);
+    void writecycle (uint16_t addr, uint32_t sample, uint16_t data);
+    void waitforintreq ();
+    void postintreq (uint32_t bits);
+    void irqinit ();
+    void irqlatsample ();
+    void irqlatreport ();
+    uint16_t const *getregs ();
+    uint64_t getcycles ();
+    uint64_t getinsts ();
+    int hostfd (int fd);
+    void save_errno ();
+    static void *mintimesthread (void *param);
+    static void *statsthread (void *param);
+    void updatestats (bool rate);
+    void setirqatns (uint64_t irqatns);
+    uint64_t virtualnowns ();
+    void lineclocktick ();
+    int asyncstart (bool write, int fd, void *buf, uint16_t len);
+    int asyncawait (int tag, bool wait);
+    int mapwinmap (uint16_t addr, MapWin *mw);
+    void mapwinunmap (uint16_t addr);
+    void startirqthread ();
+    static void *irqthread (void *param);
+    void irqloop ();
+    void dumpregs ();
+    void senddata (uint16_t data);
+    uint16_t recvdata (void);
+    uint8_t  readmembyte (uint32_t addr);
+    uint16_t readmemword (uint32_t addr);
+    uint32_t readmemlong (uint32_t addr);
+    uint64_t readmemquad (uint32_t addr);
+    double   readmemdoub (uint32_t addr);
+    float    readmemflt  (uint32_t addr);
+    void writememlong (uint32_t addr, uint32_t val);
+    void writememquad (uint32_t addr, uint64_t val);
+    void writememdoub (uint32_t addr, double   val);
+    void writememflt  (uint32_t addr, float    val);
+    void *getmemptr (uint32_t addr, uint32_t size, bool write);
+    void chargememcycles (uint32_t size);
+    char const *getmemstr (uint32_t addr);
+    void shadowcheck (uint32_t sample);
+};
+
+static MagicReader const magicreaders[] = { &Machine::mr_syscall };
+static MagicWriter const magicwriters[] = { &Machine::mw_syscall };
+
+static bool batchmode;
+static bool randmem;
+static bool idleskip;
+static bool irqlatency;
+static bool oddok;
+static bool savesnapexit;
+static bool virtualtime;
+static char const *savesnapname;
+static HodeStats *hodestats;
+static int volatile snapsignal;
+static Machine *mainmach;
+static uint32_t memcycles;
+static uint32_t stopataddr = -1;
+static uint32_t virtualhz = DEFCPUHZ;
+static uint64_t cosimcycles;
+static uint64_t savesnapat = -1ULL;
+static bool savesnapwait;   // -savesnapat reached but waiting for async i/o to finish
+
+static int runbatch (char const *batchname, int numthreads, bool translate, bool haltstop);
+static bool openstats (char const *statsname, uint32_t cpuhz);
+static uint64_t nowns ();
+static void *batchthread (void *qiv);
 static int twohexchars (char const *str);
 static uint16_t randopcode ();
 static uint16_t randuint16 ();
-static void dumpregs ();
-static void senddata (uint16_t data);
-static uint16_t recvdata (void);
-static uint16_t readmemword (uint32_t addr);
-static uint32_t readmemlong (uint32_t addr);
-static uint64_t readmemquad (uint32_t addr);
-static double   readmemdoub (uint32_t addr);
-static float    readmemflt  (uint32_t addr);
-static void writememlong (uint32_t addr, uint32_t val);
-static void writememquad (uint32_t addr, uint64_t val);
-static void writememdoub (uint32_t addr, double   val);
-static void writememflt  (uint32_t addr, float    val);
-static void *getmemptr (uint32_t addr, uint32_t size, bool write);
-static char const *getmemstr (uint32_t addr);
-static void shadowcheck (uint32_t sample);
 static void sighandler (int signum);
 static void exithandler ();
 
@@ -160,22 +435,52 @@ int main (int argc, char **argv)
     bool haltstop = false;
     bool mintimes = false;
     bool nohw = false;
-    bool oddok = false;
-    bool randmem = false;
+    bool shadowsim = false;
+    bool statecounts = false;
     bool tclhex = false;
+    bool translate = false;
+    char const *batchname = NULL;
     char const *loadname = NULL;
+    char const *loadsnapname = NULL;
+    char const *profilename = NULL;
+    char const *netlistname = NULL;
+    char const *nettimingname = NULL;
+    double netdelays[3] = { DEFSTAGENS, DEFLOADNS, DEFJUMPERNS };
     char const *simname = NULL;
+    char const *statsname = NULL;
+    char const *tracename = NULL;
     char *p;
-    int randinit = 0;
-    uint16_t lastmemread = 0;
+    int numthreads = 0;
+    int snapargi = argc;
     uint32_t cpuhz = DEFCPUHZ;
-    uint32_t stopataddr = -1;
 
     setlinebuf (stdout);
 
+    Machine *mach = new Machine ();
+
     for (int i = 0; ++ i < argc;) {
+        if (strcasecmp (argv[i], "-batch") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing filename after -batch\n");
+                return 1;
+            }
+            batchname = argv[i];
+            continue;
+        }
         if (strcasecmp (argv[i], "-chkacid") == 0) {
-            shadow.chkacid = true;
+            mach->shadow.chkacid = true;
+            continue;
+        }
+        if (strcasecmp (argv[i], "-cosim") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing cycle count after -cosim\n");
+                return 1;
+            }
+            cosimcycles = strtoull (argv[i], &p, 0);
+            if ((*p != 0) || (cosimcycles == 0)) {
+                fprintf (stderr, "raspictl: bad -cosim cycle count '%s'\n", argv[i]);
+                return 1;
+            }
             continue;
         }
         if (strcasecmp (argv[i], "-cpuhz") == 0) {
@@ -190,10 +495,73 @@ int main (int argc, char **argv)
             haltstop = true;
             continue;
         }
+        if (strcasecmp (argv[i], "-idleskip") == 0) {
+            idleskip = true;
+            continue;
+        }
+        if (strcasecmp (argv[i], "-irqlatency") == 0) {
+            irqlatency = true;
+            continue;
+        }
+        if (strcasecmp (argv[i], "-j") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing count after -j\n");
+                return 1;
+            }
+            numthreads = strtol (argv[i], &p, 0);
+            if ((*p != 0) || (numthreads <= 0)) {
+                fprintf (stderr, "raspictl: bad -j count '%s'\n", argv[i]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcasecmp (argv[i], "-memcycles") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing count after -memcycles\n");
+                return 1;
+            }
+            memcycles = strtoul (argv[i], &p, 0);
+            if (*p != 0) {
+                fprintf (stderr, "raspictl: bad -memcycles count '%s'\n", argv[i]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcasecmp (argv[i], "-loadsnap") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing filename after -loadsnap\n");
+                return 1;
+            }
+            loadsnapname = argv[i];
+            continue;
+        }
         if (strcasecmp (argv[i], "-mintimes") == 0) {
             mintimes = true;
             continue;
         }
+        if (strcasecmp (argv[i], "-netdelays") == 0) {
+            if ((++ i >= argc) || (sscanf (argv[i], "%lf,%lf,%lf", &netdelays[0], &netdelays[1], &netdelays[2]) != 3)) {
+                fprintf (stderr, "raspictl: missing <stage>,<load>,<jumper> after -netdelays\n");
+                return 1;
+            }
+            continue;
+        }
+        if (strcasecmp (argv[i], "-netlist") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing file name after -netlist\n");
+                return 1;
+            }
+            netlistname = argv[i];
+            continue;
+        }
+        if (strcasecmp (argv[i], "-nettiming") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing file name after -nettiming\n");
+                return 1;
+            }
+            nettimingname = argv[i];
+            continue;
+        }
         if (strcasecmp (argv[i], "-nohw") == 0) {
             nohw = true;
             continue;
@@ -203,17 +571,48 @@ int main (int argc, char **argv)
             continue;
         }
         if (strcasecmp (argv[i], "-printinstr") == 0) {
-            shadow.printinstr = true;
+            mach->shadow.printinstr = true;
             continue;
         }
         if (strcasecmp (argv[i], "-printstate") == 0) {
-            shadow.printstate = true;
+            mach->shadow.printstate = true;
+            continue;
+        }
+        if (strcasecmp (argv[i], "-profile") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing filename after -profile\n");
+                return 1;
+            }
+            profilename = argv[i];
             continue;
         }
         if ((strcasecmp (argv[i], "-randmem") == 0) && (loadname == NULL)) {
             oddok = true;
             randmem = true;
-            randinit = 14;
+            continue;
+        }
+        if (strcasecmp (argv[i], "-savesnap") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing filename after -savesnap\n");
+                return 1;
+            }
+            savesnapname = argv[i];
+            continue;
+        }
+        if (strcasecmp (argv[i], "-savesnapat") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing cycle count after -savesnapat\n");
+                return 1;
+            }
+            savesnapat = strtoull (argv[i], &p, 0);
+            if (*p != 0) {
+                fprintf (stderr, "raspictl: bad -savesnapat cycle count '%s'\n", argv[i]);
+                return 1;
+            }
+            continue;
+        }
+        if (strcasecmp (argv[i], "-shadowsim") == 0) {
+            shadowsim = true;
             continue;
         }
         if (strcasecmp (argv[i], "-sim") == 0) {
@@ -224,6 +623,18 @@ int main (int argc, char **argv)
             simname = argv[i];
             continue;
         }
+        if (strcasecmp (argv[i], "-statecounts") == 0) {
+            statecounts = true;
+            continue;
+        }
+        if (strcasecmp (argv[i], "-stats") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing name after -stats\n");
+                return 1;
+            }
+            statsname = argv[i];
+            continue;
+        }
         if (strcasecmp (argv[i], "-stopat") == 0) {
             if ((++ i >= argc) || (argv[i][0] == '-')) {
                 fprintf (stderr, "raspictl: missing address after -stopat\n");
@@ -240,101 +651,743 @@ int main (int argc, char **argv)
             tclhex = true;
             continue;
         }
+        if (strcasecmp (argv[i], "-trace") == 0) {
+            if ((++ i >= argc) || (argv[i][0] == '-')) {
+                fprintf (stderr, "raspictl: missing filename after -trace\n");
+                return 1;
+            }
+            tracename = argv[i];
+            continue;
+        }
+        if (strcasecmp (argv[i], "-translate") == 0) {
+            if (! FastXlat::supported ()) {
+                fprintf (stderr, "raspictl: -translate not supported on this host\n");
+                return 1;
+            }
+            translate = true;
+            continue;
+        }
+        if (strcasecmp (argv[i], "-virtualtime") == 0) {
+            virtualtime = true;
+            continue;
+        }
         if (argv[i][0] == '-') {
             fprintf (stderr, "raspictl: unknown option %s\n", argv[i]);
             return 1;
         }
-        if ((loadname != NULL) || randmem) {
+        if ((loadname != NULL) || randmem || (batchname != NULL)) {
             fprintf (stderr, "raspictl: unknown argument %s\n", argv[i]);
             return 1;
         }
 
+        // snapshot already has memory loaded, so all remaining args are for the program
+        if (loadsnapname != NULL) {
+            snapargi = i;
+            break;
+        }
+
         // hex filename, remainder of command line args available to program
         loadname = argv[i];
-        cmdargc  = argc - i;
-        cmdargv  = argv + i;
+        mach->cmdargc = argc - i;
+        mach->cmdargv = argv + i;
         break;
     }
-    if ((loadname == NULL) && ! randmem) {
-        fprintf (stderr, "raspictl: missing loadfile parameter\n");
+    if (translate && (stopataddr <= 0xFFFF)) {
+        fprintf (stderr, "raspictl: -stopat not supported with -translate\n");
         return 1;
     }
-
-    // read loadfile contents into memory
-    if (loadname != NULL) {
-        FILE *loadfile = fopen (loadname, "r");
-        if (loadfile == NULL) {
-            fprintf (stderr, "raspictl: error opening loadfile %s: %m\n", loadname);
+    if (cpuhz == 0) {
+        fprintf (stderr, "raspictl: bad -cpuhz frequency\n");
+        return 1;
+    }
+    virtualhz = cpuhz;
+    if ((netlistname != NULL) && (nohw || (simname != NULL))) {
+        fprintf (stderr, "raspictl: -netlist not supported with -nohw, -sim\n");
+        return 1;
+    }
+    if ((nettimingname != NULL) && (netlistname == NULL)) {
+        fprintf (stderr, "raspictl: -nettiming requires -netlist\n");
+        return 1;
+    }
+    if (virtualtime && (batchname == NULL) && (! nohw || randmem || mach->shadow.printstate || shadowsim)) {
+        fprintf (stderr, "raspictl: -virtualtime requires -nohw without -printstate, -randmem, -shadowsim\n");
+        return 1;
+    }
+    if (idleskip && (batchname == NULL) && (! nohw || randmem || mach->shadow.printstate || shadowsim || (tracename != NULL))) {
+        fprintf (stderr, "raspictl: -idleskip requires -nohw without -printstate, -randmem, -shadowsim, -trace\n");
+        return 1;
+    }
+    if (irqlatency && ((batchname != NULL) || randmem || virtualtime)) {
+        fprintf (stderr, "raspictl: -irqlatency not supported with -batch, -randmem, -virtualtime\n");
+        return 1;
+    }
+    if ((profilename != NULL) && ((batchname != NULL) || ! nohw || randmem || mach->shadow.printstate || shadowsim || translate)) {
+        fprintf (stderr, "raspictl: -profile requires -nohw without -batch, -printstate, -randmem, -shadowsim, -translate\n");
+        return 1;
+    }
+    if ((tracename != NULL) && ((batchname != NULL) || ! nohw || randmem || mach->shadow.printstate || shadowsim || translate)) {
+        fprintf (stderr, "raspictl: -trace requires -nohw without -batch, -printstate, -randmem, -shadowsim, -translate\n");
+        return 1;
+    }
+    if ((cosimcycles != 0) && ((batchname != NULL) || ! nohw || idleskip || mach->shadow.printstate || shadowsim)) {
+        fprintf (stderr, "raspictl: -cosim requires -nohw without -batch, -idleskip, -printstate, -shadowsim\n");
+        return 1;
+    }
+    if ((cosimcycles != 0) && randmem && translate) {
+        fprintf (stderr, "raspictl: -cosim not supported with both -randmem and -translate\n");
+        return 1;
+    }
+    if ((statsname != NULL) && (batchname != NULL)) {
+        fprintf (stderr, "raspictl: -stats not supported with -batch\n");
+        return 1;
+    }
+    if (statecounts && ((statsname == NULL) || translate)) {
+        fprintf (stderr, "raspictl: -statecounts requires -stats without -translate\n");
+        return 1;
+    }
+    if ((numthreads != 0) && (batchname == NULL)) {
+        fprintf (stderr, "raspictl: -j requires -batch\n");
+        return 1;
+    }
+    if (batchname != NULL) {
+        if (randmem || (loadsnapname != NULL) || (savesnapname != NULL) || (simname != NULL) || (netlistname != NULL) || mach->shadow.printstate || shadowsim) {
+            fprintf (stderr, "raspictl: -batch not supported with -loadsnap, -netlist, -printstate, -randmem, -savesnap, -shadowsim, -sim\n");
             return 1;
         }
-        char loadline[144], *p;
-        while (fgets (loadline, sizeof loadline, loadfile) != NULL) {
-            uint32_t addr = strtoul (loadline, &p, 16);
-            if (tclhex) {
-                if ((*(p ++) != ' ') || (addr >= sizeof memory) || (addr & 7) || (p[16] != '\n')) goto badload;
-                for (int i = 8; -- i >= 0;) {
-                    int data = twohexchars (p);
-                    if (data < 0) goto badload;
-                    memory[addr+i] = data;
-                    p += 2;
-                }
-            } else {
-                if (*(p ++) != ':') goto badload;
-                while (*p != '\n') {
-                    int data = twohexchars (p);
-                    if ((data < 0) || (addr >= sizeof memory)) goto badload;
-                    memory[addr++] = data;
-                    p += 2;
-                }
-            }
-        }
-        fclose (loadfile);
-        goto goodload;
-    badload:;
-        fprintf (stderr, "raspictl: bad loadfile line %s", loadline);
+        delete mach;
+        if (numthreads == 0) numthreads = sysconf (_SC_NPROCESSORS_ONLN);
+        return runbatch (batchname, numthreads, translate, haltstop);
+    }
+    if ((loadsnapname != NULL) && (loadname == NULL) && ! randmem) {
+
+        // snapshot filename takes the place of the hex filename as program's argv[0]
+        mach->cmdargc = argc - snapargi + 1;
+        mach->cmdargv = new char *[mach->cmdargc+1];
+        mach->cmdargv[0] = (char *) loadsnapname;
+        memcpy (mach->cmdargv + 1, argv + snapargi, (mach->cmdargc - 1) * sizeof *mach->cmdargv);
+        mach->cmdargv[mach->cmdargc] = NULL;
+    } else if ((loadname == NULL) && ! randmem) {
+        fprintf (stderr, "raspictl: missing loadfile parameter\n");
+        return 1;
+    } else if (loadsnapname != NULL) {
+        fprintf (stderr, "raspictl: -loadsnap given with %s\n", randmem ? "-randmem" : "hex file");
+        return 1;
+    }
+    if (((loadsnapname != NULL) || (savesnapname != NULL)) && (! nohw || randmem || mach->shadow.printstate || shadowsim)) {
+        fprintf (stderr, "raspictl: -loadsnap and -savesnap require -nohw without -printstate, -randmem, -shadowsim\n");
         return 1;
-    goodload:;
     }
+    if ((savesnapat != -1ULL) && (savesnapname == NULL)) {
+        fprintf (stderr, "raspictl: -savesnapat requires -savesnap\n");
+        return 1;
+    }
+    savesnapexit = (savesnapname != NULL) && (savesnapat == -1ULL);
+
+    // read loadfile contents into memory
+    if ((loadname != NULL) && ! mach->loadhex (loadname, tclhex)) return 1;
 
     if (mintimes) {
         pthread_t pid;
-        int rc = pthread_create (&pid, NULL, mintimesthread, NULL);
+        int rc = pthread_create (&pid, NULL, Machine::mintimesthread, mach);
+        if (rc != 0) abort ();
+        pthread_detach (pid);
+    }
+
+    if (statsname != NULL) {
+        if (! openstats (statsname, cpuhz)) return 1;
+        pthread_t pid;
+        int rc = pthread_create (&pid, NULL, Machine::statsthread, mach);
         if (rc != 0) abort ();
         pthread_detach (pid);
     }
 
     // make sure we undo termios on exit
+    mainmach = mach;
     signal (SIGHUP,  sighandler);
     signal (SIGINT,  sighandler);
     signal (SIGTERM, sighandler);
+    if (savesnapname != NULL) signal (SIGUSR1, sighandler);
 
     // access cpu circuitry
     // either physical circuit via gpio pins
     // ...or netgen simulator via pipes
+    // ...or gate-level simulation of netgen's netlist
     // ...or nothing but shadow
-    gpio = (simname != NULL) ? (GpioLib *) new PipeLib (simname) :
-                            (nohw ? (GpioLib *) new NohwLib (&shadow) :
-                                        (GpioLib *) new PhysLib (cpuhz, ! shadow.chkacid));
-    gpio->open ();
+    NetlistLib *netlistlib = (netlistname != NULL) ? new NetlistLib (netlistname) : NULL;
+    mach->gpio = (simname != NULL) ? (GpioLib *) new PipeLib (simname) :
+                 (netlistlib != NULL) ? (GpioLib *) netlistlib :
+                            (nohw ? (GpioLib *) new NohwLib (&mach->shadow) :
+                                        (GpioLib *) new PhysLib (cpuhz, ! mach->shadow.chkacid));
+    mach->gpio->open ();
+    if (nettimingname != NULL) {
+        netlistlib->settiming (nettimingname, &mach->shadow, netdelays[0], netdelays[1], netdelays[2]);
+    }
 
     // close gpio on exit
     atexit (exithandler);
 
     // reset CPU circuit for a couple cycles
-    gpio->writegpio (false, G_RESET);
-    gpio->halfcycle ();
-    gpio->halfcycle ();
-    gpio->halfcycle ();
+    mach->gpio->writegpio (false, G_RESET);
+    mach->gpio->halfcycle ();
+    mach->gpio->halfcycle ();
+    mach->gpio->halfcycle ();
 
     // tell shadowing that cpu is in reset0 state
-    shadow.open (gpio);
-    shadow.reset ();
+    mach->shadow.open (mach->gpio);
+    mach->shadow.reset ();
 
     // drop reset and leave clock signal low
     // enable reading data from cpu
-    gpio->writegpio (false, 0);
-    gpio->halfcycle ();
+    mach->gpio->writegpio (false, 0);
+    mach->gpio->halfcycle ();
+
+    // simulating without hardware, run an instruction at a time unless something needs to see each cycle
+    // ...-cosim has shadow see each cycle of what the instruction-at-a-time simulator did
+    if (nohw && (! randmem || (cosimcycles != 0)) && ! mach->shadow.printstate && ! shadowsim) {
+        mach->startfastcpu ();
+        if ((loadsnapname != NULL) && ! mach->loadsnap (loadsnapname)) return 1;
+        if (translate) mach->startxlat ();
+        if (cosimcycles != 0) mach->startcosim ();
+        mach->setstopcycle ();
+        if (statecounts) {
+            mach->fastcpu->statecounts = hodestats->statecounts;
+            __atomic_or_fetch (&hodestats->flags, HSF_STATES, __ATOMIC_RELAXED);
+        }
+        Profiler *profiler = NULL;
+        if (profilename != NULL) {
+
+            // map file is hex file name with .map in place of .hex
+            // image files have their own symbols
+            std::string mapname;
+            if ((loadname != NULL) && (mach->imgfile == NULL)) {
+                mapname = loadname;
+                size_t len = mapname.size ();
+                if ((len > 4) && (strcasecmp (mapname.c_str () + len - 4, ".hex") == 0)) mapname.resize (len - 4);
+                mapname += ".map";
+            }
+            profiler = new Profiler (mapname.empty () ? NULL : mapname.c_str ());
+            if (mach->imgfile != NULL) {
+                char const *strs = (char const *) mach->imgfile + mach->imghdr->stroffs;
+                for (uint32_t i = 0; i < mach->imghdr->nsymbols; i ++) {
+                    HImgSym const *sym = &mach->imgsyms[i];
+                    if (sym->psect != HIMG_ABS) profiler->addsymbol (sym->value, strs + sym->name);
+                }
+                profiler->sortsymbols ();
+            }
+            mach->fastcpu->profiler = profiler;
+        }
+        Tracer *tracer = NULL;
+        if (tracename != NULL) {
+            tracer = new Tracer ();
+            if (! tracer->open (tracename)) return 1;
+            mach->fastcpu->tracer = tracer;
+        }
+        int rc = mach->runfastcpu (haltstop);
+        if (tracer != NULL) {
+            tracer->close (mach->fastcpu->regs, mach->fastcpu->psw, mach->getcycles ());
+        }
+        if (profiler != NULL) {
+            FILE *proffile = fopen (profilename, "w");
+            if (proffile == NULL) {
+                fprintf (stderr, "raspictl: error creating %s: %m\n", profilename);
+                return rc;
+            }
+            profiler->report (proffile, mach->getcycles (), mach->getinsts ());
+            fclose (proffile);
+        }
+        return rc;
+    }
+
+    if (hodestats != NULL) __atomic_or_fetch (&hodestats->flags, HSF_STATES, __ATOMIC_RELAXED);
+    return mach->runshadow (haltstop);
+}
+
+
+// run jobs listed in -batch file on a pool of threads
+// each line of the file is a job:
+//   hexfile [args ...] [<stdinfile] [>stdoutfile] [2>stderrfile]
+// blank lines and lines beginning with # are ignored
+// jobs are dealt out round-robin to the threads' queues
+// ...then a thread that empties its own queue steals from the far end of the others
+// prints exit code and cycle count of each job when all have completed
+//  output:
+//   returns 0: all jobs exited with status 0
+//        else: some job failed
+struct BatchJob {
+    char const *hexname;
+    char const *stdinname;
+    char const *stdoutname;
+    char const *stderrname;
+    int exitcode;
+    std::vector<char *> args;
+    uint64_t cycles;
+    uint64_t insts;
+    uint64_t usecs;
+};
+
+struct BatchQueue {
+    pthread_mutex_t lock;
+    std::deque<BatchJob *> jobs;
+};
 
+static bool batchhaltstop;
+static bool batchtranslate;
+static BatchQueue *batchqueues;
+static int batchnumqueues;
+
+static BatchJob *batchnextjob (int qi);
+static void batchrunjob (BatchJob *job);
+
+static int runbatch (char const *batchname, int numthreads, bool translate, bool haltstop)
+{
+    FILE *batchfile = fopen (batchname, "r");
+    if (batchfile == NULL) {
+        fprintf (stderr, "raspictl: error opening batch file %s: %m\n", batchname);
+        return 1;
+    }
+
+    std::vector<BatchJob *> jobs;
+    char batchline[4096], *p, *q, *s;
+    for (int lineno = 1; fgets (batchline, sizeof batchline, batchfile) != NULL; lineno ++) {
+        p = strchr (batchline, '\n');
+        if (p == NULL) {
+            fprintf (stderr, "raspictl: %s:%d line too long\n", batchname, lineno);
+            return 1;
+        }
+        *p = 0;
+        p = batchline + strspn (batchline, " \t");
+        if ((*p == 0) || (*p == '#')) continue;
+
+        BatchJob *job = new BatchJob ();
+        for (q = strtok_r (p, " \t", &s); q != NULL; q = strtok_r (NULL, " \t", &s)) {
+            if ((q[0] == '<') && (q[1] != 0)) job->stdinname = strdup (q + 1);
+            else if ((q[0] == '>') && (q[1] != 0)) job->stdoutname = strdup (q + 1);
+            else if ((q[0] == '2') && (q[1] == '>') && (q[2] != 0)) job->stderrname = strdup (q + 2);
+            else job->args.push_back (strdup (q));
+        }
+        if (job->args.size () == 0) {
+            fprintf (stderr, "raspictl: %s:%d missing hex file name\n", batchname, lineno);
+            return 1;
+        }
+        job->hexname = job->args[0];
+        job->args.push_back (NULL);
+        jobs.push_back (job);
+    }
+    fclose (batchfile);
+
+    batchmode      = true;
+    batchhaltstop  = haltstop;
+    batchtranslate = translate;
+    batchnumqueues = numthreads;
+    batchqueues    = new BatchQueue[numthreads];
+    for (int i = 0; i < numthreads; i ++) {
+        pthread_mutex_init (&batchqueues[i].lock, NULL);
+    }
+    for (unsigned j = 0; j < jobs.size (); j ++) {
+        batchqueues[j%numthreads].jobs.push_back (jobs[j]);
+    }
+
+    struct timespec begts, endts;
+    if (clock_gettime (CLOCK_MONOTONIC, &begts) < 0) abort ();
+
+    pthread_t *pids = new pthread_t[numthreads];
+    for (int i = 0; i < numthreads; i ++) {
+        int rc = pthread_create (&pids[i], NULL, batchthread, (void *) (long) i);
+        if (rc != 0) abort ();
+    }
+    for (int i = 0; i < numthreads; i ++) {
+        pthread_join (pids[i], NULL);
+    }
+
+    if (clock_gettime (CLOCK_MONOTONIC, &endts) < 0) abort ();
+
+    // print results in order given in batch file
+    int nfailed = 0;
+    printf ("  job  exit        cycles        instrs     msec  hexfile\n");
+    for (unsigned j = 0; j < jobs.size (); j ++) {
+        BatchJob *job = jobs[j];
+        printf ("%5u %5d %13llu %13llu %8llu  %s\n", j + 1, job->exitcode,
+                job->cycles, job->insts, job->usecs / 1000, job->hexname);
+        if (job->exitcode != 0) nfailed ++;
+    }
+    printf ("raspictl: %u jobs, %d failed, %d threads, %llu msec\n", (unsigned) jobs.size (), nfailed, numthreads,
+            (endts.tv_sec - begts.tv_sec) * 1000ULL + endts.tv_nsec / 1000000 - begts.tv_nsec / 1000000);
+    return (nfailed == 0) ? 0 : 1;
+}
+
+// one of these per -j thread, runs jobs until there are none left
+static void *batchthread (void *qiv)
+{
+    int qi = (long) qiv;
+    for (BatchJob *job; (job = batchnextjob (qi)) != NULL;) {
+        batchrunjob (job);
+    }
+    return NULL;
+}
+
+// get next job for a thread to run
+// take from front of thread's own queue else steal from back of another thread's queue
+static BatchJob *batchnextjob (int qi)
+{
+    for (int i = 0; i < batchnumqueues; i ++) {
+        BatchQueue *bq = &batchqueues[(qi+i)%batchnumqueues];
+        BatchJob *job = NULL;
+        pthread_mutex_lock (&bq->lock);
+        if (! bq->jobs.empty ()) {
+            if (i == 0) {
+                job = bq->jobs.front ();
+                bq->jobs.pop_front ();
+            } else {
+                job = bq->jobs.back ();
+                bq->jobs.pop_back ();
+            }
+        }
+        pthread_mutex_unlock (&bq->lock);
+        if (job != NULL) return job;
+    }
+    return NULL;
+}
+
+// run a job to completion in its own machine
+static void batchrunjob (BatchJob *job)
+{
+    struct timespec begts, endts;
+    if (clock_gettime (CLOCK_MONOTONIC, &begts) < 0) abort ();
+
+    Machine *mach = new Machine ();
+    mach->cmdargc = job->args.size () - 1;
+    mach->cmdargv = &job->args[0];
+    job->exitcode = -1;
+
+    // redirect program's stdin, stdout, stderr
+    if (job->stdinname != NULL) {
+        mach->stdfds[0] = open (job->stdinname, O_RDONLY);
+        if (mach->stdfds[0] < 0) {
+            fprintf (stderr, "raspictl: error opening %s: %m\n", job->stdinname);
+            goto done;
+        }
+    }
+    if (job->stdoutname != NULL) {
+        mach->stdfds[1] = open (job->stdoutname, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (mach->stdfds[1] < 0) {
+            fprintf (stderr, "raspictl: error creating %s: %m\n", job->stdoutname);
+            goto done;
+        }
+    }
+    if (job->stderrname != NULL) {
+        mach->stdfds[2] = open (job->stderrname, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+        if (mach->stdfds[2] < 0) {
+            fprintf (stderr, "raspictl: error creating %s: %m\n", job->stderrname);
+            goto done;
+        }
+        mach->errfile = fdopen (mach->stdfds[2], "w");
+        if (mach->errfile == NULL) abort ();
+        setlinebuf (mach->errfile);
+    }
+
+    if (! mach->loadhex (job->hexname, false)) goto done;
+    mach->startfastcpu ();
+    if (batchtranslate) mach->startxlat ();
+    job->exitcode = mach->runfastcpu (batchhaltstop);
+    job->cycles   = mach->getcycles ();
+    job->insts    = mach->getinsts ();
+
+done:;
+    int stdinfd  = mach->stdfds[0];
+    int stdoutfd = mach->stdfds[1];
+    FILE *errfile = mach->errfile;
+    delete mach;
+    if (stdinfd  > 2) close (stdinfd);
+    if (stdoutfd > 2) close (stdoutfd);
+    if (errfile != stderr) fclose (errfile);
+
+    if (clock_gettime (CLOCK_MONOTONIC, &endts) < 0) abort ();
+    job->usecs = (endts.tv_sec - begts.tv_sec) * 1000000ULL + endts.tv_nsec / 1000 - begts.tv_nsec / 1000;
+}
+
+Machine::Machine ()
+{
+    memset (asyncreqs, 0, sizeof asyncreqs);
+    exited        = false;
+    halting       = false;
+    irqlatwoke    = false;
+    irqrun        = false;
+    cmdargv       = NULL;
+    cosim         = NULL;
+    fastcpu       = NULL;
+    fastxlat      = NULL;
+    errfile       = stderr;
+    gpio          = NULL;
+    cmdargc       = 0;
+    exitcode      = 0;
+    haltepfd      = -1;
+    haltfd        = -1;
+    irqpipe[0]    = -1;
+    irqpipe[1]    = -1;
+    lineclockfd   = -1;
+    randinit      = 14;
+    stdfds[0]     = 0;
+    stdfds[1]     = 1;
+    stdfds[2]     = 2;
+    pthread_cond_init (&asynccond, NULL);
+    pthread_mutex_init (&asynclock, NULL);
+    irqpid        = 0;
+    lastmemread   = 0;
+    readonlysize  = 0;
+    stacklimit    = 0;
+    asyncpending  = 0;
+    asyncseq      = 0;
+    intreqreg     = 0;
+    syncintreq    = 0;
+    watchwrite    = 0;
+    irqlatdeadline = 0;
+    lineclockcycle = -1ULL;
+    lineclockns   = 0;
+    mr_syscall_rc = 0;
+    imgfile       = NULL;
+    imgsize       = 0;
+    imghdr        = NULL;
+    imgsyms       = NULL;
+    memset (readcounts, 0, sizeof readcounts);
+
+    // page aligned so SCN_MAPWIN can map files into it
+    memory = (uint8_t *) mmap (NULL, 0x10000, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (memory == MAP_FAILED) abort ();
+}
+
+// tear down machine that was run by runbatch()
+Machine::~Machine ()
+{
+    // stop line clock and async i/o thread
+    if (irqpid != 0) {
+        pthread_mutex_lock (&asynclock);
+        irqrun = false;
+        pthread_mutex_unlock (&asynclock);
+        if (write (irqpipe[1], "", 1) < 0) abort ();
+        pthread_join (irqpid, NULL);
+        close (irqpipe[0]);
+        close (irqpipe[1]);
+    }
+    if (haltepfd >= 0) {
+        close (haltepfd);
+        close (haltfd);
+        close (lineclockfd);
+    }
+
+    // put back any tty settings it changed and close any files it left open
+    for (std::map<int,struct termios>::iterator it = savedtermioss.begin (); it != savedtermioss.end (); it ++) {
+        tcsetattr (hostfd (it->first), TCSANOW, &it->second);
+    }
+    for (std::set<int>::iterator it = hodefds.begin (); it != hodefds.end (); it ++) {
+        close (*it);
+    }
+
+    // write out and unmap any file windows
+    while (! mapwins.empty ()) mapwinunmap (mapwins.begin ()->first);
+    munmap (memory, 0x10000);
+    if (imgfile != NULL) munmap ((void *) imgfile, imgsize);
+
+    delete cosim;
+    delete fastxlat;
+    delete fastcpu;
+    pthread_cond_destroy (&asynccond);
+    pthread_mutex_destroy (&asynclock);
+}
+
+// read hex file contents into memory
+bool Machine::loadhex (char const *loadname, bool tclhex)
+{
+    FILE *loadfile = fopen (loadname, "r");
+    if (loadfile == NULL) {
+        fprintf (errfile, "raspictl: error opening loadfile %s: %m\n", loadname);
+        return false;
+    }
+    char loadline[144], *p;
+    if (! tclhex) {
+        int rc = fread (loadline, 1, sizeof HIMG_MAGIC - 1, loadfile);
+        if ((rc == sizeof HIMG_MAGIC - 1) && (memcmp (loadline, HIMG_MAGIC, rc) == 0)) {
+            bool ok = loadimage (loadname, fileno (loadfile));
+            fclose (loadfile);
+            return ok;
+        }
+        rewind (loadfile);
+    }
+    while (fgets (loadline, sizeof loadline, loadfile) != NULL) {
+        uint32_t addr = strtoul (loadline, &p, 16);
+        if (tclhex) {
+            if ((*(p ++) != ' ') || (addr >= 0x10000) || (addr & 7) || (p[16] != '\n')) goto badload;
+            for (int i = 8; -- i >= 0;) {
+                int data = twohexchars (p);
+                if (data < 0) goto badload;
+                memory[addr+i] = data;
+                p += 2;
+            }
+        } else {
+            if (*(p ++) != ':') goto badload;
+            while (*p != '\n') {
+                int data = twohexchars (p);
+                if ((data < 0) || (addr >= 0x10000)) goto badload;
+                memory[addr++] = data;
+                p += 2;
+            }
+        }
+    }
+    fclose (loadfile);
+    return true;
+
+badload:;
+    fprintf (errfile, "raspictl: bad loadfile line %s", loadline);
+    fclose (loadfile);
+    return false;
+}
+
+// map link -i image file into memory
+// the memory image is mapped copy-on-write straight from the file when page aligned
+// the whole file stays mapped read-only for the symbol table
+bool Machine::loadimage (char const *loadname, int loadfd)
+{
+    struct stat statbuf;
+    if (fstat (loadfd, &statbuf) < 0) {
+        fprintf (errfile, "raspictl: error statting loadfile %s: %m\n", loadname);
+        return false;
+    }
+    imgsize = statbuf.st_size;
+    if (imgsize < sizeof *imghdr) goto badimage;
+    imgfile = (uint8_t const *) mmap (NULL, imgsize, PROT_READ, MAP_PRIVATE, loadfd, 0);
+    if (imgfile == MAP_FAILED) {
+        fprintf (errfile, "raspictl: error mapping loadfile %s: %m\n", loadname);
+        imgfile = NULL;
+        return false;
+    }
+    imghdr  = (HImgHdr const *) imgfile;
+    imgsyms = (HImgSym const *) (imgfile + imghdr->symoffs);
+
+    // everything has to be within the file and memory image within 64KB
+    if ((imghdr->memsize > 0x10000) ||
+        ((uint64_t) imghdr->memoffs + imghdr->memsize > imgsize) ||
+        ((uint64_t) imghdr->psectoffs + imghdr->npsects * sizeof (HImgPSect) > imgsize) ||
+        ((uint64_t) imghdr->symoffs + imghdr->nsymbols * sizeof (HImgSym) > imgsize) ||
+        ((uint64_t) imghdr->stroffs + imghdr->strsize > imgsize) ||
+        (imghdr->strsize == 0) || (imgfile[imghdr->stroffs+imghdr->strsize-1] != 0)) goto badimage;
+    for (uint32_t i = 0; i < imghdr->nsymbols; i ++) {
+        if (imgsyms[i].name >= imghdr->strsize) goto badimage;
+    }
+
+    // processor always starts at zero
+    if (imghdr->entry != 0) {
+        fprintf (errfile, "raspictl: loadfile %s entry %04X is not reset address 0000\n", loadname, imghdr->entry);
+        return false;
+    }
+
+    {
+        long pagesize = sysconf (_SC_PAGESIZE);
+        if ((imghdr->memoffs % pagesize == 0) && (imghdr->memsize % pagesize == 0)) {
+            if ((imghdr->memsize != 0) && (mmap (memory, imghdr->memsize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_FIXED, loadfd, imghdr->memoffs) == MAP_FAILED)) {
+                fprintf (errfile, "raspictl: error mapping loadfile %s memory: %m\n", loadname);
+                return false;
+            }
+        } else {
+            memcpy (memory, imgfile + imghdr->memoffs, imghdr->memsize);
+        }
+    }
+
+    // crtl start sets this too but have it in effect from the first instruction
+    // stack limit waits for SCN_SETROSIZE as stack pointer starts out as zero, ie, below any limit
+    readonlysize = imghdr->rosize;
+    return true;
+
+badimage:;
+    fprintf (errfile, "raspictl: bad image loadfile %s\n", loadname);
+    return false;
+}
+
+// get name+offset for an address from the image symbols, just hex if no image
+std::string Machine::symbolize (uint16_t addr)
+{
+    char buf[16];
+    sprintf (buf, "%04X", addr);
+    if (imgfile == NULL) return buf;
+
+    // find last relocatable symbol at or below the address
+    char const *strs = (char const *) imgfile + imghdr->stroffs;
+    uint32_t lo = 0;
+    uint32_t hi = imghdr->nsymbols;
+    while (lo < hi) {
+        uint32_t mid = (lo + hi) / 2;
+        if (imgsyms[mid].value <= addr) lo = mid + 1;
+        else hi = mid;
+    }
+    while (lo > 0) {
+        HImgSym const *sym = &imgsyms[--lo];
+        if (sym->psect == HIMG_ABS) continue;
+        std::string str = buf;
+        str += " ";
+        str += strs + sym->name;
+        if (sym->value != addr) {
+            sprintf (buf, "+%04X", addr - sym->value);
+            str += buf;
+        }
+        return str;
+    }
+    return buf;
+}
+
+// set up to simulate an instruction at a time
+void Machine::startfastcpu ()
+{
+    if (cosimcycles == 0) {
+        fastcpu = new FastCpu (fastmemread, fastmemwrite, this, &intreqreg);
+    } else {
+        fastcpu = new FastCpu (cosimread, cosimwrite, this, &intreqreg);
+        fastcpu->fetcher = cosimfetch;
+    }
+    fastcpu->idledetect = idleskip;
+    fastcpu->printinstr = shadow.printinstr;
+    fastcpu->stacklimit = stacklimit;
+    fastcpu->reset ();
+}
+
+// translate hot code to host machine code
+void Machine::startxlat ()
+{
+    fastxlat = new FastXlat (fastcpu, memory);
+    fastxlat->setrosize (readonlysize);
+    fastxlat->setwatch (watchwrite);
+    fastcpu->xlat = fastxlat;
+}
+
+// compare shadow against fastcpu (and fastxlat) as they run
+// call after loadsnap() and startxlat() so it starts from where fastcpu is
+void Machine::startcosim ()
+{
+    cosim = new CoSim (memory, fastxlat != NULL, memcycles == 0);
+    if (fastxlat != NULL) fastxlat->setallslow ();
+    cosim->begin (fastcpu->regs, fastcpu->psw, fastcpu->getinsts ());
+}
+
+// program exited or something stopped it
+// exit process unless running instruction-at-a-time, in which case runfastcpu() returns the code
+void Machine::stopmach (int code)
+{
+    if (fastcpu == NULL) exit (code);
+    exitcode = code;
+    exited   = true;
+    fastcpu->stopcycle = 0;
+}
+
+// simulator detected an error in the program, registers have been dumped
+// in -batch mode, stop just this machine, otherwise abort the process
+void Machine::fatalerr ()
+{
+    if (! batchmode) abort ();
+    stopmach (-1);
+}
+
+// simulate processor a cycle at a time via gpio pins
+// either physical circuit, netgen simulator or just shadow
+int Machine::runshadow (bool haltstop)
+{
     for ever {
 
         // invariant:
@@ -349,17 +1402,16 @@ int main (int argc, char **argv)
 
             // -haltstop means just print a message and exit
             if (haltstop) {
-                fprintf (stderr, "raspictl: PC=%04X  HALT %04X\n", lastmemread, (sample & G_DATA) / G_DATA0);
+                fprintf (errfile, "raspictl: PC=%04X  HALT %04X\n", lastmemread, (sample & G_DATA) / G_DATA0);
                 return 0;
             }
 
             // otherwise wait for an interrupt
+            if (hodestats != NULL) hsinc (&hodestats->halts, 1);
             if (! randmem) {
-                pthread_mutex_lock (&intreqlock);
-                while (intreqreg == 0) {
-                    pthread_cond_wait (&intreqcond, &intreqlock);
-                }
-                pthread_mutex_unlock (&intreqlock);
+                uint64_t begns = (hodestats != NULL) ? nowns () : 0;
+                waitforintreq ();
+                if (hodestats != NULL) hsinc (&hodestats->haltns, nowns () - begns);
             }
         }
 
@@ -376,85 +1428,632 @@ int main (int argc, char **argv)
 
         // process the signal sample from just before raising clock
         if (sample & (G_READ | G_WRITE)) {
-            if (((sample & (G_WORD | G_DATA0)) == (G_WORD | G_DATA0)) && ! oddok) {
-                fprintf (stderr, "raspictl: odd word access %s\n", GpioLib::decocon (CON_G, sample).c_str ());
-                dumpregs ();
-                abort ();
-            }
-
             uint16_t addr = sample / G_DATA0;
-            uint32_t mi = addr / 2 - MAGIC / 2;
-
-            if (addr == stopataddr) {
-                fprintf (stderr, "raspictl: stopat %04X; PC %04X\n", addr, shadow.regs[7]);
-                return 2;
-            }
+            checkmemaccess (addr, sample);
 
             if (sample & G_READ) {
                 readcounts[addr/2] ++;
                 lastmemread = addr;
-                uint16_t data;
-                if (randmem) {
-                    if ((randinit > 0) && (-- randinit & 1)) {
-                        data = 0xC000 | ((randinit - 1) << (REGD - 1)) | (7 << REGA);
-                    } else if (shadow.state == Shadow::FETCH2) {
-                        data = randopcode ();
-                    } else {
-                        data = randuint16 ();
-                    }
-                } else if (mi < sizeof magicreaders / sizeof magicreaders[0]) {
-                    MagicReader *mr = magicreaders[mi];
-                    data = (*mr) (sample);
-                } else {
-                    data = memory[addr];
-                    if (sample & G_WORD) {
-                        data |= ((uint16_t) memory[addr^1]) << 8;
-                    }
-                }
+                uint16_t data = randmem ? randread (shadow.state == Shadow::FETCH2) : readcycle (addr, sample);
                 senddata (data);
             }
 
             if (sample & G_WRITE) {
                 uint16_t data = recvdata ();
                 if (randmem) {
-                    intreqreg = (randuint16 () & 1) * IRQ_RANDMEM;
+                    __atomic_store_n (&intreqreg, (randuint16 () & 1) * IRQ_RANDMEM, __ATOMIC_RELAXED);
                 } else {
-                    if (mi < sizeof magicwriters / sizeof magicwriters[0]) {
-                        MagicWriter *mw = magicwriters[mi];
-                        (*mw) (sample, data);
-                    } else {
-                        if (((addr ^ watchwrite) & -2) == 0) {
-                            fprintf (stderr, "raspictl: watch write addr %04X data %04X\n", addr, data);
-                            dumpregs ();
-                        }
-                        if (addr < readonlysize) {
-                            fprintf (stderr, "raspictl: write addr %04X below rosize %04X\n", addr, readonlysize);
-                            dumpregs ();
-                            abort ();
-                        }
-                        memory[addr] = data;
-                        if (sample & G_WORD) {
-                            memory[addr^1] = data >> 8;
-                        }
-                    }
+                    writecycle (addr, sample, data);
                 }
             }
         }
 
         if (shadow.regs[6] < stacklimit) {
-            fprintf (stderr, "raspictl: stack pointer %04X below limit %04X\n", shadow.regs[6], stacklimit);
+            fprintf (errfile, "raspictl: stack pointer %04X below limit %04X\n", shadow.regs[6], stacklimit);
             dumpregs ();
             abort ();
         }
 
-        // update irq pin
-        syncintreq = intreqreg ? G_IRQ : 0;
+        // update irq pin
+        syncintreq = intreqreg ? G_IRQ : 0;
+
+        // drop the clock and enable data bus read
+        // then wait half a clock cycle while clock is low
+        gpio->writegpio (false, syncintreq);
+        gpio->halfcycle ();
+    }
+}
+
+
+// simulate processor an instruction at a time
+// there are no gpio pins to wiggle so memory is accessed directly by fastcpu
+int Machine::runfastcpu (bool haltstop)
+{
+    // maybe snapshot was taken while waiting for interrupt
+    bool halted = fastcpu->gethalted ();
+
+    for ever {
+        int fr;
+        if (! halted) fr = (cosim == NULL) ? fastcpu->run () : runcosim ();
+        else if (skiphalted ()) fr = FR_STOP;
+        else {
+            waithalted ();
+            halted = false;
+            continue;
+        }
+
+        switch (fr) {
+            case FR_HALT: {
+                if (hodestats != NULL) hsinc (&hodestats->halts, 1);
+                if (haltstop) {
+                    fprintf (errfile, "raspictl: PC=%04X  HALT %04X\n", (uint16_t) (fastcpu->regs[7] - 2), fastcpu->regs[(fastcpu->ir>>REGB)&7]);
+                    if (savesnapexit) writesnap ();
+                    finishcosim ();
+                    return 0;
+                }
+
+                // -randmem has nothing to wake it up so just keep going, same as runshadow()
+                halted = ! randmem;
+                break;
+            }
+
+            // program exited, reached line clock or -savesnapat cycle count or got a signal
+            case FR_STOP: {
+                if (exited) {
+                    if (savesnapexit) writesnap ();
+                    finishcosim ();
+                    return exitcode;
+                }
+                uint64_t cycles = fastcpu->getcycles ();
+                if (cycles >= lineclockcycle) {
+                    __atomic_fetch_or (&intreqreg, IRQ_LINECLOCK, __ATOMIC_SEQ_CST);
+                    lineclockcycle = -1ULL;
+                }
+                if ((cycles >= savesnapat) && (snapsignal == 0)) {
+                    if (writesnap ()) savesnapat = -1ULL;
+                    else {
+                        // try again every so often until async i/o finishes
+                        savesnapwait = true;
+                        savesnapat = cycles + SNAP_RETRYCYCLES;
+                    }
+                }
+                checksnapsignal ();
+                setstopcycle ();
+                halted = fastcpu->gethalted ();
+                break;
+            }
+
+            // spinning in a loop that only an interrupt gets it out of
+            case FR_IDLE: {
+                skipidle ();
+                break;
+            }
+
+            case FR_STACK: goto stackerr;
+            default: abort ();
+        }
+    }
+stackerr:;
+
+    fprintf (errfile, "raspictl: stack pointer %04X below limit %04X\n", fastcpu->regs[6], stacklimit);
+    dumpregs ();
+    fatalerr ();
+    return exitcode;
+}
+
+// -cosim: run fastcpu for up to cosimcycles then have shadow catch up and compare
+//  output:
+//   returns what fastcpu->run() returned
+int Machine::runcosim ()
+{
+    uint64_t cycles = fastcpu->getcycles ();
+    uint64_t stopcycle = fastcpu->stopcycle;
+    uint64_t stepcycle = cycles + cosimcycles;
+    if (stepcycle < stopcycle) fastcpu->stopcycle = stepcycle;
+    int fr = fastcpu->run ();
+
+    // leave it be if stopmach() or a signal zeroed it
+    if (fastcpu->stopcycle == stepcycle) fastcpu->stopcycle = stopcycle;
+
+    if (! cosim->step (fastcpu->regs, fastcpu->psw, fastcpu->getcycles () - cycles, fastcpu->getinsts ())) {
+        dumpregs ();
+        fatalerr ();
+    }
+    return fr;
+}
+
+// -cosim: fastcpu is done, have shadow finish the last instruction
+void Machine::finishcosim ()
+{
+    if (cosim == NULL) return;
+    if (! cosim->finish ()) {
+        dumpregs ();
+        fatalerr ();
+        return;
+    }
+    fprintf (errfile, "raspictl: cosim matched %llu instructions\n", cosim->getinsts ());
+}
+
+// -cosim: fastcpu is fetching an opcode, log it for shadow to replay
+uint16_t Machine::cosimfetch (void *param, uint16_t addr, bool word)
+{
+    Machine *mach = (Machine *) param;
+    uint16_t data = randmem ? mach->randread (true) : fastmemread (param, addr, word);
+    mach->cosim->fetch (mach->fastcpu->getinsts (), addr, data);
+    return data;
+}
+
+// -cosim: fastcpu is reading data, log it for shadow to replay
+uint16_t Machine::cosimread (void *param, uint16_t addr, bool word)
+{
+    Machine *mach = (Machine *) param;
+    uint16_t data = randmem ? mach->randread (false) : fastmemread (param, addr, word);
+    mach->cosim->read (mach->fastcpu->getinsts (), addr, word, data);
+    return data;
+}
+
+// -cosim: fastcpu is writing data, log it for shadow to check against
+void Machine::cosimwrite (void *param, uint16_t addr, bool word, uint16_t data)
+{
+    Machine *mach = (Machine *) param;
+    mach->cosim->write (mach->fastcpu->getinsts (), addr, word, data);
+    if (randmem) {
+        __atomic_store_n (&mach->intreqreg, (randuint16 () & 1) * IRQ_RANDMEM, __ATOMIC_RELAXED);
+    } else {
+        fastmemwrite (param, addr, word, data);
+    }
+}
+
+// -randmem: make up data for the cpu to read
+// starts out with LDW Rn,#random for R6 down to R0
+uint16_t Machine::randread (bool fetch)
+{
+    if ((randinit > 0) && (-- randinit & 1)) {
+        return 0xC000 | ((randinit - 1) << (REGD - 1)) | (7 << REGA);
+    }
+    return fetch ? randopcode () : randuint16 ();
+}
+
+// fastcpu is reading memory, do what the main loop does for a G_READ cycle
+uint16_t Machine::fastmemread (void *param, uint16_t addr, bool word)
+{
+    Machine *mach = (Machine *) param;
+    uint32_t sample = addr * G_DATA0 | G_READ | (word ? G_WORD : 0);
+    mach->checkmemaccess (addr, sample);
+    mach->readcounts[addr/2] ++;
+    return mach->readcycle (addr, sample);
+}
+
+// fastcpu is writing memory, do what the main loop does for a G_WRITE cycle
+void Machine::fastmemwrite (void *param, uint16_t addr, bool word, uint16_t data)
+{
+    Machine *mach = (Machine *) param;
+    uint32_t sample = addr * G_DATA0 | G_WRITE | (word ? G_WORD : 0);
+    mach->checkmemaccess (addr, sample);
+    mach->writecycle (addr, sample, data);
+}
+
+// check memory access from cpu for odd address and -stopat address
+void Machine::checkmemaccess (uint16_t addr, uint32_t sample)
+{
+    if (((sample & (G_WORD | G_DATA0)) == (G_WORD | G_DATA0)) && ! oddok) {
+        fprintf (errfile, "raspictl: odd word access %s\n", GpioLib::decocon (CON_G, sample).c_str ());
+        dumpregs ();
+        fatalerr ();
+    }
+
+    if (addr == stopataddr) {
+        fprintf (errfile, "raspictl: stopat %04X; PC %04X\n", addr, getregs ()[7]);
+        stopmach (2);
+    }
+}
+
+// get data for cpu memory read cycle from memory or magic location
+uint16_t Machine::readcycle (uint16_t addr, uint32_t sample)
+{
+    uint32_t mi = addr / 2 - MAGIC / 2;
+    if (mi < sizeof magicreaders / sizeof magicreaders[0]) {
+        MagicReader mr = magicreaders[mi];
+        return (this->*mr) (sample);
+    }
+    uint16_t data = memory[addr];
+    if (sample & G_WORD) {
+        data |= ((uint16_t) memory[addr^1]) << 8;
+    }
+    return data;
+}
+
+// write data from cpu memory write cycle to memory or magic location
+void Machine::writecycle (uint16_t addr, uint32_t sample, uint16_t data)
+{
+    if (irqlatency && (addr == 0xFFFE)) irqlatsample ();
+    uint32_t mi = addr / 2 - MAGIC / 2;
+    if (mi < sizeof magicwriters / sizeof magicwriters[0]) {
+        MagicWriter mw = magicwriters[mi];
+        (this->*mw) (sample, data);
+        return;
+    }
+    if (((addr ^ watchwrite) & -2) == 0) {
+        fprintf (errfile, "raspictl: watch write addr %04X data %04X\n", addr, data);
+        dumpregs ();
+    }
+    if (addr < readonlysize) {
+        fprintf (errfile, "raspictl: write addr %04X below rosize %04X\n", addr, readonlysize);
+        dumpregs ();
+        fatalerr ();
+        return;
+    }
+    memory[addr] = data;
+    if (sample & G_WORD) {
+        memory[addr^1] = data >> 8;
+    }
+}
+
+// fastcpu executed a HALT, wait for an interrupt request
+// write snapshot while waiting if signal requests it
+void Machine::waithalted ()
+{
+    uint64_t begns = (hodestats != NULL) ? nowns () : 0;
+    do {
+        waitforintreq ();
+        checksnapsignal ();
+    } while (intreqreg == 0);
+    if (hodestats != NULL) hsinc (&hodestats->haltns, nowns () - begns);
+}
+
+// -virtualtime and fastcpu is halted, skip ahead to next line clock tick or -savesnapat instead of sleeping
+// cpu stays halted so a snapshot taken there resumes waiting for the interrupt
+//  output:
+//   returns false: nothing scheduled, have to wait for interrupt
+//            true: cycle count advanced to stopcycle, process as if run() returned FR_STOP
+bool Machine::skiphalted ()
+{
+    uint64_t stopcycle = fastcpu->stopcycle;
+    if (! virtualtime || (intreqreg != 0) || (asyncpending != 0) || (stopcycle == -1ULL)) return false;
+    if (stopcycle > fastcpu->getcycles ()) {
+        fastcpu->setstate (stopcycle, fastcpu->getinsts (), true, fastcpu->geteoi ());
+    }
+    return true;
+}
+
+// -idleskip and fastcpu is spinning in a loop that will go around the same until an interrupt
+// skip ahead whole iterations as if it had kept spinning, it resumes at the top of the loop
+// ...with -virtualtime, up to stopcycle so it stops at the same place it would have anyway
+// ...otherwise (or waiting on async i/o) sleep until an interrupt is requested, counting the time at -cpuhz
+void Machine::skipidle ()
+{
+    uint64_t loopcycles = fastcpu->idlecycles;
+    uint64_t cycles = fastcpu->getcycles ();
+    uint64_t stopcycle = fastcpu->stopcycle;
+    uint64_t iters = (stopcycle > cycles) ? (stopcycle - cycles) / loopcycles : 0;
+    if (! virtualtime || (asyncpending != 0) || (stopcycle == -1ULL)) {
+        struct timespec begts, endts;
+        if (clock_gettime (CLOCK_MONOTONIC, &begts) < 0) abort ();
+        waitforintreq ();
+        if (clock_gettime (CLOCK_MONOTONIC, &endts) < 0) abort ();
+        uint64_t us = (endts.tv_sec - begts.tv_sec) * 1000000ULL + endts.tv_nsec / 1000 - begts.tv_nsec / 1000;
+        uint64_t slept = us * virtualhz / 1000000 / loopcycles;
+        if (iters > slept) iters = slept;
+    }
+    fastcpu->setstate (cycles + iters * loopcycles, fastcpu->getinsts () + iters * fastcpu->idleinsts, false, fastcpu->geteoi ());
+}
+
+// signal handler requested a snapshot, write it out then maybe exit
+void Machine::checksnapsignal ()
+{
+    int signum = snapsignal;
+    if (signum != 0) {
+        savesnapwait = false;
+        writesnap ();
+        if (signum != SIGUSR1) {
+            fprintf (errfile, "raspictl: terminated for signal %d\n", signum);
+            exit (1);
+        }
+        snapsignal = 0;
+        setstopcycle ();
+    }
+}
+
+// set cycle count for fastcpu->run() to return FR_STOP at
+// ...whichever comes first of -savesnapat or -virtualtime line clock
+// ...or right away if exiting or got a signal
+void Machine::setstopcycle ()
+{
+    uint64_t stopcycle = (savesnapat < lineclockcycle) ? savesnapat : lineclockcycle;
+    fastcpu->stopcycle = stopcycle;
+    if (exited || (snapsignal != 0)) fastcpu->stopcycle = 0;
+}
+
+// write snapshot file
+// fastcpu is at the beginning of an instruction
+//  returns true: snapshot written
+//         false: async i/o in progress, snapshot not written
+bool Machine::writesnap ()
+{
+    // async i/o requests aren't saved, so resuming would AWAIT something that never completes
+    pthread_mutex_lock (&asynclock);
+    int busytag;
+    for (busytag = 0; busytag < ASYNC_MAX; busytag ++) {
+        if (asyncreqs[busytag].state != ASYNC_FREE) break;
+    }
+    pthread_mutex_unlock (&asynclock);
+    if (busytag < ASYNC_MAX) {
+        if (! savesnapwait) fprintf (errfile, "raspictl: snapshot %s not written, async i/o tag %d in progress\n", savesnapname, busytag);
+        return false;
+    }
+
+    SnapHdr *hdr = (SnapHdr *) calloc (1, sizeof *hdr);
+    if (hdr == NULL) abort ();
+    memcpy (hdr->magic, SNAP_MAGIC, sizeof hdr->magic);
+    hdr->version      = SNAP_VERSION;
+    hdr->cycles       = fastcpu->getcycles ();
+    hdr->insts        = fastcpu->getinsts ();
+    hdr->watchwrite   = watchwrite;
+    memcpy (hdr->regs, fastcpu->regs, sizeof hdr->regs);
+    hdr->psw          = fastcpu->psw;
+    hdr->eoi          = fastcpu->geteoi ();
+    hdr->readonlysize = readonlysize;
+    hdr->stacklimit   = stacklimit;
+    hdr->syscallrc    = mr_syscall_rc;
+    hdr->halted       = fastcpu->gethalted ();
+
+    hdr->intreqreg    = __atomic_load_n (&intreqreg, __ATOMIC_SEQ_CST);
+    hdr->lineclockns  = lineclockns;
+    for (std::map<uint16_t,MapWin>::iterator it = mapwins.begin (); it != mapwins.end (); it ++) {
+        fprintf (errfile, "raspictl: file window %04X not saved in snapshot, contents saved as memory\n", it->first);
+    }
+
+    // save name, access mode and position of each file opened by the program
+    for (std::set<int>::iterator it = hodefds.begin (); it != hodefds.end (); it ++) {
+        int fd = *it;
+        if (hdr->nfds >= SNAP_MAXFDS) {
+            fprintf (errfile, "raspictl: too many open files to snapshot, fd %d not saved\n", fd);
+            continue;
+        }
+        SnapFd *sfd = &hdr->fds[hdr->nfds];
+        char procname[32];
+        sprintf (procname, "/proc/self/fd/%d", fd);
+        int rc = readlink (procname, sfd->path, sizeof sfd->path - 1);
+        if ((rc < 0) || (sfd->path[0] != '/')) {
+            fprintf (errfile, "raspictl: fd %d is not a file, not saved in snapshot\n", fd);
+            memset (sfd->path, 0, sizeof sfd->path);
+            continue;
+        }
+        sfd->fd     = fd;
+        sfd->flags  = fcntl (fd, F_GETFL);
+        sfd->offset = lseek (fd, 0, SEEK_CUR);
+        hdr->nfds ++;
+    }
+
+    // write header then memory at SNAP_MEMOFFS so loader can mmap it
+    // write to temp file then rename so an old snapshot is not lost if we crash
+    char *tmpname = (char *) malloc (strlen (savesnapname) + 5);
+    if (tmpname == NULL) abort ();
+    sprintf (tmpname, "%s.tmp", savesnapname);
+    int fd = open (tmpname, O_WRONLY | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        fprintf (errfile, "raspictl: error creating snapshot %s: %m\n", tmpname);
+        abort ();
+    }
+    if ((pwrite (fd, hdr, sizeof *hdr, 0) != (int) sizeof *hdr) ||
+        (pwrite (fd, memory, 0x10000, SNAP_MEMOFFS) != 0x10000) ||
+        (close (fd) < 0) || (rename (tmpname, savesnapname) < 0)) {
+        fprintf (errfile, "raspictl: error writing snapshot %s: %m\n", savesnapname);
+        abort ();
+    }
+    fprintf (errfile, "raspictl: snapshot %s written at %llu cycles; %llu instrs\n", savesnapname, hdr->cycles, hdr->insts);
+    free (tmpname);
+    free (hdr);
+    savesnapwait = false;
+    return true;
+}
+
+// load snapshot file written by writesnap()
+// memory is mapped copy-on-write so only pages actually touched get read in
+bool Machine::loadsnap (char const *snapname)
+{
+    SnapHdr *hdr = (SnapHdr *) malloc (sizeof *hdr);
+    if (hdr == NULL) abort ();
+    int fd = open (snapname, O_RDONLY);
+    if (fd < 0) {
+        fprintf (errfile, "raspictl: error opening snapshot %s: %m\n", snapname);
+        free (hdr);
+        return false;
+    }
+    int rc = pread (fd, hdr, sizeof *hdr, 0);
+    if ((rc != (int) sizeof *hdr) || (memcmp (hdr->magic, SNAP_MAGIC, sizeof hdr->magic) != 0) ||
+            (hdr->version != SNAP_VERSION) || (hdr->nfds > SNAP_MAXFDS)) {
+        fprintf (errfile, "raspictl: %s is not a version %d snapshot\n", snapname, SNAP_VERSION);
+        close (fd);
+        free (hdr);
+        return false;
+    }
+
+    // memory is mmapped from the file, touching pages past the end would be SIGBUS
+    struct stat statbuf;
+    if (fstat (fd, &statbuf) < 0) {
+        fprintf (errfile, "raspictl: error statting snapshot %s: %m\n", snapname);
+        close (fd);
+        free (hdr);
+        return false;
+    }
+    if (statbuf.st_size < SNAP_MEMOFFS + 0x10000) {
+        fprintf (errfile, "raspictl: snapshot %s truncated, %lld bytes, need %d\n", snapname, (long long) statbuf.st_size, SNAP_MEMOFFS + 0x10000);
+        close (fd);
+        free (hdr);
+        return false;
+    }
+    void *mem = mmap (NULL, 0x10000, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, SNAP_MEMOFFS);
+    if (mem == MAP_FAILED) {
+        fprintf (errfile, "raspictl: error mapping snapshot %s: %m\n", snapname);
+        close (fd);
+        free (hdr);
+        return false;
+    }
+    close (fd);
+    munmap (memory, 0x10000);
+    memory = (uint8_t *) mem;
+
+    memcpy (fastcpu->regs, hdr->regs, sizeof fastcpu->regs);
+    fastcpu->psw = hdr->psw;
+    fastcpu->setstate (hdr->cycles, hdr->insts, hdr->halted != 0, hdr->eoi);
+    readonlysize = hdr->readonlysize;
+    stacklimit   = hdr->stacklimit;
+    watchwrite   = hdr->watchwrite;
+    fastcpu->stacklimit = stacklimit;
+    mr_syscall_rc = hdr->syscallrc;
+
+    // re-open files at same fd number and position
+    for (uint32_t i = 0; i < hdr->nfds; i ++) {
+        SnapFd *sfd = &hdr->fds[i];
+        int fd = open (sfd->path, sfd->flags & ~ (O_CREAT | O_EXCL | O_TRUNC));
+        if (fd < 0) {
+            fprintf (errfile, "raspictl: error re-opening fd %d %s: %m\n", sfd->fd, sfd->path);
+            continue;
+        }
+        if ((sfd->offset >= 0) && (lseek (fd, sfd->offset, SEEK_SET) < 0)) {
+            fprintf (errfile, "raspictl: error positioning fd %d %s: %m\n", sfd->fd, sfd->path);
+        }
+        if (fd != sfd->fd) {
+            if (dup2 (fd, sfd->fd) < 0) {
+                fprintf (errfile, "raspictl: error re-opening fd %d %s: %m\n", sfd->fd, sfd->path);
+                close (fd);
+                continue;
+            }
+            close (fd);
+        }
+        hodefds.insert (sfd->fd);
+    }
+
+    // restore pending interrupt requests then re-arm line clock
+    // a deadline already passed posts IRQ_LINECLOCK again right away
+    __atomic_store_n (&intreqreg, hdr->intreqreg, __ATOMIC_SEQ_CST);
+    if (hdr->lineclockns != 0) setirqatns (hdr->lineclockns);
+
+    fprintf (errfile, "raspictl: snapshot %s loaded at %llu cycles; %llu instrs\n", snapname, hdr->cycles, hdr->insts);
+    free (hdr);
+    return true;
+}
+
+// cpu is halted, wait for something to request an interrupt
+// if snapshotting, poll for signal requesting a snapshot
+// the line clock timerfd is in haltepfd so the tick is seen here directly without waiting for irqthread
+void Machine::waitforintreq ()
+{
+    irqinit ();
+
+    // halting must be set before checking intreqreg so postintreq() either sees it or its bit is seen here
+    __atomic_store_n (&halting, true, __ATOMIC_SEQ_CST);
+    while ((__atomic_load_n (&intreqreg, __ATOMIC_SEQ_CST) == 0) && (snapsignal == 0)) {
+        struct epoll_event events[2];
+        int n = epoll_wait (haltepfd, events, 2, (savesnapname == NULL) ? -1 : 100);
+        if (n < 0) {
+            if (errno != EINTR) abort ();
+            n = 0;
+        }
+        irqlatwoke = true;
+        for (int i = 0; i < n; i ++) {
+            if (events[i].data.fd == lineclockfd) {
+                lineclocktick ();
+            } else {
+                uint64_t count;
+                if ((read (haltfd, &count, sizeof count) < 0) && (errno != EAGAIN)) abort ();
+            }
+        }
+    }
+    __atomic_store_n (&halting, false, __ATOMIC_SEQ_CST);
+}
+
+// post interrupt request from irqthread, waking cpu if it is waiting in waitforintreq()
+void Machine::postintreq (uint32_t bits)
+{
+    __atomic_fetch_or (&intreqreg, bits, __ATOMIC_SEQ_CST);
+    if (__atomic_load_n (&halting, __ATOMIC_SEQ_CST)) {
+        uint64_t one = 1;
+        if (write (haltfd, &one, sizeof one) < 0) abort ();
+    }
+}
+
+// -irqlatency: cpu is taking an interrupt, ie, IREQ is writing psw to FFFE
+// if it is for a line clock deadline not yet measured, save how long after the deadline it is
+// ...separately for whether the cpu was woken from waitforintreq() or was running
+void Machine::irqlatsample ()
+{
+    bool woke = irqlatwoke;
+    irqlatwoke = false;
+    uint64_t deadline = __atomic_load_n (&lineclockns, __ATOMIC_SEQ_CST);
+    if (! (intreqreg & IRQ_LINECLOCK) || (deadline == 0) || (deadline == irqlatdeadline)) return;
+    irqlatdeadline = deadline;
+    struct timespec nowts;
+    if (clock_gettime (CLOCK_REALTIME, &nowts) < 0) abort ();
+    uint64_t nowns = nowts.tv_sec * 1000000000ULL + nowts.tv_nsec;
+    uint64_t latns = (nowns > deadline) ? nowns - deadline : 0;
+    irqlatnss[woke].push_back ((latns > 0xFFFFFFFFU) ? 0xFFFFFFFFU : latns);
+}
+
+// -irqlatency: print line clock latency statistics
+void Machine::irqlatreport ()
+{
+    for (int woke = 0; woke < 2; woke ++) {
+        std::vector<uint32_t> *lats = &irqlatnss[woke];
+        char const *how = woke ? "halted " : "running";
+        size_t n = lats->size ();
+        if (n == 0) {
+            fprintf (errfile, "raspictl: irqlatency %s: no samples\n", how);
+            continue;
+        }
+        std::sort (lats->begin (), lats->end ());
+        uint64_t sum = 0;
+        for (size_t i = 0; i < n; i ++) sum += (*lats)[i];
+        fprintf (errfile, "raspictl: irqlatency %s: %6u samples  min %8.1f  avg %8.1f  50%% %8.1f  99%% %8.1f  max %8.1f uS\n",
+                how, (uint32_t) n, (*lats)[0] / 1000.0, sum / 1000.0 / n, (*lats)[n/2] / 1000.0,
+                (*lats)[n*99/100] / 1000.0, (*lats)[n-1] / 1000.0);
+    }
+}
+
+// create line clock timerfd and the epoll set waitforintreq() sleeps on
+// done on first use so they don't take fd numbers a snapshot is restoring
+void Machine::irqinit ()
+{
+    if (haltepfd >= 0) return;
+    lineclockfd = timerfd_create (CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (lineclockfd < 0) abort ();
+    haltfd = eventfd (0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (haltfd < 0) abort ();
+    haltepfd = epoll_create1 (EPOLL_CLOEXEC);
+    if (haltepfd < 0) abort ();
+    struct epoll_event event;
+    memset (&event, 0, sizeof event);
+    event.events  = EPOLLIN;
+    event.data.fd = lineclockfd;
+    if (epoll_ctl (haltepfd, EPOLL_CTL_ADD, lineclockfd, &event) < 0) abort ();
+    event.data.fd = haltfd;
+    if (epoll_ctl (haltepfd, EPOLL_CTL_ADD, haltfd, &event) < 0) abort ();
+}
+
+// translate program's fd to host fd
+// 0,1,2 may be redirected by -batch, and -batch programs can only access files they opened
+int Machine::hostfd (int fd)
+{
+    if ((fd >= 0) && (fd <= 2)) return stdfds[fd];
+    if (batchmode && (hodefds.count (fd) == 0)) return -1;
+    return fd;
+}
+
+// get registers from whichever is simulating the processor
+uint16_t const *Machine::getregs ()
+{
+    return (fastcpu != NULL) ? fastcpu->regs : shadow.regs;
+}
+
+uint64_t Machine::getcycles ()
+{
+    return (fastcpu != NULL) ? fastcpu->getcycles () : shadow.getcycles ();
+}
 
-        // drop the clock and enable data bus read
-        // then wait half a clock cycle while clock is low
-        gpio->writegpio (false, syncintreq);
-        gpio->halfcycle ();
-    }
+uint64_t Machine::getinsts ()
+{
+    return (fastcpu != NULL) ? fastcpu->getinsts () : shadow.getinsts ();
 }
 
 static int twohexchars (char const *str)
@@ -525,34 +2124,37 @@ static uint16_t randuint16 ()
     return (uint16_t) seed;
 }
 
-static void dumpregs ()
+void Machine::dumpregs ()
 {
-    fprintf (stderr, "raspictl:  R0=%04X R1=%04X R2=%04X R3=%04X R4=%04X R5=%04X R6=%04X PC=%04X\n",
-            shadow.regs[0], shadow.regs[1], shadow.regs[2], shadow.regs[3],
-            shadow.regs[4], shadow.regs[5], shadow.regs[6], shadow.regs[7]);
+    uint16_t const *regs = getregs ();
+    fprintf (errfile, "raspictl:  R0=%04X R1=%04X R2=%04X R3=%04X R4=%04X R5=%04X R6=%04X PC=%04X\n",
+            regs[0], regs[1], regs[2], regs[3], regs[4], regs[5], regs[6], regs[7]);
+    if (imgfile != NULL) {
+        fprintf (errfile, "raspictl:  R3=%s PC=%s\n", symbolize (regs[3]).c_str (), symbolize (regs[7]).c_str ());
+    }
 }
 
 // CPU wrote to syscall magic location
 // assume it is a pointer to syscall parameter block
-static uint16_t mr_syscall_rc;
-
-static void mw_syscall (uint32_t sample, uint16_t data)
+void Machine::mw_syscall (uint32_t sample, uint16_t data)
 {
     if (data & 1) {
         mr_syscall_rc = -1;
         errno = -ENOSYS;
         save_errno ();
-        fprintf (stderr, "raspictl: odd syscall addr %04X\n", data);
+        fprintf (errfile, "raspictl: odd syscall addr %04X\n", data);
         return;
     }
     uint16_t scn = readmemword (data);
+    if ((hodestats != NULL) && (scn < HS_NSYSCALLS)) hsinc (&hodestats->syscalls[scn], 1);
     switch (scn) {
 
         // exit() system call
         case SCN_EXIT: {
             uint16_t code = readmemword (data + 2);
-            fprintf (stderr, "raspictl: SCN_EXIT:%u; %llu cycles\n", code, shadow.getcycles ());
-            exit (code);
+            fprintf (errfile, "raspictl: SCN_EXIT:%u; %llu cycles; %llu instrs\n", code, getcycles (), getinsts ());
+            if (irqlatency) irqlatreport ();
+            stopmach (code);
             break;
         }
 
@@ -560,7 +2162,7 @@ static void mw_syscall (uint32_t sample, uint16_t data)
         case SCN_PRINTLN: {
             uint16_t addr = readmemword (data + 2);
             char const *str = getmemstr (addr);
-            fprintf (stderr, "raspictl: SCN_PRINTLN:%s\n", str);
+            fprintf (errfile, "raspictl: SCN_PRINTLN:%s\n", str);
             break;
         }
 
@@ -569,22 +2171,21 @@ static void mw_syscall (uint32_t sample, uint16_t data)
         //  .word   0: negate; 1: assert
         case SCN_INTREQ: {
             uint16_t code = readmemword (data + 2);
-            fprintf (stderr, "raspictl: SCN_INTREQ:%s\n", ((code != 0) ? "true" : "false"));
-            pthread_mutex_lock (&intreqlock);
-            if (code != 0) intreqreg |= IRQ_SCNINTREQ;
-                    else intreqreg &= ~ IRQ_SCNINTREQ;
-            pthread_mutex_unlock (&intreqlock);
+            fprintf (errfile, "raspictl: SCN_INTREQ:%s\n", ((code != 0) ? "true" : "false"));
+            if (code != 0) __atomic_fetch_or (&intreqreg, IRQ_SCNINTREQ, __ATOMIC_SEQ_CST);
+                    else __atomic_fetch_and (&intreqreg, ~ IRQ_SCNINTREQ, __ATOMIC_SEQ_CST);
             break;
         }
 
         // close() system call
         case SCN_CLOSE: {
             int fd = (int)(sint16_t) readmemword (data + 2);
-            if (fd <= 2) fd = -999;
+            if ((fd <= 2) || (hostfd (fd) < 0)) fd = -999;
             int rc = close (fd);
             if (rc < 0) save_errno ();
             mr_syscall_rc = rc;
             savedtermioss.erase (fd);
+            hodefds.erase (fd);
             break;
         }
 
@@ -592,6 +2193,11 @@ static void mw_syscall (uint32_t sample, uint16_t data)
         //  .word   SCN_GETNOWNS
         //  .word   addr of uint64_t that gets the current timestamp
         case SCN_GETNOWNS: {
+            if (virtualtime) {
+                writememquad (readmemword (data + 2), virtualnowns ());
+                mr_syscall_rc = 0;
+                break;
+            }
             struct timespec nowts;
             if (clock_gettime (CLOCK_REALTIME, &nowts) < 0) abort ();
             writememquad (readmemword (data + 2), nowts.tv_sec * 1000000000ULL + nowts.tv_nsec);
@@ -606,6 +2212,7 @@ static void mw_syscall (uint32_t sample, uint16_t data)
             uint16_t mode = readmemword (data + 6);
             int rc = open (path, flags, mode);
             if (rc < 0) save_errno ();
+                  else hodefds.insert (rc);
             mr_syscall_rc = rc;
             break;
         }
@@ -616,7 +2223,8 @@ static void mw_syscall (uint32_t sample, uint16_t data)
             uint16_t len = readmemword (data + 6);
             uint16_t adr = readmemword (data + 4);
             void *buf = (adr == 0) ? NULL : getmemptr (adr, len, true);
-            int rc = read (fd, buf, len);
+            if ((adr != 0) && (buf == NULL)) break;
+            int rc = read (hostfd (fd), buf, len);
             if (rc < 0) save_errno ();
             mr_syscall_rc = rc;
             break;
@@ -628,36 +2236,120 @@ static void mw_syscall (uint32_t sample, uint16_t data)
             uint16_t len = readmemword (data + 6);
             uint16_t adr = readmemword (data + 4);
             void *buf = (adr == 0) ? NULL : getmemptr (adr, len, false);
-            int rc = write (fd, buf, len);
+            if ((adr != 0) && (buf == NULL)) break;
+            int rc = write (hostfd (fd), buf, len);
             if (rc < 0) save_errno ();
             mr_syscall_rc = rc;
             break;
         }
 
+        // start read() or write() in background
+        //  .word   SCN_AREAD or SCN_AWRITE
+        //  .word   fd
+        //  .word   buffer address
+        //  .word   buffer length
+        // returns:
+        //   -1 : error (EAGAIN if ASYNC_MAX requests already started)
+        //  else: tag to pass to SCN_AWAIT
+        // IRQ_ASYNCIO is requested when it completes, buffer must be left alone until then
+        case SCN_AREAD:
+        case SCN_AWRITE: {
+            int fd = (int)(sint16_t) readmemword (data + 2);
+            uint16_t len = readmemword (data + 6);
+            uint16_t adr = readmemword (data + 4);
+            void *buf = (adr == 0) ? NULL : getmemptr (adr, len, scn == SCN_AREAD);
+            if ((adr != 0) && (buf == NULL)) break;
+            mr_syscall_rc = asyncstart (scn == SCN_AWRITE, hostfd (fd), buf, len);
+            break;
+        }
+
+        // get result of SCN_AREAD or SCN_AWRITE, freeing its tag
+        //  .word   SCN_AWAIT
+        //  .word   tag
+        //  .word   0: return -1 with EAGAIN if not done; 1: wait for it to complete
+        // returns:
+        //  what read() or write() returned
+        // IRQ_ASYNCIO is cleared when no more completed requests are waiting for SCN_AWAIT
+        case SCN_AWAIT: {
+            int tag = (int)(sint16_t) readmemword (data + 2);
+            bool wait = readmemword (data + 4) != 0;
+            mr_syscall_rc = asyncawait (tag, wait);
+            break;
+        }
+
+        // bulk memory operations done by host instead of byte at a time
+        //  .word   SCN_MEMCPY or SCN_MEMMOVE
+        //  .word   dest address
+        //  .word   source address
+        //  .word   byte count
+        // SCN_MEMCPY copies forward a byte at a time when dest overlaps the end of source, like __memcpy
+        case SCN_MEMCPY:
+        case SCN_MEMMOVE: {
+            uint16_t len = readmemword (data + 6);
+            uint16_t src = readmemword (data + 4);
+            uint16_t dst = readmemword (data + 2);
+            uint8_t *dstptr = (uint8_t *) getmemptr (dst, len, true);
+            uint8_t const *srcptr = (uint8_t const *) getmemptr (src, len, false);
+            if ((dstptr == NULL) || (srcptr == NULL)) break;
+            if ((scn == SCN_MEMCPY) && (dst > src) && (dst - src < len)) {
+                for (uint32_t i = 0; i < len; i ++) dstptr[i] = srcptr[i];
+            } else {
+                memmove (dstptr, srcptr, len);
+            }
+            chargememcycles (len);
+            mr_syscall_rc = 0;
+            break;
+        }
+
+        //  .word   SCN_MEMSET
+        //  .word   dest address
+        //  .word   fill byte
+        //  .word   byte count
+        case SCN_MEMSET: {
+            uint16_t len = readmemword (data + 6);
+            uint8_t  val = readmemword (data + 4);
+            uint16_t dst = readmemword (data + 2);
+            void *dstptr = getmemptr (dst, len, true);
+            if (dstptr == NULL) break;
+            memset (dstptr, val, len);
+            chargememcycles (len);
+            mr_syscall_rc = 0;
+            break;
+        }
+
+        //  .word   SCN_STRLEN
+        //  .word   string address
+        // returns length not including null
+        case SCN_STRLEN: {
+            uint16_t len = strlen (getmemstr (readmemword (data + 2)));
+            chargememcycles (len + 1);
+            mr_syscall_rc = len;
+            break;
+        }
+
+        //  .word   SCN_MEMCMP
+        //  .word   address
+        //  .word   address
+        //  .word   byte count
+        // returns difference of first mismatched bytes, signed like memcmp.asm, or 0 if all match
+        case SCN_MEMCMP: {
+            uint16_t len = readmemword (data + 6);
+            sint8_t const *ptr2 = (sint8_t const *) getmemptr (readmemword (data + 4), len, false);
+            sint8_t const *ptr1 = (sint8_t const *) getmemptr (readmemword (data + 2), len, false);
+            if ((ptr1 == NULL) || (ptr2 == NULL)) break;
+            uint16_t i;
+            for (i = 0; (i < len) && (ptr1[i] == ptr2[i]); i ++) { }
+            chargememcycles ((i < len) ? i + 1 : len);
+            mr_syscall_rc = (i < len) ? ptr1[i] - ptr2[i] : 0;
+            break;
+        }
+
         // .word SCN_IRQATNS
         // .word addr of uint64_t when to interrupt or 0 to stop
         case SCN_IRQATNS: {
             uint16_t irqataddr = readmemword (data + 2);
             uint64_t irqatns = (irqataddr != 0) ? readmemquad (irqataddr) : 0;
-            pthread_mutex_lock (&intreqlock);
-            intreqreg &= ~ IRQ_LINECLOCK;
-            if (irqatns != 0) {
-                lineclockabs.tv_sec  = irqatns / 1000000000;
-                lineclockabs.tv_nsec = irqatns % 1000000000;
-                if (! lineclockrun) {
-                    rdcycuninit ();
-                    pthread_t pid;
-                    int rc = pthread_create (&pid, NULL, lineclockthread, NULL);
-                    if (rc != 0) abort ();
-                    pthread_detach (pid);
-                    lineclockrun = true;
-                    rdcycinit ();
-                }
-            } else {
-                memset (&lineclockabs, 0, sizeof lineclockabs);
-            }
-            pthread_cond_broadcast (&lineclockcond);
-            pthread_mutex_unlock (&intreqlock);
+            setirqatns (irqatns);
             mr_syscall_rc = 0;
             break;
         }
@@ -696,6 +2388,7 @@ static void mw_syscall (uint32_t sample, uint16_t data)
                 uint16_t bufadr = readmemword (data + 6);
                 if (bufadr != 0) {
                     void *bufptr = getmemptr (bufadr, buflen, true);
+                    if (bufptr == NULL) break;
                     memcpy (bufptr, cmdptr, buflen);
                 }
                 mr_syscall_rc = cmdlen;
@@ -723,7 +2416,7 @@ static void mw_syscall (uint32_t sample, uint16_t data)
                 default: abort ();
             }
             //if (! isfinite (leftop) || ! isfinite (riteop) || ! isfinite (result)) {
-            //  fprintf (stderr, "raspictl*: %g = %g %u %g\n", result, leftop, scn, riteop);
+            //  fprintf (errfile, "raspictl*: %g = %g %u %g\n", result, leftop, scn, riteop);
             //  dumpregs ();
             //}
             writememdoub (readmemword (data + 2), result);
@@ -809,9 +2502,9 @@ static void mw_syscall (uint32_t sample, uint16_t data)
                 case 'Q': value = (double) (uint64_t) readmemquad (r1); break;
                 case 'f': value = (double)            readmemflt  (r1); break;
                 case 'd': value = (double)            readmemdoub (r1); break;
-                default: fprintf (stderr, "raspictl: invalid SCN_CVT_FP from %c\n", r2 & 0xFF);
+                default: fprintf (errfile, "raspictl: invalid SCN_CVT_FP from %c\n", r2 & 0xFF);
             }
-            //fprintf (stderr, "raspictl SCN_CVT_FP*: %c %g %c\n", r2 & 0xFF, value, r2 >> 8);
+            //fprintf (errfile, "raspictl SCN_CVT_FP*: %c %g %c\n", r2 & 0xFF, value, r2 >> 8);
             switch (r2 >> 8) {
                 case 'b': r0 = (sint16_t) (sint8_t) value; break;
                 case 'B': r0 = (uint16_t) (uint8_t) value; break;
@@ -824,7 +2517,7 @@ static void mw_syscall (uint32_t sample, uint16_t data)
                 case 'f': writememflt  (r0, (float)    value); break;
                 case 'd': writememdoub (r0, (double)   value); break;
                 case 'z': r0 = (value != 0.0);
-                default: fprintf (stderr, "raspictl: invalid SCN_CVT_FP to %c\n", r2 >> 8);
+                default: fprintf (errfile, "raspictl: invalid SCN_CVT_FP to %c\n", r2 >> 8);
             }
             mr_syscall_rc = r0;
             break;
@@ -860,20 +2553,153 @@ static void mw_syscall (uint32_t sample, uint16_t data)
             break;
         }
 
+        // long/quad integer functions
+        // divide by zero gives all ones quotient and dividend remainder same as software
+        //  .word   uint16_t SCN_xxx_LLL
+        //  .word   uint32_t *resultaddr
+        //  .word   uint32_t *leftopaddr
+        //  .word   uint32_t *riteopaddr
+        case SCN_MUL_LLL:
+        case SCN_DIV_LLL:
+        case SCN_MOD_LLL: {
+            uint32_t leftop = readmemlong (readmemword (data + 4));
+            uint32_t riteop = readmemlong (readmemword (data + 6));
+            uint32_t result;
+            switch (scn) {
+                case SCN_MUL_LLL: result = leftop * riteop; break;
+                case SCN_DIV_LLL: result = (riteop == 0) ? 0xFFFFFFFFU : leftop / riteop; break;
+                case SCN_MOD_LLL: result = (riteop == 0) ? leftop : leftop % riteop; break;
+                default: abort ();
+            }
+            writememlong (readmemword (data + 2), result);
+            break;
+        }
+
+        //  .word   uint16_t SCN_xxx_QQx
+        //  .word   uint64_t *resultaddr
+        //  .word   uint64_t *leftopaddr
+        //  .word   uint32_t or uint64_t *riteopaddr
+        case SCN_DIV_QQL:
+        case SCN_DIV_QQQ:
+        case SCN_MOD_QQQ: {
+            uint64_t leftop = readmemquad (readmemword (data + 4));
+            uint64_t riteop = (scn == SCN_DIV_QQL) ? readmemlong (readmemword (data + 6)) : readmemquad (readmemword (data + 6));
+            uint64_t result;
+            if (scn == SCN_MOD_QQQ) {
+                result = (riteop == 0) ? leftop : leftop % riteop;
+            } else {
+                result = (riteop == 0) ? 0xFFFFFFFFFFFFFFFFULL : leftop / riteop;
+            }
+            writememquad (readmemword (data + 2), result);
+            break;
+        }
+
+        //  .word   uint16_t SCN_MOD_WQW
+        //  .word   unused
+        //  .word   uint64_t *leftopaddr
+        //  .word   uint16_t riteop
+        //  returns remainder
+        case SCN_MOD_WQW: {
+            uint64_t leftop = readmemquad (readmemword (data + 4));
+            uint16_t riteop = readmemword (data + 6);
+            mr_syscall_rc = (riteop == 0) ? (uint16_t) leftop : leftop % riteop;
+            break;
+        }
+
+        //  .word   uint16_t SCN_xxx_LLW
+        //  .word   uint32_t *resultaddr
+        //  .word   uint32_t *operandaddr
+        //  .word   uint16_t shiftcount
+        case SCN_SHL_LLW:
+        case SCN_SHR_LLW:
+        case SCN_ASR_LLW: {
+            uint32_t operand = readmemlong (readmemword (data + 4));
+            uint16_t count   = readmemword (data + 6) & 31;
+            uint32_t result;
+            switch (scn) {
+                case SCN_SHL_LLW: result = operand << count; break;
+                case SCN_SHR_LLW: result = operand >> count; break;
+                case SCN_ASR_LLW: result = (sint32_t) operand >> count; break;
+                default: abort ();
+            }
+            writememlong (readmemword (data + 2), result);
+            break;
+        }
+
+        //  .word   uint16_t SCN_xxx_QQW
+        //  .word   uint64_t *resultaddr
+        //  .word   uint64_t *operandaddr
+        //  .word   uint16_t shiftcount
+        case SCN_SHL_QQW:
+        case SCN_SHR_QQW:
+        case SCN_ASR_QQW: {
+            uint64_t operand = readmemquad (readmemword (data + 4));
+            uint16_t count   = readmemword (data + 6) & 63;
+            uint64_t result;
+            switch (scn) {
+                case SCN_SHL_QQW: result = operand << count; break;
+                case SCN_SHR_QQW: result = operand >> count; break;
+                case SCN_ASR_QQW: result = (sint64_t) operand >> count; break;
+                default: abort ();
+            }
+            writememquad (readmemword (data + 2), result);
+            break;
+        }
+
+        //  .word   uint16_t SCN_CMP_QQ
+        //  .word   uint16_t branchcode (0=blt, 4=blo, 8=bge, 12=bhis, 16=ble, 20=blos, 24=bgt, 28=bhi, 32/36=beq, 40/44=bne)
+        //  .word   uint64_t *leftopaddr
+        //  .word   uint64_t *riteopaddr
+        //  returns 0 if branch would be taken, 1 if not
+        case SCN_CMP_QQ: {
+            uint16_t code  = readmemword (data + 2);
+            uint64_t uleft = readmemquad (readmemword (data + 4));
+            uint64_t urite = readmemquad (readmemword (data + 6));
+            sint64_t sleft = uleft;
+            sint64_t srite = urite;
+            bool taken = false;
+            switch (code >> 2) {
+                case  0: taken = sleft <  srite; break;
+                case  1: taken = uleft <  urite; break;
+                case  2: taken = sleft >= srite; break;
+                case  3: taken = uleft >= urite; break;
+                case  4: taken = sleft <= srite; break;
+                case  5: taken = uleft <= urite; break;
+                case  6: taken = sleft >  srite; break;
+                case  7: taken = uleft >  urite; break;
+                case  8:
+                case  9: taken = uleft == urite; break;
+                case 10:
+                case 11: taken = uleft != urite; break;
+                default: fprintf (errfile, "raspictl: invalid SCN_CMP_QQ code %u\n", code);
+            }
+            mr_syscall_rc = ! taken;
+            break;
+        }
+
         case SCN_SETROSIZE: {
             readonlysize = readmemword (data + 2);
+            if (fastxlat != NULL) fastxlat->setrosize (readonlysize);
+
+            // start code calls it after setting up the stack, so image's stack limit can take effect now
+            if ((imgfile != NULL) && (stacklimit < imghdr->stklim) && (getregs ()[6] != 0)) {
+                stacklimit = imghdr->stklim;
+                if (fastcpu != NULL) fastcpu->stacklimit = stacklimit;
+            }
             mr_syscall_rc = 0;
             break;
         }
 
         case SCN_SETSTKLIM: {
             stacklimit = readmemword (data + 2);
+            if (fastcpu != NULL) fastcpu->stacklimit = stacklimit;
             mr_syscall_rc = 0;
             break;
         }
 
         case SCN_PRINTINSTR: {
             shadow.printinstr = (readmemword (data + 2) & 1) != 0;
+            if (fastcpu != NULL) fastcpu->printinstr = shadow.printinstr;
             mr_syscall_rc = 0;
             break;
         }
@@ -895,8 +2721,214 @@ static void mw_syscall (uint32_t sample, uint16_t data)
             break;
         }
 
+        // math library functions
+        //  .word   SCN_xxx_DD(D)
+        //  .word   result
+        //  .word   operand
+        //  .word   operand (pow, atan2 only)
+        case SCN_SIN_DD:
+        case SCN_COS_DD:
+        case SCN_TAN_DD:
+        case SCN_EXP_DD:
+        case SCN_LOG_DD:
+        case SCN_SQRT_DD:
+        case SCN_POW_DDD:
+        case SCN_ATAN2_DDD: {
+            double x = readmemdoub (readmemword (data + 4));
+            double y = 0.0;
+            if ((scn == SCN_POW_DDD) || (scn == SCN_ATAN2_DDD)) y = readmemdoub (readmemword (data + 6));
+            double r;
+            switch (scn) {
+                case SCN_SIN_DD:    r = sin   (x);    break;
+                case SCN_COS_DD:    r = cos   (x);    break;
+                case SCN_TAN_DD:    r = tan   (x);    break;
+                case SCN_EXP_DD:    r = exp   (x);    break;
+                case SCN_LOG_DD:    r = log   (x);    break;
+                case SCN_SQRT_DD:   r = sqrt  (x);    break;
+                case SCN_POW_DDD:   r = pow   (x, y); break;
+                case SCN_ATAN2_DDD: r = atan2 (x, y); break;
+                default: abort ();
+            }
+            writememdoub (readmemword (data + 2), r);
+            mr_syscall_rc = 0;
+            break;
+        }
+
+        case SCN_SIN_FF:
+        case SCN_COS_FF:
+        case SCN_TAN_FF:
+        case SCN_EXP_FF:
+        case SCN_LOG_FF:
+        case SCN_SQRT_FF:
+        case SCN_POW_FFF:
+        case SCN_ATAN2_FFF: {
+            float x = readmemflt (readmemword (data + 4));
+            float y = 0.0F;
+            if ((scn == SCN_POW_FFF) || (scn == SCN_ATAN2_FFF)) y = readmemflt (readmemword (data + 6));
+            float r;
+            switch (scn) {
+                case SCN_SIN_FF:    r = sinf   (x);    break;
+                case SCN_COS_FF:    r = cosf   (x);    break;
+                case SCN_TAN_FF:    r = tanf   (x);    break;
+                case SCN_EXP_FF:    r = expf   (x);    break;
+                case SCN_LOG_FF:    r = logf   (x);    break;
+                case SCN_SQRT_FF:   r = sqrtf  (x);    break;
+                case SCN_POW_FFF:   r = powf   (x, y); break;
+                case SCN_ATAN2_FFF: r = atan2f (x, y); break;
+                default: abort ();
+            }
+            writememflt (readmemword (data + 2), r);
+            mr_syscall_rc = 0;
+            break;
+        }
+
+        // format printf-style string with hode int, long, pointer sizes
+        //  .word   SCN_VFORMAT
+        //  .word   format string
+        //  .word   va_list, ie, address of first argument
+        //  .word   output buffer
+        //  .word   output buffer size
+        // returns:
+        //   -1 : can't do it, use software formatting
+        //  else: total length of formatted string (no null), only first buffer-size chars are stored
+        case SCN_VFORMAT: {
+            uint16_t size = readmemword (data + 8);
+            uint16_t buf  = readmemword (data + 6);
+            VFormat vf;
+            vf.getmemptr = vfgetmemptr;
+            vf.getmemstr = vfgetmemstr;
+            vf.memparam  = this;
+            vf.ap   = readmemword (data + 4);
+            if (! vf.format (readmemword (data + 2)) || (vf.out.size () > 0x7FFF)) {
+                mr_syscall_rc = -1;
+                break;
+            }
+            uint16_t len = vf.out.size ();
+            if (size > len) size = len;
+            if (size > 0) {
+                void *bufptr = getmemptr (buf, size, true);
+                if (bufptr == NULL) break;
+                memcpy (bufptr, vf.out.data (), size);
+            }
+            chargememcycles (len);
+            mr_syscall_rc = len;
+            break;
+        }
+
+        // map hode memory window to host file
+        // cpu and syscall reads and writes of the window go directly to the file
+        //  .word   SCN_MAPWIN
+        //  .word   fd
+        //  .word   window address (multiple of host page size)
+        //  .word   window size (multiple of host page size, max MAPWIN_MAXSIZE, 0 to unmap)
+        //  .quad   file offset (multiple of host page size)
+        // returns:
+        //   -1 : error (EINVAL if window overlaps read-only memory or another window)
+        //  else: number of window bytes before end-of-file
+        // file opened read-only is mapped copy-on-write, writes to the window are discarded
+        // writes beyond end-of-file are discarded, so extend the file with write() first
+        // memory contents are put back when the window is unmapped
+        case SCN_MAPWIN: {
+            int fd = (int)(sint16_t) readmemword (data + 2);
+            uint16_t addr = readmemword (data + 4);
+            uint16_t size = readmemword (data + 6);
+            uint64_t offset = readmemquad (data + 8);
+            uint32_t pagesize = sysconf (_SC_PAGESIZE);
+            mr_syscall_rc = -1;
+
+            if (size == 0) {
+                if (mapwins.count (addr) == 0) {
+                    errno = EINVAL;
+                    save_errno ();
+                    break;
+                }
+                mapwinunmap (addr);
+                mr_syscall_rc = 0;
+                break;
+            }
+
+            // must be page aligned and below the magic page as ERRNO is in memory
+            // ...and above the read-only code and data so the program can't write over them through the file
+            if ((addr % pagesize != 0) || (size % pagesize != 0) || (offset % pagesize != 0) ||
+                    (size > MAPWIN_MAXSIZE) || ((uint32_t) addr + size > (MAGIC & - pagesize)) ||
+                    (addr < readonlysize)) {
+                errno = EINVAL;
+                save_errno ();
+                break;
+            }
+            for (std::map<uint16_t,MapWin>::iterator it = mapwins.begin (); it != mapwins.end (); it ++) {
+                if ((addr < it->first + it->second.size) && (it->first < addr + size)) {
+                    errno = EINVAL;
+                    save_errno ();
+                    goto mapwindone;
+                }
+            }
+            {
+                int flags = fcntl (hostfd (fd), F_GETFL);
+                if (flags < 0) {
+                    save_errno ();
+                    break;
+                }
+                if ((flags & O_ACCMODE) == O_WRONLY) {
+                    errno = EACCES;
+                    save_errno ();
+                    break;
+                }
+                MapWin mw;
+                mw.fd = dup (hostfd (fd));
+                if (mw.fd < 0) {
+                    save_errno ();
+                    break;
+                }
+                mw.shared = (flags & O_ACCMODE) == O_RDWR;
+                mw.size   = size;
+                mw.offset = offset;
+                mw.saved.assign (memory + addr, memory + addr + size);
+                int rc = mapwinmap (addr, &mw);
+                if (rc < 0) {
+                    save_errno ();
+                    close (mw.fd);
+                    break;
+                }
+                mapwins[addr] = mw;
+                mr_syscall_rc = rc;
+            }
+        mapwindone:;
+            break;
+        }
+
+        // write modified window contents to file and move window to another file offset
+        //  .word   SCN_MAPSYNC
+        //  .word   window address
+        //  .quad   new file offset (multiple of host page size)
+        // returns:
+        //   -1 : error
+        //  else: number of window bytes before end-of-file
+        case SCN_MAPSYNC: {
+            uint16_t addr = readmemword (data + 2);
+            uint64_t offset = readmemquad (data + 4);
+            mr_syscall_rc = -1;
+            std::map<uint16_t,MapWin>::iterator it = mapwins.find (addr);
+            if ((it == mapwins.end ()) || (offset % sysconf (_SC_PAGESIZE) != 0)) {
+                errno = EINVAL;
+                save_errno ();
+                break;
+            }
+            MapWin *mw = &it->second;
+            if (mw->shared && (msync (memory + addr, mw->size, MS_SYNC) < 0)) {
+                save_errno ();
+                break;
+            }
+            mw->offset = offset;
+            int rc = mapwinmap (addr, mw);
+            if (rc < 0) save_errno ();
+            mr_syscall_rc = rc;
+            break;
+        }
+
         case SCN_WATCHWRITE: {
             watchwrite = readmemword (data + 2);
+            if (fastxlat != NULL) fastxlat->setwatch (watchwrite);
             mr_syscall_rc = 0;
             break;
         }
@@ -917,6 +2949,7 @@ static void mw_syscall (uint32_t sample, uint16_t data)
                 if (bufsize > 0) {
                     if (envlen > bufsize) envlen = bufsize;
                     void *bufaddr = getmemptr (readmemword (data + 2), envlen, true);
+                    if (bufaddr == NULL) break;
                     memcpy (bufaddr, envstr, envlen);
                 }
             }
@@ -932,7 +2965,7 @@ static void mw_syscall (uint32_t sample, uint16_t data)
             int  fd = (int)(sint16_t) readmemword (data + 2);
             bool echo = readmemword (data + 4) != 0;
             if (savedtermioss.count (fd) == 0) {
-                if (tcgetattr (fd, &ttyattrs) < 0) {
+                if (tcgetattr (hostfd (fd), &ttyattrs) < 0) {
                     mr_syscall_rc = -1;
                     save_errno ();
                     break;
@@ -948,7 +2981,7 @@ static void mw_syscall (uint32_t sample, uint16_t data)
                     ttyattrs.c_lflag |= ISIG;   // still handle ^C, ^Z
                 }
             }
-            if (tcsetattr (fd, TCSANOW, &ttyattrs) < 0) {
+            if (tcsetattr (hostfd (fd), TCSANOW, &ttyattrs) < 0) {
                 mr_syscall_rc = -2;
                 save_errno ();
                 break;
@@ -961,25 +2994,26 @@ static void mw_syscall (uint32_t sample, uint16_t data)
             mr_syscall_rc = -1;
             errno = -ENOSYS;
             save_errno ();
-            fprintf (stderr, "raspictl: unknown syscall %u\n", scn);
+            fprintf (errfile, "raspictl: unknown syscall %u\n", scn);
             break;
         }
     }
 }
 
-static uint16_t mr_syscall (uint32_t sample)
+uint16_t Machine::mr_syscall (uint32_t sample)
 {
     return mr_syscall_rc;
 }
 
-static void save_errno ()
+void Machine::save_errno ()
 {
     *(uint16_t *)(memory + ERRNO) = errno;
 }
 
 // runs in background to print cycle rate at beginning of every minute for testing
-static void *mintimesthread (void *dummy)
+void *Machine::mintimesthread (void *param)
 {
+    Machine *mach = (Machine *) param;
     pthread_cond_t cond;
     pthread_mutex_t lock;
     struct timespec nowts, waits;
@@ -989,7 +3023,7 @@ static void *mintimesthread (void *dummy)
     pthread_mutex_lock (&lock);
 
     if (clock_gettime (CLOCK_REALTIME, &nowts) < 0) abort ();
-    uint64_t lastcycs = shadow.getcycles ();
+    uint64_t lastcycs = mach->getcycles ();
     uint32_t lastsecs = nowts.tv_sec;
 
     waits.tv_nsec = 0;
@@ -1001,7 +3035,7 @@ static void *mintimesthread (void *dummy)
         while (rc == 0);
         if (rc != ETIMEDOUT) abort ();
         if (clock_gettime (CLOCK_REALTIME, &nowts) < 0) abort ();
-        uint64_t cycs = shadow.getcycles ();
+        uint64_t cycs = mach->getcycles ();
         uint32_t secs = nowts.tv_sec;
         fprintf (stderr, "raspictl: %02d:%02d:%02d  %12llu cycles  avg %6llu Hz  %6.3f uS\n",
                     secs / 3600 % 24, secs / 60 % 60, secs % 60,
@@ -1009,7 +3043,7 @@ static void *mintimesthread (void *dummy)
                     (secs - lastsecs) * 1000000.0 / (cycs - lastcycs));
         FILE *profile = fopen ("raspictl.readcounts", "w");
         if (profile != NULL) {
-            fwrite (readcounts, sizeof readcounts, 1, profile);
+            fwrite (mach->readcounts, sizeof mach->readcounts, 1, profile);
             fclose (profile);
         }
         lastcycs = cycs;
@@ -1018,36 +3052,311 @@ static void *mintimesthread (void *dummy)
     return NULL;
 }
 
+// -stats: create the /dev/shm segment and fill in the header
+// hodetop ignores it until magic is filled in
+static bool openstats (char const *statsname, uint32_t cpuhz)
+{
+    ASSERT (HS_NSTATES == Shadow::IREQ5 + 1);
+
+    std::string shmname = (statsname[0] == '/') ? statsname : std::string ("/") + statsname;
+    int shmfd = shm_open (shmname.c_str (), O_RDWR | O_CREAT, 0644);
+    if (shmfd < 0) {
+        fprintf (stderr, "raspictl: error creating /dev/shm%s: %m\n", shmname.c_str ());
+        return false;
+    }
+
+    // truncate to zero first so counts left over from a previous run are cleared
+    if ((ftruncate (shmfd, 0) < 0) || (ftruncate (shmfd, sizeof *hodestats) < 0)) {
+        fprintf (stderr, "raspictl: error sizing /dev/shm%s: %m\n", shmname.c_str ());
+        close (shmfd);
+        return false;
+    }
+    void *ptr = mmap (NULL, sizeof *hodestats, PROT_READ | PROT_WRITE, MAP_SHARED, shmfd, 0);
+    if (ptr == MAP_FAILED) {
+        fprintf (stderr, "raspictl: error mapping /dev/shm%s: %m\n", shmname.c_str ());
+        close (shmfd);
+        return false;
+    }
+    close (shmfd);
+
+    hodestats = (HodeStats *) ptr;
+    hodestats->version = HODESTATS_VERSION;
+    hodestats->size    = sizeof *hodestats;
+    hodestats->pid     = getpid ();
+    hodestats->cpuhz   = cpuhz;
+    hodestats->startns = nowns ();
+    __atomic_store_n (&hodestats->magic, HODESTATS_MAGIC, __ATOMIC_RELEASE);
+    return true;
+}
+
+// -stats: periodically copy counts the cpu keeps for itself to the /dev/shm segment
+void *Machine::statsthread (void *param)
+{
+    Machine *mach = (Machine *) param;
+    while (true) {
+        usleep (STATSUS);
+        mach->updatestats (true);
+    }
+    return NULL;
+}
+
+//  input:
+//   rate = update hz from counts since last update
+void Machine::updatestats (bool rate)
+{
+    uint64_t now    = nowns ();
+    uint64_t cycles = getcycles ();
+    uint64_t lastns = hsget (&hodestats->updatens);
+    if (rate && (lastns != 0) && (now > lastns)) {
+        hsset (&hodestats->hz, (cycles - hsget (&hodestats->cycles)) * 1000000000ULL / (now - lastns));
+    }
+    hsset (&hodestats->cycles, cycles);
+    hsset (&hodestats->insts, getinsts ());
+    if (fastcpu != NULL) hsset (&hodestats->irqs, fastcpu->getirqs ());
+    hsset (&hodestats->updatens, now);
+}
+
+static uint64_t nowns ()
+{
+    struct timespec nowts;
+    if (clock_gettime (CLOCK_REALTIME, &nowts) < 0) abort ();
+    return nowts.tv_sec * 1000000000ULL + nowts.tv_nsec;
+}
+
+
+// -virtualtime clock starts at 2020-01-01 00:00:00 UTC and advances virtualhz cycles per second
+#define VIRTUALBASENS 1577836800000000000ULL
+
+// get -virtualtime CLOCK_REALTIME equivalent from cycle count
+uint64_t Machine::virtualnowns ()
+{
+    uint64_t cycles = fastcpu->getcycles ();
+    return VIRTUALBASENS + cycles / virtualhz * 1000000000ULL + cycles % virtualhz * 1000000000ULL / virtualhz;
+}
+
+// set time line clock interrupts at, starting irqthread if not already running
+// with -virtualtime, fastcpu->run() stops at the corresponding cycle instead
+//  input:
+//   irqatns = CLOCK_REALTIME to interrupt at or 0 to stop
+void Machine::setirqatns (uint64_t irqatns)
+{
+    if (virtualtime) {
+        __atomic_fetch_and (&intreqreg, ~ IRQ_LINECLOCK, __ATOMIC_SEQ_CST);
+        lineclockns = irqatns;
+        lineclockcycle = -1ULL;
+        if (irqatns != 0) {
+
+            // first cycle at or after the given time
+            uint64_t ns = (irqatns > VIRTUALBASENS) ? irqatns - VIRTUALBASENS : 0;
+            lineclockcycle = ns / 1000000000 * virtualhz + (ns % 1000000000 * virtualhz + 999999999) / 1000000000;
+        }
+        setstopcycle ();
+        return;
+    }
+
+    // new deadline goes in before clearing the request
+    // ...so a tick for the old deadline that lineclocktick() is still processing doesn't get posted
+    irqinit ();
+    __atomic_store_n (&lineclockns, irqatns, __ATOMIC_SEQ_CST);
+    __atomic_fetch_and (&intreqreg, ~ IRQ_LINECLOCK, __ATOMIC_SEQ_CST);
+
+    // one-shot timer, re-armed by the program's next SCN_IRQATNS
+    struct itimerspec its;
+    memset (&its, 0, sizeof its);
+    its.it_value.tv_sec  = irqatns / 1000000000;
+    its.it_value.tv_nsec = irqatns % 1000000000;
+    if (timerfd_settime (lineclockfd, TFD_TIMER_ABSTIME, &its, NULL) < 0) abort ();
+    if (irqatns != 0) startirqthread ();
+}
+
+// line clock timerfd is readable, post interrupt request if deadline reached
+// called by irqthread when cpu is running and by waitforintreq() when halted, whichever reads the timerfd first posts it
+void Machine::lineclocktick ()
+{
+    uint64_t expirations;
+    if (read (lineclockfd, &expirations, sizeof expirations) < 0) {
+        if (errno != EAGAIN) abort ();
+        return;
+    }
+    uint64_t deadline = __atomic_load_n (&lineclockns, __ATOMIC_SEQ_CST);
+    if (deadline == 0) return;
+    struct timespec nowts;
+    if (clock_gettime (CLOCK_REALTIME, &nowts) < 0) abort ();
+    if (nowts.tv_sec * 1000000000ULL + nowts.tv_nsec >= deadline) postintreq (IRQ_LINECLOCK);
+}
 
-// runs in background to post interrupt request whenever lineclockabs time is reached
-// exits when woken with lineclockabs.tv == 0
-static void *lineclockthread (void *dummy)
+// queue read() or write() for irqthread, starting it if not already running
+//  input:
+//   write = false: read(); true: write()
+//   fd = host fd
+//   buf,len = buffer in hode memory
+//  output:
+//   returns -1: failed, errno saved
+//         else: tag for asyncawait()
+int Machine::asyncstart (bool write, int fd, void *buf, uint16_t len)
 {
-    pthread_mutex_lock (&intreqlock);
-    while (lineclockabs.tv_sec != 0) {
+    if (fd < 0) {
+        errno = EBADF;
+        save_errno ();
+        return -1;
+    }
 
-        // if already requsting an interrupt,
-        //  block until SCN_LINECLOCK is called
-        // else,
-        //  block until the given time is reached or SCN_LINECLOCK is called
-        int rc = (intreqreg & IRQ_LINECLOCK) ?
-                pthread_cond_wait (&lineclockcond, &intreqlock) :
-                pthread_cond_timedwait (&lineclockcond, &intreqlock, &lineclockabs);
+    irqinit ();
+    pthread_mutex_lock (&asynclock);
+    int tag;
+    for (tag = 0; tag < ASYNC_MAX; tag ++) {
+        if (asyncreqs[tag].state == ASYNC_FREE) break;
+    }
+    if (tag >= ASYNC_MAX) {
+        pthread_mutex_unlock (&asynclock);
+        errno = EAGAIN;
+        save_errno ();
+        return -1;
+    }
+    AsyncReq *req = &asyncreqs[tag];
+    req->state = ASYNC_QUEUED;
+    req->write = write;
+    req->fd    = fd;
+    req->buf   = buf;
+    req->len   = len;
+    req->seq   = asyncseq ++;
+    asyncpending ++;
+    pthread_mutex_unlock (&asynclock);
+    startirqthread ();
+
+    // wake irqthread so it polls the new request's fd
+    if (::write (irqpipe[1], "", 1) < 0) abort ();
+    return tag;
+}
 
-        // if reached the requested time, post an interrupt request
-        if (rc != 0) {
-            if (rc != ETIMEDOUT) abort ();
-            intreqreg |= IRQ_LINECLOCK;
-            pthread_cond_signal (&intreqcond);
+// get result of request started by asyncstart()
+//  input:
+//   tag = as returned by asyncstart()
+//   wait = false: return EAGAIN if not complete; true: wait for it
+//  output:
+//   returns read() or write() return value, errno saved if failed
+int Machine::asyncawait (int tag, bool wait)
+{
+    pthread_mutex_lock (&asynclock);
+    if ((tag < 0) || (tag >= ASYNC_MAX) || (asyncreqs[tag].state == ASYNC_FREE)) {
+        pthread_mutex_unlock (&asynclock);
+        errno = EINVAL;
+        save_errno ();
+        return -1;
+    }
+    AsyncReq *req = &asyncreqs[tag];
+    while (req->state != ASYNC_DONE) {
+        if (! wait) {
+            pthread_mutex_unlock (&asynclock);
+            errno = EAGAIN;
+            save_errno ();
+            return -1;
         }
+        pthread_cond_wait (&asynccond, &asynclock);
+    }
+    int rc = req->rc;
+    if (rc < 0) {
+        errno = req->err;
+        save_errno ();
+    }
+    req->state = ASYNC_FREE;
+
+    // stop requesting interrupt if that was the last one completed
+    int i;
+    for (i = 0; i < ASYNC_MAX; i ++) {
+        if (asyncreqs[i].state == ASYNC_DONE) break;
+    }
+    if (i >= ASYNC_MAX) __atomic_fetch_and (&intreqreg, ~ IRQ_ASYNCIO, __ATOMIC_SEQ_CST);
+    pthread_mutex_unlock (&asynclock);
+    return rc;
+}
+
+// start irqthread if not already running
+// it runs until the machine is torn down
+void Machine::startirqthread ()
+{
+    pthread_mutex_lock (&asynclock);
+    if (! irqrun) {
+        if (pipe (irqpipe) < 0) abort ();
+        irqrun = true;
+        if (! batchmode) rdcycuninit ();
+        int rc = pthread_create (&irqpid, NULL, irqthread, this);
+        if (rc != 0) abort ();
+        if (! batchmode) rdcycinit ();
     }
+    pthread_mutex_unlock (&asynclock);
+}
 
-    // SCN_LINECLOCK was passed a zero, so exit
-    lineclockrun = false;
-    pthread_mutex_unlock (&intreqlock);
+// runs in background to post line clock ticks and do SCN_AREAD/SCN_AWRITE requests
+// polls the oldest queued request on each fd so a read waiting for a terminal doesn't hold up writes to another fd
+// posts IRQ_LINECLOCK when the timerfd expires and IRQ_ASYNCIO as each request completes
+void *Machine::irqthread (void *param)
+{
+    Machine *mach = (Machine *) param;
+    mach->irqloop ();
     return NULL;
 }
 
+void Machine::irqloop ()
+{
+    pthread_mutex_lock (&asynclock);
+    while (irqrun) {
+        struct pollfd pfds[ASYNC_MAX+2];
+        int tags[ASYNC_MAX+2];
+        pfds[0].fd = irqpipe[0];
+        pfds[0].events = POLLIN;
+        pfds[1].fd = lineclockfd;
+        pfds[1].events = POLLIN;
+        int npfds = 2;
+        for (int i = 0; i < ASYNC_MAX; i ++) {
+            AsyncReq *req = &asyncreqs[i];
+            if (req->state != ASYNC_QUEUED) continue;
+            int j;
+            for (j = 0; j < ASYNC_MAX; j ++) {
+                AsyncReq *older = &asyncreqs[j];
+                if ((older->state == ASYNC_QUEUED) && (older->fd == req->fd) && ((int32_t) (older->seq - req->seq) < 0)) break;
+            }
+            if (j < ASYNC_MAX) continue;
+            pfds[npfds].fd = req->fd;
+            pfds[npfds].events = req->write ? POLLOUT : POLLIN;
+            tags[npfds++] = i;
+        }
+        pthread_mutex_unlock (&asynclock);
+
+        if (poll (pfds, npfds, -1) < 0) {
+            if (errno != EINTR) abort ();
+            pfds[0].revents = 0;
+            pfds[1].revents = 0;
+            npfds = 2;
+        }
+        if (pfds[0].revents != 0) {
+            char buf[16];
+            if (read (irqpipe[0], buf, sizeof buf) < 0) abort ();
+        }
+        if (pfds[1].revents != 0) lineclocktick ();
+
+        // do the read() or write() on each fd that is ready
+        // ...or has an error or hangup so read() or write() will return that
+        pthread_mutex_lock (&asynclock);
+        for (int k = 2; k < npfds; k ++) {
+            if (pfds[k].revents == 0) continue;
+            AsyncReq *req = &asyncreqs[tags[k]];
+            req->state = ASYNC_BUSY;
+            pthread_mutex_unlock (&asynclock);
+            int rc = req->write ? ::write (req->fd, req->buf, req->len) : read (req->fd, req->buf, req->len);
+            int err = errno;
+            pthread_mutex_lock (&asynclock);
+            req->rc    = rc;
+            req->err   = err;
+            req->state = ASYNC_DONE;
+            asyncpending --;
+            postintreq (IRQ_ASYNCIO);
+            pthread_cond_broadcast (&asynccond);
+        }
+    }
+    pthread_mutex_unlock (&asynclock);
+}
+
 // send data byte/word to CPU in response to a MEM_READ cycle
 // we are half way through the cycle after the CPU asserted MEM_READ with clock still high
 // we must send the data to the cpu with time to let it soak in before raising clock again
@@ -1064,7 +3373,7 @@ static void *lineclockthread (void *dummy)
 //  we wait a half cycle whilst the data soaks into the instruction register latch and instruction decoding circuitry
 //  we raise the clock leaving the data going to the cpu so it will get clocked in correctly
 //  we wait a half cycle whilst cpu is closing the instruction register latch and transitioning to first state of the instruction
-static void senddata (uint16_t data)
+void Machine::senddata (uint16_t data)
 {
     // drop the clock and start sending data to cpu
     gpio->writegpio (true, (data * G_DATA0) | syncintreq);
@@ -1099,7 +3408,7 @@ static void senddata (uint16_t data)
 //  we wait a half cycle for the cpu to finish sending the data
 //  it is now tge very end of the STORE2 cycle
 //  we read the data from the gpio pins
-static uint16_t recvdata (void)
+uint16_t Machine::recvdata (void)
 {
     uint32_t sample;
 
@@ -1118,109 +3427,193 @@ static uint16_t recvdata (void)
     return sample / G_DATA0;
 }
 
+// map file window into memory at mw->offset
+//  returns -1: error, errno set
+//        else: number of bytes before end-of-file
+// pages beyond end-of-file are mapped as zeroes as accessing them would SIGBUS
+int Machine::mapwinmap (uint16_t addr, MapWin *mw)
+{
+    struct stat statbuf;
+    if (fstat (mw->fd, &statbuf) < 0) return -1;
+
+    uint32_t pagesize = sysconf (_SC_PAGESIZE);
+    uint32_t filebytes = mw->size;
+    uint32_t mapbytes  = mw->size;
+    if ((uint64_t) statbuf.st_size <= mw->offset) {
+        filebytes = mapbytes = 0;
+    } else if ((uint64_t) statbuf.st_size - mw->offset < mw->size) {
+        filebytes = statbuf.st_size - mw->offset;
+        mapbytes  = (filebytes + pagesize - 1) & - pagesize;
+    }
+
+    if ((mapbytes > 0) && (mmap (memory + addr, mapbytes, PROT_READ | PROT_WRITE,
+            (mw->shared ? MAP_SHARED : MAP_PRIVATE) | MAP_FIXED, mw->fd, mw->offset) == MAP_FAILED)) return -1;
+    if ((mapbytes < mw->size) && (mmap (memory + addr + mapbytes, mw->size - mapbytes, PROT_READ | PROT_WRITE,
+            MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED)) return -1;
+
+    // translated code might have been in the window
+    if (fastxlat != NULL) fastxlat->invalidate (addr, mw->size);
+    return filebytes;
+}
+
+// write window out to file and put original memory contents back
+void Machine::mapwinunmap (uint16_t addr)
+{
+    MapWin *mw = &mapwins[addr];
+    if (mw->shared && (msync (memory + addr, mw->size, MS_SYNC) < 0)) {
+        fprintf (errfile, "raspictl: error writing file window %04X: %m\n", addr);
+    }
+    if (mmap (memory + addr, mw->size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) == MAP_FAILED) abort ();
+    memcpy (memory + addr, mw->saved.data (), mw->size);
+    if (fastxlat != NULL) fastxlat->invalidate (addr, mw->size);
+    close (mw->fd);
+    mapwins.erase (addr);
+}
+
 // read memory with bounds checking
-static uint16_t readmemword (uint32_t addr)
+uint8_t Machine::readmembyte (uint32_t addr)
+{
+    uint8_t const *ptr = (uint8_t const *) getmemptr (addr, 1, false);
+    return (ptr == NULL) ? 0 : *ptr;
+}
+
+uint16_t Machine::readmemword (uint32_t addr)
 {
     if (addr + 2 > MAGIC) {
-        fprintf (stderr, "raspictl: bad readmemword %08X\n", addr);
+        fprintf (errfile, "raspictl: bad readmemword %08X\n", addr);
         return 0;
     }
     return *(uint16_t *)(memory + addr);
 }
 
-static uint32_t readmemlong (uint32_t addr)
+uint32_t Machine::readmemlong (uint32_t addr)
 {
     uint32_t val;
     void *ptr = getmemptr (addr, sizeof val, false);
+    if (ptr == NULL) return 0;
     memcpy (&val, ptr, sizeof val);
     return val;
 }
 
-static uint64_t readmemquad (uint32_t addr)
+uint64_t Machine::readmemquad (uint32_t addr)
 {
     uint64_t val;
     void *ptr = getmemptr (addr, sizeof val, false);
+    if (ptr == NULL) return 0;
     memcpy (&val, ptr, sizeof val);
     return val;
 }
 
-static double readmemdoub (uint32_t addr)
+double Machine::readmemdoub (uint32_t addr)
 {
     double val;
     void *ptr = getmemptr (addr, sizeof val, false);
+    if (ptr == NULL) return 0;
     memcpy (&val, ptr, sizeof val);
     return val;
 }
 
-static float readmemflt (uint32_t addr)
+float Machine::readmemflt (uint32_t addr)
 {
     float val;
     void *ptr = getmemptr (addr, sizeof val, false);
+    if (ptr == NULL) return 0;
     memcpy (&val, ptr, sizeof val);
     return val;
 }
 
-static void writememlong (uint32_t addr, uint32_t val)
+void Machine::writememlong (uint32_t addr, uint32_t val)
 {
     void *ptr = getmemptr (addr, sizeof val, true);
-    memcpy (ptr, &val, sizeof val);
+    if (ptr != NULL) memcpy (ptr, &val, sizeof val);
 }
 
-static void writememquad (uint32_t addr, uint64_t val)
+void Machine::writememquad (uint32_t addr, uint64_t val)
 {
     void *ptr = getmemptr (addr, sizeof val, true);
-    memcpy (ptr, &val, sizeof val);
+    if (ptr != NULL) memcpy (ptr, &val, sizeof val);
 }
 
-static void writememdoub (uint32_t addr, double val)
+void Machine::writememdoub (uint32_t addr, double val)
 {
     void *ptr = getmemptr (addr, sizeof val, true);
-    memcpy (ptr, &val, sizeof val);
+    if (ptr != NULL) memcpy (ptr, &val, sizeof val);
 }
 
-static void writememflt  (uint32_t addr, float val)
+void Machine::writememflt  (uint32_t addr, float val)
 {
     void *ptr = getmemptr (addr, sizeof val, true);
-    memcpy (ptr, &val, sizeof val);
+    if (ptr != NULL) memcpy (ptr, &val, sizeof val);
 }
 
-static void *getmemptr (uint32_t addr, uint32_t size, bool write)
+// get pointer to memory for a system service to access
+//  returns NULL if bad address (-batch job is stopped)
+void *Machine::getmemptr (uint32_t addr, uint32_t size, bool write)
 {
     if (addr + size > MAGIC) {
-        fprintf (stderr, "raspictl: bad getmemptr %04X size %04X\n", addr, size);
+        fprintf (errfile, "raspictl: bad getmemptr %04X size %04X\n", addr, size);
         dumpregs ();
-        abort ();
+        fatalerr ();
+        return NULL;
     }
     if (write) {
         if ((watchwrite >= addr) && (watchwrite - addr < size)) {
-            fprintf (stderr, "raspictl: watch write addr %04X by system service\n", watchwrite);
+            fprintf (errfile, "raspictl: watch write addr %04X by system service\n", watchwrite);
             dumpregs ();
         }
         if (addr < readonlysize) {
-            fprintf (stderr, "raspictl: write address %04X below rosize %04X\n", addr, readonlysize);
+            fprintf (errfile, "raspictl: write address %04X below rosize %04X\n", addr, readonlysize);
             dumpregs ();
-            abort ();
+            fatalerr ();
+            return NULL;
         }
+        if (fastxlat != NULL) fastxlat->invalidate (addr, size);
     }
     return memory + addr;
 }
 
-static char const *getmemstr (uint32_t addr)
+// SCN_VFORMAT access to hode memory
+void *Machine::vfgetmemptr (void *param, uint32_t addr, uint32_t size, bool write)
+{
+    return ((Machine *) param)->getmemptr (addr, size, write);
+}
+
+char const *Machine::vfgetmemstr (void *param, uint32_t addr)
+{
+    return ((Machine *) param)->getmemstr (addr);
+}
+
+// charge -memcycles cycles per byte for bulk memory syscall
+// only fastcpu counts cycles itself, shadow counts whatever the cpu is doing
+void Machine::chargememcycles (uint32_t size)
+{
+    if (fastcpu != NULL) fastcpu->addcycles (size * memcycles);
+}
+
+char const *Machine::getmemstr (uint32_t addr)
 {
     uint32_t size;
     for (size = 0; addr + size < MAGIC; size ++) {
         if (memory[addr+size] == 0) return (char const *) (memory + addr);
     }
-    fprintf (stderr, "raspictl: bad getmemstr %08X at PC=%04X\n", addr, shadow.regs[7]);
-    abort ();
+    fprintf (errfile, "raspictl: bad getmemstr %08X at PC=%04X\n", addr, getregs ()[7]);
+    dumpregs ();
+    fatalerr ();
+    return "";
 }
 
 // verify CPU state and update shadow state
 // should be called just before raising clock
 //  input:
 //   sample = value just read from gpio pins
-static void shadowcheck (uint32_t sample)
+void Machine::shadowcheck (uint32_t sample)
 {
+    // count the state the cycle that is ending was in
+    if (hodestats != NULL) {
+        hsinc (&hodestats->statecounts[shadow.state], 1);
+        if (shadow.state == Shadow::IREQ1) hsinc (&hodestats->irqs, 1);
+    }
+
     // check it, abort if error
     if (shadow.check (sample)) abort ();
 
@@ -1232,8 +3625,15 @@ static void shadowcheck (uint32_t sample)
 }
 
 // signal that terminates process, do exit() so exithandler() gets called
+// if -savesnap, have runfastcpu() write snapshot at end of current instruction
+// ...unless a previous signal still hasn't been processed (maybe blocked in read())
 static void sighandler (int signum)
 {
+    if ((savesnapname != NULL) && (mainmach != NULL) && (mainmach->fastcpu != NULL) && (snapsignal == 0)) {
+        snapsignal = signum;
+        mainmach->fastcpu->stopcycle = 0;
+        return;
+    }
     fprintf (stderr, "raspictl: terminated for signal %d\n", signum);
     exit (1);
 }
@@ -1242,10 +3642,16 @@ static void sighandler (int signum)
 static void exithandler ()
 {
     // maybe turn stdin echo back on
-    if (savedtermioss.count (0) != 0) {
-        tcsetattr (0, TCSANOW, &savedtermioss[0]);
+    if (mainmach->savedtermioss.count (0) != 0) {
+        tcsetattr (0, TCSANOW, &mainmach->savedtermioss[0]);
     }
 
     // close gpio access
-    gpio->close ();
+    mainmach->gpio->close ();
+
+    // leave final counts for hodetop
+    if (hodestats != NULL) {
+        mainmach->updatestats (false);
+        __atomic_or_fetch (&hodestats->flags, HSF_EXITED, __ATOMIC_RELAXED);
+    }
 }
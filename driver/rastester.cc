@@ -22,6 +22,9 @@
  * Requires four IOW56Paddles connected to the A,C,I,D connectors.
  * sudo insmod km/enabtsc.ko
  * sudo ./rastester -cpuhz 200 -loop
+ * or on the gate-level netlist without hardware, recording test vectors for faultsim
+ *   and when each connector pin settled with propagation delays:
+ *   ./rastester -netlist rasboard.bin [-vectors rastester.vec] [-nettiming rastester.txt]
 
  * inputs to rasboard:
 
@@ -99,6 +102,9 @@ int main (int argc, char **argv)
     bool loopit = false;
     int passno = 0;
     uint32_t cpuhz = DEFCPUHZ;
+    char const *netlistname = NULL;
+    char const *vectorsname = NULL;
+    char const *nettimingname = NULL;
 
     setlinebuf (stdout);
 
@@ -115,6 +121,9 @@ int main (int argc, char **argv)
             loopit = true;
             continue;
         }
+        int rc = NetlistLib::testeropt (argc, argv, &i, &netlistname, &vectorsname, &nettimingname);
+        if (rc < 0) return 1;
+        if (rc > 0) continue;
         if (argv[i][0] == '-') {
             fprintf (stderr, "unknown option %s\n", argv[i]);
             return 1;
@@ -124,8 +133,12 @@ int main (int argc, char **argv)
     }
 
     // access rasboard circuitry via gpio and paddles
-    gpio = new PhysLib (cpuhz);
-    gpio->open ();
+    // ...or gate-level simulation of its netlist
+    gpio = NetlistLib::testeropen (netlistname, vectorsname, nettimingname);
+    if (gpio == NULL) {
+        gpio = new PhysLib (cpuhz);
+        gpio->open ();
+    }
 
     srand (0);
 
@@ -23,6 +23,9 @@
  * Can test up to all four register boards at once.
  * sudo insmod km/enabtsc.ko
  * sudo ./regtester [-cpuhz 200] [-loop] [01] [23] [45] [67]
+ * or on the gate-level netlist without hardware, recording test vectors for faultsim
+ *   and when each connector pin settled with propagation delays:
+ *   ./regtester -netlist regboard.bin [-vectors regtester.vec] [-nettiming regtester.txt] [01] [23] [45] [67]
  */
 
 #include <stdio.h>
@@ -52,6 +55,9 @@ int main (int argc, char **argv)
     bool loopit = false;
     int passno = 0;
     uint32_t cpuhz = DEFCPUHZ;
+    char const *netlistname = NULL;
+    char const *vectorsname = NULL;
+    char const *nettimingname = NULL;
 
     setlinebuf (stdout);
 
@@ -68,6 +74,9 @@ int main (int argc, char **argv)
             loopit = true;
             continue;
         }
+        int rc = NetlistLib::testeropt (argc, argv, &i, &netlistname, &vectorsname, &nettimingname);
+        if (rc < 0) return 1;
+        if (rc > 0) continue;
         if (argv[i][0] == '-') {
             fprintf (stderr, "unknown option %s\n", argv[i]);
             return 1;
@@ -84,8 +93,12 @@ int main (int argc, char **argv)
     }
 
     // access regboard circuitry via paddles
-    gpio = new PhysLib (cpuhz);
-    gpio->open ();
+    // ...or gate-level simulation of its netlist
+    gpio = NetlistLib::testeropen (netlistname, vectorsname, nettimingname);
+    if (gpio == NULL) {
+        gpio = new PhysLib (cpuhz);
+        gpio->open ();
+    }
 
     writeccon (0);
     gpio->halfcycle ();
@@ -22,6 +22,9 @@
  * Requires two IOW56Paddles connected to the C and I connectors.
  * sudo insmod km/enabtsc.ko
  * sudo ./seqtester -cpuhz 200 -loop
+ * or on the gate-level netlist without hardware, recording test vectors for faultsim
+ *   and when each connector pin settled with propagation delays:
+ *   ./seqtester -netlist seqboard.bin [-vectors seqtester.vec] [-nettiming seqtester.txt]
  */
 
 #include <errno.h>
@@ -94,6 +97,9 @@ int main (int argc, char **argv)
     int instno = 0;
     int passno = 0;
     uint32_t cpuhz = DEFCPUHZ;
+    char const *netlistname = NULL;
+    char const *vectorsname = NULL;
+    char const *nettimingname = NULL;
 
     setlinebuf (stdout);
 
@@ -110,6 +116,9 @@ int main (int argc, char **argv)
             loopit = true;
             continue;
         }
+        int rc = NetlistLib::testeropt (argc, argv, &i, &netlistname, &vectorsname, &nettimingname);
+        if (rc < 0) return 1;
+        if (rc > 0) continue;
         if (argv[i][0] == '-') {
             fprintf (stderr, "unknown option %s\n", argv[i]);
             return 1;
@@ -119,8 +128,12 @@ int main (int argc, char **argv)
     }
 
     // access seqboard circuitry via paddles
-    gpio = new PhysLib (cpuhz);
-    gpio->open ();
+    // ...or gate-level simulation of its netlist
+    gpio = NetlistLib::testeropen (netlistname, vectorsname, nettimingname);
+    if (gpio == NULL) {
+        gpio = new PhysLib (cpuhz);
+        gpio->open ();
+    }
 
     srand (0);
 
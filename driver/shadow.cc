@@ -53,6 +53,7 @@ void Shadow::reset ()
 {
     state = RESET0;
     cycle = 0;
+    insts = 0;
     fatal = false;
 }
 
@@ -127,31 +128,11 @@ bool Shadow::check (uint32_t sample)
             check_c (csb, C_IRQ | C_PSW_BT | C_MEM_WORD | C_PSW_IE);
             check_i (ir);
 
-            // things generated in module aluboard()
-            uint16_t rawshrout = asb & 1;
-            uint16_t rawshrmid = (asb >> 8) & 1;
-
-            // things generated in module psw()
-            uint16_t bnot     = (ir >> 2) & (ir >> 0) & 1;
-            uint16_t rawcin   = ((ir >> 2) & (ir >> 1) & (psw | (~ ir >> 3)) & 1) ^ bnot;
-            uint16_t rawshrin = ((asb >> 15) & 1 & ir) | (psw & 1 & (ir >> 1));
-
             // see what bits should be on the D connector
             ASSERT (D_DBUS == 0xFFFF);
-            uint32_t dsb = alu;
-            if (rawcin)      dsb |= D_RAWCIN;
-            if (rawshrin)    dsb |= D_RAWSHRIN;
-            if (rawshrout)   dsb |= D_RAWSHROUT;
-            if (rawshrmid)   dsb |= D_RAWSHRMIDI | D_RAWSHRMIDO;
-            if (rawcout > 0) dsb |= D_RAWCOUT;
-            if (rawvout > 0) dsb |= D_RAWVOUT;
-            if (rawcmid > 0) dsb |= D_RAWCMIDI | D_RAWCMIDO;
-
-            uint32_t mask = D_DBUS | D_RAWCIN | D_RAWSHRIN | D_RAWSHROUT | D_RAWSHRMIDI | D_RAWSHRMIDO;
-            if (rawcout >= 0) mask |= D_RAWCOUT;
-            if (rawvout >= 0) mask |= D_RAWVOUT;
-            if (rawcmid >= 0) mask |= D_RAWCMIDI | D_RAWCMIDO;
-            check_d (dsb, mask);
+            uint32_t mask;
+            uint32_t dsb = alu | getraws (&mask);
+            check_d (dsb, D_DBUS | mask);
 
             break;
         }
@@ -405,6 +386,7 @@ bool Shadow::clock (uint16_t mq, bool irq)
         case FETCH2: {
             regs[7] = alu;
             ir = mq;
+            insts ++;
             switch ((ir >> 13) & 7) {
                 case 0: {
                     if ((ir & 0b0001110000000001) != 0) {
@@ -811,6 +793,61 @@ uint64_t Shadow::getcycles ()
 #endif
 }
 
+uint64_t Shadow::getinsts ()
+{
+    return insts;
+}
+
+// get raw alu signals that should be on the D connector during ARITH1
+//  output:
+//   returns D_RAW... bits that should be set
+//   *mask = D_RAW... bits that are valid for the opcode
+uint32_t Shadow::getraws (uint32_t *mask)
+{
+    uint16_t asb = regs[(ir>>REGA)&7];
+
+    // things generated in module aluboard()
+    uint16_t rawshrout = asb & 1;
+    uint16_t rawshrmid = (asb >> 8) & 1;
+
+    // things generated in module psw()
+    uint16_t bnot     = (ir >> 2) & (ir >> 0) & 1;
+    uint16_t rawcin   = ((ir >> 2) & (ir >> 1) & (psw | (~ ir >> 3)) & 1) ^ bnot;
+    uint16_t rawshrin = ((asb >> 15) & 1 & ir) | (psw & 1 & (ir >> 1));
+
+    uint32_t dsb = 0;
+    if (rawcin)      dsb |= D_RAWCIN;
+    if (rawshrin)    dsb |= D_RAWSHRIN;
+    if (rawshrout)   dsb |= D_RAWSHROUT;
+    if (rawshrmid)   dsb |= D_RAWSHRMIDI | D_RAWSHRMIDO;
+    if (rawcout > 0) dsb |= D_RAWCOUT;
+    if (rawvout > 0) dsb |= D_RAWVOUT;
+    if (rawcmid > 0) dsb |= D_RAWCMIDI | D_RAWCMIDO;
+
+    *mask = D_RAWCIN | D_RAWSHRIN | D_RAWSHROUT | D_RAWSHRMIDI | D_RAWSHRMIDO;
+    if (rawcout >= 0) *mask |= D_RAWCOUT;
+    if (rawvout >= 0) *mask |= D_RAWVOUT;
+    if (rawcmid >= 0) *mask |= D_RAWCMIDI | D_RAWCMIDO;
+
+    return dsb;
+}
+
+// pick up where some other simulator left off at the end of an instruction
+//  input:
+//   newregs,newpsw = state at end of instruction
+//   newcycle,newinsts = counts at end of instruction
+//   irq = interrupt request line during last cycle of the instruction
+void Shadow::resume (uint16_t const *newregs, uint16_t newpsw, uint64_t newcycle, uint64_t newinsts, bool irq)
+{
+    memcpy (regs, newregs, sizeof regs);
+    loadPsw (newpsw);
+    cycle = newcycle;
+    insts = newinsts;
+    fatal = false;
+    state = endOfInst (irq);
+    alu   = (state == FETCH1) ? regs[7] : 0xFFFE;
+}
+
 // get what should be on GPIO connector right now, assuming hw has had time to settle in new state
 // assume GPIO connector is turned to connect data pins to ALU output
 // returns what check() is expecting
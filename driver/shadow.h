@@ -47,7 +47,12 @@ struct Shadow {
     bool check (uint32_t sample);
     bool clock (uint16_t mq, bool irq);
     uint64_t getcycles ();
+    uint64_t getinsts ();
+    uint32_t getraws (uint32_t *mask);
     uint32_t readgpio ();
+    void resume (uint16_t const *newregs, uint16_t newpsw, uint64_t newcycle, uint64_t newinsts, bool irq);
+
+    static char const *statestr (State s);
 
 private:
     bool fatal;
@@ -60,6 +65,7 @@ private:
     uint16_t newpsw;
     uint32_t samples[8];
     uint64_t cycle;
+    uint64_t insts;
 
     State endOfInst (bool irq);
     bool branchTrue ();
@@ -74,7 +80,6 @@ private:
     void check_i (uint16_t isb);
 
     static char const *boolstr (bool b);
-    static char const *statestr (State s);
 };
 
 #endif
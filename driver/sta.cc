@@ -0,0 +1,254 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+/**
+ * Static timing analysis of a netgen -netbin file.
+ * Finds worst-case arrival times from flipflop outputs and input ports
+ * to flipflop inputs and output ports, without simulating anything.
+
+    cd ../modules
+    ./master.sh -gen master -netbin master.bin
+    ../driver/sta.x86_64 -top 20 master.bin
+
+    flipflops (DFFs, DLats) are whatever cells are in feedback loops
+    ...their outputs launch paths at the -clkq time
+    ...and whatever their loops read from outside ends paths (D, T, _PC, _PS inputs)
+    ports not driven by cells (RasPi outputs, connector inputs) launch paths at time zero
+    ports driven by cells (connector outputs) end paths
+
+    each cell takes the -delays stage time plus the load time for each load on its output
+    (the loads netgen's Network.getLoads() counted), jumpers between boards take the jumper time
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <vector>
+
+#include "netlist.h"
+
+#define NOPATH 0xFFFFFFFFFFFFFFFFULL    // arrival time of nets no path reaches
+
+// a place a path ends
+struct EndPoint {
+    uint32_t net;
+    bool flipflop;          // input to flipflop (else output port)
+};
+
+static Netlist *netlist;
+static std::vector<uint64_t> arrivals;  // latest arrival time of each net (picoseconds)
+static std::vector<int32_t> preds;      // net the latest arrival came from, -1 if launched here
+static std::vector<char const *> portnames;   // name of a port on each net, NULL if none
+
+static void printpath (EndPoint const *ep, int rank);
+static char const *hierarchy (char const *netname);
+
+int main (int argc, char **argv)
+{
+    char const *netname = NULL;
+    double clkqns = 2 * DEFSTAGENS;
+    double stagens = DEFSTAGENS;
+    double loadns = DEFLOADNS;
+    double jumperns = DEFJUMPERNS;
+    int top = 10;
+
+    setlinebuf (stdout);
+
+    for (int i = 0; ++ i < argc;) {
+        if (strcasecmp (argv[i], "-clkq") == 0) {
+            if (++ i >= argc) {
+                fprintf (stderr, "-clkq missing nanoseconds\n");
+                return 1;
+            }
+            clkqns = atof (argv[i]);
+            continue;
+        }
+        if (strcasecmp (argv[i], "-delays") == 0) {
+            if ((++ i >= argc) || (sscanf (argv[i], "%lf,%lf,%lf", &stagens, &loadns, &jumperns) != 3)) {
+                fprintf (stderr, "-delays missing <stage>,<load>,<jumper>\n");
+                return 1;
+            }
+            continue;
+        }
+        if (strcasecmp (argv[i], "-top") == 0) {
+            if (++ i >= argc) {
+                fprintf (stderr, "-top missing count\n");
+                return 1;
+            }
+            top = atoi (argv[i]);
+            continue;
+        }
+        if (argv[i][0] == '-') {
+            fprintf (stderr, "unknown option %s\n", argv[i]);
+            return 1;
+        }
+        if (netname != NULL) {
+            fprintf (stderr, "unknown argument %s\n", argv[i]);
+            return 1;
+        }
+        netname = argv[i];
+    }
+    if (netname == NULL) {
+        fprintf (stderr, "usage: sta [-clkq <ns>] [-delays <stage>,<load>,<jumper>] [-top <n>] <netbinfile>\n");
+        return 1;
+    }
+
+    struct timespec started, finished;
+    if (clock_gettime (CLOCK_MONOTONIC, &started) < 0) abort ();
+
+    netlist = new Netlist ();
+    if (! netlist->load (netname)) return 1;
+    netlist->setdelays (stagens, loadns, jumperns);
+    netlist->printsummary (stdout);
+    printf ("sta: stage %.1fns + %.1fns per load, jumper %.1fns, clock-to-Q %.1fns\n", stagens, loadns, jumperns, clkqns);
+
+    uint32_t nnets = netlist->nnets;
+    portnames.resize (nnets);
+    for (uint32_t p = 0; p < netlist->nports; p ++) {
+        uint32_t n = netlist->portnet (p);
+        if (portnames[n] == NULL) portnames[n] = netlist->portname (p);
+    }
+
+    // launch paths from input ports and flipflop outputs
+    arrivals.assign (nnets, NOPATH);
+    preds.assign (nnets, -1);
+    uint32_t nportstarts = 0;
+    uint32_t nffstarts = 0;
+    for (uint32_t n = 0; n < nnets; n ++) {
+        if ((portnames[n] != NULL) && (netlist->nets[n].cell < 0) && ! (netlist->nets[n].flags & (NBN_GND | NBN_VCC))) {
+            arrivals[n] = 0;
+            nportstarts ++;
+        }
+    }
+    uint64_t clkq = (clkqns <= 0) ? 0 : (uint64_t) (clkqns * 1000.0 + 0.5);
+    for (uint32_t c = 0; c < netlist->ncells; c ++) {
+        if (netlist->cells[c].loop) {
+            arrivals[netlist->cells[c].out] = clkq;
+            nffstarts ++;
+        }
+    }
+
+    // propagate through cells not in loops
+    // they are levelized so everything a cell reads has its arrival time by the time we get to it
+    for (uint32_t c = 0; c < netlist->ncells; c ++) {
+        Netlist::Cell const *cell = &netlist->cells[c];
+        if (cell->loop) continue;
+        uint32_t beg = (cell->nprods == 0) ? cell->jumps : netlist->prods[cell->prods].ins;
+        uint64_t latest = NOPATH;
+        int32_t pred = -1;
+        for (uint32_t i = beg; i < cell->jumps + cell->njumps; i ++) {
+            uint32_t in = netlist->inputs[i];
+            if ((arrivals[in] != NOPATH) && ((latest == NOPATH) || (latest < arrivals[in]))) {
+                latest = arrivals[in];
+                pred   = in;
+            }
+        }
+        if (latest != NOPATH) {
+            arrivals[cell->out] = latest + netlist->delays[c];
+            preds[cell->out]    = pred;
+        }
+    }
+
+    // paths end at what the flipflop loops read from outside the loop and at output ports
+    std::vector<EndPoint> endpoints;
+    std::vector<bool> isend (nnets);
+    uint32_t nffends = 0;
+    for (uint32_t c = 0; c < netlist->ncells; c ++) {
+        Netlist::Cell const *cell = &netlist->cells[c];
+        if (! cell->loop) continue;
+        uint32_t beg = (cell->nprods == 0) ? cell->jumps : netlist->prods[cell->prods].ins;
+        for (uint32_t i = beg; i < cell->jumps + cell->njumps; i ++) {
+            uint32_t in = netlist->inputs[i];
+            int32_t d = netlist->nets[in].cell;
+            if (isend[in] || (arrivals[in] == NOPATH) || ((d >= 0) && (netlist->cells[d].scc == cell->scc))) continue;
+            isend[in] = true;
+            EndPoint ep;
+            ep.net = in;
+            ep.flipflop = true;
+            endpoints.push_back (ep);
+            nffends ++;
+        }
+    }
+    for (uint32_t n = 0; n < nnets; n ++) {
+        if ((portnames[n] != NULL) && ! isend[n] && (netlist->nets[n].cell >= 0) && (arrivals[n] != NOPATH)) {
+            isend[n] = true;
+            EndPoint ep;
+            ep.net = n;
+            ep.flipflop = false;
+            endpoints.push_back (ep);
+        }
+    }
+    printf ("sta: %u start points (%u flipflop outputs, %u input ports), %u end points (%u flipflop inputs, %u output ports)\n",
+        nffstarts + nportstarts, nffstarts, nportstarts, (uint32_t) endpoints.size (), nffends, (uint32_t) endpoints.size () - nffends);
+
+    // latest arriving first, ties by net number so the report is the same everywhere
+    std::sort (endpoints.begin (), endpoints.end (), [] (EndPoint const &a, EndPoint const &b) {
+        if (arrivals[a.net] != arrivals[b.net]) return arrivals[a.net] > arrivals[b.net];
+        return a.net < b.net;
+    });
+
+    if (clock_gettime (CLOCK_MONOTONIC, &finished) < 0) abort ();
+    printf ("sta: analyzed in %.3f sec\n",
+        (finished.tv_sec - started.tv_sec) + (finished.tv_nsec - started.tv_nsec) / 1000000000.0);
+
+    for (int i = 0; (i < top) && (i < (int) endpoints.size ()); i ++) {
+        printpath (&endpoints[i], i + 1);
+    }
+    return 0;
+}
+
+// print path leading to an end point, start point first
+static void printpath (EndPoint const *ep, int rank)
+{
+    if (ep->flipflop) {
+        printf ("\n%3d: %.1fns to flipflop input %s\n", rank, arrivals[ep->net] / 1000.0, netlist->nets[ep->net].name);
+    } else {
+        printf ("\n%3d: %.1fns to output port %s\n", rank, arrivals[ep->net] / 1000.0, portnames[ep->net]);
+    }
+
+    std::vector<uint32_t> path;
+    for (int32_t n = ep->net; n >= 0; n = preds[n]) path.push_back (n);
+
+    printf ("    arrival     incr  hierarchy                 net\n");
+    uint64_t prev = 0;
+    for (uint32_t j = path.size (); j > 0;) {
+        uint32_t n = path[--j];
+        char const *name = netlist->nets[n].name;
+        char const *what = "";
+        if (j == path.size () - 1) {
+            int32_t c = netlist->nets[n].cell;
+            what = ((c >= 0) && netlist->cells[c].loop) ? "  (flipflop)" : "  (input port)";
+        }
+        if ((j == 0) && ! ep->flipflop) {
+            what = "  (output port)";
+        }
+        printf ("  %7.1fns %+7.1fns  %-24s  %s%s\n", arrivals[n] / 1000.0, (arrivals[n] - prev) / 1000.0, hierarchy (name), name, what);
+        prev = arrivals[n];
+    }
+}
+
+// get module hierarchy of a net, ie, the instance names after the first slash, outermost last
+static char const *hierarchy (char const *netname)
+{
+    char const *slash = strchr (netname, '/');
+    return (slash == NULL) ? "top" : slash + 1;
+}
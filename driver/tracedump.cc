@@ -0,0 +1,243 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// decode trace file written by raspictl -trace
+//  ./tracedump [-map <mapfile>] [-pc <lo>[-<hi>]] ... [-sym <name>] ... <tracefile>
+//      -map : symbolize addresses using link.c .map file
+//      -pc  : only print instructions in the given hex address range (inclusive)
+//      -sym : only print instructions within the given function (requires -map)
+//  prints one line per instruction:
+//      cycle count, pc, opcode, disassembly, registers and psw changed, memory written
+//  ...then totals
+
+#include <algorithm>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "disassemble.h"
+#include "fastcpu.h"
+#include "tracer.h"
+
+struct Symbol {
+    uint16_t addr;
+    std::string name;
+    bool operator< (Symbol const &that) const { return addr < that.addr; }
+};
+
+struct Range {
+    uint16_t lo, hi;
+};
+
+static std::vector<Symbol> symbols;
+
+static bool readmap (char const *mapname);
+static std::string symbolize (uint16_t addr);
+
+int main (int argc, char **argv)
+{
+    char const *mapname = NULL;
+    char const *tracename = NULL;
+    std::vector<Range> ranges;
+    std::vector<char const *> symnames;
+
+    for (int i = 0; ++ i < argc;) {
+        if (strcasecmp (argv[i], "-map") == 0) {
+            if (++ i >= argc) {
+                fprintf (stderr, "tracedump: missing filename after -map\n");
+                return 1;
+            }
+            mapname = argv[i];
+            continue;
+        }
+        if (strcasecmp (argv[i], "-pc") == 0) {
+            if (++ i >= argc) {
+                fprintf (stderr, "tracedump: missing range after -pc\n");
+                return 1;
+            }
+            char *p;
+            Range range;
+            range.lo = range.hi = strtoul (argv[i], &p, 16);
+            if (*p == '-') range.hi = strtoul (p + 1, &p, 16);
+            if ((*p != 0) || (range.hi < range.lo)) {
+                fprintf (stderr, "tracedump: bad -pc range %s\n", argv[i]);
+                return 1;
+            }
+            ranges.push_back (range);
+            continue;
+        }
+        if (strcasecmp (argv[i], "-sym") == 0) {
+            if (++ i >= argc) {
+                fprintf (stderr, "tracedump: missing name after -sym\n");
+                return 1;
+            }
+            symnames.push_back (argv[i]);
+            continue;
+        }
+        if ((argv[i][0] == '-') || (tracename != NULL)) {
+            fprintf (stderr, "tracedump: unknown argument %s\n", argv[i]);
+            return 1;
+        }
+        tracename = argv[i];
+    }
+    if (tracename == NULL) {
+        fprintf (stderr, "usage: tracedump [-map <mapfile>] [-pc <lo>[-<hi>]] ... [-sym <name>] ... <tracefile>\n");
+        return 1;
+    }
+    if ((mapname != NULL) && ! readmap (mapname)) return 1;
+
+    // each -sym goes from its address up to the next symbol
+    for (std::vector<char const *>::iterator it = symnames.begin (); it != symnames.end (); it ++) {
+        if (mapname == NULL) {
+            fprintf (stderr, "tracedump: -sym requires -map\n");
+            return 1;
+        }
+        size_t i;
+        for (i = 0; i < symbols.size (); i ++) {
+            if (symbols[i].name == *it) break;
+        }
+        if (i >= symbols.size ()) {
+            fprintf (stderr, "tracedump: symbol %s not found in %s\n", *it, mapname);
+            return 1;
+        }
+        Range range;
+        range.lo = symbols[i].addr;
+        range.hi = (i + 1 < symbols.size ()) ? symbols[i+1].addr - 1 : 0xFFFF;
+        ranges.push_back (range);
+    }
+
+    TraceReader reader;
+    if (! reader.open (tracename)) return 1;
+
+    char const **disasms = (char const **) calloc (0x10000, sizeof *disasms);
+    if (disasms == NULL) abort ();
+
+    int rc;
+    TraceRec rec;
+    uint64_t endcycle = 0;
+    uint64_t ninsts = 0;
+    uint64_t nirqs = 0;
+    while ((rc = reader.next (&rec)) > 0) {
+        endcycle = rec.cycle + rec.cycles;
+        if (rec.irq) nirqs ++;
+        else ninsts ++;
+
+        if (! ranges.empty ()) {
+            if (rec.irq) continue;
+            std::vector<Range>::iterator it;
+            for (it = ranges.begin (); it != ranges.end (); it ++) {
+                if ((rec.pc >= it->lo) && (rec.pc <= it->hi)) break;
+            }
+            if (it == ranges.end ()) continue;
+        }
+
+        // what the instruction did
+        char effects[128];
+        effects[0] = 0;
+        int len = 0;
+        for (int i = 0; i < 7; i ++) {
+            if (rec.regmask & (1 << i)) len += sprintf (effects + len, " R%d=%04X", i, rec.regs[i]);
+        }
+        if (rec.pswchanged) len += sprintf (effects + len, " PS=%04X", rec.psw);
+        for (int i = 0; i < rec.nwrites; i ++) {
+            len += sprintf (effects + len, " %04X<=%0*X", rec.wraddr[i], rec.wrword[i] ? 4 : 2, rec.wrdata[i]);
+        }
+        if (rec.cycles != (rec.irq ? FC_IREQ : tracestdcycles (rec.ir))) {
+            len += sprintf (effects + len, " (%u cycles)", rec.cycles);
+        }
+
+        printf ("%12llu  %04X", (unsigned long long) rec.cycle, rec.pc);
+        if (! symbols.empty ()) printf ("  %-24s", symbolize (rec.pc).c_str ());
+        if (rec.irq) {
+            printf ("  %-24s", "**INTERRUPT**");
+        } else {
+            if (disasms[rec.ir] == NULL) {
+                disasms[rec.ir] = strdup (disassemble (rec.ir).c_str ());
+            }
+            printf ("  %04X  %-16s", rec.ir, disasms[rec.ir]);
+        }
+        printf ("%s\n", effects);
+    }
+
+    printf ("tracedump: %llu instrs; %llu interrupts; %llu cycles\n",
+        (unsigned long long) ninsts, (unsigned long long) nirqs, (unsigned long long) endcycle);
+    return (rc < 0) ? 1 : 0;
+}
+
+// read symbols from link.c .map file
+//  each symbol is listed twice: 'addr name objfile' lines with two or one symbols per line
+static bool readmap (char const *mapname)
+{
+    FILE *mapfile = fopen (mapname, "r");
+    if (mapfile == NULL) {
+        fprintf (stderr, "tracedump: error opening %s: %m\n", mapname);
+        return false;
+    }
+
+    char line[4096];
+    while (fgets (line, sizeof line, mapfile) != NULL) {
+        char *toks[8];
+        int ntoks = 0;
+        for (char *p = strtok (line, " \t\n"); (p != NULL) && (ntoks < 8); p = strtok (NULL, " \t\n")) {
+            toks[ntoks++] = p;
+        }
+        if ((ntoks != 3) && (ntoks != 6)) continue;
+        for (int i = 0; i < ntoks; i += 3) {
+            char *p;
+            uint32_t addr = strtoul (toks[i], &p, 16);
+            if ((strlen (toks[i]) != 4) || (*p != 0)) break;
+            strtoul (toks[i+1], &p, 16);
+            if ((strlen (toks[i+1]) == 4) && (*p == 0)) break;
+            Symbol sym;
+            sym.addr = addr;
+            sym.name = toks[i+1];
+            symbols.push_back (sym);
+        }
+    }
+    fclose (mapfile);
+
+    // keep the first name seen at each address
+    std::stable_sort (symbols.begin (), symbols.end ());
+    std::vector<Symbol> uniques;
+    for (std::vector<Symbol>::iterator it = symbols.begin (); it != symbols.end (); it ++) {
+        if (uniques.empty () || (uniques.back ().addr != it->addr)) uniques.push_back (*it);
+    }
+    symbols = uniques;
+    return true;
+}
+
+// get symbol+offset for an address
+static std::string symbolize (uint16_t addr)
+{
+    char buf[16];
+    Symbol key;
+    key.addr = addr;
+    std::vector<Symbol>::iterator it = std::upper_bound (symbols.begin (), symbols.end (), key);
+    if (it == symbols.begin ()) {
+        sprintf (buf, "%04X", addr);
+        return buf;
+    }
+    -- it;
+    if (it->addr == addr) return it->name;
+    sprintf (buf, "+%04X", addr - it->addr);
+    return it->name + buf;
+}
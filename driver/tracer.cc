@@ -0,0 +1,441 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+
+// compact binary instruction trace for raspictl -trace and tracedump
+// fastcpu calls instr() at the beginning of every instruction
+// ...which writes the previous instruction's record now that its effects are known
+// the file starts with a header giving the initial pc, registers, psw and cycle count
+// ...then each record holds just what a reader can't figure out from that state:
+//  tag byte: TT_INSN | flags
+//  opcode (2 bytes)
+//  pc delta, only if it didn't fall through from the previous instruction
+//  cycle count, only if not the normal number for the opcode (halted, etc)
+//  new psw, only if changed
+//  new register values, only those that changed
+// memory writes are not written at all, the reader computes them from the registers
+// ...as it does the psw and pc pushed by an interrupt
+// an interrupt record has a pc delta only if it interrupted a jump
+// all numbers are little endian
+// the file is mapped a chunk at a time so records written before raspictl crashes are kept
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "fastcpu.h"
+#include "tracer.h"
+
+#define TRACE_CHUNK (64 << 20)  // how much of file to map at a time
+#define TRACE_HDRSZ 34          // magic, pc, R0..R6, psw, cycle
+
+// number of cycles the opcode takes when not halted
+uint32_t tracestdcycles (uint16_t ir)
+{
+    switch ((ir >> 13) & 7) {
+        case 0: {
+            if (ir & 0x1C01) return FC_BCC;
+            switch ((ir >> 1) & 7) {
+                case 0: return FC_HALT;
+                case 1: return FC_IRET;
+                case 2: return FC_WRPS;
+                case 3: return FC_RDPS;
+            }
+            return 0;
+        }
+        case 1: return FC_ARITH;
+        case 2:
+        case 3: return FC_STORE;
+        case 4: return FC_LDA;
+    }
+    return (tracefallthru (0, ir) == 4) ? FC_LOADI : FC_LOAD;
+}
+
+// where the instruction goes if it doesn't jump, ie, skip over immediate operand
+uint16_t tracefallthru (uint16_t pc, uint16_t ir)
+{
+    bool imm = (ir >= 0xA000) && ((ir & 0x7F) == 0) && (((ir >> REGA) & 7) == 7) && (((ir >> REGD) & 7) != 7);
+    return pc + (imm ? 4 : 2);
+}
+
+static int putvarint (uint8_t *p, uint64_t v)
+{
+    int n = 0;
+    while (v >= 0x80) {
+        p[n++] = (uint8_t) (v | 0x80);
+        v >>= 7;
+    }
+    p[n++] = (uint8_t) v;
+    return n;
+}
+
+// zig-zag encode so small backward jumps are small numbers too
+static int putpcdelta (uint8_t *p, int16_t delta)
+{
+    return putvarint (p, (uint16_t) ((delta << 1) ^ (delta >> 15)));
+}
+
+static int putword (uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t) v;
+    p[1] = (uint8_t) (v >> 8);
+    return 2;
+}
+
+
+Tracer::Tracer ()
+{
+    fd = -1;
+    mapped = NULL;
+    mapoffs = 0;
+    filepos = 0;
+    started = false;
+    pending = false;
+}
+
+bool Tracer::open (char const *name)
+{
+    fd = ::open (name, O_RDWR | O_CREAT | O_TRUNC, 0666);
+    if (fd < 0) {
+        fprintf (stderr, "raspictl: error creating %s: %m\n", name);
+        return false;
+    }
+    return true;
+}
+
+// fastcpu is about to execute an instruction
+// write the previous one's record now that we know what it did
+void Tracer::instr (uint16_t pc, uint16_t ir, uint16_t const *regs, uint16_t psw, uint64_t cycle)
+{
+    if (! started) header (pc, regs, psw, cycle);
+    if (pending) finish (regs, psw, cycle);
+    pending   = true;
+    pendpc    = pc;
+    pendir    = ir;
+    pendcycle = cycle;
+}
+
+// fastcpu is about to take an interrupt
+void Tracer::interrupt (uint16_t const *regs, uint16_t psw, uint64_t cycle)
+{
+    if (! started) header (regs[7], regs, psw, cycle);
+    if (pending) finish (regs, psw, cycle);
+    uint8_t *p = room (4);
+    p[0] = TT_IRQ;
+    int n = 1;
+    if (regs[7] != nextpc) {
+        p[0] |= TT_PCDLT;
+        n    += putpcdelta (p + 1, regs[7] - nextpc);
+    }
+    filepos  += n;
+    lastpsw   = psw & 0x7FFF;
+    nextpc    = 2;
+}
+
+// done tracing, write last instruction and trim file to what was written
+void Tracer::close (uint16_t const *regs, uint16_t psw, uint64_t cycle)
+{
+    if (fd < 0) return;
+    if (! started) header (regs[7], regs, psw, cycle);
+    if (pending) finish (regs, psw, cycle);
+    *room (1) = TT_END;
+    filepos  += 1;
+    munmap (mapped, TRACE_CHUNK);
+    mapped = NULL;
+    if (ftruncate (fd, filepos) < 0) {
+        fprintf (stderr, "raspictl: error truncating trace file: %m\n");
+    }
+    ::close (fd);
+    fd = -1;
+}
+
+void Tracer::header (uint16_t pc, uint16_t const *regs, uint16_t psw, uint64_t cycle)
+{
+    uint8_t *p = room (TRACE_HDRSZ);
+    memcpy (p, TRACE_MAGIC, 8);
+    p += 8;
+    p += putword (p, pc);
+    for (int i = 0; i < 7; i ++) {
+        p += putword (p, regs[i]);
+    }
+    p += putword (p, psw);
+    for (int i = 0; i < 8; i ++) {
+        *(p ++) = (uint8_t) (cycle >> (i * 8));
+    }
+    filepos += TRACE_HDRSZ;
+
+    memcpy (lastregs, regs, sizeof lastregs);
+    lastpsw = psw;
+    nextpc  = pc;
+    started = true;
+}
+
+// write the pending instruction's record given the state just after it finished
+void Tracer::finish (uint16_t const *regs, uint16_t psw, uint64_t cycle)
+{
+    uint8_t *p = room (40);
+    uint8_t *q = p + 3;
+    uint8_t tag = TT_INSN;
+
+    if (pendpc != nextpc) {
+        tag |= TT_PCDLT;
+        q   += putpcdelta (q, pendpc - nextpc);
+    }
+    uint64_t cycles = cycle - pendcycle;
+    if (cycles != tracestdcycles (pendir)) {
+        tag |= TT_CYCS;
+        q   += putvarint (q, cycles);
+    }
+    if (psw != lastpsw) {
+        tag |= TT_PSW;
+        q   += putword (q, psw);
+        lastpsw = psw;
+    }
+
+    uint8_t mask = 0;
+    int nregs = 0;
+    int lastreg = 0;
+    for (int i = 0; i < 7; i ++) {
+        if (regs[i] != lastregs[i]) {
+            mask |= 1 << i;
+            nregs ++;
+            lastreg = i;
+        }
+    }
+    if (nregs == 1) {
+        tag |= (lastreg + 1) << 4;
+    } else if (nregs > 1) {
+        tag |= TT_REGS;
+        *(q ++) = mask;
+    }
+    for (int i = 0; i < 7; i ++) {
+        if (mask & (1 << i)) {
+            q += putword (q, regs[i]);
+            lastregs[i] = regs[i];
+        }
+    }
+
+    p[0] = tag;
+    putword (p + 1, pendir);
+    filepos += q - p;
+    nextpc   = tracefallthru (pendpc, pendir);
+    pending  = false;
+}
+
+// get pointer to where the next nbytes go in the file, mapping more if needed
+uint8_t *Tracer::room (int nbytes)
+{
+    if ((mapped == NULL) || (filepos + nbytes > mapoffs + TRACE_CHUNK)) {
+        if (mapped != NULL) munmap (mapped, TRACE_CHUNK);
+        mapoffs = filepos & - (uint64_t) sysconf (_SC_PAGESIZE);
+        if (ftruncate (fd, mapoffs + TRACE_CHUNK) < 0) {
+            fprintf (stderr, "raspictl: error extending trace file: %m\n");
+            abort ();
+        }
+        mapped = (uint8_t *) mmap (NULL, TRACE_CHUNK, PROT_READ | PROT_WRITE, MAP_SHARED, fd, mapoffs);
+        if (mapped == MAP_FAILED) {
+            fprintf (stderr, "raspictl: error mapping trace file: %m\n");
+            abort ();
+        }
+    }
+    return mapped + (filepos - mapoffs);
+}
+
+
+TraceReader::TraceReader ()
+{
+    mapped   = NULL;
+    filesize = 0;
+    filepos  = 0;
+    filename = NULL;
+    overrun  = false;
+}
+
+TraceReader::~TraceReader ()
+{
+    if (mapped != NULL) munmap ((void *) mapped, filesize);
+}
+
+bool TraceReader::open (char const *name)
+{
+    filename = name;
+    int fd = ::open (name, O_RDONLY);
+    if (fd < 0) {
+        fprintf (stderr, "tracedump: error opening %s: %m\n", name);
+        return false;
+    }
+    struct stat statbuf;
+    if (fstat (fd, &statbuf) < 0) abort ();
+    filesize = statbuf.st_size;
+    if (filesize < TRACE_HDRSZ) {
+        fprintf (stderr, "tracedump: %s too short for a trace file\n", name);
+        ::close (fd);
+        return false;
+    }
+    mapped = (uint8_t const *) mmap (NULL, filesize, PROT_READ, MAP_SHARED, fd, 0);
+    ::close (fd);
+    if (mapped == MAP_FAILED) {
+        fprintf (stderr, "tracedump: error mapping %s: %m\n", name);
+        mapped = NULL;
+        return false;
+    }
+    if (memcmp (mapped, TRACE_MAGIC, 8) != 0) {
+        fprintf (stderr, "tracedump: %s is not a trace file\n", name);
+        return false;
+    }
+
+    filepos = 8;
+    nextpc  = getword ();
+    for (int i = 0; i < 7; i ++) {
+        regs[i] = getword ();
+    }
+    psw   = getword ();
+    cycle = 0;
+    for (int i = 0; i < 8; i ++) {
+        cycle |= (uint64_t) mapped[filepos++] << (i * 8);
+    }
+    return true;
+}
+
+// decode next record from trace file
+//  output:
+//   returns 1: *rec filled in
+//           0: end of trace
+//          -1: trace is truncated or corrupt
+int TraceReader::next (TraceRec *rec)
+{
+    if (filepos >= filesize) {
+        fprintf (stderr, "tracedump: %s truncated\n", filename);
+        return -1;
+    }
+
+    uint8_t tag = mapped[filepos++];
+    switch (tag) {
+        case TT_PAD: {
+            fprintf (stderr, "tracedump: %s truncated\n", filename);
+            return -1;
+        }
+        case TT_IRQ:
+        case TT_IRQ | TT_PCDLT: {
+            if (tag & TT_PCDLT) nextpc += getpcdelta ();
+            memset (rec, 0, sizeof *rec);
+            rec->irq        = true;
+            rec->pc         = nextpc;
+            rec->cycle      = cycle;
+            rec->cycles     = FC_IREQ;
+            rec->nwrites    = 2;
+            rec->wrword[0]  = true;
+            rec->wraddr[0]  = 0xFFFE;
+            rec->wrdata[0]  = psw;
+            rec->wrword[1]  = true;
+            rec->wraddr[1]  = 0xFFFC;
+            rec->wrdata[1]  = nextpc;
+            rec->pswchanged = (psw & 0x8000) != 0;
+            psw            &= 0x7FFF;
+            nextpc          = 2;
+            cycle          += FC_IREQ;
+            memcpy (rec->regs, regs, sizeof rec->regs);
+            rec->psw        = psw;
+            return 1;
+        }
+        case TT_END: return 0;
+    }
+    if (! (tag & TT_INSN) || ((tag & TT_REGS) && (tag & TT_REG1))) {
+        fprintf (stderr, "tracedump: %s bad tag %02X at %llu\n", filename, tag, (unsigned long long) filepos - 1);
+        return -1;
+    }
+    rec->irq    = false;
+    rec->ir     = getword ();
+    rec->pc     = nextpc;
+    if (tag & TT_PCDLT) rec->pc += getpcdelta ();
+    rec->cycle  = cycle;
+    rec->cycles = (tag & TT_CYCS) ? getvarint () : tracestdcycles (rec->ir);
+
+    // stores write what's in the registers before the instruction
+    // ...with pc already incremented over the opcode
+    rec->nwrites = 0;
+    if ((rec->ir & 0xC000) == 0x4000) {
+        regs[7] = rec->pc + 2;
+        bool word = ! (rec->ir & 0x2000);
+        uint16_t offs = ((rec->ir & 0x7F) ^ 0x40) - 0x40;
+        rec->nwrites   = 1;
+        rec->wrword[0] = word;
+        rec->wraddr[0] = regs[(rec->ir>>REGA)&7] + offs;
+        rec->wrdata[0] = regs[(rec->ir>>REGD)&7] & (word ? 0xFFFF : 0x00FF);
+    }
+
+    rec->pswchanged = (tag & TT_PSW) != 0;
+    if (rec->pswchanged) psw = getword ();
+
+    uint8_t mask = 0;
+    if (tag & TT_REGS) mask = (filepos < filesize) ? mapped[filepos++] : 0;
+    if (tag & TT_REG1) mask = 1 << (((tag & TT_REG1) >> 4) - 1);
+    for (int i = 0; i < 7; i ++) {
+        if (mask & (1 << i)) regs[i] = getword ();
+    }
+    rec->regmask = mask;
+    memcpy (rec->regs, regs, sizeof rec->regs);
+    rec->psw = psw;
+    if (overrun) {
+        fprintf (stderr, "tracedump: %s truncated\n", filename);
+        return -1;
+    }
+
+    nextpc = tracefallthru (rec->pc, rec->ir);
+    cycle += rec->cycles;
+    return 1;
+}
+
+uint64_t TraceReader::getvarint ()
+{
+    uint64_t v = 0;
+    for (int shift = 0;; shift += 7) {
+        if (filepos >= filesize) {
+            overrun = true;
+            break;
+        }
+        uint8_t b = mapped[filepos++];
+        v |= (uint64_t) (b & 0x7F) << shift;
+        if (! (b & 0x80)) break;
+    }
+    return v;
+}
+
+uint16_t TraceReader::getpcdelta ()
+{
+    uint16_t zz = getvarint ();
+    return (zz >> 1) ^ - (zz & 1);
+}
+
+uint16_t TraceReader::getword ()
+{
+    if (filepos + 2 > filesize) {
+        filepos = filesize;
+        overrun = true;
+        return 0;
+    }
+    uint16_t v = mapped[filepos] | (mapped[filepos+1] << 8);
+    filepos += 2;
+    return v;
+}
@@ -0,0 +1,111 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+#ifndef _TRACER_H
+#define _TRACER_H
+
+#include "miscdefs.h"
+
+#define TRACE_MAGIC "HODETRC1"
+
+// trace file tag bytes
+#define TT_PAD   0x00   // never written, rest of file was never filled in (raspictl crashed)
+#define TT_END   0x02   // raspictl closed the trace normally
+#define TT_IRQ   0x10   // interrupt taken, with TT_PCDLT flag
+#define TT_INSN  0x80   // instruction, with these flags:
+#define TT_PCDLT 0x01   //   zig-zag varint pc delta from where previous instruction would fall through to
+#define TT_CYCS  0x02   //   varint cycle count, else the normal number for the opcode
+#define TT_PSW   0x04   //   psw changed, new value follows
+#define TT_REGS  0x08   //   several registers changed, mask byte and new values follow
+#define TT_REG1  0x70   //   one register changed, 1+register number, new value follows
+
+// writes trace file as fastcpu executes instructions (raspictl -trace)
+struct Tracer {
+    Tracer ();
+    bool open (char const *name);
+    void instr (uint16_t pc, uint16_t ir, uint16_t const *regs, uint16_t psw, uint64_t cycle);
+    void interrupt (uint16_t const *regs, uint16_t psw, uint64_t cycle);
+    void close (uint16_t const *regs, uint16_t psw, uint64_t cycle);
+
+private:
+    int fd;
+    uint8_t *mapped;            // chunk of file currently mapped
+    uint64_t mapoffs;           // file offset of mapped chunk
+    uint64_t filepos;           // file offset of next byte to write
+    bool started;               // header has been written
+    bool pending;               // instruction started but effects not yet written
+
+    uint16_t pendpc;            // instruction started but effects not yet written
+    uint16_t pendir;
+    uint64_t pendcycle;
+
+    uint16_t lastregs[7];       // registers, psw as of last written record
+    uint16_t lastpsw;
+    uint16_t nextpc;            // where last written instruction falls through to
+
+    void header (uint16_t pc, uint16_t const *regs, uint16_t psw, uint64_t cycle);
+    void finish (uint16_t const *regs, uint16_t psw, uint64_t cycle);
+    uint8_t *room (int nbytes);
+};
+
+// one decoded trace record
+struct TraceRec {
+    bool irq;                   // interrupt taken (pc,ir not valid)
+    uint16_t pc;                // address of instruction
+    uint16_t ir;                // opcode
+    uint64_t cycle;             // cycle count at start of instruction
+    uint32_t cycles;            // number of cycles it took
+    uint8_t regmask;            // which of R0..R6 it changed
+    bool pswchanged;            // it changed psw
+    uint16_t regs[7];           // registers after instruction
+    uint16_t psw;               // psw after instruction
+    int nwrites;                // number of memory writes
+    bool wrword[2];             // memory writes done by instruction or interrupt
+    uint16_t wraddr[2];
+    uint16_t wrdata[2];
+};
+
+// reads trace file written by Tracer (tracedump)
+struct TraceReader {
+    TraceReader ();
+    ~TraceReader ();
+    bool open (char const *name);
+    int next (TraceRec *rec);
+
+private:
+    uint8_t const *mapped;
+    uint64_t filesize;
+    uint64_t filepos;
+    char const *filename;
+    bool overrun;               // tried to read past end of file
+
+    uint16_t regs[8];
+    uint16_t psw;
+    uint16_t nextpc;
+    uint64_t cycle;
+
+    uint64_t getvarint ();
+    uint16_t getpcdelta ();
+    uint16_t getword ();
+};
+
+uint32_t tracestdcycles (uint16_t ir);
+uint16_t tracefallthru (uint16_t pc, uint16_t ir);
+
+#endif
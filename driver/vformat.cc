@@ -0,0 +1,568 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+// formats printf() strings for the SCN_VFORMAT system call
+// output matches crtl/library/vfprintf.c and vfprintf_fp.c so programs print the same either way
+// ...hode memory is accessed through the getmemptr(), getmemstr() callbacks
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "vformat.h"
+
+// format string the same as crtl/library/vfprintf.c and vfprintf_fp.c
+//  input:
+//   fmtaddr = format string in hode memory
+//   ap = first argument in hode memory
+//  output:
+//   returns false: something vfprintf.c would assert() on
+//            true: out = formatted string
+bool VFormat::format (uint16_t fmtaddr)
+{
+    char fc, ncb[32];
+    char const *fp, *sp;
+    uint16_t spaddr;
+
+    for (fp = getmemstr (memparam, fmtaddr); (fc = *fp) != 0;) {
+        if (fc != '%') {
+            sp = strchr (fp, '%');
+            int i = (sp == NULL) ? strlen (fp) : sp - fp;
+            putst (i, fp);
+            fp += i;
+            continue;
+        }
+
+        altform   = false;
+        zeropad   = false;
+        leftjust  = false;
+        posblank  = false;
+        plussign  = false;
+        minwidth  = 0;
+        precision = -1;
+        intsize   = 2;
+        fltsize   = 4;
+
+        fp ++;
+
+        // hode int is 16 bits, long is 32, long long is 64, pointers are 16
+        while ((fc = *fp) != 0) {
+            fp ++;
+            switch (fc) {
+                case '#': altform = true; break;
+                case '0': if (! leftjust) zeropad = true; break;
+                case '-': leftjust = true; zeropad = false; break;
+                case ' ': if (! plussign) posblank = true; break;
+                case '+': plussign = true; posblank = false; break;
+                case '1': case '2': case '3': case '4': case '5':
+                case '6': case '7': case '8': case '9':
+                case '*': -- fp; fp = getfmtint (fp, &minwidth); break;
+                case '.': fp = getfmtint (fp, &precision); break;
+                case 'h': intsize  = 2; fltsize = 4; break;
+                case 'l': intsize += intsize; fltsize = 8; break;
+                case 'B': intsize  = 1; break;
+                case 'L': intsize  = 4; fltsize = 4; break;
+                case 'P': intsize  = 2; break;
+                case 'Q': intsize  = 8; fltsize = 8; break;
+                case 'W': intsize  = 2; break;
+                default: goto gotfinal;
+            }
+        }
+    gotfinal:
+
+        char *ncp = ncb + sizeof ncb - 1;
+        *ncp = 0;
+        switch (fc) {
+            case 'c': {
+                fc = readmembyte (vaarg (1, 1));
+                if (! leftjust) putfc (minwidth - 1, ' ');
+                putch (fc);
+                putfc (minwidth, ' ');
+                break;
+            }
+
+            case 's':
+            case 'S': {
+                spaddr = readmemword (vaarg (2, 2));
+                sp = (spaddr == 0) ? "(nil)" : getmemstr (memparam, spaddr);
+                int i = (sint16_t) strlen (sp);
+                if ((precision < 0) || (precision > i)) precision = i;
+                if (! leftjust) putfc (minwidth - precision, ' ');
+                if (fc == 's') putst (precision, sp);
+                else {
+                    while ((precision > 0) && ((fc = *(sp ++)) != 0)) {
+                        precision --;
+                        if ((fc == 0x7F) || (fc & 0x80) || (fc < ' ')) fc = '.';
+                        putch (fc);
+                    }
+                }
+                putfc (minwidth, ' ');
+                break;
+            }
+
+            case 'd':
+            case 'i': {
+                if (! getsnum ()) return false;
+                do {
+                    *(-- ncp) = (char) (unum % 10) + '0';
+                    unum /= 10;
+                } while (unum != 0);
+                putint (ncp, "");
+                break;
+            }
+
+            case 'o': {
+                if (! getunum ()) return false;
+                do {
+                    *(-- ncp) = (char) (unum & 7) + '0';
+                    unum >>= 3;
+                } while (unum != 0);
+                putint (ncp, "0");
+                break;
+            }
+
+            case 'u': {
+                if (! getunum ()) return false;
+                do {
+                    *(-- ncp) = (char) (unum % 10) + '0';
+                    unum /= 10;
+                } while (unum != 0);
+                putint (ncp, "");
+                break;
+            }
+
+            case 'x':
+            case 'X': {
+                if (! getunum ()) return false;
+                do {
+                    *(-- ncp) = ((fc == 'x') ? "0123456789abcdef" : "0123456789ABCDEF")[unum&15];
+                    unum >>= 4;
+                } while (unum != 0);
+                putint (ncp, (fc == 'x') ? "0x" : "0X");
+                break;
+            }
+
+            case 'A':
+            case 'E':
+            case 'F':
+            case 'G':
+            case 'a':
+            case 'e':
+            case 'f':
+            case 'g': {
+                formatfp (fc);
+                break;
+            }
+
+            case 'p': {
+                unum = readmemword (vaarg (2, 2));
+                negative = false;
+                do {
+                    *(-- ncp) = "0123456789abcdef"[unum&15];
+                    unum /= 16;
+                } while (unum != 0);
+                altform = true;
+                putint (ncp, "0x");
+                break;
+            }
+
+            case 'n': {
+                uint16_t a = readmemword (vaarg (2, 2));
+                if (intsize == 4) writememlong (a, out.size ());
+                else {
+                    uint16_t n = out.size ();
+                    void *ptr = getmemptr (memparam, a, 2, true);
+                    if (ptr == NULL) return false;
+                    memcpy (ptr, &n, 2);
+                }
+                break;
+            }
+
+            default: {
+                putch (fc);
+                break;
+            }
+        }
+    }
+
+    return true;
+}
+
+// floating point conversions, same as vfprintf_fp.c
+void VFormat::formatfp (char fc)
+{
+    int i, numsize;
+
+    switch (fc) {
+        case 'G':
+        case 'g': {
+            if (! getfnum (true)) goto infnan;
+            if (precision < 0) precision = 6;
+            if (precision == 0) precision = 1;
+            roundflt (precision - 1);
+            if ((expon < -4) || (expon >= precision)) {
+                -- precision;
+                fc -= 'g' - 'e';
+                goto format_e;
+            }
+            precision -= expon + 1;
+            goto format_f;
+        }
+
+        case 'E':
+        case 'e': {
+            if (! getfnum (true)) goto infnan;
+            if (precision < 0) precision = 6;
+            roundflt (precision);
+            goto format_e;
+        }
+
+        case 'F':
+        case 'f': {
+            if (! getfnum (true)) goto infnan;
+            if (precision < 0) precision = 6;
+            roundflt (precision + expon);
+            goto format_f;
+        }
+
+        case 'A':
+        case 'a': {
+            if (! getfnum (false)) goto infnan;
+            putsign ();
+            putch ('0');
+            putch ('x');
+            uint64_t u;
+            memcpy (&u, &fnum, sizeof u);
+            int exp = (u >> 52) & 0x7FF;
+            putch ('0' + (exp != 0));
+            unsigned int i, j;
+            for (j = 0; j < 12; j ++) {
+                if (((u >> (j * 4)) & 15) != 0) break;
+            }
+            i = 13;
+            if (exp == 0) {
+                exp = 1;
+                do {
+                    unsigned int k = i - 1;
+                    unsigned int d = (u >> (k * 4)) & 15;
+                    if (d != 0) break;
+                    exp -= 4;
+                    i = k;
+                } while (i > j);
+            }
+            if (i > j) {
+                putch ('.');
+                do {
+                    -- i;
+                    unsigned int d = (u >> (i * 4)) & 15;
+                    putch ((d < 10) ? '0' + d : fc + d - 10);
+                } while (i > j);
+            }
+            putch ('p');
+            exp -= 1023;
+            if (exp < 0) {
+                putch ('-');
+                exp = - exp;
+            }
+            char buf[4];
+            i = 4;
+            do {
+                buf[--i] = exp % 10 + '0';
+                exp /= 10;
+            } while (exp > 0);
+            putst (4 - i, buf + i);
+            return;
+        }
+    }
+
+infnan:
+    i = strlen (nfe);
+    if ((precision < 0) || (precision > i)) precision = i;
+    if (! leftjust) putfc (minwidth - precision, ' ');
+    putst (precision, nfe);
+    putfc (minwidth, ' ');
+    return;
+
+format_e:
+    numsize = precision;
+    if ((numsize > 0) || altform) numsize ++;
+    numsize ++;
+    if (negative || plussign || posblank) numsize ++;
+    numsize += 3;
+    if ((expon < -99) || (expon > 99)) numsize ++;
+    if ((expon < 0) || plussign || posblank) numsize ++;
+    if (! leftjust && ! zeropad) putfc (minwidth - numsize, ' ');
+    putsign ();
+    if (! leftjust && zeropad) putfc (minwidth - numsize, '0');
+    i = (int) fnum;
+    putch ((char) i + '0');
+    if (altform || (precision > 0)) putch ('.');
+    while (precision > 0) {
+        fnum -= i;
+        fnum *= 10.0;
+        -- precision;
+        i = (int) fnum;
+        putch ((char) i + '0');
+    }
+    putch (fc);
+    negative = (expon < 0);
+    if (negative) expon = - expon;
+    putsign ();
+    if (expon > 99) putch ((char) (expon / 100) + '0');
+    putch (((expon / 10) % 10) + '0');
+    putch ((expon % 10) + '0');
+    putfc (minwidth, ' ');
+    return;
+
+format_f:
+    numsize = precision;
+    if ((numsize > 0) || altform) numsize ++;
+    numsize ++;
+    if (expon > 0) numsize += expon;
+    if (negative || plussign || posblank) numsize ++;
+    if (! leftjust && ! zeropad) putfc (minwidth - numsize, ' ');
+    putsign ();
+    if (! leftjust && zeropad) putfc (minwidth - numsize, '0');
+    if (expon < 0) putch ('0');
+    else do {
+        i = (int) fnum;
+        putch ((char) i + '0');
+        fnum = (fnum - i) * 10.0;
+    } while (-- expon >= 0);
+    if (altform || (precision > 0)) {
+        putch ('.');
+        while (-- precision >= 0) {
+            if (++ expon < 0) i = 0;
+            else {
+                i = (int) fnum;
+                fnum = (fnum - i) * 10.0;
+            }
+            putch ((char) i + '0');
+        }
+    }
+    putfc (minwidth, ' ');
+}
+
+// get address of next argument, same as stdarg.h va_arg()
+uint16_t VFormat::vaarg (uint16_t size, uint16_t alin)
+{
+    uint16_t ptr = (ap + alin - 1) & - alin;
+    ap = ptr + size;
+    return ptr;
+}
+
+// get unsigned integer into unum
+bool VFormat::getunum ()
+{
+    switch (intsize) {
+        case 1: unum = readmembyte (vaarg (1, 1)); break;
+        case 2: unum = readmemword (vaarg (2, 2)); break;
+        case 4: unum = readmemlong (vaarg (4, 2)); break;
+        case 8: unum = readmemquad (vaarg (8, 2)); break;
+        default: return false;
+    }
+    negative = false;
+    return true;
+}
+
+// get signed integer into unum with sign in negative
+bool VFormat::getsnum ()
+{
+    int64_t snum;
+    switch (intsize) {
+        case 1: snum = (int8_t) readmembyte (vaarg (1, 1)); break;
+        case 2: snum = (int16_t) readmemword (vaarg (2, 2)); break;
+        case 4: snum = (int32_t) readmemlong (vaarg (4, 2)); break;
+        case 8: snum = (int64_t) readmemquad (vaarg (8, 2)); break;
+        default: return false;
+    }
+    negative = (snum < 0);
+    unum = negative ? - (uint64_t) snum : snum;
+    return true;
+}
+
+// get floating point into fnum and expon, fnum normalized 1.0 <= fnum < 10.0 if scale
+// returns false with nfe set if inf or nan
+bool VFormat::getfnum (bool scale)
+{
+    if (fltsize == 4) {
+        float flt = readmemflt (vaarg (4, 2));
+        if (isnan (flt)) {
+            nfe = "nan";
+            return false;
+        }
+        if (isinf (flt)) {
+            nfe = (flt < 0.0) ? "-inf" : plussign ? "+inf" : posblank ? " inf" : "inf";
+            return false;
+        }
+        fnum = flt;
+    } else {
+        fnum = readmemdoub (vaarg (8, 2));
+        if (isnan (fnum)) {
+            nfe = "nan";
+            return false;
+        }
+        if (isinf (fnum)) {
+            nfe = (fnum < 0.0) ? "-inf" : plussign ? "+inf" : posblank ? " inf" : "inf";
+            return false;
+        }
+    }
+    negative = (fnum < 0.0);
+    if (negative) fnum = - fnum;
+    expon = 0;
+    if (scale && (fnum > 0.0)) {
+        while (fnum < 1.0) {
+            fnum *= 10.0;
+            expon --;
+        }
+        while (fnum >= 10.0) {
+            fnum /= 10.0;
+            expon ++;
+        }
+    }
+    return true;
+}
+
+// round fnum to the given number of digits
+void VFormat::roundflt (int prec)
+{
+    double roundfact = 0.5;
+    while (-- prec >= 0) roundfact /= 10.0;
+    fnum += roundfact;
+    if (fnum >= 10.0) {
+        fnum = 1.0;
+        expon ++;
+    }
+}
+
+// get width or precision from format string or next int argument if '*'
+char const *VFormat::getfmtint (char const *fp, int *fi_r)
+{
+    if (*fp == '*') {
+        *fi_r = (int16_t) readmemword (vaarg (2, 2));
+        return fp + 1;
+    }
+    char *ep;
+    *fi_r = (int16_t) strtoul (fp, &ep, 10);
+    return ep;
+}
+
+// put the integer digits, optionally prepending the alternate string and padding as required
+void VFormat::putint (char const *digs, char const *alt)
+{
+    int numdigs    = strlen (digs);
+    int signneeded = negative || plussign || posblank;
+    int altneeded  = altform ? strlen (alt) : 0;
+    int numzeroes  = (numdigs < precision) ? precision - numdigs : 0;
+
+    if (! leftjust && ! zeropad) putfc (minwidth - (signneeded + altneeded + numzeroes + numdigs), ' ');
+    putsign ();
+    putst (altneeded, alt);
+    if (! leftjust && zeropad) putfc (minwidth - (numzeroes + numdigs), '0');
+    putfc (numzeroes, '0');
+    putst (numdigs, digs);
+    putfc (minwidth, ' ');
+}
+
+void VFormat::putsign ()
+{
+    if (negative) putch ('-');
+    else if (plussign) putch ('+');
+    else if (posblank) putch (' ');
+}
+
+void VFormat::putfc (int s, char c)
+{
+    if (s > 0) {
+        minwidth -= s;
+        out.append (s, c);
+    }
+}
+
+void VFormat::putst (int s, char const *b)
+{
+    if (s > 0) {
+        minwidth -= s;
+        out.append (b, s);
+    }
+}
+
+void VFormat::putch (char c)
+{
+    minwidth --;
+    out.push_back (c);
+}
+
+uint8_t VFormat::readmembyte (uint32_t addr)
+{
+    uint8_t const *ptr = (uint8_t const *) getmemptr (memparam, addr, 1, false);
+    return (ptr == NULL) ? 0 : *ptr;
+}
+
+uint16_t VFormat::readmemword (uint32_t addr)
+{
+    uint16_t val;
+    void *ptr = getmemptr (memparam, addr, sizeof val, false);
+    if (ptr == NULL) return 0;
+    memcpy (&val, ptr, sizeof val);
+    return val;
+}
+
+uint32_t VFormat::readmemlong (uint32_t addr)
+{
+    uint32_t val;
+    void *ptr = getmemptr (memparam, addr, sizeof val, false);
+    if (ptr == NULL) return 0;
+    memcpy (&val, ptr, sizeof val);
+    return val;
+}
+
+uint64_t VFormat::readmemquad (uint32_t addr)
+{
+    uint64_t val;
+    void *ptr = getmemptr (memparam, addr, sizeof val, false);
+    if (ptr == NULL) return 0;
+    memcpy (&val, ptr, sizeof val);
+    return val;
+}
+
+double VFormat::readmemdoub (uint32_t addr)
+{
+    double val;
+    void *ptr = getmemptr (memparam, addr, sizeof val, false);
+    if (ptr == NULL) return 0;
+    memcpy (&val, ptr, sizeof val);
+    return val;
+}
+
+float VFormat::readmemflt (uint32_t addr)
+{
+    float val;
+    void *ptr = getmemptr (memparam, addr, sizeof val, false);
+    if (ptr == NULL) return 0;
+    memcpy (&val, ptr, sizeof val);
+    return val;
+}
+
+void VFormat::writememlong (uint32_t addr, uint32_t val)
+{
+    void *ptr = getmemptr (memparam, addr, sizeof val, true);
+    if (ptr != NULL) memcpy (ptr, &val, sizeof val);
+}
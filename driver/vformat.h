@@ -0,0 +1,76 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+#ifndef _VFORMAT_H
+#define _VFORMAT_H
+
+#include <stdint.h>
+#include <string>
+
+// state of one SCN_VFORMAT call, same as crtl/library/vfprintf.c Par
+// works the same as vfprintf.c so output matches whichever does the formatting
+struct VFormat {
+    typedef void *GetMemPtr (void *param, uint32_t addr, uint32_t size, bool write);
+    typedef char const *GetMemStr (void *param, uint32_t addr);
+
+    GetMemPtr *getmemptr;       // get pointer to hode memory, NULL if bad address
+    GetMemStr *getmemstr;       // get null terminated string in hode memory
+    void *memparam;             // passed to getmemptr, getmemstr
+    std::string out;            // output so far
+    uint16_t ap;                // next argument in hode memory
+    int minwidth;               // mininum output field width
+    int precision;              // number of decimal places to output
+    bool negative;              // number being output requires a '-' sign
+    bool altform;               // output it in alternative format
+    bool zeropad;               // right justify, zero fill
+    bool leftjust;              // left justify, blank fill
+    bool posblank;              // if positive, output a space for the sign
+    bool plussign;              // if positive, output a '+' for the sign
+    int intsize;                // integer size: 1=Byte, 2=Word, 4=Long, 8=Quad
+    int fltsize;                // float size: 4=float, 8=double
+    uint64_t unum;
+    double fnum;
+    int expon;
+    char const *nfe;            // "inf" or "nan"
+
+    bool format (uint16_t fmtaddr);
+
+private:
+    uint8_t  readmembyte (uint32_t addr);
+    uint16_t readmemword (uint32_t addr);
+    uint32_t readmemlong (uint32_t addr);
+    uint64_t readmemquad (uint32_t addr);
+    double   readmemdoub (uint32_t addr);
+    float    readmemflt  (uint32_t addr);
+    void writememlong (uint32_t addr, uint32_t val);
+    uint16_t vaarg (uint16_t size, uint16_t alin);
+    bool getunum ();
+    bool getsnum ();
+    bool getfnum (bool scale);
+    void roundflt (int prec);
+    char const *getfmtint (char const *fp, int *fi_r);
+    void formatfp (char fc);
+    void putint (char const *digs, char const *alt);
+    void putsign ();
+    void putfc (int s, char c);
+    void putst (int s, char const *b);
+    void putch (char c);
+};
+
+#endif
@@ -43,6 +43,7 @@ public class GenCtx {
     public HashMap<String,WiredAnd>  wiredands; // all wired ands (combine networks)
     public int topgap;                          // in addition to TOPSIDE
     public LinkedList<Comp>          conncol;
+    public LinkedList<RasPiModule>   raspis;    // raspi modules whose circuitry has been generated
     public OldNetFile                oldnetfile;
 
     public final static int RIGHTSIDE   = 183;  // 10th inch
@@ -60,6 +61,7 @@ public class GenCtx {
         netclasses   = new HashMap<> ();
         placeables   = new HashMap<> ();
         predrawables = new ArrayList<> ();
+        raspis       = new LinkedList<> ();
         prewiregrids = new HashMap<> ();
         wiredands    = new HashMap<> ();
 
@@ -0,0 +1,283 @@
+//    Copyright (C) Mike Rieker, Beverly, MA USA
+//    www.outerworldapps.com
+//
+//    This program is free software; you can redistribute it and/or modify
+//    it under the terms of the GNU General Public License as published by
+//    the Free Software Foundation; version 2 of the License.
+//
+//    This program is distributed in the hope that it will be useful,
+//    but WITHOUT ANY WARRANTY; without even the implied warranty of
+//    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//    GNU General Public License for more details.
+//
+//    EXPECT it to FAIL when someone's HeALTh or PROpeRTy is at RISk.
+//
+//    You should have received a copy of the GNU General Public License
+//    along with this program; if not, write to the Free Software
+//    Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+//
+//    http://www.gnu.org/licenses/gpl-2.0.html
+/**
+ * Write flattened component-level netlist in binary for the driver's netlist simulator.
+ * Layout must match ../driver/netbin.h.
+ */
+
+import java.io.FileOutputStream;
+import java.nio.ByteBuffer;
+import java.nio.ByteOrder;
+import java.nio.charset.StandardCharsets;
+import java.util.ArrayList;
+import java.util.HashMap;
+import java.util.TreeMap;
+import java.util.TreeSet;
+
+public class NetBin {
+    public final static String MAGIC = "HODENET1";
+
+    public final static int NBN_GND = 1;
+    public final static int NBN_VCC = 2;
+
+    public final static int NBK_NPN    = 1;
+    public final static int NBK_PNP    = 2;
+    public final static int NBK_NFET   = 3;
+    public final static int NBK_DIODE  = 4;
+    public final static int NBK_LED    = 5;
+    public final static int NBK_RESIS  = 6;
+    public final static int NBK_CAPAC  = 7;
+    public final static int NBK_JUMPER = 8;
+
+    public final static int NBP_NONE = 0xFFFFFFFF;
+
+    private final static int HDRSIZE  = 48;
+    private final static int NETSIZE  = 8;
+    private final static int COMPSIZE = 16;
+    private final static int PORTSIZE = 8;
+
+    private GenCtx genctx;
+    private HashMap<String,Integer> netindices;
+    private HashMap<String,Integer> stroffsets;
+    private ArrayList<String> strings;
+    private int strsize;
+
+    // write the generated circuit to the given file
+    //  input:
+    //   name   = file to write
+    //   genctx = circuit as generated from genmod
+    //   genmod = top-level module that was generated
+    public static void write (String name, GenCtx genctx, Module genmod)
+            throws Exception
+    {
+        new NetBin (genctx).writeFile (name, genmod);
+    }
+
+    private NetBin (GenCtx genctx)
+    {
+        this.genctx = genctx;
+        netindices  = new HashMap<> ();
+        stroffsets  = new HashMap<> ();
+        strings     = new ArrayList<> ();
+    }
+
+    private void writeFile (String name, Module genmod)
+            throws Exception
+    {
+        // jumpers between boards only exist in the simulator, so get networks of what drives them
+        // - connector output pins are already generated so this normally finds existing networks
+        // - done first in case it generates something new
+        TreeMap<String,Network[]> jumpers = new TreeMap<> ();
+        for (OpndLhs var : genmod.variables.values ()) {
+            if (var instanceof ConnModule.IPinOutput) {
+                ConnModule.IPinOutput ipin = (ConnModule.IPinOutput) var;
+                if ((ipin.pinnet != null) && (ipin.jumpers != null)) {
+                    Network[] jnets = new Network[ipin.jumpers.length+1];
+                    jnets[0] = ipin.pinnet;
+                    for (int i = 0; i < ipin.jumpers.length; i ++) {
+                        jnets[i+1] = ipin.jumpers[i].generate (genctx, 0);
+                    }
+                    jumpers.put (ipin.name, jnets);
+                }
+            }
+        }
+
+        // top-level module's pins
+        // - input pins only exist when generating a module by itself for testing, eg, -gen alueight
+        // - done before getting net names in case it generates something new
+        TreeMap<String,Network> ports = new TreeMap<> ();
+        for (OpndLhs param : genmod.params) {
+            int bw = param.busWidth ();
+            for (int rbit = 0; rbit < bw; rbit ++) {
+                String portname = (param.hidim > param.lodim) ? param.name + "[" + (param.lodim + rbit) + "]" : param.name;
+                ports.put (portname, param.generate (genctx, rbit));
+            }
+        }
+
+        // one entry per merged network, ie, wired-and subnets all become the one wired-and network
+        TreeSet<String> netnames = genctx.getMergedNetNames ();
+        String[] netarray = netnames.toArray (new String[0]);
+        for (int i = 0; i < netarray.length; i ++) {
+            netindices.put (netarray[i], i);
+        }
+        int[] netloads = new int[netarray.length];
+        for (Network net : genctx.nets.values ()) {
+            netloads[netIndex(net)] += net.getLoads ();
+        }
+
+        // components that make up the logic, connectors become ports
+        ArrayList<Comp> comps = new ArrayList<> ();
+        ArrayList<String[]> comppins = new ArrayList<> ();
+        int npins = 0;
+        for (String compname : new TreeSet<> (genctx.comps.keySet ())) {
+            Comp comp = genctx.comps.get (compname);
+            String[] pinos = getPinNumbers (comp);
+            if (pinos != null) {
+                comps.add (comp);
+                comppins.add (pinos);
+                npins += pinos.length;
+            }
+        }
+        for (Network[] jnets : jumpers.values ()) {
+            npins += jnets.length;
+        }
+        for (Network net : genctx.nets.values ()) {
+            for (Network.Conn conn : net.connections) {
+                if (conn.comp instanceof Comp.Conn) {
+                    ports.put (conn.comp.name + "." + conn.pino, net);
+                }
+            }
+        }
+
+        // raspberry pi's cpu-side signals
+        for (RasPiModule raspi : genctx.raspis) {
+            raspi.getNetBinPorts (ports);
+        }
+
+        // lay the file out
+        int netoffs  = HDRSIZE;
+        int ncomps   = comps.size () + jumpers.size ();
+        int compoffs = netoffs  + netarray.length * NETSIZE;
+        int pinoffs  = compoffs + ncomps * COMPSIZE;
+        int portoffs = pinoffs  + npins * 4;
+        int stroffs  = portoffs + ports.size () * PORTSIZE;
+
+        ByteBuffer bb = ByteBuffer.allocate (stroffs);
+        bb.order (ByteOrder.LITTLE_ENDIAN);
+        bb.put (MAGIC.getBytes (StandardCharsets.US_ASCII));
+        bb.putInt (netarray.length);
+        bb.putInt (ncomps);
+        bb.putInt (npins);
+        bb.putInt (ports.size ());
+        bb.putInt (netoffs);
+        bb.putInt (compoffs);
+        bb.putInt (pinoffs);
+        bb.putInt (portoffs);
+        bb.putInt (stroffs);
+        int strsizepos = bb.position ();
+        bb.putInt (0);
+
+        for (int i = 0; i < netarray.length; i ++) {
+            String netname = netarray[i];
+            bb.putInt (stringOffset (netname));
+            bb.putShort ((short) Math.min (netloads[i], 0xFFFF));
+            bb.putShort ((short) (netname.equals ("GND") ? NBN_GND : netname.equals ("VCC") ? NBN_VCC : 0));
+        }
+
+        int pinindex = 0;
+        for (int i = 0; i < comps.size (); i ++) {
+            Comp comp = comps.get (i);
+            String[] pinos = comppins.get (i);
+            bb.putInt (stringOffset (comp.name));
+            bb.putInt (stringOffset (comp.value));
+            bb.putInt (pinindex);
+            bb.put ((byte) getKind (comp));
+            bb.put ((byte) pinos.length);
+            bb.putShort ((short) 0);
+            pinindex += pinos.length;
+        }
+        for (String jname : jumpers.keySet ()) {
+            Network[] jnets = jumpers.get (jname);
+            bb.putInt (stringOffset (jname));
+            bb.putInt (stringOffset ("jumper"));
+            bb.putInt (pinindex);
+            bb.put ((byte) NBK_JUMPER);
+            bb.put ((byte) jnets.length);
+            bb.putShort ((short) 0);
+            pinindex += jnets.length;
+        }
+
+        for (int i = 0; i < comps.size (); i ++) {
+            Comp comp = comps.get (i);
+            for (String pino : comppins.get (i)) {
+                Network net = comp.getPinNetwork (pino);
+                bb.putInt ((net == null) ? NBP_NONE : netIndex (net));
+            }
+        }
+        for (Network[] jnets : jumpers.values ()) {
+            for (Network net : jnets) {
+                bb.putInt (netIndex (net));
+            }
+        }
+
+        for (String portname : ports.keySet ()) {
+            bb.putInt (stringOffset (portname));
+            bb.putInt (netIndex (ports.get (portname)));
+        }
+
+        bb.putInt (strsizepos, strsize);
+
+        FileOutputStream fos = new FileOutputStream (name);
+        try {
+            fos.write (bb.array ());
+            for (String s : strings) {
+                fos.write (s.getBytes (StandardCharsets.US_ASCII));
+                fos.write (0);
+            }
+        } finally {
+            fos.close ();
+        }
+    }
+
+    // get index of merged network the given network is part of
+    private int netIndex (Network net)
+    {
+        return netindices.get (genctx.getWiredAndNetworkName (net.name));
+    }
+
+    // get offset of string in the string table, adding it if not already there
+    private int stringOffset (String s)
+    {
+        Integer offs = stroffsets.get (s);
+        if (offs == null) {
+            offs = strsize;
+            stroffsets.put (s, offs);
+            strings.add (s);
+            strsize += s.getBytes (StandardCharsets.US_ASCII).length + 1;
+        }
+        return offs;
+    }
+
+    // get pin numbers in the order given by netbin.h
+    // null if component is not part of the logic (Comp.Conn, Comp.Hole, Comp.ByCap)
+    // Comp.Capac, eg, ConnModule's pwrcap capacitor, goes in as NBK_CAPAC, the simulator ignores it
+    private static String[] getPinNumbers (Comp comp)
+    {
+        if (comp instanceof Comp.Trans) return new String[] { Comp.Trans.PIN_E, Comp.Trans.PIN_B, Comp.Trans.PIN_C };
+        if (comp instanceof Comp.Diode) return new String[] { Comp.Diode.PIN_A, Comp.Diode.PIN_C };
+        if (comp instanceof Comp.SmLed) return new String[] { Comp.SmLed.PIN_A, Comp.SmLed.PIN_C };
+        if (comp instanceof Comp.Resis) return new String[] { Comp.Resis.PIN_A, Comp.Resis.PIN_C };
+        if (comp instanceof Comp.Capac) return new String[] { Comp.Capac.PIN_P, Comp.Capac.PIN_N };
+        return null;
+    }
+
+    private static int getKind (Comp comp)
+    {
+        if (comp instanceof Comp.Trans) {
+            if (comp.value.equals ("2N3906")) return NBK_PNP;
+            if (comp.value.equals ("2N7000")) return NBK_NFET;
+            return NBK_NPN;
+        }
+        if (comp instanceof Comp.Diode) return NBK_DIODE;
+        if (comp instanceof Comp.SmLed) return NBK_LED;
+        if (comp instanceof Comp.Resis) return NBK_RESIS;
+        return NBK_CAPAC;
+    }
+}
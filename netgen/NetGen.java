@@ -58,6 +58,7 @@ public class NetGen {
         LinkedList<String> modfns = new LinkedList<> ();
         String genname = null;
         String mapname = null;
+        String netbinname = null;
         String netname = null;
         String pcbname = null;
         String propname = null;
@@ -94,6 +95,13 @@ public class NetGen {
                 netname = args[i];
                 continue;
             }
+            if (arg.equals ("-netbin")) {
+                if ((++ i >= args.length) || args[i].startsWith ("-")) {
+                    throw new Exception ("missing file name after -netbin");
+                }
+                netbinname = args[i];
+                continue;
+            }
             if (arg.equals ("-pcb")) {
                 if ((++ i >= args.length) || args[i].startsWith ("-")) {
                     throw new Exception ("missing file name after -pcb");
@@ -155,8 +163,8 @@ public class NetGen {
         if (modfns.isEmpty ()) {
             throw new Exception ("no module files specified");
         }
-        if (((netname != null) || (pcbname != null) || (repname != null) || (resname != null)) && (genname == null)) {
-            throw new Exception ("must specify -gen module when giving -net, -pcb, -report, -resist");
+        if (((netname != null) || (netbinname != null) || (pcbname != null) || (repname != null) || (resname != null)) && (genname == null)) {
+            throw new Exception ("must specify -gen module when giving -net, -netbin, -pcb, -report, -resist");
         }
 
         starttime = System.currentTimeMillis ();
@@ -251,6 +259,11 @@ public class NetGen {
             ps.close ();
         }
 
+        // output binary netlist file for driver's netlist simulator
+        if (netbinname != null) {
+            NetBin.write (netbinname, genctx, genmod);
+        }
+
         // output circuit board file
         if (pcbname != null) {
             PrintStream ps = new PrintStream (pcbname);
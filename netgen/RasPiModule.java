@@ -25,6 +25,7 @@
 
 import java.io.IOException;
 import java.io.PrintStream;
+import java.util.TreeMap;
 
 public class RasPiModule extends Module {
     public final static int CLKNS = 1000;
@@ -342,11 +343,30 @@ public class RasPiModule extends Module {
         }
     }
 
+    // get cpu-side networks of the level converters for netgen -netbin
+    // the netlist simulator drives and samples these directly like the simulator's examine and force do
+    public void getNetBinPorts (TreeMap<String,Network> ports)
+    {
+        ports.put (name + ".clk",    clkcpunet);
+        ports.put (name + ".reset",  rescpunet);
+        ports.put (name + ".irq",    irqcpunet);
+        ports.put (name + ".mread",  mreadcpunet);
+        ports.put (name + ".mwrite", mwritecpunet);
+        ports.put (name + ".mword",  mwordcpunet);
+        ports.put (name + ".halt",   haltcpunet);
+        ports.put (name + ".v33",    v33net);
+        for (int i = 0; i < nbits; i ++) {
+            ports.put (name + ".mq[" + i + "]", mqcpunets[i]);
+            ports.put (name + ".md[" + i + "]", mdcpunets[i]);
+        }
+    }
+
     // generate circuitry, ie, connector and level converters, for the raspberry pi
     // connect networks to its pins
     private void getCircuit (GenCtx genctx)
     {
         if (mqcpunets == null) {
+            genctx.raspis.add (this);
 
             // connectors and holes always go in lower right corner of board
             moduleleftx = genctx.boardwidth - NetGen.CORNER10THS - 25;